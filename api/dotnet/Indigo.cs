@@ -123,6 +123,18 @@ namespace com.epam.indigo
             checkResult(_indigo_lib.indigoDbgResetProfiling(whole_session ? 1 : 0));
         }
 
+        public long dbgProfilingGetCounter (string name, bool whole_session)
+        {
+            setSessionID();
+            return checkResult(_indigo_lib.indigoDbgProfilingGetCounter(name, whole_session ? 1 : 0));
+        }
+
+        public string dbgProfilingJson (bool whole_session)
+        {
+            setSessionID();
+            return checkResult(_indigo_lib.indigoDbgProfilingJson(whole_session ? 1 : 0));
+        }
+
         private static int strLen(sbyte* input)
         {
             int res = 0;
@@ -247,6 +259,16 @@ namespace com.epam.indigo
             return result;
         }
 
+        public long checkResult(long result)
+        {
+            if (result < 0)
+            {
+                throw new IndigoException(_sbyteToStringUTF8(_indigo_lib.indigoGetLastError()));
+            }
+
+            return result;
+        }
+
         public string checkResult(sbyte* result)
         {
             if (result == null)
@@ -643,6 +665,12 @@ namespace com.epam.indigo
             return new IndigoObject(this, checkResult(_indigo_lib.indigoCreateArray()));
         }
 
+        public IndigoObject createQuerySet()
+        {
+            setSessionID();
+            return new IndigoObject(this, checkResult(_indigo_lib.indigoCreateQuerySet()));
+        }
+
         public float similarity(IndigoObject obj1, IndigoObject obj2)
         {
             return similarity(obj1, obj2, "");
@@ -811,6 +839,25 @@ namespace com.epam.indigo
             return new IndigoObject(this, checkResult(_indigo_lib.indigoReactionProductEnumerate(reaction.self, indigoArrayArray.self)));
         }
 
+        public IndigoObject iterateEnumeratedProducts(IndigoObject reaction, IndigoObject monomers)
+        {
+            setSessionID();
+            return new IndigoObject(this, checkResult(_indigo_lib.indigoIterateEnumeratedProducts(reaction.self, monomers.self)), reaction);
+        }
+
+        public IndigoObject sparseFingerprints(IndigoObject molecules)
+        {
+            return sparseFingerprints(molecules, "");
+        }
+
+        public IndigoObject sparseFingerprints(IndigoObject molecules, string type)
+        {
+            setSessionID();
+            if (type == null)
+                type = "";
+            return new IndigoObject(this, checkResult(_indigo_lib.indigoSparseFingerprints(molecules.self, type)));
+        }
+
         public IndigoObject createSaver(IndigoObject output, string format)
         {
             setSessionID();
@@ -329,6 +329,7 @@ namespace com.epam.indigo
         int indigoFoldHydrogens(int item);
         int indigoUnfoldHydrogens(int item);
         int indigoLayout(int item);
+        sbyte* indigoLayoutBatch(int objects, int threads, int per_item_timeout_ms);
         int indigoClean2d (int item);
         sbyte* indigoSmiles(int item);
         sbyte* indigoSmarts(int item);
@@ -359,6 +360,10 @@ namespace com.epam.indigo
         int indigoCountBits(int fingerprint);
         int indigoCommonBits(int fingerprint1, int fingerprint2);
         float indigoSimilarity(int molecule1, int molecule2, string metrics);
+        int indigoSparseFingerprint(int molecule, string type);
+        int indigoFoldFingerprint(int sparse_fingerprint, int bits);
+        int indigoSparseFingerprints(int molecules, string type);
+        int indigoSparseFingerprintsCSR(int fingerprints, int* rows, int* nnz, int** indptr, uint** hashes, int** counts);
 
         int indigoIterateSDF(int reader);
         int indigoIterateRDF(int reader);
@@ -393,6 +398,9 @@ namespace com.epam.indigo
         int indigoUnignoreAllAtoms(int matcher);
         int indigoMatch(int matcher, int query);
         int indigoCountMatches(int matcher, int query);
+        int indigoCreateQuerySet();
+        int indigoQuerySetAdd(int query_set, int query);
+        int* indigoQuerySetMatch(int query_set, int target, int* count);
         int indigoCountMatchesWithLimit(int matcher, int query, int embeddings_limit);
         int indigoIterateMatches(int matcher, int query);
         int indigoHighlightedTarget(int match);
@@ -425,6 +433,7 @@ namespace com.epam.indigo
         int* indigoSymmetryClasses(int molecule, int* size);
 
         int indigoReactionProductEnumerate(int reaction, int monomers);
+        int indigoIterateEnumeratedProducts(int reaction, int monomers);
         int indigoTransform(int reaction, int monomers);
 
         int indigoExpandAbbreviations (int structure);
@@ -437,6 +446,8 @@ namespace com.epam.indigo
         sbyte* indigoDbgInternalType(int item);
         sbyte* indigoDbgProfiling (int whole_sessoin);
         int indigoDbgResetProfiling (int whole_sessoin);
+        long indigoDbgProfilingGetCounter (string name, int whole_session);
+        sbyte* indigoDbgProfilingJson (int whole_session);
         int indigoDbgBreakpoint ();
     }
 }
@@ -1509,6 +1509,12 @@ namespace com.epam.indigo
             dispatcher.checkResult(_indigo_lib.indigoLayout(self));
         }
 
+        public string layoutBatch(int threads, int timeout)
+        {
+            dispatcher.setSessionID();
+            return dispatcher.checkResult(_indigo_lib.indigoLayoutBatch(self, threads, timeout));
+        }
+
         public void clean2d()
         {
             dispatcher.setSessionID();
@@ -1639,6 +1645,46 @@ namespace com.epam.indigo
             return dispatcher.checkResult(_indigo_lib.indigoCountBits(self));
         }
 
+        public IndigoObject sparseFingerprint()
+        {
+            return sparseFingerprint("");
+        }
+
+        public IndigoObject sparseFingerprint(string type)
+        {
+            if (type == null)
+                type = "";
+            dispatcher.setSessionID();
+            return new IndigoObject(dispatcher, dispatcher.checkResult(_indigo_lib.indigoSparseFingerprint(self, type)));
+        }
+
+        public IndigoObject foldFingerprint(int bits)
+        {
+            dispatcher.setSessionID();
+            return new IndigoObject(dispatcher, dispatcher.checkResult(_indigo_lib.indigoFoldFingerprint(self, bits)));
+        }
+
+        public void sparseFingerprintsCSR(out int[] indptr, out uint[] hashes, out int[] counts)
+        {
+            dispatcher.setSessionID();
+            int rows, nnz;
+            int* indptr_ptr;
+            uint* hashes_ptr;
+            int* counts_ptr;
+            dispatcher.checkResult(_indigo_lib.indigoSparseFingerprintsCSR(self, &rows, &nnz, &indptr_ptr, &hashes_ptr, &counts_ptr));
+
+            indptr = new int[rows + 1];
+            hashes = new uint[nnz];
+            counts = new int[nnz];
+            for (int i = 0; i <= rows; ++i)
+                indptr[i] = indptr_ptr[i];
+            for (int i = 0; i < nnz; ++i)
+            {
+                hashes[i] = hashes_ptr[i];
+                counts[i] = counts_ptr[i];
+            }
+        }
+
         public string rawData()
         {
             dispatcher.setSessionID();
@@ -1757,6 +1803,24 @@ namespace com.epam.indigo
             return dispatcher.checkResult(_indigo_lib.indigoCountMatches(self, query.self));
         }
 
+        public int querySetAdd(IndigoObject query)
+        {
+            dispatcher.setSessionID();
+            return dispatcher.checkResult(_indigo_lib.indigoQuerySetAdd(self, query.self));
+        }
+
+        public int[] querySetMatch(IndigoObject target)
+        {
+            dispatcher.setSessionID();
+            int count;
+            int* ids = dispatcher.checkResult(_indigo_lib.indigoQuerySetMatch(self, target.self, &count));
+
+            int[] res = new int[count];
+            for (int i = 0; i < count; ++i)
+                res[i] = ids[i];
+            return res;
+        }
+
         public int countMatchesWithLimit(IndigoObject query, int embeddings_limit)
         {
             dispatcher.setSessionID();
@@ -684,6 +684,14 @@ CEXPORT int indigoUnfoldHydrogens (int item);
 CEXPORT int indigoLayout(int object);
 CEXPORT int indigoClean2d(int object);
 
+// Lays out the molecules and reactions of the array in the given number of
+// threads (0 means the number of processors). The smart layout of an item
+// that takes more than per_item_timeout_ms (0 means the "timeout" option)
+// is replaced by the fast one. Returns a JSON array with an entry per item:
+// [{"status": "ok", "time": 0.01}, {"status": "fallback", "time": 0.5, "message": "..."}, ...]
+// Status is "ok", "fallback" or "error", time is in seconds.
+CEXPORT const char * indigoLayoutBatch (int objects, int threads, int per_item_timeout_ms);
+
 CEXPORT const char * indigoSmiles (int item);
 CEXPORT const char * indigoSmarts (int item);
 CEXPORT const char * indigoCanonicalSmarts (int item);
@@ -780,11 +788,34 @@ CEXPORT int indigoLoadFingerprintFromBuffer(const byte *buffer, int size);
 // Constructs a 'fingerprint' object from a normalized array of double descriptors
 CEXPORT int indigoLoadFingerprintFromDescriptors(const double *arr, int arr_len, int size, double density);
 
-// Accepts two molecules, two reactions, or two fingerprints.
-// Returns the similarity measure between them.
-// Metrics: "tanimoto", "tversky", "tversky <alpha> <beta>", "euclid-sub" or "normalized-edit"
+// Returns a 'sparse fingerprint' object: the Morgan feature hashes of the
+// molecule with their counts, not folded into bits.
+// Types: "ecfp2", "ecfp4", "ecfp6" or "ecfp8".
+// Zero pointer or empty string defaults to "ecfp4".
+CEXPORT int indigoSparseFingerprint (int molecule, const char *type);
+
+// Folds a sparse fingerprint into a 'fingerprint' object of the given
+// number of bits. The bits are the same as of indigoFingerprint() with the
+// same similarity type, when the numbers of bits are equal.
+CEXPORT int indigoFoldFingerprint (int sparse_fingerprint, int bits);
+
+// Returns a 'sparse fingerprints' object with the sparse fingerprints of all
+// the molecules of an array or an iterator
+CEXPORT int indigoSparseFingerprints (int molecules, const char *type);
+
+// Gives the sparse fingerprints in the compressed sparse row format: the
+// features of the i-th molecule are hashes[indptr[i]] .. hashes[indptr[i + 1] - 1]
+// with the counts at the same positions. The buffers are valid until the
+// object is freed.
+CEXPORT int indigoSparseFingerprintsCSR (int fingerprints, int *rows, int *nnz, const int **indptr,
+                                         const unsigned int **hashes, const int **counts);
+
+// Accepts two molecules, two reactions, two fingerprints or two sparse
+// fingerprints. Returns the similarity measure between them.
+// Metrics: "tanimoto", "dice", "tversky", "tversky <alpha> <beta>", "euclid-sub" or "normalized-edit"
 // Zero pointer or empty string defaults to "tanimoto".
 // "tversky" without numbers defaults to alpha = beta = 0.5
+// For the sparse fingerprints the counts of the features are used.
 CEXPORT float indigoSimilarity (int item1, int item2, const char *metrics);
 
 /* Working with SDF/RDF/SMILES/CML/CDX files  */
@@ -873,6 +904,16 @@ CEXPORT int indigoCountMatchesWithLimit (int matcher, int query, int embeddings_
 // Returns substructure matches iterator
 CEXPORT int indigoIterateMatches (int matcher, int query);
 
+// Returns a new empty 'query set' object. A query set checks many queries
+// against one target at once, the target is prepared only once and the
+// queries are screened by fingerprints and element counts.
+CEXPORT int indigoCreateQuerySet (void);
+// Adds a copy of the query to the set and returns its index in the set
+CEXPORT int indigoQuerySetAdd (int query_set, int query);
+// Returns the indices of the queries that are substructures of the target,
+// in ascending order. The array is valid until the next call.
+CEXPORT const int * indigoQuerySetMatch (int query_set, int target, int *count_out);
+
 // Accepts a 'match' object obtained from indigoMatchSubstructure.
 // Returns a new molecule which has the query highlighted.
 CEXPORT int indigoHighlightedTarget (int match);
@@ -977,6 +1018,14 @@ CEXPORT int indigoToBuffer (int handle, char **buf, int *size);
 // reactions with R-Sites replaced by the actual substituents.
 CEXPORT int indigoReactionProductEnumerate (int reaction, int monomers);
 
+// The same products as indigoReactionProductEnumerate returns, one by one
+// for indigoNext. The products are built by parts, in the worker threads
+// if the "rpe-threads" option is set, and are not kept after they are
+// returned. The duplicates are found by the canonical SMILES, or only by its
+// 64-bit hash if the "rpe-dedup-exact" option is reset, which takes less
+// memory but may skip a product with the same hash.
+CEXPORT int indigoIterateEnumeratedProducts (int reaction, int monomers);
+
 CEXPORT int indigoTransform (int reaction, int monomers);
 
 
@@ -999,4 +1048,9 @@ CEXPORT int indigoDbgResetProfiling (int /*bool*/ whole_session);
 // Methods that returns profiling counter value for a particular counter
 CEXPORT qword indigoDbgProfilingGetCounter (const char *name, int /*bool*/ whole_session);
 
+// Returns all the profiling labels as a JSON object:
+// {"label": {"type": "timer", "count": 1, "total": 0.1, "avg": 0.1, "max": 0.1}, ...}
+// Timer values are in seconds. Profiling can be turned off by the "profiling" option.
+CEXPORT const char * indigoDbgProfilingJson (int /*bool*/ whole_session);
+
 #endif
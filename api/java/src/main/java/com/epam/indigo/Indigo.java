@@ -101,6 +101,12 @@ public class Indigo {
         return result;
     }
 
+    static public long checkResultLong(Object obj, long result) {
+        if (result < 0)
+            throw new IndigoException(obj, _lib.indigoGetLastError());
+        return result;
+    }
+
     static public float checkResultFloat(Object obj, float result) {
         if (result < 0)
             throw new IndigoException(obj, _lib.indigoGetLastError());
@@ -712,6 +718,11 @@ public class Indigo {
         return new IndigoObject(this, checkResult(this, _lib.indigoCreateArray()));
     }
 
+    public IndigoObject createQuerySet() {
+        setSessionID();
+        return new IndigoObject(this, checkResult(this, _lib.indigoCreateQuerySet()));
+    }
+
     public IndigoObject iterateSDFile(String filename) {
         setSessionID();
         int result = checkResult(this, _lib.indigoIterateSDFile(filename));
@@ -844,6 +855,24 @@ public class Indigo {
         return new IndigoObject(this, res);
     }
 
+    public IndigoObject iterateEnumeratedProducts(IndigoObject reaction, IndigoObject monomers) {
+        Object[] guard = new Object[]{this, reaction, monomers};
+        setSessionID();
+        return new IndigoObject(this, checkResult(guard, _lib.indigoIterateEnumeratedProducts(reaction.self, monomers.self)), reaction);
+    }
+
+    public IndigoObject sparseFingerprints(IndigoObject molecules) {
+        return sparseFingerprints(molecules, "");
+    }
+
+    public IndigoObject sparseFingerprints(IndigoObject molecules, String type) {
+        if (type == null)
+            type = "";
+        Object[] guard = new Object[]{this, molecules};
+        setSessionID();
+        return new IndigoObject(this, checkResult(guard, _lib.indigoSparseFingerprints(molecules.self, type)));
+    }
+
     public void transform(IndigoObject reaction, IndigoObject monomer) {
         Object[] guard = new Object[]{this, reaction, monomer};
         setSessionID();
@@ -865,6 +894,16 @@ public class Indigo {
         _lib.indigoDbgBreakpoint();
     }
 
+    public long dbgProfilingGetCounter(String name, boolean whole_session) {
+        setSessionID();
+        return checkResultLong(this, _lib.indigoDbgProfilingGetCounter(name, whole_session ? 1 : 0));
+    }
+
+    public String dbgProfilingJson(boolean whole_session) {
+        setSessionID();
+        return checkResultString(this, _lib.indigoDbgProfilingJson(whole_session ? 1 : 0));
+    }
+
     public IndigoObject toIndigoArray(Collection<IndigoObject> coll) {
         setSessionID();
         IndigoObject arr = createArray();
@@ -388,6 +388,8 @@ public interface IndigoLib extends Library
 
    int indigoLayout (int object);
 
+   Pointer indigoLayoutBatch (int objects, int threads, int per_item_timeout_ms);
+
    int indigoClean2d (int object);
 
    Pointer indigoSmiles (int item);
@@ -424,6 +426,11 @@ public interface IndigoLib extends Library
    int indigoCountBits (int fingerprint);
    int indigoCommonBits (int fingerprint1, int fingerprint2);
    float indigoSimilarity (int item1, int item2, String metrics);
+   int indigoSparseFingerprint (int molecule, String type);
+   int indigoFoldFingerprint (int sparse_fingerprint, int bits);
+   int indigoSparseFingerprints (int molecules, String type);
+   int indigoSparseFingerprintsCSR (int fingerprints, IntByReference rows, IntByReference nnz, PointerByReference indptr,
+                                    PointerByReference hashes, PointerByReference counts);
 
    int indigoIterateSDF    (int reader);
    int indigoIterateRDF    (int reader);
@@ -465,6 +472,9 @@ public interface IndigoLib extends Library
    int indigoUnignoreAllAtoms (int matcher);
    int indigoMatch (int matcher, int query);
    int indigoCountMatches (int matcher, int query);
+   int indigoCreateQuerySet ();
+   int indigoQuerySetAdd (int query_set, int query);
+   Pointer indigoQuerySetMatch (int query_set, int target, IntByReference count);
    int indigoCountMatchesWithLimit (int matcher, int query, int embeddings_limit);
    int indigoIterateMatches (int matcher, int query);
    int indigoHighlightedTarget (int match);
@@ -489,6 +499,7 @@ public interface IndigoLib extends Library
    Pointer indigoToString (int handle);
    int indigoToBuffer (int handle, PointerByReference buf, IntByReference size);
    int indigoReactionProductEnumerate (int reaction, int monomers);
+   int indigoIterateEnumeratedProducts (int reaction, int monomers);
    int indigoTransform (int reaction, int monomers);
 
    int indigoExpandAbbreviations (int structure);
@@ -502,4 +513,6 @@ public interface IndigoLib extends Library
 
    int indigoDbgBreakpoint ();
    Pointer indigoDbgInternalType (int object);
+   long indigoDbgProfilingGetCounter (String name, int whole_session);
+   Pointer indigoDbgProfilingJson (int whole_session);
 }
@@ -1529,6 +1529,12 @@ public class IndigoObject implements Iterator<IndigoObject>, Iterable<IndigoObje
       Indigo.checkResult(this, _lib.indigoLayout(self));
    }
 
+   public String layoutBatch(int threads, int timeout)
+   {
+      dispatcher.setSessionID();
+      return Indigo.checkResultString(this, _lib.indigoLayoutBatch(self, threads, timeout));
+   }
+
    public void clean2d()
    {
       dispatcher.setSessionID();
@@ -1641,6 +1647,42 @@ public class IndigoObject implements Iterator<IndigoObject>, Iterable<IndigoObje
       return Indigo.checkResult(this, _lib.indigoCountBits(self));
    }
 
+   public IndigoObject sparseFingerprint ()
+   {
+      return sparseFingerprint("");
+   }
+
+   public IndigoObject sparseFingerprint (String type)
+   {
+      dispatcher.setSessionID();
+      return new IndigoObject(dispatcher, Indigo.checkResult(this, _lib.indigoSparseFingerprint(self, type)));
+   }
+
+   public IndigoObject foldFingerprint (int bits)
+   {
+      dispatcher.setSessionID();
+      return new IndigoObject(dispatcher, Indigo.checkResult(this, _lib.indigoFoldFingerprint(self, bits)));
+   }
+
+   // Returns the indptr, hashes and counts arrays of the sparse fingerprints
+   public int[][] sparseFingerprintsCSR ()
+   {
+      IntByReference rows = new IntByReference();
+      IntByReference nnz = new IntByReference();
+      PointerByReference indptr = new PointerByReference();
+      PointerByReference hashes = new PointerByReference();
+      PointerByReference counts = new PointerByReference();
+
+      dispatcher.setSessionID();
+      Indigo.checkResult(this, _lib.indigoSparseFingerprintsCSR(self, rows, nnz, indptr, hashes, counts));
+
+      int[][] res = new int[3][];
+      res[0] = indptr.getValue().getIntArray(0, rows.getValue() + 1);
+      res[1] = nnz.getValue() > 0 ? hashes.getValue().getIntArray(0, nnz.getValue()) : new int[0];
+      res[2] = nnz.getValue() > 0 ? counts.getValue().getIntArray(0, nnz.getValue()) : new int[0];
+      return res;
+   }
+
    public String rawData ()
    {
       dispatcher.setSessionID();
@@ -1760,6 +1802,20 @@ public class IndigoObject implements Iterator<IndigoObject>, Iterable<IndigoObje
       return Indigo.checkResult(this, query, _lib.indigoCountMatches(self, query.self));
    }
 
+   public int querySetAdd (IndigoObject query)
+   {
+      dispatcher.setSessionID();
+      return Indigo.checkResult(this, query, _lib.indigoQuerySetAdd(self, query.self));
+   }
+
+   public int[] querySetMatch (IndigoObject target)
+   {
+      IntByReference count = new IntByReference();
+      dispatcher.setSessionID();
+      Pointer p = Indigo.checkResultPointer(this, _lib.indigoQuerySetMatch(self, target.self, count));
+      return p.getIntArray(0, count.getValue());
+   }
+
    public int countMatchesWithLimit (IndigoObject query, int embeddings_limit)
    {
       dispatcher.setSessionID();
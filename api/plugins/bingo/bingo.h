@@ -31,13 +31,40 @@ CEXPORT int bingoInsertRecordObj (int db, int obj);
 CEXPORT int bingoInsertRecordObjWithId (int db, int obj, int id);
 CEXPORT int bingoInsertRecordObjWithExtFP (int db, int obj, int fp);
 CEXPORT int bingoInsertRecordObjWithIdAndExtFP (int db, int obj, int id, int fp);
+
+// Inserts all the objects of an array or an iterator (e.g. SDF loader).
+// ids (if not NULL) gives the record ids, otherwise the id property is used.
+// result_ids (if not NULL) receives the record ids, -1 for the records that
+// failed or had a used id. Both arrays have 'count' items, ids must have one
+// per object. The objects are read by chunks, fingerprints are built in
+// 'threads' threads (0 means the number of processors) and the records are
+// inserted under the database lock, which is released between the portions.
+// If an iterator turns out to have a different number of objects, the records
+// of the chunks read before that stay inserted.
+// Returns the number of inserted records.
+CEXPORT int bingoInsertRecordsBatch (int db, int objects, const int *ids, int *result_ids, int count, int threads);
 CEXPORT int bingoDeleteRecord (int db, int id);
 CEXPORT int bingoGetRecordObj (int db, int id);
 
 CEXPORT int bingoOptimize (int db);
 
+// Rewrites the database files without the deleted records. Record ids are kept.
+// Returns the number of reclaimed records, reclaimed_bytes (if not NULL) receives
+// the number of reclaimed bytes of the storage. The database must have no active searches.
+CEXPORT int bingoCompact (int db, long long *reclaimed_bytes);
+
+// Returns the error of the last container build of the background optimizer
+// ("bg_optimize" option), or an empty string if it succeeded or the optimizer
+// is not running. Failed builds are retried, and bingoOptimize builds the rest.
+CEXPORT const char * bingoGetBgOptimizeError (int db);
+
 // Search methods that returns search object
 // Search object is an iterator
+//
+// options = "part:<id>/<count>" to search only a part of the database
+// bingoSearchSub also accepts "threads:<count>" (0 for the number of processors)
+// and "order:id|any", separated by ';'. In the "id" order (default) results go in the same order
+// as in the single-threaded search, "any" returns them as soon as they are found.
 CEXPORT int bingoSearchSub (int db, int query_obj, const char *options);
 CEXPORT int bingoSearchExact (int db, int query_obj, const char *options);
 CEXPORT int bingoSearchMolFormula (int db, const char *query, const char *options);
@@ -224,6 +224,25 @@ namespace com.epam.indigo
            return Bingo.checkResult(_indigo, _lib.bingoInsertRecordObjWithIdAndExtFP(_id, record.self, id, ext_fp.self));
         }
 
+        /// <summary>
+        /// Inserts all the structures of an array or an iterator. Fingerprints are built in
+        /// several threads and the records are inserted by portions under the database lock.
+        /// </summary>
+        /// <param name="records">Indigo array or iterator with chemical structures</param>
+        /// <param name="ids">record ids, one per structure, or null to use the id property</param>
+        /// <param name="threads">number of threads, 0 means the number of processors</param>
+        /// <returns>ids of the records, -1 for the structures that were not inserted</returns>
+        public unsafe int[] insertBatch(IndigoObject records, int[] ids, int threads)
+        {
+           _indigo.setSessionID();
+           int[] result_ids = new int[ids != null ? ids.Length : records.count()];
+           fixed (int* ids_ptr = ids, result_ptr = result_ids)
+           {
+              Bingo.checkResult(_indigo, _lib.bingoInsertRecordsBatch(_id, records.self, ids_ptr, result_ptr, result_ids.Length, threads));
+           }
+           return result_ids;
+        }
+
         /// <summary>
         /// Delete a record by id
         /// </summary>
@@ -446,6 +465,26 @@ namespace com.epam.indigo
            Bingo.checkResult(_indigo, _lib.bingoOptimize(_id));
         }
 
+        /// <summary>
+        /// Rewrites the database files without the deleted records. Record ids are kept.
+        /// </summary>
+        /// <returns>Number of reclaimed records</returns>
+        public int compact ()
+        {
+           _indigo.setSessionID();
+           return Bingo.checkResult(_indigo, _lib.bingoCompact(_id, null));
+        }
+
+        /// <summary>
+        /// Returns the error of the last container build of the background optimizer
+        /// </summary>
+        /// <returns>Error message, or an empty string if the last build succeeded</returns>
+        public string getBgOptimizeError ()
+        {
+           _indigo.setSessionID();
+           return Bingo.checkResult(_indigo, _lib.bingoGetBgOptimizeError(_id));
+        }
+
         /// <summary>
         /// Returns an IndigoObject for the record with the specified id
         /// </summary>
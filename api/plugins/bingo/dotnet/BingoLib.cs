@@ -16,9 +16,12 @@ namespace com.epam.indigo
         int bingoInsertRecordObjWithId(int db, int obj, int id);
         int bingoInsertRecordObjWithExtFP (int db, int obj, int ext_fp);
         int bingoInsertRecordObjWithIdAndExtFP(int db, int obj, int ext_fp, int id);
+        int bingoInsertRecordsBatch (int db, int objects, int *ids, int *result_ids, int count, int threads);
         int bingoDeleteRecord (int db, int index);
 
         int bingoOptimize (int db);
+        int bingoCompact (int db, long *reclaimed_bytes);
+        string bingoGetBgOptimizeError (int db);
 
         int bingoSearchSub (int db, int query_obj, string options);
         int bingoSearchSim (int db, int query_obj, float min, float max, string options);
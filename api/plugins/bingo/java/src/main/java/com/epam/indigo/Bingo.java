@@ -210,6 +210,22 @@ public class Bingo {
 		return Bingo.checkResult(_indigo, _lib.bingoInsertRecordObjWithIdAndExtFP(_id, record.self, id, ext_fp.self));
 	}
 
+    /**
+        Inserts all the structures of an array or an iterator. Fingerprints are built
+        in several threads and the records are inserted by portions under the database lock.
+
+        @param records Indigo array or iterator with chemical structures (molecules or reactions)
+        @param ids record ids, one per structure, or null to use the id property
+        @param threads number of threads, 0 means the number of processors
+        @return ids of the records, -1 for the structures that were not inserted
+    */
+	public int[] insertBatch(IndigoObject records, int[] ids, int threads) {
+		_indigo.setSessionID();
+		int[] result_ids = new int[ids != null ? ids.length : records.count()];
+		Bingo.checkResult(_indigo, _lib.bingoInsertRecordsBatch(_id, records.self, ids, result_ids, result_ids.length, threads));
+		return result_ids;
+	}
+
 	/**
         Delete a record by id
 
@@ -434,6 +450,26 @@ public class Bingo {
 		Bingo.checkResult(_indigo, _lib.bingoOptimize(_id));
 	}
 
+   	/**
+        Rewrites the database files without the deleted records. Record ids are kept.
+
+        @return number of reclaimed records
+    */
+	public int compact () {
+		_indigo.setSessionID();
+		return Bingo.checkResult(_indigo, _lib.bingoCompact(_id, null));
+	}
+
+   	/**
+        Returns the error of the last container build of the background optimizer
+
+        @return error message, or an empty string if the last build succeeded
+    */
+	public String getBgOptimizeError () {
+		_indigo.setSessionID();
+		return Bingo.checkResult(_indigo, _lib.bingoGetBgOptimizeError(_id));
+	}
+
 	/**
         Returns an IndigoObject for the record with the specified id
 
@@ -16,6 +16,7 @@ package com.epam.indigo;
 
 import com.sun.jna.Library;
 import com.sun.jna.ptr.FloatByReference;
+import com.sun.jna.ptr.LongByReference;
 
 public interface BingoLib extends Library
 {
@@ -27,9 +28,12 @@ public interface BingoLib extends Library
         int bingoInsertRecordObjWithId(int db, int obj, int id);
         int bingoInsertRecordObjWithExtFP (int db, int obj, int ext_fp);
         int bingoInsertRecordObjWithIdAndExtFP(int db, int obj, int ext_fp, int id);
+        int bingoInsertRecordsBatch (int db, int objects, int[] ids, int[] result_ids, int count, int threads);
         int bingoDeleteRecord (int db, int index);
 
         int bingoOptimize (int db);
+        int bingoCompact (int db, LongByReference reclaimed_bytes);
+        String bingoGetBgOptimizeError (int db);
 
         int bingoSearchSub (int db, int query_obj, String options);
         int bingoSearchSim (int db, int query_obj, float min, float max, String options);
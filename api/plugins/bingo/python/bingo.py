@@ -50,6 +50,8 @@ class Bingo(object):
         self._lib.bingoInsertRecordObjWithId.argtypes = [c_int, c_int, c_int]
         self._lib.bingoInsertRecordObjWithIdAndExtFP.restype = c_int
         self._lib.bingoInsertRecordObjWithIdAndExtFP.argtypes = [c_int, c_int, c_int, c_int]
+        self._lib.bingoInsertRecordsBatch.restype = c_int
+        self._lib.bingoInsertRecordsBatch.argtypes = [c_int, c_int, POINTER(c_int), POINTER(c_int), c_int, c_int]
         self._lib.bingoDeleteRecord.restype = c_int
         self._lib.bingoDeleteRecord.argtypes = [c_int, c_int]
         self._lib.bingoSearchSub.restype = c_int
@@ -80,6 +82,10 @@ class Bingo(object):
         self._lib.bingoGetCurrentSimilarityValue.argtypes = [c_int]
         self._lib.bingoOptimize.restype = c_int
         self._lib.bingoOptimize.argtypes = [c_int]
+        self._lib.bingoCompact.restype = c_int
+        self._lib.bingoCompact.argtypes = [c_int, POINTER(c_longlong)]
+        self._lib.bingoGetBgOptimizeError.restype = c_char_p
+        self._lib.bingoGetBgOptimizeError.argtypes = [c_int]
         self._lib.bingoEstimateRemainingResultsCount.restype = c_int
         self._lib.bingoEstimateRemainingResultsCount.argtypes = [c_int]
         self._lib.bingoEstimateRemainingResultsCountError.restype = c_int
@@ -178,6 +184,18 @@ class Bingo(object):
             return Bingo._checkResult(self._indigo,
                                       self._lib.bingoInsertRecordObjWithIdAndExtFP(self._id, indigoObject.id, index, ext_fp.id))
 
+    def insertBatch(self, indigoObjects, indices=None, threads=0):
+        self._indigo._setSessionId()
+        ids = None
+        if indices:
+            count = len(indices)
+            ids = (c_int * count)(*indices)
+        else:
+            count = indigoObjects.count()
+        result_ids = (c_int * count)()
+        Bingo._checkResult(self._indigo, self._lib.bingoInsertRecordsBatch(self._id, indigoObjects.id, ids, result_ids, count, threads))
+        return list(result_ids)
+
     def delete(self, index):
         self._indigo._setSessionId()
         Bingo._checkResult(self._indigo, self._lib.bingoDeleteRecord(self._id, index))
@@ -245,6 +263,16 @@ class Bingo(object):
         self._indigo._setSessionId()
         Bingo._checkResult(self._indigo, self._lib.bingoOptimize(self._id))
 
+    def compact(self):
+        self._indigo._setSessionId()
+        reclaimed_bytes = c_longlong()
+        reclaimed_records = Bingo._checkResult(self._indigo, self._lib.bingoCompact(self._id, pointer(reclaimed_bytes)))
+        return reclaimed_records, reclaimed_bytes.value
+
+    def getBgOptimizeError(self):
+        self._indigo._setSessionId()
+        return Bingo._checkResultString(self._indigo, self._lib.bingoGetBgOptimizeError(self._id))
+
     def getRecordById (self, id):
         self._indigo._setSessionId()
         return IndigoObject(self._indigo, Bingo._checkResult(self._indigo, self._lib.bingoGetRecordObj(self._id, id)))
@@ -19,12 +19,15 @@
 #include "indigo_internal.h"
 #include "indigo_molecule.h"
 #include "indigo_reaction.h"
+#include "indigo_array.h"
 #include "indigo_fingerprints.h"
 #include "indigo_cpp.h"
 #include "bingo_internal.h"
 
 #include "bingo_index.h"
 #include "bingo_lock.h"
+#include "bingo_batch_insert.h"
+#include "bingo_background_optimizer.h"
 
 #include <stdio.h>
 #include <string>
@@ -44,10 +47,49 @@ IMPL_EXCEPTION(indigo, BingoException, "bingo");
 static PtrPool<Index> _bingo_instances;
 static OsLock _bingo_lock;
 static PtrArray<DatabaseLockData> _lockers;
+static PtrArray<BackgroundOptimizer> _optimizers;
 static PtrPool<Matcher> _searches;
 static OsLock _searches_lock;
 static Array<int> _searches_db;
 
+// Starts the background optimizer of the database if it is turned on by the options
+static void _startBgOptimizer (int db)
+{
+   BaseIndex &bingo_index = dynamic_cast<BaseIndex &>(_bingo_instances.ref(db));
+   int threshold = bingo_index.getBgOptimizeThreshold();
+
+   if (threshold <= 0 || bingo_index.isReadOnly())
+      return;
+
+   AutoPtr<BackgroundOptimizer> optimizer(new BackgroundOptimizer(bingo_index, *_lockers[db], db, threshold));
+
+   OsLocker bingo_locker(_bingo_lock);
+   _optimizers.expand(db + 1);
+   _optimizers.reset(db, optimizer.release());
+}
+
+// Waits for the current build of the background optimizer and stops it
+static void _stopBgOptimizer (int db)
+{
+   AutoPtr<BackgroundOptimizer> optimizer;
+   {
+      OsLocker bingo_locker(_bingo_lock);
+      if (db < _optimizers.size())
+         optimizer.reset(_optimizers.release(db));
+   }
+}
+
+// Registers the search. The matcher must be created under the read lock of
+// the database, so that bingoCompact sees it once it takes the write lock.
+static int _addSearch (int db, Matcher *matcher)
+{
+   OsLocker searches_locker(_searches_lock);
+   int search_id = _searches.add(matcher);
+   _searches_db.expand(search_id + 1);
+   _searches_db[search_id] = db;
+   return search_id;
+}
+
 static int _bingoCreateOrLoadDatabaseFile (const char *location, const char *options, bool create, const char *type = 0)
 {
    Indigo &self = indigoGetInstance();
@@ -100,11 +142,13 @@ static int _bingoCreateOrLoadDatabaseFile (const char *location, const char *opt
       OsLocker bingo_locker(_bingo_lock);
       _bingo_instances[db_id] = context.release();
       AutoPtr<DatabaseLockData> locker_ptr;
-      locker_ptr.reset(new DatabaseLockData());
+      locker_ptr.reset(new DatabaseLockData(db_id));
       _lockers.expand(db_id + 1);
       _lockers[db_id] = locker_ptr.release();
    }
 
+   _startBgOptimizer(db_id);
+
    return db_id;
 }
 
@@ -215,6 +259,7 @@ CEXPORT int bingoCloseDatabase (int db)
 {
    BINGO_BEGIN_DB(db)
    {
+      _stopBgOptimizer(db);
       _bingo_instances.remove(db);
       return 1;
    }
@@ -292,6 +337,114 @@ CEXPORT int bingoInsertRecordObjWithIdAndExtFP (int db, int obj, int id, int fp)
    BINGO_END(-1);
 }
 
+CEXPORT int bingoInsertRecordsBatch (int db, int objects, const int *ids, int *result_ids, int count, int threads)
+{
+   BINGO_BEGIN_DB(db)
+   {
+      IndigoObject &objects_obj = self.getObject(objects);
+      BaseIndex &bingo_index = dynamic_cast<BaseIndex &>(_bingo_instances.ref(db));
+      const char *key_name = bingo_index.getIdPropertyName();
+
+      bool has_ids = (ids != 0 || result_ids != 0);
+      if (has_ids && count < 0)
+         throw BingoException("bingoInsertRecordsBatch: incorrect count of ids %d", count);
+
+      IndigoArray *arr = 0;
+      if (IndigoArray::is(objects_obj))
+      {
+         arr = &IndigoArray::cast(objects_obj);
+         if ((ids != 0 && arr->objects.size() != count) || (has_ids && arr->objects.size() > count))
+            throw BingoException("bingoInsertRecordsBatch: there are %d objects for %d ids", arr->objects.size(), count);
+      }
+
+      if (threads <= 0)
+         threads = osGetProcessorsCount();
+
+      PtrArray<IndigoObject> iterated;
+      Array<IndigoObject *> batch;
+      Array<int> obj_ids;
+      ObjArray<BaseIndex::ObjectIndexData> objs_data;
+      Array<bool> prepared;
+      int read_count = 0, inserted_count = 0;
+
+      while (true)
+      {
+         batch.clear();
+         iterated.clear();
+
+         if (arr != 0)
+         {
+            for (int i = read_count; i < arr->objects.size() && batch.size() < BatchPrepareDispatcher::CHUNK_SIZE; i++)
+               batch.push(arr->objects[i]);
+         }
+         else
+         {
+            IndigoObject *obj;
+            while (batch.size() < BatchPrepareDispatcher::CHUNK_SIZE && (obj = objects_obj.next()) != 0)
+            {
+               iterated.add(obj);
+               batch.push(obj);
+            }
+         }
+
+         if (batch.size() == 0)
+            break;
+
+         if (has_ids && read_count + batch.size() > count)
+            throw BingoException("bingoInsertRecordsBatch: there are more objects than ids (%d)", count);
+
+         obj_ids.clear_resize(batch.size());
+
+         {
+            profTimerStart(t, "batch_load");
+            for (int i = 0; i < batch.size(); i++)
+            {
+               IndigoObject &obj = *batch[i];
+
+               obj_ids[i] = -1;
+               if (ids != 0)
+                  obj_ids[i] = ids[read_count + i];
+               else if (key_name != 0 && obj.getProperties().contains(key_name))
+                  obj_ids[i] = strtol(obj.getProperties().at(key_name), NULL, 10);
+
+               // Lazy loaded objects are parsed here, as the loader options
+               // are bound to the current Indigo session
+               try
+               {
+                  if (bingo_index.getType() == Index::MOLECULE && IndigoMolecule::is(obj))
+                     obj.getBaseMolecule();
+                  else if (bingo_index.getType() == Index::REACTION && IndigoReaction::is(obj))
+                     obj.getBaseReaction();
+               }
+               catch (Exception &)
+               {
+                  batch[i] = 0;
+               }
+            }
+         }
+
+         BatchPrepareDispatcher dispatcher(bingo_index, self.arom_options, batch);
+         dispatcher.prepare(threads, objs_data, prepared);
+
+         {
+            profTimerStart(t, "batch_insert");
+            inserted_count += bingo_index.addPrepared(objs_data, prepared, obj_ids, *_lockers[db]);
+         }
+
+         if (result_ids != 0)
+            memcpy(result_ids + read_count, obj_ids.ptr(), obj_ids.sizeInBytes());
+
+         read_count += batch.size();
+      }
+
+      if (ids != 0 && read_count != count)
+         throw BingoException("bingoInsertRecordsBatch: there are %d objects for %d ids", read_count, count);
+
+      return inserted_count;
+   }
+   BINGO_END(-1);
+}
+
 CEXPORT int bingoDeleteRecord (int db, int id)
 {
    BINGO_BEGIN_DB(db)
@@ -364,6 +517,93 @@ CEXPORT int bingoOptimize (int db)
    BINGO_END(-1);
 }
 
+CEXPORT int bingoCompact (int db, long long *reclaimed_bytes)
+{
+   BINGO_BEGIN_DB(db)
+   {
+      BaseIndex &bingo_index = dynamic_cast<BaseIndex &>(_bingo_instances.ref(db));
+
+      AutoPtr<BaseIndex> compacted;
+      if (bingo_index.getType() == Index::MOLECULE)
+         compacted.reset(new MoleculeIndex());
+      else
+         compacted.reset(new ReactionIndex());
+
+      // Compacted storage is written through a temporary database id
+      int compact_id;
+      {
+         OsLocker bingo_locker(_bingo_lock);
+         compact_id = _bingo_instances.add(0);
+      }
+
+      int reclaimed_rows = 0;
+      qword reclaimed_size = 0;
+
+      // The storage files are reopened, the containers can't be built meanwhile
+      _stopBgOptimizer(db);
+
+      try
+      {
+         WriteLock wlock(*_lockers[db]);
+
+         // Searches are created under the read lock, none can start until
+         // the compaction is over
+         {
+            OsLocker searches_locker(_searches_lock);
+            for (int i = _searches.begin(); i != _searches.end(); i = _searches.next(i))
+               if (_searches_db[i] == db)
+                  throw BingoException("bingoCompact: database has active searches");
+         }
+
+         bingo_index.compact(compacted.ref(), compact_id, reclaimed_rows, reclaimed_size);
+      }
+      catch (...)
+      {
+         compacted.reset(0);
+         {
+            OsLocker bingo_locker(_bingo_lock);
+            _bingo_instances.remove(compact_id);
+         }
+         MMFStorage::setDatabaseId(db);
+         _startBgOptimizer(db);
+         throw;
+      }
+
+      compacted.reset(0);
+      {
+         OsLocker bingo_locker(_bingo_lock);
+         _bingo_instances.remove(compact_id);
+      }
+
+      MMFStorage::setDatabaseId(db);
+      _startBgOptimizer(db);
+
+      if (reclaimed_bytes != 0)
+         *reclaimed_bytes = (long long)reclaimed_size;
+
+      return reclaimed_rows;
+   }
+   BINGO_END(-1);
+}
+
+CEXPORT const char * bingoGetBgOptimizeError (int db)
+{
+   BINGO_BEGIN_DB(db)
+   {
+      std::string message;
+      {
+         OsLocker bingo_locker(_bingo_lock);
+         if (db < _optimizers.size() && _optimizers[db] != 0)
+            _optimizers[db]->getLastError(message);
+      }
+
+      auto &tmp = self.getThreadTmpData();
+      tmp.string.readString(message.c_str(), true);
+      return tmp.string.ptr();
+   }
+   BINGO_END(0);
+}
+
 CEXPORT int bingoSearchSub (int db, int query_obj, const char *options)
 {
    BINGO_BEGIN_DB(db)
@@ -376,18 +616,12 @@ CEXPORT int bingoSearchSub (int db, int query_obj, const char *options)
 
          AutoPtr<MoleculeSubstructureQueryData> query_data(new MoleculeSubstructureQueryData(obj.getQueryMolecule()));
 
+         ReadLock rlock(*_lockers[db]);
          MoleculeIndex &bingo_index = dynamic_cast<MoleculeIndex &>(_bingo_instances.ref(db));
          MoleculeSubMatcher *matcher = dynamic_cast<MoleculeSubMatcher *>(bingo_index.createMatcher("sub", query_data.release(), options));
+         matcher->setLockData(_lockers[db]);
 
-         int search_id;
-         {
-            OsLocker searches_locker(_searches_lock);
-            search_id = _searches.add(matcher);
-            _searches_db.expand(search_id + 1);
-            _searches_db[search_id] = db;
-         }
-
-         return search_id;
+         return _addSearch(db, matcher);
       }
       else if (IndigoQueryReaction::is(obj))
       {
@@ -395,18 +629,12 @@ CEXPORT int bingoSearchSub (int db, int query_obj, const char *options)
 
          AutoPtr<ReactionSubstructureQueryData> query_data(new ReactionSubstructureQueryData(obj.getQueryReaction()));
 
+         ReadLock rlock(*_lockers[db]);
          ReactionIndex &bingo_index = dynamic_cast<ReactionIndex &>(_bingo_instances.ref(db));
          ReactionSubMatcher *matcher = dynamic_cast<ReactionSubMatcher *>(bingo_index.createMatcher("sub", query_data.release(), options));
+         matcher->setLockData(_lockers[db]);
 
-         int search_id;
-         {
-            OsLocker searches_locker(_searches_lock);
-            search_id = _searches.add(matcher);
-            _searches_db.expand(search_id + 1);
-            _searches_db[search_id] = db;
-         }
-
-         return search_id;
+         return _addSearch(db, matcher);
       }
       else
          throw BingoException("bingoSearchSub: only query molecule and query reaction can be set as query object");
@@ -426,18 +654,11 @@ CEXPORT int bingoSearchExact (int db, int query_obj, const char *options)
 
          AutoPtr<MoleculeExactQueryData> query_data(new MoleculeExactQueryData(obj.getMolecule()));
 
+         ReadLock rlock(*_lockers[db]);
          MoleculeIndex &bingo_index = dynamic_cast<MoleculeIndex &>(_bingo_instances.ref(db));
          MolExactMatcher *matcher = dynamic_cast<MolExactMatcher *>(bingo_index.createMatcher("exact", query_data.release(), options));
 
-         int search_id;
-         {
-            OsLocker searches_locker(_searches_lock);
-            search_id = _searches.add(matcher);
-            _searches_db.expand(search_id + 1);
-            _searches_db[search_id] = db;
-         }
-
-         return search_id;
+         return _addSearch(db, matcher);
       }
       else if (IndigoReaction::is(obj))
       {
@@ -445,18 +666,11 @@ CEXPORT int bingoSearchExact (int db, int query_obj, const char *options)
 
          AutoPtr<ReactionExactQueryData> query_data(new ReactionExactQueryData(obj.getReaction()));
 
+         ReadLock rlock(*_lockers[db]);
          ReactionIndex &bingo_index = dynamic_cast<ReactionIndex &>(_bingo_instances.ref(db));
          RxnExactMatcher *matcher = dynamic_cast<RxnExactMatcher *>(bingo_index.createMatcher("exact", query_data.release(), options));
 
-         int search_id;
-         {
-            OsLocker searches_locker(_searches_lock);
-            search_id = _searches.add(matcher);
-            _searches_db.expand(search_id + 1);
-            _searches_db[search_id] = db;
-         }
-
-         return search_id;
+         return _addSearch(db, matcher);
       }
       else
          throw BingoException("bingoSearchExact: only non-query molecules and reactions can be set as query object");
@@ -474,18 +688,11 @@ CEXPORT int bingoSearchMolFormula (int db, const char *query, const char *option
 
       AutoPtr<GrossQueryData> query_data(new GrossQueryData(gross_str));
 
+      ReadLock rlock(*_lockers[db]);
       BaseIndex &bingo_index = dynamic_cast<BaseIndex &>(_bingo_instances.ref(db));
       MolGrossMatcher *matcher = dynamic_cast<MolGrossMatcher *>(bingo_index.createMatcher("formula", query_data.release(), options));
 
-      int search_id;
-      {
-         OsLocker searches_locker(_searches_lock);
-         search_id = _searches.add(matcher);
-         _searches_db.expand(search_id + 1);
-         _searches_db[search_id] = db;
-      }
-
-      return search_id;
+      return _addSearch(db, matcher);
    }
    BINGO_END(-1);
 }
@@ -502,18 +709,11 @@ CEXPORT int bingoSearchSim (int db, int query_obj, float min, float max, const c
 
          AutoPtr<MoleculeSimilarityQueryData> query_data(new MoleculeSimilarityQueryData(obj.getMolecule(), min, max));
 
+         ReadLock rlock(*_lockers[db]);
          MoleculeIndex &bingo_index = dynamic_cast<MoleculeIndex &>(_bingo_instances.ref(db));
          MoleculeSimMatcher *matcher = dynamic_cast<MoleculeSimMatcher *>(bingo_index.createMatcher("sim", query_data.release(), options));
 
-         int search_id;
-         {
-            OsLocker searches_locker(_searches_lock);
-            search_id = _searches.add(matcher);
-            _searches_db.expand(search_id + 1);
-            _searches_db[search_id] = db;
-         }
-
-         return search_id;
+         return _addSearch(db, matcher);
       }
       else if (IndigoReaction::is(obj))
       {
@@ -521,18 +721,11 @@ CEXPORT int bingoSearchSim (int db, int query_obj, float min, float max, const c
 
          AutoPtr<ReactionSimilarityQueryData> query_data(new ReactionSimilarityQueryData(obj.getReaction(), min, max));
 
+         ReadLock rlock(*_lockers[db]);
          ReactionIndex &bingo_index = dynamic_cast<ReactionIndex &>(_bingo_instances.ref(db));
          ReactionSimMatcher *matcher = dynamic_cast<ReactionSimMatcher *>(bingo_index.createMatcher("sim", query_data.release(), options));
 
-         int search_id;
-         {
-            OsLocker searches_locker(_searches_lock);
-            search_id = _searches.add(matcher);
-            _searches_db.expand(search_id + 1);
-            _searches_db[search_id] = db;
-         }
-
-         return search_id;
+         return _addSearch(db, matcher);
       }
       else
          throw BingoException("bingoSearchSim: only query molecule and query reaction can be set as query object");
@@ -553,18 +746,11 @@ CEXPORT int bingoSearchSimWithExtFP (int db, int query_obj, float min, float max
 
          AutoPtr<MoleculeSimilarityQueryData> query_data(new MoleculeSimilarityQueryData(obj.getMolecule(), min, max));
 
+         ReadLock rlock(*_lockers[db]);
          MoleculeIndex &bingo_index = dynamic_cast<MoleculeIndex &>(_bingo_instances.ref(db));
          MoleculeSimMatcher *matcher = dynamic_cast<MoleculeSimMatcher *>(bingo_index.createMatcherWithExtFP("sim", query_data.release(), options, ext_fp));
 
-         int search_id;
-         {
-            OsLocker searches_locker(_searches_lock);
-            search_id = _searches.add(matcher);
-            _searches_db.expand(search_id + 1);
-            _searches_db[search_id] = db;
-         }
-
-         return search_id;
+         return _addSearch(db, matcher);
       }
       else if (IndigoReaction::is(obj))
       {
@@ -572,18 +758,11 @@ CEXPORT int bingoSearchSimWithExtFP (int db, int query_obj, float min, float max
 
          AutoPtr<ReactionSimilarityQueryData> query_data(new ReactionSimilarityQueryData(obj.getReaction(), min, max));
 
+         ReadLock rlock(*_lockers[db]);
          ReactionIndex &bingo_index = dynamic_cast<ReactionIndex &>(_bingo_instances.ref(db));
          ReactionSimMatcher *matcher = dynamic_cast<ReactionSimMatcher *>(bingo_index.createMatcherWithExtFP("sim", query_data.release(), options, ext_fp));
 
-         int search_id;
-         {
-            OsLocker searches_locker(_searches_lock);
-            search_id = _searches.add(matcher);
-            _searches_db.expand(search_id + 1);
-            _searches_db[search_id] = db;
-         }
-
-         return search_id;
+         return _addSearch(db, matcher);
       }
       else
          throw BingoException("bingoSearchSim: only query molecule and query reaction can be set as query object");
@@ -603,18 +782,11 @@ CEXPORT int bingoSearchSimTopN (int db, int query_obj, int limit, float min, con
 
          AutoPtr<MoleculeSimilarityQueryData> query_data(new MoleculeSimilarityQueryData(obj.getMolecule(), min, 1.0));
 
+         ReadLock rlock(*_lockers[db]);
          MoleculeIndex &bingo_index = dynamic_cast<MoleculeIndex &>(_bingo_instances.ref(db));
          MoleculeTopNSimMatcher *matcher = dynamic_cast<MoleculeTopNSimMatcher *>(bingo_index.createMatcherTopN("sim", query_data.release(), options, limit));
 
-         int search_id;
-         {
-            OsLocker searches_locker(_searches_lock);
-            search_id = _searches.add(matcher);
-            _searches_db.expand(search_id + 1);
-            _searches_db[search_id] = db;
-         }
-
-         return search_id;
+         return _addSearch(db, matcher);
       }
       else if (IndigoReaction::is(obj))
       {
@@ -622,18 +794,11 @@ CEXPORT int bingoSearchSimTopN (int db, int query_obj, int limit, float min, con
 
          AutoPtr<ReactionSimilarityQueryData> query_data(new ReactionSimilarityQueryData(obj.getReaction(), min, 1.0));
 
+         ReadLock rlock(*_lockers[db]);
          ReactionIndex &bingo_index = dynamic_cast<ReactionIndex &>(_bingo_instances.ref(db));
          ReactionTopNSimMatcher *matcher = dynamic_cast<ReactionTopNSimMatcher *>(bingo_index.createMatcherTopN("sim", query_data.release(), options, limit));
 
-         int search_id;
-         {
-            OsLocker searches_locker(_searches_lock);
-            search_id = _searches.add(matcher);
-            _searches_db.expand(search_id + 1);
-            _searches_db[search_id] = db;
-         }
-
-         return search_id;
+         return _addSearch(db, matcher);
       }
       else
          throw BingoException("bingoSearchSimTopN: only query molecule and query reaction can be set as query object");
@@ -655,18 +820,11 @@ CEXPORT int bingoSearchSimTopNWithExtFP (int db, int query_obj, int limit, float
 
          AutoPtr<MoleculeSimilarityQueryData> query_data(new MoleculeSimilarityQueryData(obj.getMolecule(), min, 1.0));
 
+         ReadLock rlock(*_lockers[db]);
          MoleculeIndex &bingo_index = dynamic_cast<MoleculeIndex &>(_bingo_instances.ref(db));
          MoleculeTopNSimMatcher *matcher = dynamic_cast<MoleculeTopNSimMatcher *>(bingo_index.createMatcherTopNWithExtFP("sim", query_data.release(), options, limit, ext_fp));
 
-         int search_id;
-         {
-            OsLocker searches_locker(_searches_lock);
-            search_id = _searches.add(matcher);
-            _searches_db.expand(search_id + 1);
-            _searches_db[search_id] = db;
-         }
-
-         return search_id;
+         return _addSearch(db, matcher);
       }
       else if (IndigoReaction::is(obj))
       {
@@ -674,18 +832,11 @@ CEXPORT int bingoSearchSimTopNWithExtFP (int db, int query_obj, int limit, float
 
          AutoPtr<ReactionSimilarityQueryData> query_data(new ReactionSimilarityQueryData(obj.getReaction(), min, 1.0));
 
+         ReadLock rlock(*_lockers[db]);
          ReactionIndex &bingo_index = dynamic_cast<ReactionIndex &>(_bingo_instances.ref(db));
          ReactionTopNSimMatcher *matcher = dynamic_cast<ReactionTopNSimMatcher *>(bingo_index.createMatcherTopNWithExtFP("sim", query_data.release(), options, limit, ext_fp));
 
-         int search_id;
-         {
-            OsLocker searches_locker(_searches_lock);
-            search_id = _searches.add(matcher);
-            _searches_db.expand(search_id + 1);
-            _searches_db[search_id] = db;
-         }
-
-         return search_id;
+         return _addSearch(db, matcher);
       }
       else
          throw BingoException("bingoSearchSimTopN: only query molecule and query reaction can be set as query object");
@@ -698,18 +849,11 @@ CEXPORT int bingoEnumerateId (int db)
 {
    BINGO_BEGIN_DB(db)
    {
+      ReadLock rlock(*_lockers[db]);
       Index &index = _bingo_instances.ref(db);
       EnumeratorMatcher *matcher = dynamic_cast<EnumeratorMatcher *>(index.createMatcher("enum", nullptr, nullptr));
 
-      int search_id;
-      {
-         OsLocker searches_locker(_searches_lock);
-         search_id = _searches.add(matcher);
-         _searches_db.expand(search_id + 1);
-         _searches_db[search_id] = db;
-      }
-
-      return search_id;
+      return _addSearch(db, matcher);
    }
    BINGO_END(-1);
 }
@@ -733,8 +877,15 @@ CEXPORT int bingoNext (int search_obj)
 {
    BINGO_BEGIN_SEARCH(search_obj)
    {
+      Matcher &matcher = getMatcher(search_obj);
+
+      // Parallel matcher locks the database for each portion of work,
+      // so writers are not blocked while the search is running
+      if (matcher.isParallel())
+         return matcher.next();
+
       ReadLock rlock(*_lockers[ _searches_db[search_obj] ]);
-      return getMatcher(search_obj).next();
+      return matcher.next();
    }
    BINGO_END(-1);
 }
@@ -0,0 +1,124 @@
+#include "bingo_background_optimizer.h"
+
+#include "bingo_base_index.h"
+#include "bingo_mmf_storage.h"
+#include "bingo_multibit_tree.h"
+
+#include "base_cpp/tlscont.h"
+#include "base_cpp/profiling.h"
+
+#include <chrono>
+
+using namespace indigo;
+using namespace bingo;
+
+// Interval between the checks of the increment sizes
+static const int _CHECK_INTERVAL_MS = 100;
+// After a failed build the interval is doubled up to this number of times
+static const int _MAX_RETRY_SHIFT = 7;
+
+BackgroundOptimizer::BackgroundOptimizer (BaseIndex &index, DatabaseLockData &lock_data, int db_id,
+                                          int inc_threshold) :
+   _index(index), _lock_data(lock_data), _db_id(db_id), _inc_threshold(inc_threshold)
+{
+   _stopped = false;
+   _failures_count = 0;
+   _thread = std::thread(&BackgroundOptimizer::_run, this);
+}
+
+BackgroundOptimizer::~BackgroundOptimizer ()
+{
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stopped = true;
+   }
+   _cond.notify_all();
+
+   _thread.join();
+}
+
+void BackgroundOptimizer::_run ()
+{
+   MMFStorage::setDatabaseId(_db_id);
+   qword session_id = TL_GET_SESSION_ID();
+
+   std::unique_lock<std::mutex> lock(_mutex);
+   while (!_stopped)
+   {
+      lock.unlock();
+
+      bool built = false;
+      std::string error;
+      try
+      {
+         built = _buildContainer();
+      }
+      catch (Exception &e)
+      {
+         error = e.message();
+      }
+      catch (std::exception &e)
+      {
+         error = e.what();
+      }
+      catch (...)
+      {
+         error = "unknown error";
+      }
+
+      lock.lock();
+      if (error.empty())
+      {
+         _last_error.clear();
+         _failures_count = 0;
+      }
+      else
+      {
+         // The pending rows are still found by the searches. The error is
+         // reported by bingoGetBgOptimizeError.
+         _last_error = error;
+         _failures_count++;
+      }
+
+      if (!built)
+      {
+         int interval = _CHECK_INTERVAL_MS << __min(_failures_count, _MAX_RETRY_SHIFT);
+         _cond.wait_for(lock, std::chrono::milliseconds(interval), [this] { return _stopped; });
+      }
+   }
+   lock.unlock();
+
+   TL_RELEASE_SESSION_ID(session_id);
+}
+
+void BackgroundOptimizer::getLastError (std::string &message)
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   message = _last_error;
+}
+
+bool BackgroundOptimizer::_buildContainer ()
+{
+   {
+      ReadLock rlock(_lock_data);
+      if (!_index.getSimStorage().needsBuild(_inc_threshold))
+         return false;
+   }
+
+   ContainerSet::BuildTask task;
+   {
+      WriteLock wlock(_lock_data);
+      if (!_index.getSimStorage().startBuild(_inc_threshold, task))
+         return false;
+   }
+
+   MultibitTree tree(_index.getFingerprintParams().fingerprintSizeSim());
+   {
+      profTimerStart(t, "background_build");
+      tree.build(task.fingerprints, task.indices, task.count, task.min_ones_count, task.max_ones_count);
+   }
+
+   WriteLock wlock(_lock_data);
+   _index.getSimStorage().finishBuild(task, tree);
+   return true;
+}
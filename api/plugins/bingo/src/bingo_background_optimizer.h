@@ -0,0 +1,52 @@
+#ifndef __bingo_background_optimizer__
+#define __bingo_background_optimizer__
+
+#include "bingo_lock.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <string>
+
+namespace bingo
+{
+   class BaseIndex;
+
+   // Builds the similarity storage containers of the database in a separate
+   // thread. When the increment of a cell has enough rows, they are moved to
+   // a pending container under the write lock. The tree is built without the
+   // database lock and is set in place under the write lock again, so the
+   // searches never see a tree that is being built.
+   class BackgroundOptimizer
+   {
+   public:
+      BackgroundOptimizer (BaseIndex &index, DatabaseLockData &lock_data, int db_id, int inc_threshold);
+
+      // Waits for the current build to finish
+      ~BackgroundOptimizer ();
+
+      // Returns the error message of the last build, or an empty string if it
+      // succeeded. A failed build is retried with a growing interval.
+      void getLastError (std::string &message);
+
+   private:
+      void _run ();
+
+      // Builds one container. Returns false if there is nothing to build.
+      bool _buildContainer ();
+
+      BaseIndex &_index;
+      DatabaseLockData &_lock_data;
+      int _db_id;
+      int _inc_threshold;
+
+      std::thread _thread;
+      std::mutex _mutex;
+      std::condition_variable _cond;
+      bool _stopped;
+      std::string _last_error;
+      int _failures_count;
+   };
+};
+
+#endif // __bingo_background_optimizer__
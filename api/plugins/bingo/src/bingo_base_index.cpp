@@ -4,9 +4,11 @@
 
 #include "indigo_fingerprints.h"
 
+#include <fstream>
 #include <sstream>
 #include <string>
 #include <limits.h>
+#include <stdio.h>
 
 #include "base_cpp/profiling.h"
 #include "base_cpp/output.h"
@@ -21,28 +23,42 @@ static const char *_reaction_type = "reaction_" BINGO_VERSION;
 static const char *_molecule_type = "molecule_" BINGO_VERSION;
 static const int _type_len = 30;
 static const char *_mmf_file = "mmf_storage";
+static const char *_compact_mmf_file = "mmf_storage_compact";
+static const char *_backup_mmf_file = "mmf_storage_backup";
+static const char *_compact_marker_file = "mmf_storage_compact_done";
 static const char *_version_prop = "version";
 static const char *_read_only_prop = "read_only";
 static const char *_max_mmf_size_prop = "mmf_size";
 static const char *_min_mmf_size_prop = "first_mmf_size";
 static const char *_mt_size_prop = "mt_size";
 static const char *_id_key_prop = "key";
+static const char *_ext_sim_fp_prop = "ext_sim_fp";
+static const char *_bg_optimize_prop = "bg_optimize";
 static const size_t _min_mmf_size = 33554432; // 32Mb
 static const size_t _max_mmf_size = 536870912; // 500Mb
 static const int _small_base_size = 10000;
 static const int _sim_mt_size = 50000;
+static const int _write_portion_size = 256;
 
 BaseIndex::BaseIndex (IndexType type)
 {
    _type = type;
    _read_only = false;
+   _bg_optimize_threshold = 0;
    _index_id = -1;
 }
 
 void BaseIndex::create (const char *location, const MoleculeFingerprintParameters &fp_params, const char *options, int index_id)
+{
+   _create(location, _mmf_file, fp_params, options, index_id);
+}
+
+void BaseIndex::_create (const char *location, const char *mmf_file, const MoleculeFingerprintParameters &fp_params,
+                         const char *options, int index_id)
 {
    // TODO: introduce global parameters table, local parameters table and constants
    MMFStorage::setDatabaseId(index_id);
+   _index_id = index_id;
 
    int sub_block_size = 8192;
    int sim_block_size = 8192;
@@ -55,7 +71,7 @@ void BaseIndex::create (const char *location, const MoleculeFingerprintParameter
    std::string _cf_data_path = _location + _cf_data_filename;
    std::string _cf_offset_path = _location + _cf_offset_filename;
    std::string _mapping_path = _location + _id_mapping_filename;
-   std::string _mmf_path = _location + _mmf_file;
+   std::string _mmf_path = _location + mmf_file;
 
    _fp_params = fp_params;
 
@@ -65,6 +81,7 @@ void BaseIndex::create (const char *location, const MoleculeFingerprintParameter
    _checkOptions(option_map, true);
 
    _read_only = _getAccessType(option_map);
+   _bg_optimize_threshold = _getBgOptimizeThreshold(option_map);
 
    size_t min_mmf_size = _getMinMMfSize(option_map);
    size_t max_mmf_size = _getMaxMMfSize(option_map);
@@ -94,6 +111,7 @@ void BaseIndex::create (const char *location, const MoleculeFingerprintParameter
    _header->sim_offset = SimStorage::create(_sim_fp_storage, _fp_params.fingerprintSizeSim(), mt_size, _small_base_size);
    _header->exact_offset = ExactStorage::create(_exact_storage);
    _header->gross_offset = GrossStorage::create(_gross_storage, cf_block_size);
+   _header->deleted_offset = DeletedRowsStorage::create(_deleted_rows, sub_block_size);
 
    _header->first_free_id = 0;
    _header->object_count = 0;
@@ -102,6 +120,7 @@ void BaseIndex::create (const char *location, const MoleculeFingerprintParameter
 void BaseIndex::load (const char *location, const char *options, int index_id)
 {
    MMFStorage::setDatabaseId(index_id);
+   _index_id = index_id;
 
    if (osDirExists(location) == OS_DIR_NOTFOUND)
       throw Exception("database directory missed");
@@ -120,9 +139,11 @@ void BaseIndex::load (const char *location, const char *options, int index_id)
    _checkOptions(option_map, false);
 
    _read_only = _getAccessType(option_map);
+   _bg_optimize_threshold = _getBgOptimizeThreshold(option_map);
 
    BingoPtr<char> h_ptr;
 
+   _completeCompaction(_location);
    _mmf_storage.load(_mmf_path.c_str(), h_ptr, index_id, _read_only);
    
    _header = BingoPtr<_Header>(BingoAddr(0, MMFStorage::max_header_len + BingoAllocator::getAllocatorDataSize()));
@@ -132,7 +153,8 @@ void BaseIndex::load (const char *location, const char *options, int index_id)
    const char *ver = _properties->get(_version_prop);
 
    if (strcmp(ver, BINGO_VERSION) != 0)
-      throw Exception("BaseIndex: load(): incorrect database version");
+      throw Exception("BaseIndex: load(): database version %s is not supported, %s is expected. "
+                      "Create the database again and insert the records", ver, BINGO_VERSION);
 
    const char *type_str = (_type == MOLECULE ? _molecule_type : _reaction_type);
    if (strcmp(_properties->get("base_type"), type_str) != 0)
@@ -155,6 +177,7 @@ void BaseIndex::load (const char *location, const char *options, int index_id)
    TranspFpStorage::load(_sub_fp_storage, _header.ptr()->sub_offset);
    ByteBufferStorage::load(_cf_storage, _header.ptr()->cf_offset);
    GrossStorage::load(_gross_storage, _header.ptr()->gross_offset);
+   DeletedRowsStorage::load(_deleted_rows, _header.ptr()->deleted_offset);
 }
 
 int BaseIndex::add (/* const */ IndexObject &obj, int obj_id, DatabaseLockData &lock_data)
@@ -170,7 +193,7 @@ int BaseIndex::add (/* const */ IndexObject &obj, int obj_id, DatabaseLockData &
             throw Exception("insert fail: This id was already used");
    }
 
-   _ObjectIndexData _obj_data;
+   ObjectIndexData _obj_data;
    {
       profTimerStart(t_in, "prepare_obj_data");      
       _prepareIndexData(obj, _obj_data);
@@ -179,33 +202,7 @@ int BaseIndex::add (/* const */ IndexObject &obj, int obj_id, DatabaseLockData &
    WriteLock wlock(lock_data);
    profTimerStart(t_after, "exclusive_write");   
 
-   {
-      profTimerStart(t_in, "add_obj_data");   
-      _insertIndexData(_obj_data);
-   }
-
-   {
-      profTimerStart(t_in, "mapping_changing_1");      
-      if (obj_id == -1)
-      {
-         int i = _header->first_free_id;
-         while (back_id_mapping.get(i) != (size_t)-1)
-            i++;
-         
-         _header->first_free_id = i;
-
-         obj_id = _header->first_free_id;
-      }
-   }
-
-   int base_id = _header->object_count;
-   _header->object_count++;
-   {
-      profTimerStart(t_in, "mapping_changing_2");    
-      _mappingAdd(obj_id, base_id);
-   }
-   
-   return obj_id;
+   return _insertObject(_obj_data, obj_id);
 }
 
 int BaseIndex::addWithExtFP (/* const */ IndexObject &obj, int obj_id, DatabaseLockData &lock_data, IndigoObject &fp)
@@ -221,7 +218,7 @@ int BaseIndex::addWithExtFP (/* const */ IndexObject &obj, int obj_id, DatabaseL
             throw Exception("insert fail: This id was already used");
    }
 
-   _ObjectIndexData _obj_data;
+   ObjectIndexData _obj_data;
    {
       profTimerStart(t_in, "prepare_obj_data");      
       _prepareIndexDataWithExtFP(obj, _obj_data, fp);
@@ -230,33 +227,50 @@ int BaseIndex::addWithExtFP (/* const */ IndexObject &obj, int obj_id, DatabaseL
    WriteLock wlock(lock_data);
    profTimerStart(t_after, "exclusive_write");   
 
-   {
-      profTimerStart(t_in, "add_obj_data");   
-      _insertIndexData(_obj_data);
-   }
+   // Similarity fingerprints can't be rebuilt from the stored objects
+   if (_properties->getULongNoThrow(_ext_sim_fp_prop) != 1)
+      _properties->add(_ext_sim_fp_prop, 1ul);
+
+   return _insertObject(_obj_data, obj_id);
+}
+
+bool BaseIndex::prepareObject (IndexObject &obj, ObjectIndexData &obj_data)
+{
+   return _prepareIndexData(obj, obj_data);
+}
 
+int BaseIndex::addPrepared (ObjArray<ObjectIndexData> &objs_data, const Array<bool> &prepared,
+                            Array<int> &obj_ids, DatabaseLockData &lock_data)
+{
+   if (_read_only)
+      throw Exception("insert fail: Read only index can't be changed");
+
+   BingoMapping & back_id_mapping = _back_id_mapping_ptr.ref();
+
+   int inserted_count = 0;
+   for (int first = 0; first < objs_data.size(); first += _write_portion_size)
    {
-      profTimerStart(t_in, "mapping_changing_1");      
-      if (obj_id == -1)
+      WriteLock wlock(lock_data);
+      profTimerStart(t_after, "exclusive_write_batch");
+
+      int end = __min(first + _write_portion_size, objs_data.size());
+      for (int i = first; i < end; i++)
       {
-         int i = _header->first_free_id;
-         while (back_id_mapping.get(i) != (size_t)-1)
-            i++;
-         
-         _header->first_free_id = i;
+         int obj_id = obj_ids[i];
 
-         obj_id = _header->first_free_id;
+         if (!prepared[i] || (obj_id != -1 && back_id_mapping.get(obj_id) != (size_t)-1))
+         {
+            obj_ids[i] = -1;
+            continue;
+         }
+
+         obj_ids[i] = _insertObject(objs_data[i], obj_id);
+         inserted_count++;
       }
    }
 
-   int base_id = _header->object_count;
-   _header->object_count++;
-   {
-      profTimerStart(t_in, "mapping_changing_2");    
-      _mappingAdd(obj_id, base_id);
-   }
-   
-   return obj_id;
+   profIncCounter("batch_inserted", inserted_count);
+   return inserted_count;
 }
 
 void BaseIndex::optimize ()
@@ -277,10 +291,109 @@ void BaseIndex::remove (int obj_id)
    if (obj_id < 0 || back_id_mapping.get(obj_id) == (size_t)-1)
       throw Exception("There is no object with this id");
 
-   _cf_storage->remove(back_id_mapping.get(obj_id));
+   int base_id = (int)back_id_mapping.get(obj_id);
+
+   _cf_storage->remove(base_id);
+   _deleted_rows->remove(base_id);
    _mappingRemove(obj_id);
 }
 
+void BaseIndex::compact (BaseIndex &target, int target_index_id, int &reclaimed_rows, qword &reclaimed_bytes)
+{
+   if (_read_only)
+      throw Exception("compact fail: Read only index can't be changed");
+
+   if (_properties->getULongNoThrow(_ext_sim_fp_prop) == 1)
+      throw Exception("compact fail: index with external similarity fingerprints can't be compacted");
+
+   profTimerStart(t, "compact");
+
+   std::string compact_path = _location + _compact_mmf_file;
+   std::string marker_path = _location + _compact_marker_file;
+
+   std::string options;
+   _getCreateOptions(options);
+
+   if (target._type != _type)
+      throw Exception("compact fail: incorrect target index type");
+
+   try
+   {
+      _removeStorage(compact_path);
+      target._create(_location.c_str(), _compact_mmf_file, _fp_params, options.c_str(), target_index_id);
+
+      _copyLiveRecords(target);
+   }
+   catch (...)
+   {
+      // The current storage is untouched, the partial copy is removed by
+      // the next compaction
+      target._mmf_storage.close();
+      MMFStorage::setDatabaseId(_index_id);
+      throw;
+   }
+
+   MMFStorage::setDatabaseId(target._index_id);
+   int new_count = target._header->object_count;
+   qword new_size = BingoAllocator::getAllocatedSize();
+
+   MMFStorage::setDatabaseId(_index_id);
+   reclaimed_rows = _header->object_count - new_count;
+
+   qword old_size = BingoAllocator::getAllocatedSize();
+   reclaimed_bytes = (old_size > new_size ? old_size - new_size : 0);
+
+   target._mmf_storage.close();
+
+   // The marker commits the compaction. It is written under a temporary name
+   // and renamed, so it either holds the number of the compacted files or
+   // doesn't exist. Once it is in place the compacted files replace the
+   // current ones, by this call or by the next load() if the process dies.
+   std::string backup_path = _location + _backup_mmf_file;
+   std::string marker_tmp_path = marker_path + ".tmp";
+   int files_count = _countStorage(compact_path);
+
+   _removeStorage(backup_path);
+   {
+      std::ofstream marker(marker_tmp_path.c_str());
+      marker << files_count;
+      marker.close();
+
+      if (marker.fail() || rename(marker_tmp_path.c_str(), marker_path.c_str()) != 0)
+      {
+         ::remove(marker_tmp_path.c_str());
+         throw Exception("compact fail: can't write %s", marker_path.c_str());
+      }
+   }
+
+   _mmf_storage.close();
+
+   int bg_optimize_threshold = _bg_optimize_threshold;
+   try
+   {
+      _completeCompaction(_location);
+   }
+   catch (...)
+   {
+      // The current files are only moved aside until the marker is removed,
+      // so they can be put back. If that fails too, the marker stays and
+      // load() completes the compaction instead.
+      try
+      {
+         _rollbackCompaction(_location, files_count);
+      }
+      catch (Exception &)
+      {
+      }
+      load(_location.c_str(), "", _index_id);
+      _bg_optimize_threshold = bg_optimize_threshold;
+      throw;
+   }
+
+   load(_location.c_str(), "", _index_id);
+   _bg_optimize_threshold = bg_optimize_threshold;
+}
+
 const MoleculeFingerprintParameters & BaseIndex::getFingerprintParams () const
 {
    return _fp_params;
@@ -306,6 +419,11 @@ GrossStorage & BaseIndex::getGrossStorage ()
    return _gross_storage.ref();
 }
 
+DeletedRowsStorage & BaseIndex::getDeletedRows ()
+{
+   return _deleted_rows.ref();
+}
+
 BingoArray<int> & BaseIndex::getIdMapping ()
 {
    return _id_mapping_ptr.ref();
@@ -351,26 +469,45 @@ Index::IndexType BaseIndex::getType () const
    return _type;
 }
 
+bool BaseIndex::isReadOnly () const
+{
+   return _read_only;
+}
+
+int BaseIndex::getBgOptimizeThreshold () const
+{
+   return _bg_optimize_threshold;
+}
+
 Index::IndexType BaseIndex::determineType (const char *location)
 {
    std::string path(location);
    path += '/';
+   _completeCompaction(path);
    path += _mmf_file;
    path += '0';
    std::ifstream file(path, std::ios::binary | std::ios::in);
    
    //bool res = file.good();
 
-   char type[_type_len];
+   char type[_type_len] = {0};
    file.seekg(0);
    file.read(type, _type_len);
+   type[_type_len - 1] = 0;
 
    if (strcmp(type, _molecule_type) == 0)
       return MOLECULE;
    else if (strcmp(type, _reaction_type) == 0)
       return REACTION;
-   else
-      throw Exception("BingoIndex: determineType(): Database format is not compatible with this version.");
+
+   // The type is followed by the version, see BINGO_VERSION
+   const char *version = strchr(type, '_');
+
+   if (version != 0 && (strncmp(type, "molecule_", 9) == 0 || strncmp(type, "reaction_", 9) == 0))
+      throw Exception("BingoIndex: determineType(): database version %s is not supported, %s is expected. "
+                      "Create the database again and insert the records", version + 1, BINGO_VERSION);
+
+   throw Exception("BingoIndex: determineType(): Database format is not compatible with this version.");
 }
 
 BaseIndex::~BaseIndex()
@@ -378,6 +515,232 @@ BaseIndex::~BaseIndex()
    _mmf_storage.close();
 }
 
+void BaseIndex::_getCreateOptions (std::string &options)
+{
+   const char *create_props[] = {_max_mmf_size_prop, _min_mmf_size_prop, _mt_size_prop, _id_key_prop};
+
+   options.clear();
+   for (int i = 0; i < NELEM(create_props); i++)
+   {
+      const char *value = _properties->getNoThrow(create_props[i]);
+      if (value == 0)
+         continue;
+
+      if (!options.empty())
+         options += ';';
+      options += create_props[i];
+      options += ':';
+      options += value;
+   }
+}
+
+void BaseIndex::_copyLiveRecords (BaseIndex &target)
+{
+   QS_DEF(Array<char>, cf_str);
+   QS_DEF(Molecule, mol);
+   QS_DEF(Reaction, rxn);
+
+   // Storages of both indexes are accessed through the current database id
+   MMFStorage::setDatabaseId(_index_id);
+   int object_count = _header->object_count;
+
+   for (int base_id = 0; base_id < object_count; base_id++)
+   {
+      MMFStorage::setDatabaseId(_index_id);
+
+      if (_deleted_rows->isRemoved(base_id))
+         continue;
+
+      int obj_id = _id_mapping_ptr.ref()[base_id];
+
+      int cf_len;
+      const byte *cf_buf = _cf_storage->get(base_id, cf_len);
+      if (cf_len == -1)
+         continue;
+
+      cf_str.copy((const char *)cf_buf, cf_len);
+
+      // Fingerprints, hash and gross formula are built again from the stored object
+      ObjectIndexData obj_data;
+      BufferScanner buf_scn(cf_str);
+      bool prepared;
+
+      if (_type == MOLECULE)
+      {
+         CmfLoader cmf_loader(buf_scn);
+         cmf_loader.loadMolecule(mol);
+
+         IndexMolecule ind_mol(mol);
+         prepared = target._prepareIndexData(ind_mol, obj_data);
+      }
+      else
+      {
+         CrfLoader crf_loader(buf_scn);
+         crf_loader.loadReaction(rxn);
+
+         IndexReaction ind_rxn(rxn);
+         prepared = target._prepareIndexData(ind_rxn, obj_data);
+      }
+
+      if (!prepared)
+         throw Exception("compact fail: can't prepare the object with id=%d", obj_id);
+
+      obj_data.cf_str.copy(cf_str);
+
+      MMFStorage::setDatabaseId(target._index_id);
+
+      target._insertIndexData(obj_data);
+      int new_base_id = target._header->object_count;
+      target._header->object_count++;
+      target._mappingAdd(obj_id, new_base_id);
+   }
+
+   MMFStorage::setDatabaseId(_index_id);
+   int first_free_id = _header->first_free_id;
+
+   MMFStorage::setDatabaseId(target._index_id);
+   target._header->first_free_id = first_free_id;
+}
+
+void BaseIndex::_renameStorage (const std::string &from_path, const std::string &to_path)
+{
+   for (int i = 0; ; i++)
+   {
+      std::ostringstream from_name, to_name;
+      from_name << from_path << i;
+      to_name << to_path << i;
+
+      if (!std::ifstream(from_name.str().c_str()).good())
+         break;
+
+      if (rename(from_name.str().c_str(), to_name.str().c_str()) != 0)
+         throw Exception("BaseIndex: can't rename %s", from_name.str().c_str());
+   }
+}
+
+int BaseIndex::_countStorage (const std::string &mmf_path)
+{
+   int count = 0;
+
+   for (;; count++)
+   {
+      std::ostringstream name;
+      name << mmf_path << count;
+
+      if (!std::ifstream(name.str().c_str()).good())
+         break;
+   }
+
+   return count;
+}
+
+static bool _storageFileExists (const std::string &mmf_path, int i, std::string &name)
+{
+   std::ostringstream name_stream;
+   name_stream << mmf_path << i;
+   name = name_stream.str();
+
+   return std::ifstream(name.c_str()).good();
+}
+
+void BaseIndex::_completeCompaction (const std::string &location)
+{
+   std::string mmf_path = location + _mmf_file;
+   std::string compact_path = location + _compact_mmf_file;
+   std::string backup_path = location + _backup_mmf_file;
+   std::string marker_path = location + _compact_marker_file;
+
+   std::ifstream marker(marker_path.c_str());
+   if (!marker.good())
+      return;
+
+   int files_count = 0;
+   marker >> files_count;
+   marker.close();
+
+   if (files_count <= 0)
+      throw Exception("BaseIndex: incorrect compaction marker %s", marker_path.c_str());
+
+   // Every step can be repeated after a crash. A current file is one that
+   // has no compacted file left to take its place, or one beyond them.
+   std::string name, compact_name, backup_name;
+   for (int i = 0; ; i++)
+   {
+      bool exists = _storageFileExists(mmf_path, i, name);
+      bool has_compact = (i < files_count && _storageFileExists(compact_path, i, compact_name));
+
+      if (i >= files_count && !exists && !_storageFileExists(backup_path, i, backup_name))
+         break;
+
+      if (exists && (i >= files_count || has_compact))
+      {
+         _storageFileExists(backup_path, i, backup_name);
+         if (rename(name.c_str(), backup_name.c_str()) != 0)
+            throw Exception("BaseIndex: can't rename %s", name.c_str());
+      }
+   }
+
+   for (int i = 0; i < files_count; i++)
+   {
+      if (!_storageFileExists(compact_path, i, compact_name))
+         continue;
+
+      _storageFileExists(mmf_path, i, name);
+      if (rename(compact_name.c_str(), name.c_str()) != 0)
+         throw Exception("BaseIndex: can't rename %s", compact_name.c_str());
+   }
+
+   if (::remove(marker_path.c_str()) != 0)
+      throw Exception("BaseIndex: can't remove %s", marker_path.c_str());
+
+   _removeStorage(backup_path);
+}
+
+void BaseIndex::_rollbackCompaction (const std::string &location, int files_count)
+{
+   std::string mmf_path = location + _mmf_file;
+   std::string compact_path = location + _compact_mmf_file;
+   std::string backup_path = location + _backup_mmf_file;
+   std::string marker_path = location + _compact_marker_file;
+
+   std::string name, compact_name, backup_name;
+   for (int i = 0; i < files_count; i++)
+   {
+      if (_storageFileExists(compact_path, i, compact_name) || !_storageFileExists(mmf_path, i, name))
+         continue;
+
+      if (rename(name.c_str(), compact_name.c_str()) != 0)
+         throw Exception("BaseIndex: can't rename %s", name.c_str());
+   }
+
+   // The current files that are still in place were never moved aside
+   for (int i = 0; _storageFileExists(backup_path, i, backup_name); i++)
+   {
+      if (_storageFileExists(mmf_path, i, name))
+         continue;
+
+      if (rename(backup_name.c_str(), name.c_str()) != 0)
+         throw Exception("BaseIndex: can't rename %s", backup_name.c_str());
+   }
+
+   if (::remove(marker_path.c_str()) != 0)
+      throw Exception("BaseIndex: can't remove %s", marker_path.c_str());
+}
+
+void BaseIndex::_removeStorage (const std::string &mmf_path)
+{
+   // From the last file, so that the rest stay numbered contiguously if
+   // this is interrupted
+   for (int i = _countStorage(mmf_path) - 1; i >= 0; i--)
+   {
+      std::ostringstream name;
+      name << mmf_path << i;
+
+      if (::remove(name.str().c_str()) != 0)
+         throw Exception("BaseIndex: can't remove %s", name.str().c_str());
+   }
+}
+
 void BaseIndex::_checkOptions (std::map<std::string, std::string> &option_map, bool is_create)
 {
    for(std::map<std::string, std::string>::iterator it = option_map.begin(); 
@@ -389,11 +752,13 @@ void BaseIndex::_checkOptions (std::map<std::string, std::string> &option_map, b
              (it->first.compare(_mt_size_prop) != 0) && 
              (it->first.compare(_min_mmf_size_prop) != 0) &&
              (it->first.compare(_max_mmf_size_prop) != 0) &&
-             (it->first.compare(_id_key_prop) != 0))
+             (it->first.compare(_id_key_prop) != 0) &&
+             (it->first.compare(_bg_optimize_prop) != 0))
             throw Exception("Creating index error: incorrect input options");
       }
       else if ((it->first.compare(_read_only_prop)) != 0 &&
-               (it->first.compare(_id_key_prop) != 0))
+               (it->first.compare(_id_key_prop) != 0) &&
+               (it->first.compare(_bg_optimize_prop) != 0))
          throw Exception("Loading index error: incorrect input options");
    }
 }
@@ -449,6 +814,20 @@ bool BaseIndex::_getAccessType (std::map<std::string, std::string> &option_map)
    return false;
 }
 
+int BaseIndex::_getBgOptimizeThreshold (std::map<std::string, std::string> &option_map)
+{
+   if (option_map.find(_bg_optimize_prop) == option_map.end())
+      return 0;
+
+   unsigned long u_dec = 0;
+   std::istringstream isstr(option_map[_bg_optimize_prop]);
+   isstr >> u_dec;
+
+   if (isstr.fail() || u_dec > INT_MAX)
+      throw Exception("BaseIndex: incorrect %s option value", _bg_optimize_prop);
+
+   return (int)u_dec;
+}
 
 void BaseIndex::_saveProperties (const MoleculeFingerprintParameters &fp_params, int sub_block_size, 
                                  int sim_block_size, int cf_block_size, 
@@ -473,7 +852,7 @@ void BaseIndex::_saveProperties (const MoleculeFingerprintParameters &fp_params,
    }
 }
 
-bool BaseIndex::_prepareIndexData (IndexObject &obj, _ObjectIndexData &obj_data)
+bool BaseIndex::_prepareIndexData (IndexObject &obj, ObjectIndexData &obj_data)
 {
    {
       profTimerStart(t, "prepare_cf");
@@ -499,7 +878,7 @@ bool BaseIndex::_prepareIndexData (IndexObject &obj, _ObjectIndexData &obj_data)
    return true;
 }
 
-bool BaseIndex::_prepareIndexDataWithExtFP (IndexObject &obj, _ObjectIndexData &obj_data, IndigoObject &fp)
+bool BaseIndex::_prepareIndexDataWithExtFP (IndexObject &obj, ObjectIndexData &obj_data, IndigoObject &fp)
 {
    {
       profTimerStart(t, "prepare_cf");
@@ -530,7 +909,7 @@ bool BaseIndex::_prepareIndexDataWithExtFP (IndexObject &obj, _ObjectIndexData &
    return true;
 }
 
-void BaseIndex::_insertIndexData (_ObjectIndexData &obj_data)
+void BaseIndex::_insertIndexData (ObjectIndexData &obj_data)
 {
    _sub_fp_storage.ptr()->add(obj_data.sub_fp.ptr());
    _sim_fp_storage.ptr()->add(obj_data.sim_fp.ptr(), _header->object_count);
@@ -539,6 +918,39 @@ void BaseIndex::_insertIndexData (_ObjectIndexData &obj_data)
    _gross_storage.ptr()->add(obj_data.gross_str, _header->object_count);
 }
 
+int BaseIndex::_insertObject (ObjectIndexData &obj_data, int obj_id)
+{
+   BingoMapping & back_id_mapping = _back_id_mapping_ptr.ref();
+
+   {
+      profTimerStart(t_in, "add_obj_data");   
+      _insertIndexData(obj_data);
+   }
+
+   {
+      profTimerStart(t_in, "mapping_changing_1");      
+      if (obj_id == -1)
+      {
+         int i = _header->first_free_id;
+         while (back_id_mapping.get(i) != (size_t)-1)
+            i++;
+         
+         _header->first_free_id = i;
+
+         obj_id = _header->first_free_id;
+      }
+   }
+
+   int base_id = _header->object_count;
+   _header->object_count++;
+   {
+      profTimerStart(t_in, "mapping_changing_2");    
+      _mappingAdd(obj_id, base_id);
+   }
+   
+   return obj_id;
+}
+
 void BaseIndex::_mappingLoad ()
 {
    _id_mapping_ptr = BingoPtr< BingoArray<int> >(_header->mapping_offset);
@@ -11,10 +11,15 @@
 #include "bingo_exact_storage.h"
 #include "bingo_gross_storage.h"
 #include "bingo_sim_storge.h"
+#include "bingo_deleted_rows.h"
 #include "bingo_lock.h"
 #include "indigo_internal.h"
 
-#define BINGO_VERSION "v0.72"
+// Version of the database files. v0.73 adds the deleted rows storage to the
+// header and keeps the similarity increments bucketed by popcount, so the
+// databases of v0.72 are not loaded and have to be created again from the
+// source records.
+#define BINGO_VERSION "v0.73"
 
 using namespace indigo;
 
@@ -56,11 +61,23 @@ namespace bingo
 
       virtual IndexType getType () const = 0;
 
+      virtual bool isReadOnly () const = 0;
+
       virtual ~Index () {};
    };
 
    class BaseIndex : public Index
    {
+   public:
+      struct ObjectIndexData 
+      {
+         Array<byte> sub_fp;
+         Array<byte> sim_fp;
+         Array<char> cf_str;
+         Array<char> gross_str;
+         dword hash;
+      };
+
    private:   
       struct _Header
       {
@@ -72,6 +89,7 @@ namespace bingo
          BingoAddr sim_offset;
          BingoAddr exact_offset;
          BingoAddr gross_offset;
+         BingoAddr deleted_offset;
          int object_count;
          int first_free_id;
       };
@@ -85,10 +103,29 @@ namespace bingo
 
       virtual int addWithExtFP (IndexObject &obj, int obj_id, DatabaseLockData &lock_data, IndigoObject &fp);
 
+      // Builds the index data of the object. The storage is not accessed,
+      // so the objects can be prepared in parallel.
+      bool prepareObject (IndexObject &obj, ObjectIndexData &obj_data);
+
+      // Inserts the prepared objects. The write lock is taken for each portion
+      // of 256 objects, so searches are not blocked for the whole batch.
+      // obj_ids[i] is the requested id of the i-th object (-1 for a new id)
+      // and receives the inserted id or -1 if the object is not prepared or
+      // its id is already used. Returns the number of inserted objects.
+      int addPrepared (ObjArray<ObjectIndexData> &objs_data, const Array<bool> &prepared,
+                       Array<int> &obj_ids, DatabaseLockData &lock_data);
+
       virtual void optimize ();
 
       virtual void remove (int id);
 
+      // Rewrites the storage of the index without the removed rows. The live
+      // rows are copied into the empty target index that is created in the new
+      // files with the given id, then the files are swapped and the index is
+      // reloaded. External ids of the objects are kept. The swap is committed
+      // by a marker file and completed by load() if it was interrupted.
+      void compact (BaseIndex &target, int target_index_id, int &reclaimed_rows, qword &reclaimed_bytes);
+
       const MoleculeFingerprintParameters & getFingerprintParams () const;
 
       TranspFpStorage & getSubStorage ();
@@ -99,6 +136,8 @@ namespace bingo
       
       GrossStorage & getGrossStorage ();
 
+      DeletedRowsStorage & getDeletedRows ();
+
       BingoArray<int> & getIdMapping ();
 
       BingoMapping & getBackIdMapping ();
@@ -115,6 +154,13 @@ namespace bingo
 
       virtual IndexType getType () const;
 
+      virtual bool isReadOnly () const;
+
+      // Minimal number of the increment rows of a similarity storage cell
+      // that are built into a container by the background optimizer
+      // ("bg_optimize" option). Returns 0 if the optimizer is off.
+      int getBgOptimizeThreshold () const;
+
       static IndexType determineType (const char *location);
 
       virtual ~BaseIndex ();
@@ -123,17 +169,9 @@ namespace bingo
       BaseIndex (IndexType type);
       IndexType _type;
       bool _read_only;
+      int _bg_optimize_threshold;
 
    private:
-      struct _ObjectIndexData 
-      {
-         Array<byte> sub_fp;
-         Array<byte> sim_fp;
-         Array<char> cf_str;
-         Array<char> gross_str;
-         dword hash;
-      };
-
       MMFStorage _mmf_storage;
       BingoPtr<_Header> _header;
       BingoPtr< BingoArray<int> > _id_mapping_ptr;
@@ -143,6 +181,7 @@ namespace bingo
       BingoPtr<ExactStorage> _exact_storage;
       BingoPtr<GrossStorage> _gross_storage;
       BingoPtr<ByteBufferStorage> _cf_storage;
+      BingoPtr<DeletedRowsStorage> _deleted_rows;
       BingoPtr<Properties> _properties;
       
       MoleculeFingerprintParameters _fp_params;
@@ -150,6 +189,27 @@ namespace bingo
 
       int _index_id;
 
+      void _create (const char *location, const char *mmf_file, const MoleculeFingerprintParameters &fp_params,
+                    const char *options, int index_id);
+
+      void _getCreateOptions (std::string &options);
+
+      void _copyLiveRecords (BaseIndex &target);
+
+      static void _renameStorage (const std::string &from_path, const std::string &to_path);
+
+      static void _removeStorage (const std::string &mmf_path);
+
+      static int _countStorage (const std::string &mmf_path);
+
+      // Replaces the storage files with the compacted ones if the compaction
+      // was committed but not finished
+      static void _completeCompaction (const std::string &location);
+
+      // Puts the current storage files back if the compaction couldn't be
+      // completed
+      static void _rollbackCompaction (const std::string &location, int files_count);
+
       static void _checkOptions (std::map<std::string, std::string> &option_map, bool is_create);
 
       static size_t _getMinMMfSize (std::map<std::string, std::string> &option_map);
@@ -158,15 +218,19 @@ namespace bingo
 
       static bool _getAccessType (std::map<std::string, std::string> &option_map);
 
+      static int _getBgOptimizeThreshold (std::map<std::string, std::string> &option_map);
+
       void _saveProperties (const MoleculeFingerprintParameters &fp_params, int sub_block_size, 
                             int sim_block_size, int cf_block_size, 
                             std::map<std::string, std::string> &option_map);
 
-      bool _prepareIndexData (IndexObject &obj, _ObjectIndexData &obj_data);
+      bool _prepareIndexData (IndexObject &obj, ObjectIndexData &obj_data);
+
+      bool _prepareIndexDataWithExtFP (IndexObject &obj, ObjectIndexData &obj_data, IndigoObject &fp);
 
-      bool _prepareIndexDataWithExtFP (IndexObject &obj, _ObjectIndexData &obj_data, IndigoObject &fp);
+      void _insertIndexData(ObjectIndexData &obj_data);
 
-      void _insertIndexData(_ObjectIndexData &obj_data);
+      int _insertObject (ObjectIndexData &obj_data, int obj_id);
 
       void _mappingCreate ();
 
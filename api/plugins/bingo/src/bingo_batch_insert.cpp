@@ -0,0 +1,125 @@
+#include "bingo_batch_insert.h"
+
+#include "bingo_object.h"
+
+#include "indigo_internal.h"
+#include "indigo_molecule.h"
+#include "indigo_reaction.h"
+
+#include "base_cpp/profiling.h"
+
+using namespace indigo;
+using namespace bingo;
+
+// Number of records that are prepared by one command
+static const int _RECORDS_PER_COMMAND = 64;
+
+namespace
+{
+   class BatchPrepareCommand : public OsCommand
+   {
+   public:
+      virtual void clear ()
+      {
+         first = 0;
+         count = 0;
+      }
+
+      virtual void execute (OsCommandResult &result)
+      {
+         for (int i = first; i < first + count; i++)
+            dispatcher->prepareRecord(i);
+      }
+
+      BatchPrepareDispatcher *dispatcher;
+      int first;
+      int count;
+   };
+}
+
+BatchPrepareDispatcher::BatchPrepareDispatcher (BaseIndex &index, const AromaticityOptions &arom_options,
+                                                const Array<IndigoObject *> &objects) :
+   OsCommandDispatcher(HANDLING_ORDER_ANY, false),
+   _index(index), _arom_options(arom_options), _objects(objects)
+{
+   _objs_data = 0;
+   _prepared = 0;
+   _next_record = 0;
+}
+
+void BatchPrepareDispatcher::prepare (int threads_count, ObjArray<BaseIndex::ObjectIndexData> &objs_data,
+                                      Array<bool> &prepared)
+{
+   profTimerStart(t, "batch_prepare");
+
+   objs_data.clear();
+   for (int i = 0; i < _objects.size(); i++)
+      objs_data.push();
+
+   prepared.clear_resize(_objects.size());
+   prepared.fill(false);
+
+   _objs_data = &objs_data;
+   _prepared = &prepared;
+   _next_record = 0;
+
+   // Small batches are not worth the threads start
+   if (_objects.size() <= _RECORDS_PER_COMMAND)
+      threads_count = 0;
+
+   run(threads_count);
+}
+
+void BatchPrepareDispatcher::prepareRecord (int idx)
+{
+   if (_objects[idx] == 0)
+      return;
+
+   IndigoObject &obj = *_objects[idx];
+   BaseIndex::ObjectIndexData &obj_data = _objs_data->at(idx);
+
+   try
+   {
+      if (_index.getType() == Index::MOLECULE)
+      {
+         if (!IndigoMolecule::is(obj))
+            return;
+
+         obj.getBaseMolecule().aromatize(_arom_options);
+         IndexMolecule ind_mol(obj.getMolecule());
+         _prepared->at(idx) = _index.prepareObject(ind_mol, obj_data);
+      }
+      else
+      {
+         if (!IndigoReaction::is(obj))
+            return;
+
+         obj.getBaseReaction().aromatize(_arom_options);
+         IndexReaction ind_rxn(obj.getReaction());
+         _prepared->at(idx) = _index.prepareObject(ind_rxn, obj_data);
+      }
+   }
+   catch (Exception &)
+   {
+      _prepared->at(idx) = false;
+   }
+}
+
+OsCommand * BatchPrepareDispatcher::_allocateCommand ()
+{
+   BatchPrepareCommand *command = new BatchPrepareCommand();
+   command->dispatcher = this;
+   return command;
+}
+
+bool BatchPrepareDispatcher::_setupCommand (OsCommand &command)
+{
+   if (_next_record >= _objects.size())
+      return false;
+
+   BatchPrepareCommand &prepare_command = (BatchPrepareCommand &)command;
+   prepare_command.first = _next_record;
+   prepare_command.count = __min(_RECORDS_PER_COMMAND, _objects.size() - _next_record);
+   _next_record += prepare_command.count;
+   return true;
+}
@@ -0,0 +1,55 @@
+#ifndef __bingo_batch_insert__
+#define __bingo_batch_insert__
+
+#include "base_cpp/os_thread_wrapper.h"
+#include "base_cpp/obj_array.h"
+#include "base_cpp/array.h"
+#include "molecule/molecule_arom.h"
+
+#include "bingo_base_index.h"
+
+class IndigoObject;
+
+using namespace indigo;
+
+namespace bingo
+{
+   // Builds the index data (CF, gross formula, fingerprints and hash) of the
+   // batch records in the worker threads. Records are handed out by portions,
+   // each record is written into its own slot, so no locking is needed.
+   // The prepared data is inserted by BaseIndex::addPrepared. Objects must be
+   // loaded before the dispatcher is run, null objects are treated as failed
+   // records.
+   // A batch is processed by chunks of CHUNK_SIZE objects, so the memory of
+   // the loaded objects and their index data is bounded.
+   class BatchPrepareDispatcher : public OsCommandDispatcher
+   {
+   public:
+      enum { CHUNK_SIZE = 4096 };
+
+      BatchPrepareDispatcher (BaseIndex &index, const AromaticityOptions &arom_options,
+                              const Array<IndigoObject *> &objects);
+
+      // Fills objs_data and prepared for each object
+      void prepare (int threads_count, ObjArray<BaseIndex::ObjectIndexData> &objs_data,
+                    Array<bool> &prepared);
+
+      void prepareRecord (int idx);
+
+   protected:
+      virtual OsCommand * _allocateCommand ();
+
+      virtual bool _setupCommand (OsCommand &command);
+
+   private:
+      BaseIndex &_index;
+      AromaticityOptions _arom_options;
+      const Array<IndigoObject *> &_objects;
+
+      ObjArray<BaseIndex::ObjectIndexData> *_objs_data;
+      Array<bool> *_prepared;
+      int _next_record;
+   };
+};
+
+#endif // __bingo_batch_insert__
@@ -7,6 +7,8 @@ ContainerSet::ContainerSet()
 {
    _inc_count = 0;
    _inc_total_ones_count = 0;
+   _pending_idx = -1;
+   _pending_count = 0;
 }
 
 void ContainerSet::setParams( int fp_size, int container_size, int min_ones_count, int max_ones_count)
@@ -19,6 +21,10 @@ void ContainerSet::setParams( int fp_size, int container_size, int min_ones_coun
 
    _increment.allocate(_container_size * _fp_size);
    _indices.allocate(_container_size);
+   _inc_buckets.init(_fp_size, _container_size);
+
+   _pending_idx = -1;
+   _pending_count = 0;
 }
 
 int ContainerSet::getContCount() const
@@ -44,9 +50,11 @@ bool ContainerSet::add (const byte *fingerprint, int id, int fp_ones_count)
    byte *inc = _increment.ptr();
    int *indices = _indices.ptr();
 
-   memcpy(inc + _inc_count * _fp_size, fingerprint, _fp_size);
-   indices[_inc_count] = id;
-   _inc_total_ones_count += (fp_ones_count == -1 ? bitGetOnesCount(fingerprint, _fp_size) : fp_ones_count);
+   if (fp_ones_count == -1)
+      fp_ones_count = bitGetOnesCount(fingerprint, _fp_size);
+
+   _inc_buckets.add(inc, indices, fingerprint, id, fp_ones_count);
+   _inc_total_ones_count += fp_ones_count;
    _inc_count++;
 
    if (_inc_count == _container_size)
@@ -64,6 +72,7 @@ void ContainerSet::buildContainer ()
    cont.build(_increment, _indices, _container_size, _min_ones_count, _max_ones_count);
    _increment.allocate(_container_size * _fp_size);
    _indices.allocate(_container_size);
+   _inc_buckets.clear();
 
    _inc_count = 0;
 }
@@ -81,21 +90,34 @@ void ContainerSet::splitSet (ContainerSet &new_set)
 
    _inc_total_ones_count = 0;
    new_set._inc_total_ones_count = 0;
+
+   // Rows are reordered by the buckets on insertion, so the increment is
+   // copied before it is distributed between the sets
+   QS_DEF(Array<byte>, fps);
+   QS_DEF(Array<int>, ids);
+   QS_DEF(Array<int>, ones_counts);
+   fps.copy(_increment.ptr(), _inc_count * _fp_size);
+   ids.copy(_indices.ptr(), _inc_count);
+   ones_counts.clear_resize(_inc_count);
+   for (int i = 0; i < _inc_count; i++)
+      ones_counts[i] = _inc_buckets.getOnesCount(i);
+
+   _inc_buckets.clear();
+   new_set._inc_buckets.clear();
    for (int i = 0; i < _inc_count; i++)
    {
-      int ones_count = bitGetOnesCount(_increment.ptr() + i * _fp_size, _fp_size);
+      int ones_count = ones_counts[i];
       
       if (ones_count < new_border)
       {
-         memcpy(_increment.ptr() + inc_count_cur * _fp_size, _increment.ptr() + i * _fp_size, _fp_size);
-         _indices[inc_count_cur] = (int)_indices[i];
+         _inc_buckets.add(_increment.ptr(), _indices.ptr(), fps.ptr() + i * _fp_size, ids[i], ones_count);
          inc_count_cur++;
          _inc_total_ones_count += ones_count;
       }
       else
       {
-         memcpy(new_set._increment.ptr() + new_set._inc_count * _fp_size, _increment.ptr() + i * _fp_size, _fp_size);
-         new_set._indices[new_set._inc_count] = (int)_indices[i];
+         new_set._inc_buckets.add(new_set._increment.ptr(), new_set._indices.ptr(),
+                                  fps.ptr() + i * _fp_size, ids[i], ones_count);
          new_set._inc_count++;
          new_set._inc_total_ones_count += ones_count;
       }
@@ -120,9 +142,12 @@ void ContainerSet::findSimilar (const byte *query, SimCoef &sim_coef, double min
    QS_DEF(Array<SimResult>, cell_sim_indices);
    for (int i = 0; i < _set.size(); i++)
    {
-      MultibitTree &container = _set[i];
       cell_sim_indices.clear();
-      container.findSimilar(query, sim_coef, min_coef, cell_sim_indices);
+      if (i == _pending_idx)
+         _findSimilarRows(_pending_buckets, _pending.ptr(), _pending_indices.ptr(), query, sim_coef, min_coef,
+                          cell_sim_indices);
+      else
+         _set[i].findSimilar(query, sim_coef, min_coef, cell_sim_indices);
 
       sim_indices.concat(cell_sim_indices);
    }
@@ -136,6 +161,13 @@ void ContainerSet::findSimilar (const byte *query, SimCoef &sim_coef, double min
 
 void ContainerSet::optimize()
 {
+   if (_pending_idx != -1)
+   {
+      _set[_pending_idx].build(_pending, _pending_indices, _pending_count, _min_ones_count, _max_ones_count);
+      _pending_idx = -1;
+      _pending_count = 0;
+   }
+
    if (_inc_count < _container_size / 10)
       return;
    
@@ -145,6 +177,7 @@ void ContainerSet::optimize()
    cont.build(_increment, _indices, _inc_count, _min_ones_count, _max_ones_count);
    _increment.allocate(_container_size * _fp_size);
    _indices.allocate(_container_size);
+   _inc_buckets.clear();
    _inc_count = 0;
 }
 
@@ -168,6 +201,14 @@ int ContainerSet::getSimilar( const byte *query, SimCoef &sim_coef, double min_c
       return sim_fp_indices.size();
    }
 
+   if (cont_idx == _pending_idx)
+   {
+      profTimerStart(cs_s, "pending_findSimilar");
+      _findSimilarRows(_pending_buckets, _pending.ptr(), _pending_indices.ptr(), query, sim_coef, min_coef,
+                       sim_fp_indices);
+      return sim_fp_indices.size();
+   }
+
    MultibitTree &container = _set[cont_idx];
 
    {
@@ -179,26 +220,71 @@ int ContainerSet::getSimilar( const byte *query, SimCoef &sim_coef, double min_c
    return sim_fp_indices.size();
 }
 
-int ContainerSet::_findSimilarInc (const byte *query, SimCoef &sim_coef, double min_coef, Array<SimResult> &sim_indices)
+bool ContainerSet::needsBuild (int inc_threshold) const
 {
-   byte *inc = _increment.ptr();
-   int *indices = _indices.ptr();
+   return _pending_idx != -1 || (_inc_count > 0 && _inc_count >= inc_threshold);
+}
 
-   sim_indices.clear();
+bool ContainerSet::startBuild (int inc_threshold, BuildTask &task)
+{
+   // An existing pending container is left by a build that was not
+   // finished before the database was closed, it is built again
+   if (_pending_idx == -1)
+   {
+      if (_inc_count == 0 || _inc_count < inc_threshold)
+         return false;
+
+      profIncCounter("pending_containers_count", 1);
+
+      _set.push<int>(_fp_size);
+      _pending_idx = _set.size() - 1;
+      _pending = _increment;
+      _pending_indices = _indices;
+      _pending_buckets = _inc_buckets;
+      _pending_count = _inc_count;
+
+      _increment.allocate(_container_size * _fp_size);
+      _indices.allocate(_container_size);
+      _inc_buckets.init(_fp_size, _container_size);
+      _inc_count = 0;
+   }
 
-   int query_bit_number = bitGetOnesCount(query, _fp_size);
+   task.fingerprints = _pending;
+   task.indices = _pending_indices;
+   task.count = _pending_count;
+   task.min_ones_count = _min_ones_count;
+   task.max_ones_count = _max_ones_count;
+   return true;
+}
 
-   for (int i = 0; i < _inc_count; i++)
-   {
-      byte *fp = inc + i * _fp_size;
-      int fp_bit_number = bitGetOnesCount(fp, _fp_size);
+bool ContainerSet::finishBuild (const BuildTask &task, MultibitTree &tree)
+{
+   if (_pending_idx == -1 || !((BingoAddr)_pending == (BingoAddr)task.fingerprints))
+      return false;
 
-      double coef = sim_coef.calcCoef(fp, query, query_bit_number, fp_bit_number);
-      if (coef < min_coef)
-         continue;
+   profIncCounter("trees_count", 1);
 
-      sim_indices.push(SimResult(indices[i], (float)coef));
-   }
+   _set[_pending_idx] = tree;
+   _pending_idx = -1;
+   _pending_count = 0;
+   return true;
+}
+
+int ContainerSet::_findSimilarInc (const byte *query, SimCoef &sim_coef, double min_coef, Array<SimResult> &sim_indices)
+{
+   return _findSimilarRows(_inc_buckets, _increment.ptr(), _indices.ptr(), query, sim_coef, min_coef, sim_indices);
+}
+
+int ContainerSet::_findSimilarRows (PopcountBuckets &buckets, const byte *fps, const int *indices, const byte *query,
+                                    SimCoef &sim_coef, double min_coef, Array<SimResult> &sim_indices)
+{
+   sim_indices.clear();
+
+   // The query is passed as a target to be consistent with MultibitTree
+   buckets.findSimilar(fps, query, sim_coef, min_coef, true, sim_indices);
+
+   for (int i = 0; i < sim_indices.size(); i++)
+      sim_indices[i].id = indices[sim_indices[i].id];
 
    return sim_indices.size();
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "base_cpp/obj_array.h"
 #include "bingo_cell_container.h"
 #include "bingo_multibit_tree.h"
+#include "bingo_popcount_buckets.h"
 
 #include "bingo_ptr.h"
 
@@ -20,6 +21,16 @@ namespace bingo
    class ContainerSet
    {
    public:
+      // Rows of the container that is built in background
+      struct BuildTask
+      {
+         BingoPtr<byte> fingerprints;
+         BingoPtr<int> indices;
+         int count;
+         int min_ones_count;
+         int max_ones_count;
+      };
+
       ContainerSet ();
 
       void setParams (int fp_size, int container_size, int min_ones_count, int max_ones_count);
@@ -43,19 +54,42 @@ namespace bingo
       int getSimilar (const byte *query, SimCoef &sim_coef, double min_coef, 
                         Array<SimResult> &sim_fp_indices, int cont_idx);
 
+      // Background build. The increment rows are moved to a pending container
+      // that is scanned like the increment until its tree is set in place, so
+      // the container indices seen by the searches are kept.
+      bool needsBuild (int inc_threshold) const;
+
+      // Moves the increment to the pending container if it has at least
+      // inc_threshold rows. Returns false if there is nothing to build.
+      bool startBuild (int inc_threshold, BuildTask &task);
+
+      // Sets the built tree in place of the pending container. Returns false
+      // if the container was built by optimize() in the meantime.
+      bool finishBuild (const BuildTask &task, MultibitTree &tree);
+
    private:
       BingoArray<MultibitTree> _set;
       int _fp_size;
       int _container_size;
       BingoPtr<byte> _increment;
       BingoPtr<int> _indices;
+      PopcountBuckets _inc_buckets;
       
       int _inc_count;
       int _inc_total_ones_count;
       int _min_ones_count;
       int _max_ones_count;
 
+      int _pending_idx;
+      BingoPtr<byte> _pending;
+      BingoPtr<int> _pending_indices;
+      PopcountBuckets _pending_buckets;
+      int _pending_count;
+
       int _findSimilarInc (const byte *query, SimCoef &sim_coef, double min_coef, Array<SimResult> &sim_indices);
+
+      int _findSimilarRows (PopcountBuckets &buckets, const byte *fps, const int *indices, const byte *query,
+                            SimCoef &sim_coef, double min_coef, Array<SimResult> &sim_indices);
    };
 };
 
@@ -0,0 +1,76 @@
+#include "bingo_deleted_rows.h"
+
+#include "base_c/bitarray.h"
+
+using namespace bingo;
+
+DeletedRowsStorage::DeletedRowsStorage (int block_size) : _block_size(block_size)
+{
+   _removed_count = 0;
+}
+
+BingoAddr DeletedRowsStorage::create (BingoPtr<DeletedRowsStorage> &ptr, int block_size)
+{
+   ptr.allocate();
+   new(ptr.ptr()) DeletedRowsStorage(block_size);
+   return (BingoAddr)ptr;
+}
+
+void DeletedRowsStorage::load (BingoPtr<DeletedRowsStorage> &ptr, BingoAddr offset)
+{
+   ptr = BingoPtr<DeletedRowsStorage>(offset);
+}
+
+void DeletedRowsStorage::remove (int idx)
+{
+   int pack_size = _block_size * 8;
+   int pack_idx = idx / pack_size;
+
+   if (_live_masks.size() <= pack_idx)
+      _live_masks.resize(pack_idx + 1);
+
+   BingoPtr<byte> &mask = _live_masks[pack_idx];
+   if (mask.isNull())
+   {
+      mask.allocate(_block_size);
+      memset(mask.ptr(), 0xFF, _block_size);
+   }
+
+   if (!bitGetBit(mask.ptr(), idx % pack_size))
+      return;
+
+   bitSetBit(mask.ptr(), idx % pack_size, 0);
+   _removed_count++;
+}
+
+bool DeletedRowsStorage::isRemoved (int idx)
+{
+   int pack_size = _block_size * 8;
+   int pack_idx = idx / pack_size;
+
+   if (_live_masks.size() <= pack_idx)
+      return false;
+
+   BingoPtr<byte> &mask = _live_masks[pack_idx];
+   if (mask.isNull())
+      return false;
+
+   return !bitGetBit(mask.ptr(), idx % pack_size);
+}
+
+int DeletedRowsStorage::getRemovedCount () const
+{
+   return _removed_count;
+}
+
+const byte * DeletedRowsStorage::getLiveMask (int pack_idx)
+{
+   if (_live_masks.size() <= pack_idx)
+      return 0;
+
+   BingoPtr<byte> &mask = _live_masks[pack_idx];
+   if (mask.isNull())
+      return 0;
+
+   return mask.ptr();
+}
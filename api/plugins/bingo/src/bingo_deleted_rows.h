@@ -0,0 +1,40 @@
+#ifndef __bingo_deleted_rows__
+#define __bingo_deleted_rows__
+
+#include "bingo_ptr.h"
+
+using namespace indigo;
+
+namespace bingo
+{
+   // Bitset of the removed rows of the index. The rows are grouped by packs
+   // of the transposed fingerprint storage; a pack gets a mask of the live rows
+   // when the first row of it is removed. The mask can be ANDed with the
+   // fingerprint columns, so the removed rows are dropped during screening.
+   class DeletedRowsStorage
+   {
+   public:
+      DeletedRowsStorage (int block_size);
+
+      static BingoAddr create (BingoPtr<DeletedRowsStorage> &ptr, int block_size);
+
+      static void load (BingoPtr<DeletedRowsStorage> &ptr, BingoAddr offset);
+
+      void remove (int idx);
+
+      bool isRemoved (int idx);
+
+      int getRemovedCount () const;
+
+      // Returns the mask of the live rows of the pack (block_size bytes) or 0
+      // if there are no removed rows in the pack
+      const byte * getLiveMask (int pack_idx);
+
+   private:
+      int _block_size;
+      int _removed_count;
+      BingoArray< BingoPtr<byte> > _live_masks;
+   };
+};
+
+#endif /* __bingo_deleted_rows__ */
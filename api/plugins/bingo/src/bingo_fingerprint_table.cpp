@@ -50,7 +50,7 @@ void FingerprintTable::add (const byte *fingerprint, int id)
       {
          if (_table[i].add(fingerprint, id))
          {
-            if (_table[i].getMinBorder() == _table[i].getMaxBorder() || _table[i].getContCount() > 1 || _table.size() >= _max_cell_count)
+            if (!_canSplit(i))
                _table[i].buildContainer();
             else
             {
@@ -58,6 +58,8 @@ void FingerprintTable::add (const byte *fingerprint, int id)
                for (int j = _table.size() - 2; j >= i + 1; j--)
                  _table[j + 1] =_table[j];
 
+               // The shifted cell can have containers, they must not be shared
+               _table[i + 1] = ContainerSet();
                _table[i + 1].setParams(_fp_size, _mt_size, -1, -1);
                _table[i].splitSet(_table[i + 1]);
             }
@@ -160,6 +162,14 @@ int FingerprintTable::nextFitCell (int query_bit_count, int first_fit_cell, int
    return next_idx;
 }
 
+double FingerprintTable::calcCellUpperBound (SimCoef &sim_coef, int query_bit_count, int cell_idx) const
+{
+   if (cell_idx >= _table.size())
+      throw Exception("FingerprintTable: Incorrect cell index");
+
+   return sim_coef.calcUpperBound(query_bit_count, _table[cell_idx].getMinBorder(), _table[cell_idx].getMaxBorder());
+}
+
 int FingerprintTable::getSimilar (const byte *query, SimCoef &sim_coef, double min_coef, 
                   Array<SimResult> &sim_fp_indices, int cell_idx, int cont_idx)
 {
@@ -176,6 +186,49 @@ int FingerprintTable::getSimilar (const byte *query, SimCoef &sim_coef, double m
    return sim_fp_indices.size();
 }
 
+bool FingerprintTable::needsBuild (int inc_threshold) const
+{
+   for (int i = 0; i < _table.size(); i++)
+   {
+      if (!_canSplit(i) && _table[i].needsBuild(inc_threshold))
+         return true;
+   }
+
+   return false;
+}
+
+bool FingerprintTable::startBuild (int inc_threshold, ContainerSet::BuildTask &task)
+{
+   // The cells that are split when the increment is full are left as is,
+   // the containers are built in the final cells only
+   for (int i = 0; i < _table.size(); i++)
+   {
+      if (!_canSplit(i) && _table[i].startBuild(inc_threshold, task))
+         return true;
+   }
+
+   return false;
+}
+
+bool FingerprintTable::finishBuild (const ContainerSet::BuildTask &task, MultibitTree &tree)
+{
+   // Cells can be shifted by the splits, the container is found by its rows
+   for (int i = 0; i < _table.size(); i++)
+   {
+      if (_table[i].finishBuild(task, tree))
+         return true;
+   }
+
+   return false;
+}
+
+bool FingerprintTable::_canSplit (int cell_idx) const
+{
+   const ContainerSet &cell = _table[cell_idx];
+
+   return cell.getMinBorder() != cell.getMaxBorder() && cell.getContCount() == 1 && _table.size() < _max_cell_count;
+}
+
 FingerprintTable::~FingerprintTable ()
 {
 }
\ No newline at end of file
@@ -42,9 +42,20 @@ namespace bingo
 
       int nextFitCell (int query_bit_count, int first_fit_cell, int min_cell, int max_cell, int idx) const;
 
+      // Maximal coefficient of the query and the cell fingerprints by the cell borders
+      double calcCellUpperBound (SimCoef &sim_coef, int query_bit_count, int cell_idx) const;
+
       int getSimilar (const byte *query, SimCoef &sim_coef, double min_coef, 
                       Array<SimResult> &sim_fp_indices, int cell_idx, int cont_idx);
 
+      // Background build of the containers, see ContainerSet
+
+      bool needsBuild (int inc_threshold) const;
+
+      bool startBuild (int inc_threshold, ContainerSet::BuildTask &task);
+
+      bool finishBuild (const ContainerSet::BuildTask &task, MultibitTree &tree);
+
       ~FingerprintTable();
    
    private:
@@ -58,6 +69,10 @@ namespace bingo
       BingoPtr< size_t > _inc_id_buffer;
       int _inc_size;
       int _inc_fp_count;
+
+      // The full increment of the cell is split into two cells instead of
+      // building a container
+      bool _canSplit (int cell_idx) const;
    };
 };
 
@@ -0,0 +1,56 @@
+#include "bingo_fp_screener.h"
+
+#include "base_c/bitarray.h"
+
+using namespace bingo;
+
+int TranspFpScreener::selectColumnsCount (const Array<int> &bits, BingoArray<int> &usage_counts, int items_count)
+{
+   if (items_count <= 0)
+      return __min(bits.size(), (int)MAX_COLUMNS);
+
+   // Bits are sorted by the usage count, so the most selective columns come first.
+   // Survivors are estimated as if the bits were independent; because they are not,
+   // at least MIN_COLUMNS columns are taken when available.
+   double expected = items_count;
+   int count = 0;
+   while (count < bits.size() && count < MAX_COLUMNS)
+   {
+      int usage = usage_counts[bits[count]];
+      if (usage >= items_count && count > 0)
+         break; // Set in every item: such column does not filter anything
+
+      if (count >= MIN_COLUMNS && expected < 0.5)
+         break;
+
+      expected *= (double)usage / items_count;
+      count++;
+   }
+
+   return count;
+}
+
+void TranspFpScreener::screen (const byte **columns, int columns_count, int block_size, int id_offset,
+                               Array<int> &candidates)
+{
+   if (columns_count == 0)
+   {
+      // No bits in the query: every item of the pack is a candidate
+      int size = candidates.size();
+      candidates.resize(size + block_size * 8);
+      for (int i = 0; i < block_size * 8; i++)
+         candidates[size + i] = id_offset + i;
+      return;
+   }
+
+   int size = candidates.size();
+
+   candidates.resize(size + block_size * 8);
+
+   int *found = candidates.ptr() + size;
+   int count = bitCommonOnesIndices(columns, columns_count, block_size, found);
+
+   for (int i = 0; i < count; i++)
+      found[i] += id_offset;
+   candidates.resize(size + count);
+}
@@ -0,0 +1,38 @@
+#ifndef __bingo_fp_screener__
+#define __bingo_fp_screener__
+
+#include "base_c/defs.h"
+#include "base_cpp/array.h"
+
+#include "bingo_ptr.h"
+
+using namespace indigo;
+
+namespace bingo
+{
+   // Screening of the transposed fingerprint blocks. All selected bit columns
+   // of a pack are ANDed in a single pass over the block and the surviving
+   // items are extracted word by word by bitCommonOnesIndices, which uses
+   // the AVX-512, AVX2 or portable kernel according to the CPU features.
+   class TranspFpScreener
+   {
+   public:
+      enum
+      {
+         MAX_COLUMNS = 64,
+         MIN_COLUMNS = 15
+      };
+
+      // Returns the number of leading columns from the bits (sorted by the usage
+      // count in ascending order) that is worth ANDing. The columns are taken
+      // while the expected number of survivors in a pack is not negligible.
+      static int selectColumnsCount (const Array<int> &bits, BingoArray<int> &usage_counts, int items_count);
+
+      // Appends to candidates (id_offset + i) for every item i that has
+      // all the given columns set
+      static void screen (const byte **columns, int columns_count, int block_size, int id_offset,
+                          Array<int> &candidates);
+   };
+};
+
+#endif /* __bingo_fp_screener__ */
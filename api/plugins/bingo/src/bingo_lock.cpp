@@ -1,51 +1,111 @@
 #include "bingo_lock.h"
 
-DatabaseLockData::DatabaseLockData() : writers_count(0), readers_count(0)
+#include "base_c/nano.h"
+#include "base_cpp/profiling.h"
+
+#include <stdio.h>
+
+using namespace indigo;
+
+DatabaseLockData::DatabaseLockData (int name) :
+   state(0), writers_waiting(0), sleepers(0)
+{
+   char buf[64];
+
+   snprintf(buf, sizeof(buf), "bingo_lock%d_read_wait", name);
+   read_wait_name = ProfilingSystem::getNameIndex(buf);
+   snprintf(buf, sizeof(buf), "bingo_lock%d_write_wait", name);
+   write_wait_name = ProfilingSystem::getNameIndex(buf);
+}
+
+bool DatabaseLockData::tryReadLock ()
+{
+   int s = state.load();
+   while (writers_waiting.load() == 0 && (s & WRITER_BIT) == 0)
+   {
+      if (state.compare_exchange_weak(s, s + 1))
+         return true;
+   }
+   return false;
+}
+
+void DatabaseLockData::readLock ()
+{
+   if (tryReadLock())
+      return;
+
+   qword start = nanoClock();
+   {
+      std::unique_lock<std::mutex> lock(mutex);
+      sleepers++;
+      cond.wait(lock, [this] { return tryReadLock(); });
+      sleepers--;
+   }
+   ProfilingSystem::getInstance().addTimer(read_wait_name, nanoClock() - start);
+}
+
+void DatabaseLockData::readUnlock ()
 {
-   osSemaphoreCreate(&rc_sem, 1, 1);
-   osSemaphoreCreate(&wc_sem, 1, 1);
-   osSemaphoreCreate(&w_sem, 1, 1);
-   osSemaphoreCreate(&r_sem, 1, 1);
+   if (state.fetch_sub(1) == 1 && writers_waiting.load() != 0)
+      _wakeWaiters();
+}
+
+void DatabaseLockData::writeLock ()
+{
+   writers_waiting++;
+
+   int expected = 0;
+   if (!state.compare_exchange_strong(expected, (int)WRITER_BIT))
+   {
+      qword start = nanoClock();
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         sleepers++;
+         cond.wait(lock, [this] {
+            int expected = 0;
+            return state.compare_exchange_strong(expected, (int)WRITER_BIT);
+         });
+         sleepers--;
+      }
+      ProfilingSystem::getInstance().addTimer(write_wait_name, nanoClock() - start);
+   }
+
+   writers_waiting--;
+}
+
+void DatabaseLockData::writeUnlock ()
+{
+   state.store(0);
+   _wakeWaiters();
+}
+
+void DatabaseLockData::_wakeWaiters ()
+{
+   // Waiters increment the sleepers counter before the state check, so either
+   // the waiter sees the new state or the sleeper is seen here
+   if (sleepers.load() == 0)
+      return;
+
+   std::lock_guard<std::mutex> lock(mutex);
+   cond.notify_all();
 }
 
 ReadLock::ReadLock(DatabaseLockData &data) : _data(data)
 {
-   osSemaphoreWait(&_data.r_sem);
-   osSemaphoreWait(&_data.rc_sem);
-   _data.readers_count++;
-   if (_data.readers_count == 1)
-      osSemaphoreWait(&_data.w_sem);
-   osSemaphorePost(&_data.rc_sem);
-   osSemaphorePost(&_data.r_sem);
+   _data.readLock();
 }
 
 ReadLock::~ReadLock()
 {
-   osSemaphoreWait(&_data.rc_sem);
-   _data.readers_count--;
-   if (_data.readers_count == 0)
-      osSemaphorePost(&_data.w_sem);
-   osSemaphorePost(&_data.rc_sem);
+   _data.readUnlock();
 }
 
 WriteLock::WriteLock(DatabaseLockData &data) : _data(data)
 {
-   osSemaphoreWait(&_data.wc_sem);
-   _data.writers_count++;
-   if (_data.writers_count == 1)
-      osSemaphoreWait(&_data.r_sem);
-   osSemaphorePost(&_data.wc_sem);
-
-   osSemaphoreWait(&_data.w_sem);
+   _data.writeLock();
 }
 
 WriteLock::~WriteLock()
 {
-   osSemaphorePost(&_data.w_sem);
-
-   osSemaphoreWait(&_data.wc_sem);
-   _data.writers_count--;
-   if (_data.writers_count == 0)
-      osSemaphorePost(&_data.r_sem);
-   osSemaphorePost(&_data.wc_sem);
+   _data.writeUnlock();
 }
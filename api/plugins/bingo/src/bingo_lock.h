@@ -1,14 +1,44 @@
 #ifndef __bingo_lock__
 #define __bingo_lock__
 
-#include "base_c/os_sync.h"
+#include "base_c/defs.h"
 
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+// Writer-preferring reader-writer lock of a database. Uncontended locks are
+// taken by a single atomic operation, threads wait on a condition variable
+// only when the lock is contended. New readers don't enter the lock while a
+// writer is waiting.
+//
+// Contended acquisitions are reported to the profiling system per lock:
+// "bingo_lock<name>_read_wait" and "bingo_lock<name>_write_wait" timers.
 struct DatabaseLockData
 {
-   os_semaphore rc_sem, wc_sem, w_sem, r_sem;
-   int writers_count, readers_count;
+   DatabaseLockData (int name = 0);
+
+   enum { WRITER_BIT = 0x40000000 };
+
+   // Readers count and WRITER_BIT
+   std::atomic<int> state;
+   std::atomic<int> writers_waiting;
+   std::atomic<int> sleepers;
+
+   std::mutex mutex;
+   std::condition_variable cond;
 
-   DatabaseLockData();
+   int read_wait_name, write_wait_name;
+
+   bool tryReadLock ();
+   void readLock ();
+   void readUnlock ();
+
+   void writeLock ();
+   void writeUnlock ();
+
+private:
+   void _wakeWaiters ();
 };
 
 struct ReadLock
@@ -33,4 +63,4 @@ private:
    DatabaseLockData &_data;
 };
 
-#endif //__bingo_lock__
\ No newline at end of file
+#endif //__bingo_lock__
@@ -2,6 +2,8 @@
 #include "bingo_tanimoto_coef.h"
 #include "bingo_tversky_coef.h"
 #include "bingo_euclid_coef.h"
+#include "bingo_fp_screener.h"
+#include "bingo_parallel_search.h"
 
 #include "molecule/molecule_substructure_matcher.h"
 
@@ -12,12 +14,15 @@
 #include <algorithm>
 #include <vector>
 #include <sstream>
+#include <cmath>
 
 using namespace indigo;
 using namespace bingo;
 
 static const char *_matcher_params_prop = "";
 static const char *_matcher_part_prop = "part";
+static const char *_matcher_threads_prop = "threads";
+static const char *_matcher_order_prop = "order";
 
 GrossQueryData::GrossQueryData (Array<char> &gross_str) : _obj(gross_str)
 {
@@ -149,6 +154,9 @@ BaseMatcher::BaseMatcher(BaseIndex &index, IndigoObject *& current_obj) : _index
    _current_id = 0;
    _part_id = -1;
    _part_count = -1;
+   _threads_count = 1;
+   _ordered_results = true;
+   _lock_data = 0;
 }
 
 BaseMatcher::~BaseMatcher ()
@@ -218,12 +226,24 @@ void BaseMatcher::resetThresholdLimit (float min)
    throw Exception("BaseMatcher: Matcher does not support this method");
 }
 
+void BaseMatcher::setLockData (DatabaseLockData *lock_data)
+{
+   _lock_data = lock_data;
+}
+
+bool BaseMatcher::isParallel ()
+{
+   return _threads_count > 1;
+}
+
 void BaseMatcher::setOptions (const char * options)
 {
    std::map<std::string, std::string> option_map;
    std::vector<std::string> allowed_props;
    allowed_props.push_back(_matcher_params_prop);
    allowed_props.push_back(_matcher_part_prop);
+   allowed_props.push_back(_matcher_threads_prop);
+   allowed_props.push_back(_matcher_order_prop);
    Properties::parseOptions(options, option_map, &allowed_props);
 
    if (option_map.find(_matcher_params_prop) != option_map.end())
@@ -250,17 +270,45 @@ void BaseMatcher::setOptions (const char * options)
       _part_count = part_count;
       _initPartition();
    }
+
+   if (option_map.find(_matcher_order_prop) != option_map.end())
+   {
+      const std::string &order = option_map[_matcher_order_prop];
+
+      if (order == "id")
+         _ordered_results = true;
+      else if (order == "any")
+         _ordered_results = false;
+      else
+         throw Exception("BaseMatcher: setOptions: incorrect order parameter (id or any is expected)");
+   }
+
+   if (option_map.find(_matcher_threads_prop) != option_map.end())
+   {
+      std::stringstream threads_str;
+      threads_str << option_map[_matcher_threads_prop];
+
+      int threads_count;
+      threads_str >> threads_count;
+
+      if (threads_str.fail() || threads_count < 0)
+         throw Exception("BaseMatcher: setOptions: incorrect threads parameter");
+
+      // Zero means the number of processors
+      _threads_count = (threads_count == 0 ? osGetProcessorsCount() : threads_count);
+      _initThreads();
+   }
 }
 
-bool BaseMatcher::_isCurrentObjectExist()
+void BaseMatcher::_initThreads ()
 {
-   int cf_len;
-   _index.getCfStorage().get(_current_id, cf_len);
-
-   if (cf_len == -1)
-      return false;
+   if (_threads_count > 1)
+      throw Exception("BaseMatcher: Matcher does not support multithreaded search");
+}
 
-   return true;
+bool BaseMatcher::_isCurrentObjectExist()
+{
+   return !_index.getDeletedRows().isRemoved(_current_id);
 }
 
 bool BaseMatcher::_loadCurrentObject()
@@ -354,10 +402,20 @@ BaseSubstructureMatcher::BaseSubstructureMatcher (/*const */ BaseIndex &index, I
    _final_pack = _fp_storage.getPackCount() + 1;
 
    _cand_count = 0;
+   _mapping_pending = false;
+}
+
+BaseSubstructureMatcher::~BaseSubstructureMatcher ()
+{
+   // Stop the worker threads before the matcher is destroyed
+   _parallel_search.reset(0);
 }
 
 bool BaseSubstructureMatcher::next ()
 {
+   if (_threads_count > 1)
+      return _nextParallel();
+
    //int fp_size_in_bits = _fp_size * 8;
    static int sub_cnt = 0;
 
@@ -409,6 +467,60 @@ bool BaseSubstructureMatcher::next ()
    return false;
 }
 
+bool BaseSubstructureMatcher::_nextParallel ()
+{
+   if (_parallel_search.get() == 0)
+   {
+      _parallel_search.reset(new ParallelSubSearch(*this, _threads_count, _ordered_results, _lock_data));
+      _parallel_search->start(_current_pack + 1, _final_pack);
+   }
+
+   int id;
+   while (_parallel_search->popResult(id))
+   {
+      _current_id = id;
+
+      // Current object is loaded again in the caller's thread. The object may
+      // have been removed after it was found by the worker. The mapping is
+      // computed on demand to avoid matching every found object twice.
+      bool status;
+      if (_lock_data != 0)
+      {
+         ReadLock rlock(*_lock_data);
+         status = _loadCurrentObject();
+      }
+      else
+         status = _loadCurrentObject();
+
+      if (status)
+      {
+         _mapping_pending = true;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+void BaseSubstructureMatcher::_processPack (int pack_idx, Array<int> &found)
+{
+   _findPackCandidates(pack_idx);
+
+   for (int i = 0; i < _candidates.size(); i++)
+   {
+      _current_id = _candidates[i];
+      if (_tryCurrent())
+         found.push(_current_id);
+   }
+}
+
+void BaseSubstructureMatcher::_initWorker (const BaseSubstructureMatcher &parent, SubstructureQueryData *query_data)
+{
+   _query_data.reset(query_data);
+   _query_fp.copy(parent._query_fp);
+   _query_fp_bits_used.copy(parent._query_fp_bits_used);
+}
+
 void BaseSubstructureMatcher::setQueryData (SubstructureQueryData *query_data)
 {
    _query_data.reset(query_data);
@@ -450,49 +562,34 @@ void BaseSubstructureMatcher::_findPackCandidates (int pack_idx)
 
    TranspFpStorage &fp_storage = _index.getSubStorage();
 
-   //const byte *query_fp = _query_fp.ptr();
-
-   const byte * block;
-   
    int fp_size_in_bits = _fp_size * 8;
+   int block_size = fp_storage.getBlockSize();
 
-   Array<byte> fit_bits;
-   fit_bits.clear_resize(fp_storage.getBlockSize());
-   fit_bits.fill(255);
-
-   profTimerStart(tgs, "sub_find_cand_pack_get_search");
-   int left = 0, right = fp_storage.getBlockSize() - 1;
-
-   // Filter only based on the first 10 bits
-   // TODO: collect time infromation about the reading and matching measurements and
-   // and balance between reading new block or check filtered items without reading new block
-   for (int i = 0; i < _query_fp_bits_used.size() && i < 15; i++)
-   {
-      int j = _query_fp_bits_used[i];
-      
-      profTimerStart(tgb, "sub_find_cand_pack_get_block");
-      block = fp_storage.getBlock(pack_idx * fp_size_in_bits + j);
-      profTimerStop(tgb);
-
-      profTimerStart(tgu, "sub_find_cand_pack_fit_update");
-      bitAnd(fit_bits.ptr() + left, &block[0] + left, right - left + 1);
+   // Take the most selective columns and AND them in one pass over the block
+   int columns_count = TranspFpScreener::selectColumnsCount(_query_fp_bits_used,
+      fp_storage.getFpBitUsageCounts(), block_size * 8);
 
-      while(left <= right && fit_bits[left] == 0)
-         left++;
-      while(left <= right && fit_bits[right] == 0)
-         right--;
+   const byte *columns[TranspFpScreener::MAX_COLUMNS];
 
-      if (left > right)
-         // Not more results
-         break;
+   profTimerStart(tgb, "sub_find_cand_pack_get_block");
+   for (int i = 0; i < columns_count; i++)
+      columns[i] = fp_storage.getBlock(pack_idx * fp_size_in_bits + _query_fp_bits_used[i]);
+   profTimerStop(tgb);
 
-      profTimerStop(tgu);
+   // Removed rows are dropped together with the fingerprint screening
+   const byte *live_mask = _index.getDeletedRows().getLiveMask(pack_idx);
+   if (live_mask != 0)
+   {
+      if (columns_count == TranspFpScreener::MAX_COLUMNS)
+         columns_count--; // The least selective column gives way to the mask
+      columns[columns_count++] = live_mask;
    }
+
+   profTimerStart(tgs, "sub_find_cand_pack_screen");
+   TranspFpScreener::screen(columns, columns_count, block_size, pack_idx * block_size * 8, _candidates);
    profTimerStop(tgs);
-   
-   for (int k = 0; k < 8 * fp_storage.getBlockSize(); k++)
-      if (bitGetBit(fit_bits.ptr(), k))
-         _candidates.push(k + pack_idx * fp_storage.getBlockSize() * 8);
+
+   profIncCounter("sub_find_cand_pack_columns", columns_count);
 }
 
 void BaseSubstructureMatcher::_findIncCandidates ()
@@ -504,18 +601,32 @@ void BaseSubstructureMatcher::_findIncCandidates ()
 
    int inc_block_id_offset = fp_storage.getPackCount() * fp_storage.getBlockSize() * 8;
    const byte *inc = fp_storage.getIncrement();
-   for (int i = 0; i < fp_storage.getIncrementSize(); i++)
+   DeletedRowsStorage &deleted_rows = _index.getDeletedRows();
+
+   // The increment fingerprints are stored one after another, the passed
+   // ones are written in place and then filtered by the deleted rows
+   _candidates.resize(fp_storage.getIncrementSize());
+   int passed = bitTestOnesArray(_query_fp.ptr(), inc, _fp_size, _candidates.size(), _candidates.ptr());
+   int count = 0;
+
+   for (int i = 0; i < passed; i++)
    {
-      const byte *fp = inc + i * _fp_size;
-      if (bitTestOnes(_query_fp.ptr(), fp, _fp_size))
-         _candidates.push(i + inc_block_id_offset);
+      int id = _candidates[i] + inc_block_id_offset;
+
+      if (!deleted_rows.isRemoved(id))
+         _candidates[count++] = id;
    }
+   _candidates.resize(count);
 }
 
 void BaseSubstructureMatcher::_setParameters (const char * params)
 {
 }
 
+void BaseSubstructureMatcher::_initThreads ()
+{
+}
+
 void BaseSubstructureMatcher::_initPartition ()
 {
    int pack_count_with_inc = _fp_storage.getPackCount() + 1;
@@ -547,9 +658,24 @@ MoleculeSubMatcher::MoleculeSubMatcher (/*const */ BaseIndex &index) : BaseSubst
 
 const Array<int> & MoleculeSubMatcher::currentMapping ()
 {
+   if (_mapping_pending)
+   {
+      _mapping_pending = false;
+      _tryCurrent();
+   }
    return _mapping;
 }
 
+BaseSubstructureMatcher * MoleculeSubMatcher::_createWorker ()
+{
+   SubstructureMoleculeQuery &query = (SubstructureMoleculeQuery &)(_query_data->getQueryObject());
+   QueryMolecule &query_mol = (QueryMolecule &)(query.getMolecule());
+
+   AutoPtr<MoleculeSubMatcher> worker(new MoleculeSubMatcher(_index));
+   worker->_initWorker(*this, new MoleculeSubstructureQueryData(query_mol));
+   return worker.release();
+}
+
 bool MoleculeSubMatcher::_tryCurrent ()// const
 {
    SubstructureMoleculeQuery &query = (SubstructureMoleculeQuery &)(_query_data->getQueryObject());
@@ -589,9 +715,24 @@ ReactionSubMatcher::ReactionSubMatcher (/*const */ BaseIndex &index) : BaseSubst
 
 const ObjArray<Array<int> > & ReactionSubMatcher::currentMapping ()
 {
+   if (_mapping_pending)
+   {
+      _mapping_pending = false;
+      _tryCurrent();
+   }
    return _mapping;
 }
 
+BaseSubstructureMatcher * ReactionSubMatcher::_createWorker ()
+{
+   SubstructureReactionQuery &query = (SubstructureReactionQuery &)_query_data->getQueryObject();
+   QueryReaction &query_rxn = (QueryReaction &)(query.getReaction());
+
+   AutoPtr<ReactionSubMatcher> worker(new ReactionSubMatcher(_index));
+   worker->_initWorker(*this, new ReactionSubstructureQueryData(query_rxn));
+   return worker.release();
+}
+
 bool ReactionSubMatcher::_tryCurrent ()// const
 {
    SubstructureReactionQuery &query = (SubstructureReactionQuery &)_query_data->getQueryObject();
@@ -984,294 +1125,130 @@ bool TopNSimMatcher::next ()
    return false;
 }
 
-void TopNSimMatcher::_findTopN ()
+// Orders the results by the similarity value. The heap of the best results
+// keeps the worst one on the top.
+static bool _betterSimResult (const SimResult &res1, const SimResult &res2)
 {
-   QS_DEF(Array<float>, thrs);
-   QS_DEF(Array<int>, nhits_per_block);
-   QS_DEF(Array<int>, blocks);
-   QS_DEF(Array<int>, cells);
-
-   thrs.clear();
-   nhits_per_block.clear();
-   blocks.clear();
-   cells.clear();
-
-   SimStorage &sim_storage = _index.getSimStorage();
-
-   float thr_low_limit = _query_data->getMin();
-   int   hits_limit = _limit;
-
-   _initModelDistribution(thrs, nhits_per_block);
-
-   blocks.clear_resize(thrs.size());
-   cells.clear_resize(thrs.size());
-   _current_results.clear();
-
-   bool already_found = false;
-   bool too_many = false;
-   float thr_proc = 0.0f;
-   float cur_thr  = 0.0f;
-   float thr_too_many = 0.0f;
-   int nhits = 0;
-   int start_iter = thrs.size();
-
-   int cont_count = 0;
-   int cells_count = 0;
-   int min_cell = 0;
-   int max_cell = 0;
-   int cur_cell = 0;
+   if (res1.sim_value != res2.sim_value)
+      return res1.sim_value > res2.sim_value;
+   return res1.id < res2.id;
+}
 
-   int i;
-   int cnt = 0;
+// Threshold for the fingerprints that can still get into the full top. The
+// coefficients are rounded to float in the results, so the threshold is the
+// float just below the worst result: a tie with a smaller id must pass.
+static float _topThreshold (float min_coef, float worst)
+{
+   return __max(min_coef, std::nextafter(worst, -1.0f));
+}
 
-   for (i = 0; i < thrs.size(); i++)
+void TopNSimMatcher::_addToTopN (const Array<SimResult> &portion, Array<SimResult> &top)
+{
+   for (int i = 0; i < portion.size(); i++)
    {
-      if (too_many)
-      {
-         if (thr_proc == 0.0f)
-            cur_thr = thr_too_many + (1.0f - thr_too_many)/2;
-         else
-            cur_thr = thr_too_many + (thr_proc - thr_too_many)/2;
-      }
-      else
-         cur_thr = thrs[i];
+      const SimResult &res = portion[i];
 
-      resetThresholdLimit(cur_thr);
+      if (top.size() == _limit && !_betterSimResult(res, top[0]))
+         continue;
 
-      cont_count = containersCount();
-      blocks[i] = cont_count;
-      cells_count = cellsCount();
-      cells[i] = cells_count;
-      min_cell = minCell();
-      max_cell = maxCell();
+      _current_id = res.id;
+      if (!_isCurrentObjectExist())
+         continue;
 
-      if ( (cont_count > 0) && (nhits == 0) )
+      if (top.size() == _limit)
       {
-         cnt = 0;
-         _current_results.clear();
-
-         SimResult *res = 0;
-
-         while (BaseSimilarityMatcher::next())
-         {
-            cnt++;
-            res = &_current_results.push();
-            res->id = _current_id;
-            res->sim_value = _current_sim_value;
-            cur_cell = currentCell();
-            if ( (cnt > hits_limit * 2) && ((max_cell - cur_cell) > cells_count/2) )
-            {
-               thr_too_many = cur_thr;
-               too_many = true;
-               break;
-            }
-            else
-               too_many = false;
-         }
-        
-         if (too_many)
-            continue;
-
-         if ( (cnt >= hits_limit) || (cur_thr <= thr_low_limit) )
-         {
-            already_found = true;
-            break;
-         }
+         std::pop_heap(top.ptr(), top.ptr() + top.size(), _betterSimResult);
+         top.pop();
+      }
 
-         nhits = (cnt/cont_count);
+      top.push(res);
+      std::push_heap(top.ptr(), top.ptr() + top.size(), _betterSimResult);
+   }
+}
 
-         if ( (nhits == 0) && (cnt > 0) )
-            nhits = 1;
+void TopNSimMatcher::_findTopN ()
+{
+   profTimerStart(t, "sim_top_n");
 
-         thr_proc = cur_thr;
-         nhits_per_block[i] = nhits;
-         if (i < thrs.size() - 2)
-            start_iter = i + 1;
-         else 
-         {
-            already_found = true;
-            break;
-         }
-           
-         if (thr_too_many > 0.0) 
-         {
-            thrs[i] = thr_proc;
-            thrs[start_iter] = thr_proc - (thr_proc - thr_too_many)/2;
-            if (start_iter < thrs.size() - 2)
-               thrs[start_iter + 1] = thr_too_many;
-         }    
-      }
-      else if ( (cont_count == 0) && sim_storage.isSmallBase() )
-      {
-         cnt = 0;
-         _current_results.clear();
+   QS_DEF(Array<SimResult>, top);
+   QS_DEF(Array<SimResult>, portion);
+   QS_DEF(Array<SimResult>, cells);
 
-         SimResult *res = 0;
+   top.clear();
+   cells.clear();
 
-         while (BaseSimilarityMatcher::next())
-         {
-            cnt++;
-            res = &_current_results.push();
-            res->id = _current_id;
-            res->sim_value = _current_sim_value;
+   if (_limit <= 0)
+      return;
 
-            if (cnt > hits_limit * 2)
-            {
-               thr_too_many = cur_thr;
-               too_many = true;
-               break;
-            }
-            else
-               too_many = false;
-         }
-        
-         if (too_many)
-            continue;
+   SimStorage &sim_storage = _index.getSimStorage();
+   const byte *query = _query_fp.ptr();
+   int query_bit_count = bitGetOnesCount(query, _fp_size);
+   float min_coef = _query_data->getMin();
 
-         if ( (cnt >= hits_limit) || (cur_thr <= thr_low_limit) )
-         {
-            already_found = true;
-            break;
-         }
-      }
-      else if (cont_count == 0)
-         continue;
-      else
-      {
-         nhits_per_block[i] = nhits_per_block[i-1] * 2;
-      }
+   if (sim_storage.isSmallBase())
+   {
+      portion.clear();
+      sim_storage.getIncSimilar(query, _sim_coef.ref(), min_coef, portion);
+      _addToTopN(portion, top);
    }
-
-   if (!already_found)
+   else
    {
-      bool adjusted = false;
-      float next_thr = 0.0f;
-      float prev_thr = 0.0f;
-
-      i = start_iter;
- 
-      while (i < thrs.size())
+      // Cells are visited in the order of the maximal coefficient that is
+      // reachable by their borders (the cell id is kept in SimResult::id)
+      for (int cell = 0; cell < sim_storage.getCellCount(); cell++)
       {
-         if ( (blocks[i] * nhits_per_block[i] < hits_limit) && (i < (thrs.size() - 1)) && (!adjusted) )
-         {
-            i++;
+         if (_part_count != -1 && _part_id != -1 && cell % _part_count != _part_id - 1)
             continue;
-         }   
 
-         cur_thr = thrs[i];
+         double bound = sim_storage.calcCellUpperBound(_sim_coef.ref(), query_bit_count, cell);
 
-         if ( (blocks[i] * nhits_per_block[i] > 2 * hits_limit) && (!adjusted) )
-         {
-            next_thr = cur_thr + (thrs[i - 1] - cur_thr)/2;
-            prev_thr = cur_thr;
-            cur_thr = next_thr;
-            adjusted = true;
-         }
+         // NaN is returned for the empty fingerprints
+         if (bound != bound)
+            bound = 1;
+         if (bound < min_coef)
+            continue;
 
-         too_many = false;
+         cells.push(SimResult(cell, (float)bound));
+      }
 
-         resetThresholdLimit(cur_thr);
+      std::sort(cells.ptr(), cells.ptr() + cells.size(), _betterSimResult);
 
-         cont_count = containersCount();
-         cells_count = cellsCount();
-         cells[i] = cells_count;
-         min_cell = minCell();
-         max_cell = maxCell();
+      for (int i = 0; i < cells.size(); i++)
+      {
+         int cell = cells[i].id;
+         float threshold = min_coef;
 
-         if (cont_count > 0)
+         if (top.size() == _limit)
          {
-            cnt = 0;
-            _current_results.clear();
-
-            SimResult *res = 0;
-
-            while (BaseSimilarityMatcher::next())
+            // No fingerprint of this cell and the next ones can get into the
+            // top. A tie with the worst result still can, if its id is smaller.
+            if (cells[i].sim_value < top[0].sim_value)
             {
-               cnt++;
-               res = &_current_results.push();
-               res->id = _current_id;
-               res->sim_value = _current_sim_value;
-               cur_cell = currentCell();
-               if ( (cnt > hits_limit * 2) && (max_cell - cur_cell) > cells_count/2)
-               {
-                  next_thr = cur_thr + (thr_proc - cur_thr)/2;
-                  thr_too_many = cur_thr;
-                  thrs[i] = next_thr;
-                  too_many = true;
-                  adjusted = true;
-                  break;
-               }
-            } 
-
-            if ( ((cnt >= hits_limit) || (cur_thr <= thr_low_limit)) && (!too_many) )
+               profIncCounter("sim_top_n_skipped_cells", cells.size() - i);
                break;
+            }
+
+            threshold = _topThreshold(min_coef, top[0].sim_value);
          }
-         else
-            i++; 
 
-         if (!too_many)
+         for (int cont = 0; cont < sim_storage.getCellSize(cell); cont++)
          {
-            thr_proc = cur_thr;
-            nhits_per_block[i] = cnt/cont_count;
-            if (i < (thrs.size() - 2))
-               nhits_per_block[i + 1] = nhits_per_block[i] * 2;
+            portion.clear();
+            sim_storage.getSimilar(query, _sim_coef.ref(), threshold, portion, cell, cont);
+            _addToTopN(portion, top);
 
-            if (thr_too_many > 0.0)
-            {
-               next_thr = cur_thr - (cur_thr - thr_too_many)/2;
-               thrs[i] = next_thr;
-            }
-            else if (i < (thrs.size() - 2))
-            {
-               if ( (hits_limit - cnt) < (nhits_per_block[i + 1] * (blocks[i + 1] - cont_count)) )
-               {
-                  next_thr = cur_thr - (cur_thr - thrs[i + 1])/2;
-                  thrs[i] = next_thr;
-                  adjusted = true;
-               }
-               else
-               {
-                  i++;
-                  next_thr = thrs[i];
-               }
-            }
+            if (top.size() == _limit)
+               threshold = _topThreshold(min_coef, top[0].sim_value);
          }
-
-         cur_thr = next_thr;
       }
    }
 
-   if (_current_results.size() > 0)
-   {
-      _current_results.qsort(_cmp_sim_res, 0); 
-
-      for (i = 0; i < _current_results.size(); i++)
-      {
-         _result_ids.push(_current_results[i].id);
-         _result_sims.push(_current_results[i].sim_value);
+   std::sort(top.ptr(), top.ptr() + top.size(), _betterSimResult);
 
-         if (i == (hits_limit - 1))
-            break;
-      }
-   }
-}
-
-int TopNSimMatcher::_cmp_sim_res(SimResult &res1, SimResult &res2, void *context)
-{
-   if ( (res1.sim_value - res2.sim_value) > 0.0 )
-      return -1;
-   else if ( (res1.sim_value - res2.sim_value) < 0.0 )
-      return 1;
-
-   return 0;
-}
-
-void TopNSimMatcher::_initModelDistribution(Array<float> &model_thrs, Array<int> &model_nhits_per_block)
-{
-   for (int i = 0; i < 9; i++)
+   for (int i = 0; i < top.size(); i++)
    {
-      model_thrs.push(1.0 - 0.1 * (i + 1));
-      model_nhits_per_block.push(5 * 2^(i));
+      _result_ids.push(top[i].id);
+      _result_sims.push(top[i].sim_value);
    }
 }
 
@@ -1313,6 +1290,9 @@ bool BaseExactMatcher::next ()
       _current_id = _candidates[_current_cand_id];
       _current_cand_id++;
 
+      if (!_isCurrentObjectExist())
+         continue;
+
       bool status = _tryCurrent();
       if (status)
          profIncCounter("exact_found", 1);
@@ -1542,6 +1522,9 @@ bool BaseGrossMatcher::next ()
       _current_id = _candidates[_current_cand_id];
       _current_cand_id++;
 
+      if (!_isCurrentObjectExist())
+         continue;
+
       bool status = _tryCurrent();
       if (status)
          profIncCounter("exact_found", 1);
@@ -1608,16 +1591,16 @@ bool MolGrossMatcher::_tryCurrent ()/* const */
 EnumeratorMatcher::EnumeratorMatcher (BaseIndex &index) : BaseMatcher(index, (IndigoObject *&)_indigoObject)
 {
     _id_numbers = index.getIdMapping().size();
-    _current_id = 0;
+    _current_id = -1;
     _indigoObject = nullptr;
 }
    
 bool EnumeratorMatcher::next ()
 {
-    if(_current_id < _id_numbers)
+    for (_current_id++; _current_id < _id_numbers; _current_id++)
     {
-        _current_id++;
-        return true;
+        if (_isCurrentObjectExist())
+            return true;
     }
     
     return false;
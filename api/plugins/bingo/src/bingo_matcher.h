@@ -172,6 +172,10 @@ namespace bingo
       virtual float currentSimValue () = 0;
       virtual void setOptions (const char * options) = 0;
       virtual void resetThresholdLimit (float min) = 0;
+
+      // Parallel matchers take the database read lock by themselves
+      virtual void setLockData (DatabaseLockData *lock_data) = 0;
+      virtual bool isParallel () = 0;
       
       virtual int esimateRemainingResultsCount (int &delta) = 0;
       virtual float esimateRemainingTime (float &delta) = 0;
@@ -199,6 +203,9 @@ namespace bingo
       
       virtual void setOptions (const char * options);
       virtual void resetThresholdLimit (float min);
+
+      virtual void setLockData (DatabaseLockData *lock_data);
+      virtual bool isParallel ();
       
       virtual int esimateRemainingResultsCount (int &delta);
       virtual float esimateRemainingTime (float &delta);
@@ -215,6 +222,9 @@ namespace bingo
       int _current_id;
       int _part_id;
       int _part_count;
+      int _threads_count;
+      bool _ordered_results;
+      DatabaseLockData *_lock_data;
 
       // Variables used for estimation
       MeanEstimator _match_probability_esimate, _match_time_esimate;
@@ -225,14 +235,19 @@ namespace bingo
 
       virtual void _setParameters (const char * params) = 0;
       virtual void _initPartition () = 0;
+      virtual void _initThreads ();
       
       ~BaseMatcher ();
    };
 
+   class ParallelSubSearch;
+
    class BaseSubstructureMatcher : public BaseMatcher
    {
    public:
       BaseSubstructureMatcher (/*const */ BaseIndex &index, IndigoObject *& current_obj);
+
+      virtual ~BaseSubstructureMatcher ();
    
       virtual bool next ();
 
@@ -245,22 +260,40 @@ namespace bingo
       Array<byte> _query_fp;
       Array<int> _query_fp_bits_used;
 
+      // Set when the current object was found by a worker thread and
+      // the mapping has not been computed in the caller's thread yet
+      bool _mapping_pending;
+
       void _findPackCandidates (int pack_idx);
 
       void _findIncCandidates ();
 
       virtual bool _tryCurrent ()/* const */ = 0;
 
+      // Creates a matcher with a copy of the query for a worker thread
+      virtual BaseSubstructureMatcher * _createWorker () = 0;
+
+      void _initWorker (const BaseSubstructureMatcher &parent, SubstructureQueryData *query_data);
+
       virtual void _setParameters (const char * params);
 
       virtual void _initPartition ();
 
+      virtual void _initThreads ();
+
    private:
+      friend class ParallelSubSearch;
+
       Array<int> _candidates;
       int _current_cand_id;
       int _current_pack;
       int _final_pack;
       const TranspFpStorage &_fp_storage;
+      AutoPtr<ParallelSubSearch> _parallel_search;
+
+      bool _nextParallel ();
+
+      void _processPack (int pack_idx, Array<int> &found);
    };
 
    class MoleculeSubMatcher : public BaseSubstructureMatcher
@@ -274,6 +307,8 @@ namespace bingo
 
       virtual bool _tryCurrent () /*const*/;
 
+      virtual BaseSubstructureMatcher * _createWorker ();
+
       IndexCurrentMolecule *_current_mol;
    };
    
@@ -288,6 +323,8 @@ namespace bingo
 
       virtual bool _tryCurrent () /*const*/;
 
+      virtual BaseSubstructureMatcher * _createWorker ();
+
       IndexCurrentReaction *_current_rxn;
    };
 
@@ -319,10 +356,11 @@ namespace bingo
    protected:
       float _current_sim_value;
       AutoPtr<SimilarityQueryData> _query_data;
+      int _fp_size;
+      AutoPtr<SimCoef> _sim_coef;
+      Array<byte> _query_fp;
       
    private:
-      int _fp_size;
-
       int _min_cell;
       int _max_cell;
       int _first_cell;
@@ -335,12 +373,8 @@ namespace bingo
 
       //float _current_sim_value;
 
-
-      AutoPtr<SimCoef> _sim_coef;
-      
       Array<byte> _current_block;
       const byte *_cur_loc;
-      Array<byte> _query_fp;
 
       virtual void _setParameters (const char * params);
 
@@ -375,14 +409,17 @@ namespace bingo
      
       ~TopNSimMatcher ();
    protected:
+      // Visits the cells in the order of their maximal coefficient and keeps
+      // the best results in a heap. The search stops when no remaining cell
+      // can beat the worst result of the heap, so the results are exact.
       void _findTopN ();
-      void _initModelDistribution(Array<float> &thrs, Array<int> &nhits_per_block);
-      static int _cmp_sim_res(SimResult &res1, SimResult &res2, void *context);
+
+      // Puts the existing objects of the portion into the heap of the best results
+      void _addToTopN (const Array<SimResult> &portion, Array<SimResult> &top);
 
    private:
       int _idx;
       int _limit;
-      Array<SimResult> _current_results;
       Array<int> _result_ids;
       Array<float> _result_sims;
    };
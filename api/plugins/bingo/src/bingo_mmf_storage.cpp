@@ -51,6 +51,6 @@ void MMFStorage::load (const char *filename, BingoPtr<char> header_ptr, int inde
 void MMFStorage::close ()
 {
    for (int i = 0; i < _mm_files.size(); i++)
-      _mm_files[i].close();
+      _mm_files[i]->close();
    _mm_files.clear();
 }
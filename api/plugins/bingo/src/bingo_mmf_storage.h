@@ -1,7 +1,7 @@
 #ifndef __bingo_mmf_storage__
 #define __bingo_mmf_storage__
 
-#include "base_cpp/obj_array.h"
+#include "base_cpp/ptr_array.h"
 #include "bingo_mmf.h"
 #include "bingo_ptr.h"
 
@@ -25,7 +25,7 @@ namespace bingo
 
       void close ();
    private:
-      ObjArray<MMFile> _mm_files;
+      PtrArray<MMFile> _mm_files;
       bool _read_only;
    };
 };
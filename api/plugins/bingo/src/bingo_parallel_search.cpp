@@ -0,0 +1,204 @@
+#include "bingo_parallel_search.h"
+
+#include "bingo_matcher.h"
+#include "bingo_mmf_storage.h"
+
+#include "base_cpp/tlscont.h"
+#include "base_cpp/profiling.h"
+
+using namespace indigo;
+using namespace bingo;
+
+// Maximum number of found ids that are waiting for the bingoNext call
+static const int _MAX_QUEUED_RESULTS = 4096;
+
+namespace
+{
+   class SubSearchCommand : public OsCommand
+   {
+   public:
+      virtual void clear ()
+      {
+         pack_idx = -1;
+      }
+
+      virtual void execute (OsCommandResult &result);
+
+      ParallelSubSearch *search;
+      int pack_idx;
+   };
+
+   class SubSearchResult : public OsCommandResult
+   {
+   public:
+      virtual void clear ()
+      {
+         found.clear();
+      }
+
+      Array<int> found;
+   };
+
+   void SubSearchCommand::execute (OsCommandResult &result)
+   {
+      search->processPack(pack_idx, ((SubSearchResult &)result).found);
+   }
+}
+
+ParallelSubSearch::ParallelSubSearch (BaseSubstructureMatcher &matcher, int threads_count, bool ordered,
+                                      DatabaseLockData *lock_data) :
+   OsCommandDispatcher(ordered ? HANDLING_ORDER_SERIAL : HANDLING_ORDER_ANY, false),
+   _threads_count(threads_count), _lock_data(lock_data)
+{
+   _db_id = MMFStorage::getDatabaseId();
+   _next_pack = 0;
+   _final_pack = 0;
+   _finished = false;
+   _cancelled = false;
+
+   // Workers are created here to avoid concurrent access to the matcher's query
+   for (int i = 0; i < _threads_count; i++)
+      _workers.add(matcher._createWorker());
+}
+
+ParallelSubSearch::~ParallelSubSearch ()
+{
+   {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      _cancelled = true;
+   }
+   _queue_cond.notify_all();
+
+   if (_producer.joinable())
+      _producer.join();
+}
+
+void ParallelSubSearch::start (int first_pack, int final_pack)
+{
+   _next_pack = first_pack;
+   _final_pack = final_pack;
+
+   _producer = std::thread(&ParallelSubSearch::_produce, this);
+}
+
+void ParallelSubSearch::_produce ()
+{
+   MMFStorage::setDatabaseId(_db_id);
+   qword session_id = TL_GET_SESSION_ID();
+
+   AutoPtr<Exception> exception;
+   try
+   {
+      run(_threads_count);
+   }
+   catch (Exception &e)
+   {
+      exception.reset(e.clone());
+   }
+   catch (...)
+   {
+      exception.reset(Exception("ParallelSubSearch: unknown exception").clone());
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      if (exception.get() != 0)
+         _exception.reset(exception.release());
+      _finished = true;
+   }
+   _queue_cond.notify_all();
+
+   TL_RELEASE_SESSION_ID(session_id);
+}
+
+bool ParallelSubSearch::popResult (int &id)
+{
+   std::unique_lock<std::mutex> lock(_queue_mutex);
+   _queue_cond.wait(lock, [this] { return !_queue.empty() || _finished; });
+
+   if (_queue.empty())
+   {
+      if (_exception.get() != 0)
+         _exception->throwSelf();
+      return false;
+   }
+
+   id = _queue.front();
+   _queue.pop_front();
+   lock.unlock();
+
+   _queue_cond.notify_all();
+   return true;
+}
+
+OsCommand * ParallelSubSearch::_allocateCommand ()
+{
+   SubSearchCommand *command = new SubSearchCommand();
+   command->search = this;
+   return command;
+}
+
+OsCommandResult * ParallelSubSearch::_allocateResult ()
+{
+   return new SubSearchResult();
+}
+
+bool ParallelSubSearch::_setupCommand (OsCommand &command)
+{
+   if (_next_pack >= _final_pack)
+      return false;
+
+   {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      if (_cancelled)
+         return false;
+   }
+
+   ((SubSearchCommand &)command).pack_idx = _next_pack++;
+   return true;
+}
+
+void ParallelSubSearch::_handleResult (OsCommandResult &result)
+{
+   Array<int> &found = ((SubSearchResult &)result).found;
+
+   std::unique_lock<std::mutex> lock(_queue_mutex);
+   for (int i = 0; i < found.size(); i++)
+   {
+      _queue_cond.wait(lock, [this] { return _cancelled || _queue.size() < _MAX_QUEUED_RESULTS; });
+      if (_cancelled)
+         return;
+
+      _queue.push_back(found[i]);
+      _queue_cond.notify_all();
+   }
+}
+
+void ParallelSubSearch::_prepareThread ()
+{
+   MMFStorage::setDatabaseId(_db_id);
+
+   std::lock_guard<std::mutex> lock(_workers_mutex);
+   int idx = (int)_thread_workers.size();
+   _thread_workers[std::this_thread::get_id()] = _workers[idx];
+}
+
+BaseSubstructureMatcher & ParallelSubSearch::_threadWorker ()
+{
+   std::lock_guard<std::mutex> lock(_workers_mutex);
+   return *_thread_workers.at(std::this_thread::get_id());
+}
+
+void ParallelSubSearch::processPack (int pack_idx, Array<int> &found)
+{
+   profTimerStart(t, "sub_parallel_pack");
+   BaseSubstructureMatcher &worker = _threadWorker();
+
+   if (_lock_data != 0)
+   {
+      ReadLock rlock(*_lock_data);
+      worker._processPack(pack_idx, found);
+   }
+   else
+      worker._processPack(pack_idx, found);
+}
@@ -0,0 +1,81 @@
+#ifndef __bingo_parallel_search__
+#define __bingo_parallel_search__
+
+#include "base_cpp/os_thread_wrapper.h"
+#include "base_cpp/ptr_array.h"
+#include "base_cpp/auto_ptr.h"
+
+#include "bingo_lock.h"
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+
+using namespace indigo;
+
+namespace bingo
+{
+   class BaseSubstructureMatcher;
+
+   // Substructure search over the fingerprint packs in the worker threads.
+   // Each worker thread owns a copy of the matcher with its own current object,
+   // screens a pack and tries the candidates. Found ids are passed through
+   // a bounded queue that is drained by the matcher's next(). The dispatcher
+   // main loop runs in a separate producer thread, so the search goes ahead
+   // between the bingoNext calls.
+   class ParallelSubSearch : public OsCommandDispatcher
+   {
+   public:
+      ParallelSubSearch (BaseSubstructureMatcher &matcher, int threads_count, bool ordered,
+                         DatabaseLockData *lock_data);
+
+      virtual ~ParallelSubSearch ();
+
+      // Starts the search over the packs [first_pack, final_pack)
+      void start (int first_pack, int final_pack);
+
+      // Waits for the next found id. Returns false when the search is finished.
+      bool popResult (int &id);
+
+      void processPack (int pack_idx, Array<int> &found);
+
+   protected:
+      virtual OsCommand * _allocateCommand ();
+      virtual OsCommandResult * _allocateResult ();
+
+      virtual bool _setupCommand (OsCommand &command);
+      virtual void _handleResult (OsCommandResult &result);
+
+      virtual void _prepareThread ();
+
+   private:
+      void _produce ();
+
+      BaseSubstructureMatcher & _threadWorker ();
+
+      int _threads_count;
+      DatabaseLockData *_lock_data;
+      int _db_id;
+
+      PtrArray<BaseSubstructureMatcher> _workers;
+      std::unordered_map<std::thread::id, BaseSubstructureMatcher *> _thread_workers;
+      std::mutex _workers_mutex;
+
+      // Accessed by the producer thread only
+      int _next_pack;
+      int _final_pack;
+
+      std::thread _producer;
+
+      std::deque<int> _queue;
+      std::mutex _queue_mutex;
+      std::condition_variable _queue_cond;
+      bool _finished;
+      bool _cancelled;
+      AutoPtr<Exception> _exception;
+   };
+};
+
+#endif // __bingo_parallel_search__
@@ -0,0 +1,167 @@
+#include "bingo_popcount_buckets.h"
+
+#include "base_c/bitarray.h"
+#include "base_cpp/tlscont.h"
+#include "base_cpp/profiling.h"
+
+#include "bingo_tanimoto_coef.h"
+#include "bingo_tversky_coef.h"
+#include "bingo_euclid_coef.h"
+
+using namespace bingo;
+
+// Non-virtual counterparts of the coefficients. Every coefficient must not
+// decrease with the number of common bits, the bucket bounds rely on it.
+namespace
+{
+   struct TanimotoCounts
+   {
+      bool isMonotone () const { return true; }
+
+      double calc (int common_bits, int target_bit_count, int query_bit_count) const
+      {
+         return (double)common_bits / (target_bit_count + query_bit_count - common_bits);
+      }
+   };
+
+   struct TverskyCounts
+   {
+      TverskyCounts (double alpha, double beta) : alpha(alpha), beta(beta) {}
+
+      bool isMonotone () const { return alpha >= 0 && beta >= 0; }
+
+      double calc (int common_bits, int target_bit_count, int query_bit_count) const
+      {
+         return (double)common_bits / ((target_bit_count - common_bits) * alpha +
+                                       (query_bit_count - common_bits) * beta + common_bits);
+      }
+
+      double alpha, beta;
+   };
+
+   struct EuclidCounts
+   {
+      bool isMonotone () const { return true; }
+
+      double calc (int common_bits, int target_bit_count, int query_bit_count) const
+      {
+         return (double)common_bits / target_bit_count;
+      }
+   };
+}
+
+PopcountBuckets::PopcountBuckets ()
+{
+   _fp_size = 0;
+   _bucket_width = 1;
+   clear();
+}
+
+void PopcountBuckets::init (int fp_size, int capacity)
+{
+   _fp_size = fp_size;
+   _bucket_width = fp_size * 8 / BUCKETS_COUNT + 1;
+   _ones_counts.allocate(capacity);
+
+   clear();
+}
+
+void PopcountBuckets::clear ()
+{
+   for (int i = 0; i <= BUCKETS_COUNT; i++)
+      _starts[i] = 0;
+}
+
+int PopcountBuckets::getOnesCount (int row)
+{
+   return _ones_counts[row];
+}
+
+void PopcountBuckets::findSimilar (const byte *fps, const byte *query, SimCoef &sim_coef, double min_coef,
+                                   bool query_is_target, Array<SimResult> &sim_rows)
+{
+   TverskyCoef *tversky = dynamic_cast<TverskyCoef *>(&sim_coef);
+
+   if (dynamic_cast<TanimotoCoef *>(&sim_coef) != 0)
+      _findSimilar(fps, query, TanimotoCounts(), min_coef, query_is_target, sim_rows);
+   else if (tversky != 0)
+      _findSimilar(fps, query, TverskyCounts(tversky->getAlpha(), tversky->getBeta()), min_coef,
+                   query_is_target, sim_rows);
+   else if (dynamic_cast<EuclidCoef *>(&sim_coef) != 0)
+      _findSimilar(fps, query, EuclidCounts(), min_coef, query_is_target, sim_rows);
+   else
+   {
+      int query_bit_count = bitGetOnesCount(query, _fp_size);
+
+      for (int row = 0; row < _starts[BUCKETS_COUNT]; row++)
+      {
+         const byte *fp = fps + (size_t)row * _fp_size;
+         int fp_bit_count = _ones_counts[row];
+         double coef = query_is_target ? sim_coef.calcCoef(fp, query, query_bit_count, fp_bit_count) :
+                                         sim_coef.calcCoef(fp, query, fp_bit_count, query_bit_count);
+         if (coef < min_coef)
+            continue;
+
+         sim_rows.push(SimResult(row, (float)coef));
+      }
+   }
+}
+
+template <typename Counts>
+void PopcountBuckets::_findSimilar (const byte *fps, const byte *query, const Counts &counts, double min_coef,
+                                    bool query_is_target, Array<SimResult> &sim_rows)
+{
+   profTimerStart(t, "popcount_buckets_find");
+
+   QS_DEF(Array<int>, common);
+
+   int query_bit_count = bitGetOnesCount(query, _fp_size);
+   int max_bit_count = _fp_size * 8;
+   const int *ones_counts = _ones_counts.ptr();
+
+   for (int k = 0; k < BUCKETS_COUNT; k++)
+   {
+      int count = _starts[k + 1] - _starts[k];
+      if (count == 0)
+         continue;
+
+      if (counts.isMonotone())
+      {
+         // The coefficient is maximal when all bits of the smaller
+         // fingerprint are common
+         int min_bits = k * _bucket_width;
+         int max_bits = __min(min_bits + _bucket_width - 1, max_bit_count);
+         bool may_match = false;
+
+         for (int bits = min_bits; bits <= max_bits && !may_match; bits++)
+         {
+            int common_bits = __min(bits, query_bit_count);
+            double bound = query_is_target ? counts.calc(common_bits, query_bit_count, bits) :
+                                             counts.calc(common_bits, bits, query_bit_count);
+            // NaN (both fingerprints are empty) passes, like in the row check below
+            may_match = !(bound < min_coef);
+         }
+
+         if (!may_match)
+         {
+            profIncCounter("popcount_buckets_skipped", count);
+            continue;
+         }
+      }
+
+      int first = _starts[k];
+      common.clear_resize(count);
+      bitCommonOnesArray(query, fps + (size_t)first * _fp_size, _fp_size, count, common.ptr());
+
+      for (int i = 0; i < count; i++)
+      {
+         int fp_bit_count = ones_counts[first + i];
+         double coef = query_is_target ? counts.calc(common[i], query_bit_count, fp_bit_count) :
+                                         counts.calc(common[i], fp_bit_count, query_bit_count);
+         if (coef < min_coef)
+            continue;
+
+         sim_rows.push(SimResult(first + i, (float)coef));
+      }
+   }
+}
@@ -0,0 +1,83 @@
+#ifndef __bingo_popcount_buckets__
+#define __bingo_popcount_buckets__
+
+#include "base_cpp/array.h"
+
+#include "bingo_ptr.h"
+#include "bingo_sim_coef.h"
+
+#include <string.h>
+
+using namespace indigo;
+
+namespace bingo
+{
+   // Keeps the increment fingerprints (the ones that are not built into
+   // a MultibitTree yet) grouped by the number of set bits. The owner's
+   // fingerprint and id buffers are reordered on insertion, so every bucket
+   // is a contiguous range of rows. The similarity search skips the buckets
+   // where the coefficient can't reach the minimal value and scans the rest
+   // sequentially.
+   class PopcountBuckets
+   {
+   public:
+      enum
+      {
+         BUCKETS_COUNT = 64
+      };
+
+      PopcountBuckets ();
+
+      void init (int fp_size, int capacity);
+
+      void clear ();
+
+      // Puts the fingerprint into its bucket. The buffers must have the room
+      // for one more row. The first row of every following bucket is moved
+      // to the end of that bucket, so the free row goes down to the target one.
+      template <typename IdType>
+      void add (byte *fps, IdType *ids, const byte *fingerprint, IdType id, int ones_count)
+      {
+         int bucket = ones_count / _bucket_width;
+         int hole = _starts[BUCKETS_COUNT];
+
+         for (int k = BUCKETS_COUNT - 1; k > bucket; k--)
+         {
+            if (_starts[k] != hole)
+            {
+               memcpy(fps + (size_t)hole * _fp_size, fps + (size_t)_starts[k] * _fp_size, _fp_size);
+               ids[hole] = ids[_starts[k]];
+               _ones_counts[hole] = _ones_counts[_starts[k]];
+            }
+            hole = _starts[k];
+            _starts[k + 1]++;
+         }
+         _starts[bucket + 1]++;
+
+         memcpy(fps + (size_t)hole * _fp_size, fingerprint, _fp_size);
+         ids[hole] = id;
+         _ones_counts[hole] = ones_count;
+      }
+
+      int getOnesCount (int row);
+
+      // Appends SimResult(row, coef) for every row of fps that is similar to
+      // the query. If query_is_target is set, the query is passed to the
+      // coefficient as a target, like MultibitTree does.
+      void findSimilar (const byte *fps, const byte *query, SimCoef &sim_coef, double min_coef,
+                        bool query_is_target, Array<SimResult> &sim_rows);
+
+   private:
+      template <typename Counts> void _findSimilar (const byte *fps, const byte *query, const Counts &counts,
+                                                    double min_coef, bool query_is_target, Array<SimResult> &sim_rows);
+
+      int _fp_size;
+      int _bucket_width;
+
+      // Rows of the bucket k are _starts[k] ... _starts[k + 1] - 1
+      int _starts[BUCKETS_COUNT + 1];
+      BingoPtr<int> _ones_counts;
+   };
+};
+
+#endif // __bingo_popcount_buckets__
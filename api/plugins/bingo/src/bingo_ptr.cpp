@@ -21,7 +21,7 @@ int BingoAllocator::getAllocatorDataSize ()
 }
 
 void BingoAllocator::_create (const char *filename, size_t min_size, size_t max_size, 
-                              size_t alloc_off, ObjArray<MMFile> *mm_files, int index_id)
+                              size_t alloc_off, PtrArray<MMFile> *mm_files, int index_id)
 {
    MMFile file;
 
@@ -50,12 +50,12 @@ void BingoAllocator::_create (const char *filename, size_t min_size, size_t max_
    allocator_data->_min_file_size = min_size;
    allocator_data->_max_file_size = max_size;
    allocator_data->_cur_file_id = 0;
-   inst->_mm_files->push(file);
+   inst->_pushFile(file);
    inst->_filename.assign(filename);
    inst->_index_id = index_id;
 }
 
-void BingoAllocator::_load (const char *filename, size_t alloc_off, ObjArray<MMFile> *mm_files, int index_id, bool read_only)
+void BingoAllocator::_load (const char *filename, size_t alloc_off, PtrArray<MMFile> *mm_files, int index_id, bool read_only)
 {
    std::string name;
    _genFilename(0, filename, name);
@@ -84,7 +84,7 @@ void BingoAllocator::_load (const char *filename, size_t alloc_off, ObjArray<MMF
    
    inst->_data_offset = alloc_off;
    inst->_mm_files = mm_files;
-   inst->_mm_files->push(file);
+   inst->_pushFile(file);
    inst->_filename.assign(filename);
    inst->_index_id = index_id;
 
@@ -92,15 +92,31 @@ void BingoAllocator::_load (const char *filename, size_t alloc_off, ObjArray<MMF
    {
       _genFilename(i, inst->_filename.c_str(), name);
 
-      MMFile &file = inst->_mm_files->push();
+      MMFile file;
 
       size_t file_size = _getFileSize(i, allocator_data->_min_file_size, 
                                       allocator_data->_max_file_size, allocator_data->_existing_files);
 
       file.open(name.c_str(), file_size, false, read_only);
+      inst->_pushFile(file);
    }
 }
 
+size_t BingoAllocator::getAllocatedSize ()
+{
+   BingoAllocator *inst = _getInstance();
+   OsLocker locker(inst->_alloc_lock);
+
+   byte *mmf_ptr = (byte *)inst->_mm_files->at(0)->ptr();
+   _BingoAllocatorData *allocator_data = (_BingoAllocatorData *)(mmf_ptr + inst->_data_offset);
+
+   size_t size = allocator_data->_free_off;
+   for (int i = 0; i < (int)allocator_data->_cur_file_id; i++)
+      size += inst->_mm_files->at(i)->size();
+
+   return size;
+}
+
 BingoAllocator *BingoAllocator::_getInstance ()
 {
    int database_id = MMFStorage::getDatabaseId();
@@ -116,18 +132,33 @@ BingoAllocator *BingoAllocator::_getInstance ()
 
 byte * BingoAllocator::_get (size_t file_id, size_t offset)
 {
-   //byte * mmf_ptr = (byte *)_mm_files->at(0).ptr();
+   return _file_ptrs.load(std::memory_order_acquire)[file_id] + offset;
+}
 
-   //_BingoAllocatorData *allocator_data = (_BingoAllocatorData *)(mmf_ptr + _data_offset);
-   
-   byte * file_ptr = (byte *)_mm_files->at((int)file_id).ptr();
 
-   return file_ptr + offset;
+BingoAllocator::BingoAllocator () : _file_ptrs(0), _file_ptrs_capacity(0)
+{
 }
 
-
-BingoAllocator::BingoAllocator ()
+void BingoAllocator::_pushFile (const MMFile &file)
 {
+   MMFile &added = _mm_files->add(new MMFile(file));
+   int idx = _mm_files->size() - 1;
+
+   if (idx < _file_ptrs_capacity)
+   {
+      _file_ptrs.load(std::memory_order_relaxed)[idx] = (byte *)added.ptr();
+      return;
+   }
+
+   Array<byte *> &table = _file_ptr_tables.push();
+   table.resize(__max(2 * _file_ptrs_capacity, 64));
+   for (int i = 0; i < idx; i++)
+      table[i] = _file_ptrs.load(std::memory_order_relaxed)[i];
+   table[idx] = (byte *)added.ptr();
+
+   _file_ptrs_capacity = table.size();
+   _file_ptrs.store(table.ptr(), std::memory_order_release);
 }
 
 size_t BingoAllocator::_getFileSize(size_t idx, size_t min_size, size_t max_size, dword existing_files)
@@ -151,7 +182,7 @@ size_t BingoAllocator::_getFileSize(size_t idx, size_t min_size, size_t max_size
 
 void BingoAllocator::_addFile (size_t alloc_size)
 {
-   byte * mmf_ptr = (byte *)_mm_files->at(0).ptr();
+   byte * mmf_ptr = (byte *)_mm_files->at(0)->ptr();
 
    _BingoAllocatorData *allocator_data = (_BingoAllocatorData *)(mmf_ptr + _data_offset);
    
@@ -177,12 +208,13 @@ void BingoAllocator::_addFile (size_t alloc_size)
    
    if (alloc_size > file_size)
       throw Exception("BingoAllocator: Too big allocation size");
-   
-   MMFile &file = _mm_files->push();
+
+   MMFile file;
 
    std::string name;
-   _genFilename(_mm_files->size() - 1, _filename.c_str(), name);
+   _genFilename(_mm_files->size(), _filename.c_str(), name);
    file.open(name.c_str(), file_size, true, false);
+   _pushFile(file);
    
    allocator_data->_cur_file_id++;
    allocator_data->_free_off = 0;
@@ -2,6 +2,7 @@
 #define __bingo_ptr__
 
 #include "base_cpp/obj_array.h"
+#include "base_cpp/ptr_array.h"
 #include "base_cpp/exception.h"
 #include "base_cpp/tlscont.h"
 #include "bingo_mmf.h"
@@ -9,7 +10,8 @@
 #include "base_cpp/os_sync_wrapper.h"
 #include <new>
 #include <string>
-#include <thread>     
+#include <thread>
+#include <atomic>     
 
 using namespace indigo;
 
@@ -439,6 +441,9 @@ namespace bingo
 
       static int getAllocatorDataSize ();
 
+      // Returns the number of bytes allocated in the files of the current database
+      static size_t getAllocatedSize ();
+
    private:
       struct _BingoAllocatorData
       {
@@ -453,7 +458,7 @@ namespace bingo
          size_t _free_off;
       };
 
-      ObjArray<MMFile> *_mm_files;
+      PtrArray<MMFile> *_mm_files;
 
       size_t _data_offset;
 
@@ -462,13 +467,28 @@ namespace bingo
       int _index_id;
       static OsLock _instances_lock;
 
-      static void _create (const char *filename, size_t min_size, size_t max_size, size_t alloc_off, ObjArray<MMFile> *mm_files, int index_id);
+      // Containers of the similarity storage are built in background while
+      // the database is not locked, so the allocation is serialized
+      OsLock _alloc_lock;
+
+      // Base addresses of the files. The readers access the table without the
+      // allocation lock, so a full table is copied to a twice bigger one and
+      // the previous tables are kept until the allocator is destroyed.
+      std::atomic<byte **> _file_ptrs;
+      int _file_ptrs_capacity;
+      ObjArray< Array<byte *> > _file_ptr_tables;
+
+      static void _create (const char *filename, size_t min_size, size_t max_size, size_t alloc_off, PtrArray<MMFile> *mm_files, int index_id);
      
-      static void _load (const char *filename, size_t alloc_off, ObjArray<MMFile> *mm_files, int index_id, bool read_only);
+      static void _load (const char *filename, size_t alloc_off, PtrArray<MMFile> *mm_files, int index_id, bool read_only);
+
+      void _pushFile (const MMFile &file);
 
       template<typename T> BingoAddr allocate ( int count = 1 )
       {
-         byte * mmf_ptr = (byte *)_mm_files->at(0).ptr();
+         OsLocker locker(_alloc_lock);
+
+         byte * mmf_ptr = (byte *)_mm_files->at(0)->ptr();
 
          _BingoAllocatorData *allocator_data = (_BingoAllocatorData *)(mmf_ptr + _data_offset);
    
@@ -476,13 +496,13 @@ namespace bingo
          
          size_t file_idx = allocator_data->_cur_file_id;
          size_t file_off = allocator_data->_free_off;
-         size_t file_size = _mm_files->at((int)file_idx).size();
+         size_t file_size = _mm_files->at((int)file_idx)->size();
          
          if (alloc_size > file_size - file_off)
             _addFile(alloc_size);
 
          file_idx = allocator_data->_cur_file_id;
-         file_size = _mm_files->at((int)file_idx).size();
+         file_size = _mm_files->at((int)file_idx)->size();
 
          size_t res_off = allocator_data->_free_off;
          size_t res_id = allocator_data->_cur_file_id;
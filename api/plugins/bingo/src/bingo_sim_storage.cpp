@@ -9,6 +9,7 @@ SimStorage::SimStorage (int fp_size, int mt_size, int inc_size) : _fingerprint_t
 {
    _inc_buffer.allocate(_inc_size * _fp_size);
    _inc_id_buffer.allocate(_inc_size * _fp_size);
+   _inc_buckets.init(_fp_size, _inc_size);
 }
 
 BingoAddr SimStorage::create (BingoPtr<SimStorage> &ptr, int fp_size, int mt_size, int inc_size)
@@ -28,8 +29,8 @@ void SimStorage::add (const byte *fingerprint, int id)
 {
    if ((BingoAddr)_fingerprint_table == BingoAddr::bingo_null)
    {
-      memcpy(_inc_buffer.ptr() + (_inc_fp_count * _fp_size), fingerprint, _fp_size);
-      _inc_id_buffer[_inc_fp_count] = id;
+      _inc_buckets.add(_inc_buffer.ptr(), _inc_id_buffer.ptr(), fingerprint, (size_t)id,
+                       bitGetOnesCount(fingerprint, _fp_size));
 
       _inc_fp_count++;
 
@@ -40,6 +41,7 @@ void SimStorage::add (const byte *fingerprint, int id)
             _fingerprint_table->add(_inc_buffer.ptr() + (i * _fp_size), _inc_id_buffer[i]);
       
          _inc_fp_count = 0;
+         _inc_buckets.clear();
       }
    }
    else
@@ -97,6 +99,14 @@ int SimStorage::nextFitCell (int query_bit_count, int first_fit_cell, int min_ce
    return _fingerprint_table->nextFitCell(query_bit_count, first_fit_cell, min_cell, max_cell, idx);
 }
 
+double SimStorage::calcCellUpperBound (SimCoef &sim_coef, int query_bit_count, int cell_idx) const
+{
+   if ((BingoAddr)_fingerprint_table == BingoAddr::bingo_null)
+      throw Exception("SimStorage: fingerptint table wasn't built");
+
+   return _fingerprint_table->calcCellUpperBound(sim_coef, query_bit_count, cell_idx);
+}
+
 int SimStorage::getSimilar (const byte *query, SimCoef &sim_coef, double min_coef, 
                   Array<SimResult> &sim_fp_indices, int cell_idx, int cont_idx)
 {
@@ -115,19 +125,40 @@ bool SimStorage::isSmallBase ()
 
 int SimStorage::getIncSimilar (const byte *query, SimCoef &sim_coef, double min_coef, Array<SimResult> &sim_fp_indices)
 {
-   for (int i = 0; i < _inc_fp_count; i++)
-   {
-      double coef = sim_coef.calcCoef(_inc_buffer.ptr() + (i * _fp_size), query, -1, -1);
-      if (coef < min_coef)
-         continue;
-      size_t id = _inc_id_buffer[i];
+   int first = sim_fp_indices.size();
 
-      sim_fp_indices.push(SimResult(id, coef));
-   }
+   _inc_buckets.findSimilar(_inc_buffer.ptr(), query, sim_coef, min_coef, false, sim_fp_indices);
+
+   for (int i = first; i < sim_fp_indices.size(); i++)
+      sim_fp_indices[i].id = (int)_inc_id_buffer[sim_fp_indices[i].id];
 
    return sim_fp_indices.size();
 }
 
+bool SimStorage::needsBuild (int inc_threshold) const
+{
+   if ((BingoAddr)_fingerprint_table == BingoAddr::bingo_null)
+      return false;
+
+   return _fingerprint_table->needsBuild(inc_threshold);
+}
+
+bool SimStorage::startBuild (int inc_threshold, ContainerSet::BuildTask &task)
+{
+   if ((BingoAddr)_fingerprint_table == BingoAddr::bingo_null)
+      return false;
+
+   return _fingerprint_table->startBuild(inc_threshold, task);
+}
+
+bool SimStorage::finishBuild (const ContainerSet::BuildTask &task, MultibitTree &tree)
+{
+   if ((BingoAddr)_fingerprint_table == BingoAddr::bingo_null)
+      return false;
+
+   return _fingerprint_table->finishBuild(task, tree);
+}
+
 SimStorage::~SimStorage ()
 {
 }
\ No newline at end of file
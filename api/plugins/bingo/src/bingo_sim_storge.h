@@ -9,6 +9,7 @@
 #include "time.h"
 #include "new"
 #include "bingo_fingerprint_table.h"
+#include "bingo_popcount_buckets.h"
 
 #include <vector>
 
@@ -38,6 +39,8 @@ namespace bingo
 
       int nextFitCell (int query_bit_count, int first_fit_cell, int min_cell, int max_cell, int idx) const;
 
+      double calcCellUpperBound (SimCoef &sim_coef, int query_bit_count, int cell_idx) const;
+
       int getSimilar (const byte *query, SimCoef &sim_coef, double min_coef, 
                       Array<SimResult> &sim_fp_indices, int cell_idx, int cont_idx);
 
@@ -45,12 +48,21 @@ namespace bingo
 
       int getIncSimilar (const byte *query, SimCoef &sim_coef, double min_coef, Array<SimResult> &sim_fp_indices);
 
+      // Background build of the containers. The small base has no containers.
+
+      bool needsBuild (int inc_threshold) const;
+
+      bool startBuild (int inc_threshold, ContainerSet::BuildTask &task);
+
+      bool finishBuild (const ContainerSet::BuildTask &task, MultibitTree &tree);
+
       ~SimStorage();
    
    private:
       BingoPtr< FingerprintTable > _fingerprint_table;
       BingoPtr< byte > _inc_buffer;
       BingoPtr< size_t > _inc_id_buffer;
+      PopcountBuckets _inc_buckets;
       int _inc_size;
       int _inc_fp_count;
 
@@ -16,7 +16,12 @@ TverskyCoef::TverskyCoef (int fp_size, double a, double b) : _fp_size(fp_size)
 
 double TverskyCoef::calcCoef (const byte *target, const byte *query, int target_bit_count, int query_bit_count )
 {
-   int common_bits = bitCommonOnes(target, query, _fp_size);
+   int common_bits;
+
+   if (target_bit_count == -1 && query_bit_count == -1)
+      common_bits = bitCommonOnesWithCounts(target, query, _fp_size, &target_bit_count, &query_bit_count);
+   else
+      common_bits = bitCommonOnes(target, query, _fp_size);
 
    if (target_bit_count == -1)
       target_bit_count = bitGetOnesCount(target, _fp_size);
@@ -33,7 +38,7 @@ double TverskyCoef::calcUpperBound (int query_bit_count, int min_target_bit_coun
       return 1;
 
    int min = (query_bit_count < max_target_bit_count ? query_bit_count : max_target_bit_count);
-   return min / (_alpha * min_target_bit_count + _beta * query_bit_count);
+   return min / _minDenominator(query_bit_count, min_target_bit_count);
 }
 
 double TverskyCoef::calcUpperBound (int query_bit_count, int min_target_bit_count, int max_target_bit_count, int m10, int m01 )
@@ -46,5 +51,15 @@ double TverskyCoef::calcUpperBound (int query_bit_count, int min_target_bit_coun
    
    int min = (b > max_a ? max_a : b );
 
-   return (double)min / (_alpha * min_target_bit_count + _beta * query_bit_count);
+   return (double)min / _minDenominator(query_bit_count, min_target_bit_count);
+}
+
+double TverskyCoef::_minDenominator (int query_bit_count, int min_target_bit_count)
+{
+   // MultibitTree passes the query as a target to calcCoef, so the bound
+   // has to hold for both orders of the fingerprints
+   double direct = _alpha * min_target_bit_count + _beta * query_bit_count;
+   double swapped = _alpha * query_bit_count + _beta * min_target_bit_count;
+
+   return (direct < swapped ? direct : swapped);
 }
\ No newline at end of file
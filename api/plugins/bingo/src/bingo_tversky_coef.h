@@ -20,7 +20,13 @@ namespace bingo
 
       double calcUpperBound (int query_bit_count, int min_target_bit_count, int max_target_bit_count, int m10, int m01 );
 
+      double getAlpha () const { return _alpha; }
+
+      double getBeta () const { return _beta; }
+
    private:
+      double _minDenominator (int query_bit_count, int min_target_bit_count);
+
       int _fp_size;
       double _alpha;
       double _beta;
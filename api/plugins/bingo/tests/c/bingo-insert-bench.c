@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "indigo.h"
+#include "bingo.h"
+#include "bench-fixtures.h"
+
+// Records per second inserted by bingoInsertRecordsBatch with 1, 4, 16 and
+// 32 threads, against bingoInsertRecordObj called for each record. Each run
+// creates a database in its own subdirectory of the given directory.
+// Usage: bingo-insert-bench [records] [directory] [file with SMILES]
+
+static const int threads_counts[] = {1, 4, 16, 32};
+
+// Records that can't be inserted are skipped, as the batch insertion does
+static int skip_errors = 0;
+
+void onError (const char *message, void *context)
+{
+   if (skip_errors)
+      return;
+   fprintf(stderr, "Error: %s\n", message);
+   exit(-1);
+}
+
+static int createDatabase (const char *dir, const char *name)
+{
+   char path[1024];
+
+   snprintf(path, sizeof(path), "%s/%s", dir, name);
+   return bingoCreateDatabaseFile(path, "molecule", "");
+}
+
+int main (int argc, char **argv)
+{
+   int records = (argc > 1) ? atoi(argv[1]) : 20000;
+   const char *dir = (argc > 2) ? argv[2] : "bingo-insert-bench";
+   int arr, db, *mols, *result_ids, i, k, inserted, n_ids;
+   double start, seconds, single_rate;
+
+   indigoSetErrorHandler(onError, 0);
+
+   mols = (int *)malloc(records * sizeof(int));
+   if (argc > 3)
+   {
+      int iter = indigoIterateSmilesFile(argv[3]), item;
+
+      for (i = 0; i < records && (item = indigoNext(iter)) != 0; i++)
+         mols[i] = item;
+      indigoFree(iter);
+      records = i;
+   }
+   else
+   {
+      srand(12345);
+      for (i = 0; i < records; i++)
+      {
+         char smiles[1024];
+
+         benchRandomSmiles(smiles);
+         mols[i] = indigoLoadMoleculeFromString(smiles);
+      }
+   }
+
+   arr = indigoCreateArray();
+   for (i = 0; i < records; i++)
+      indigoArrayAdd(arr, mols[i]);
+   result_ids = (int *)malloc(records * sizeof(int));
+
+   printf("%d records\n", records);
+   printf("%-24s %10s %12s %8s\n", "", "inserted", "records/s", "speedup");
+
+   db = createDatabase(dir, "single");
+   start = benchNow();
+   inserted = 0;
+   skip_errors = 1;
+   for (i = 0; i < records; i++)
+      inserted += (bingoInsertRecordObj(db, mols[i]) >= 0);
+   skip_errors = 0;
+   seconds = benchNow() - start;
+   bingoCloseDatabase(db);
+
+   single_rate = records / seconds;
+   printf("%-24s %10d %12.0f %8.2f\n", "bingoInsertRecordObj", inserted, single_rate, 1.0);
+
+   for (k = 0; k < COUNT(threads_counts); k++)
+   {
+      char name[64], title[64];
+
+      snprintf(name, sizeof(name), "batch%d", threads_counts[k]);
+      db = createDatabase(dir, name);
+
+      start = benchNow();
+      inserted = bingoInsertRecordsBatch(db, arr, NULL, result_ids, records, threads_counts[k]);
+      seconds = benchNow() - start;
+      bingoCloseDatabase(db);
+
+      // Records that are not inserted have -1
+      for (i = 0, n_ids = 0; i < records; i++)
+         n_ids += (result_ids[i] >= 0);
+      if (n_ids != inserted)
+      {
+         printf("%d ids for %d inserted records\n", n_ids, inserted);
+         return 1;
+      }
+
+      snprintf(title, sizeof(title), "batch, %d threads", threads_counts[k]);
+      printf("%-24s %10d %12.0f %8.2f\n", title, inserted, records / seconds, records / seconds / single_rate);
+   }
+
+   for (i = 0; i < records; i++)
+      indigoFree(mols[i]);
+   free(mols);
+   free(result_ids);
+   indigoFree(arr);
+   return 0;
+}
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "indigo.h"
+#include "bingo.h"
+#include "base_c/bitarray.h"
+#include "bench-fixtures.h"
+
+// Milliseconds per query of bingoSearchSub, with all the hits taken by
+// bingoNext, for every implementation of the bit array kernels that the CPU
+// supports. The screening of the transposed fingerprint packs runs through
+// these kernels, so the hits must not depend on the implementation.
+// Usage: bingo-screen-bench [records] [rounds] [directory]
+
+static const char *queries[] =
+{
+   "c1ccncc1",
+   "C1CC1Cl",
+   "NC(=O)C",
+   "c1ccoc1",
+   "C1CCNCC1C(=O)",
+   "FC(F)CN",
+   "c1ccc2ccccc2c1",
+   "BrCC=C",
+   "N#CC1CC1",
+   "c1ccccc1Oc1ccncc1",
+   "CCCCCCCC",
+   "C(=O)NC(=O)"
+};
+
+// Records that can't be loaded are skipped
+static int skip_errors = 0;
+
+void onError (const char *message, void *context)
+{
+   if (skip_errors)
+      return;
+   fprintf(stderr, "Error: %s\n", message);
+   exit(-1);
+}
+
+static int randomMolecule ()
+{
+   char smiles[1024];
+
+   benchRandomSmiles(smiles);
+   return indigoLoadMoleculeFromString(smiles);
+}
+
+// Number of the hits and the sum of their ids
+static int search (int db, int query, long long *ids_sum)
+{
+   int search = bingoSearchSub(db, query, ""), n = 0;
+
+   *ids_sum = 0;
+   while (bingoNext(search))
+   {
+      *ids_sum += bingoGetCurrentId(search);
+      n++;
+   }
+   bingoEndSearch(search);
+   return n;
+}
+
+int main (int argc, char **argv)
+{
+   int records = (argc > 1) ? atoi(argv[1]) : 200000;
+   int rounds = (argc > 2) ? atoi(argv[2]) : 5;
+   const char *dir = (argc > 3) ? argv[3] : "bingo-screen-bench";
+   int db, i, q, r, impl, inserted = 0, failed = 0;
+   int hits[COUNT(queries)];
+   long long sums[COUNT(queries)];
+   double total[COUNT(bench_bit_implementations)] = {0};
+
+   indigoSetErrorHandler(onError, 0);
+
+   db = bingoCreateDatabaseFile(dir, "molecule", "");
+
+   srand(12345);
+   skip_errors = 1;
+   for (i = 0; i < records; i++)
+   {
+      int mol = randomMolecule();
+
+      if (mol > 0)
+      {
+         inserted += (bingoInsertRecordObj(db, mol) >= 0);
+         indigoFree(mol);
+      }
+   }
+   skip_errors = 0;
+
+   // The records are moved from the increment into the packs
+   bingoOptimize(db);
+
+   printf("%d records (%d inserted), %d rounds, ms per query\n", records, inserted, rounds);
+   printf("%-20s %8s", "query", "hits");
+   for (impl = BIT_IMPL_PORTABLE; impl <= BIT_IMPL_AVX512; impl++)
+      if (bitSetImplementation(impl))
+         printf(" %9s", bench_bit_implementations[impl]);
+   printf("\n");
+
+   for (q = 0; q < COUNT(queries); q++)
+   {
+      int query = indigoLoadQueryMoleculeFromString(queries[q]);
+
+      bitSetImplementation(BIT_IMPL_PORTABLE);
+      hits[q] = search(db, query, &sums[q]);
+      printf("%-20s %8d", queries[q], hits[q]);
+
+      for (impl = BIT_IMPL_PORTABLE; impl <= BIT_IMPL_AVX512; impl++)
+      {
+         double start, seconds;
+
+         if (!bitSetImplementation(impl))
+            continue;
+
+         start = benchNow();
+         for (r = 0; r < rounds; r++)
+         {
+            long long sum;
+
+            if (search(db, query, &sum) != hits[q] || sum != sums[q])
+            {
+               printf(" MISMATCH");
+               failed = 1;
+               break;
+            }
+         }
+         seconds = benchNow() - start;
+         total[impl] += seconds;
+
+         printf(" %9.2f", seconds * 1000 / rounds);
+      }
+      printf("\n");
+      indigoFree(query);
+   }
+
+   printf("%-20s %8s", "total", "");
+   for (impl = BIT_IMPL_PORTABLE; impl <= BIT_IMPL_AVX512; impl++)
+      if (bitSetImplementation(impl))
+         printf(" %9.2f", total[impl] * 1000 / rounds);
+   printf("\n");
+
+   bingoCloseDatabase(db);
+   return failed;
+}
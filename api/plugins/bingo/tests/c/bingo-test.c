@@ -5,15 +5,169 @@
 #include "indigo.h"
 #include "bingo.h"
 
+#define COUNT(arr) (int)(sizeof(arr) / sizeof(arr[0]))
+#define RECORDS 300
+
+// Every record is one of these with a tail of carbons
+static const char *test_smiles[] =
+{
+   "O=Cc1ccccc1NC", "OC(=O)C1CCNCC1", "ClCCOC1=CC=NC=C1", "C#CC1CC1N", "FC(F)(F)c1ccc2ccccc2c1",
+   "CC(C)(C)OC(=O)N", "Brc1ccoc1", "NC(=O)C=CC(=O)O", "S=C(N)Nc1ccccc1", "CCCCCCCCCCC"
+};
+
+static const char *queries[] = {"C(=O)N", "c1ccccc1", "CCCC", "Cl"};
+
 void onError (const char *message, void *context)
 {
    fprintf(stderr, "Error: %s\n", message);
    exit(-1);
 }
 
+static void fail (const char *test, const char *message)
+{
+   printf("%s: %s\n", test, message);
+   exit(-1);
+}
+
+static int loadRecord (int idx)
+{
+   char smiles[256];
+   int i;
+
+   strcpy(smiles, test_smiles[idx % COUNT(test_smiles)]);
+   for (i = 0; i < idx / COUNT(test_smiles); i++)
+      strcat(smiles, "C");
+   return indigoLoadMoleculeFromString(smiles);
+}
+
+static int floatCmp (const void *a, const void *b)
+{
+   float f1 = *(const float *)a, f2 = *(const float *)b;
+
+   return (f1 > f2) ? -1 : (f1 < f2);
+}
+
+// Checks the hits of the substructure search against the matcher. Records
+// with deleted[idx] set must not be found, the record ids are idx + 1.
+static void checkSub (const char *test, int db, const int *deleted)
+{
+   int q, idx;
+
+   for (q = 0; q < COUNT(queries); q++)
+   {
+      int query = indigoLoadQueryMoleculeFromString(queries[q]);
+      int search = bingoSearchSub(db, query, "");
+      int found[RECORDS] = {0};
+
+      while (bingoNext(search))
+      {
+         int id = bingoGetCurrentId(search);
+
+         if (id < 1 || id > RECORDS || deleted[id - 1] || found[id - 1])
+            fail(test, "wrong hit");
+         found[id - 1] = 1;
+      }
+      bingoEndSearch(search);
+
+      for (idx = 0; idx < RECORDS; idx++)
+      {
+         int mol, matcher, match;
+
+         if (deleted[idx])
+            continue;
+         mol = loadRecord(idx);
+         matcher = indigoSubstructureMatcher(mol, "");
+         match = indigoMatch(matcher, query);
+         if ((match != 0) != found[idx])
+            fail(test, queries[q]);
+         if (match != 0)
+            indigoFree(match);
+         indigoFree(matcher);
+         indigoFree(mol);
+      }
+      indigoFree(query);
+   }
+}
+
+// The top-N similarities must be the highest ones of the full search
+static void checkTopN (int db)
+{
+   int q, n, n_top, limit = 10;
+
+   for (q = 0; q < COUNT(test_smiles); q++)
+   {
+      int query = indigoLoadMoleculeFromString(test_smiles[q]);
+      int search = bingoSearchSim(db, query, 0, 1, "tanimoto");
+      float full[RECORDS], top[RECORDS];
+
+      for (n = 0; bingoNext(search); n++)
+         full[n] = bingoGetCurrentSimilarityValue(search);
+      bingoEndSearch(search);
+
+      search = bingoSearchSimTopN(db, query, limit, 0, "tanimoto");
+      for (n_top = 0; bingoNext(search); n_top++)
+      {
+         if (n_top == limit)
+            fail("Top-N search", "too many hits");
+         top[n_top] = bingoGetCurrentSimilarityValue(search);
+      }
+      bingoEndSearch(search);
+
+      qsort(full, n, sizeof(float), floatCmp);
+      qsort(top, n_top, sizeof(float), floatCmp);
+      if (n_top != ((n < limit) ? n : limit))
+         fail("Top-N search", test_smiles[q]);
+      for (n = 0; n < n_top; n++)
+         if (top[n] != full[n])
+            fail("Top-N search", test_smiles[q]);
+      indigoFree(query);
+   }
+}
+
 int main (void)
 {
+   int arr = indigoCreateArray();
+   int ids[RECORDS], result_ids[RECORDS], deleted[RECORDS] = {0};
+   int db, i, reclaimed;
+   long long reclaimed_bytes;
+
    indigoSetErrorHandler(onError, 0);
    printf("%s\n", indigoVersion());
+
+   db = bingoCreateDatabaseFile("bingo-test-db", "molecule", "");
+
+   for (i = 0; i < RECORDS; i++)
+   {
+      int mol = loadRecord(i);
+
+      indigoArrayAdd(arr, mol);
+      indigoFree(mol);
+      ids[i] = i + 1;
+   }
+   if (bingoInsertRecordsBatch(db, arr, ids, result_ids, RECORDS, 2) != RECORDS)
+      fail("Batch insert", "wrong number of records");
+   for (i = 0; i < RECORDS; i++)
+      if (result_ids[i] != ids[i])
+         fail("Batch insert", "wrong record id");
+   indigoFree(arr);
+
+   checkSub("Batch insert", db, deleted);
+   checkTopN(db);
+
+   bingoOptimize(db);
+   for (i = 0; i < RECORDS; i += 3)
+   {
+      bingoDeleteRecord(db, ids[i]);
+      deleted[i] = 1;
+   }
+   reclaimed = bingoCompact(db, &reclaimed_bytes);
+   if (reclaimed != (RECORDS + 2) / 3 || reclaimed_bytes <= 0)
+      fail("Compact", "wrong number of reclaimed records");
+
+   checkSub("Compact", db, deleted);
+   checkTopN(db);
+
+   bingoCloseDatabase(db);
+   printf("Bingo: OK\n");
    return 0;
 }
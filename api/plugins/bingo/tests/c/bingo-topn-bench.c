@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "indigo.h"
+#include "bingo.h"
+#include "bench-fixtures.h"
+
+// Milliseconds per query of bingoSearchSimTopN for k = 1, 10, 100 and 1000,
+// against a full similarity search sorted by the caller. The top must be
+// equal to the first k rows of the full search ordered by the similarity
+// value and then by id.
+// Usage: bingo-topn-bench [records] [queries] [directory]
+
+static const char *metrics[] = {"tanimoto", "tversky 0.7 0.3"};
+
+static const int limits[] = {1, 10, 100, 1000};
+
+typedef struct
+{
+   int id;
+   float sim;
+} Hit;
+
+// Records that can't be loaded are skipped
+static int skip_errors = 0;
+
+void onError (const char *message, void *context)
+{
+   if (skip_errors)
+      return;
+   fprintf(stderr, "Error: %s\n", message);
+   exit(-1);
+}
+
+static int randomMolecule ()
+{
+   char smiles[1024];
+
+   benchRandomSmiles(smiles);
+   return indigoLoadMoleculeFromString(smiles);
+}
+
+static int hitsCmp (const void *a, const void *b)
+{
+   const Hit *h1 = (const Hit *)a, *h2 = (const Hit *)b;
+
+   if (h1->sim != h2->sim)
+      return (h1->sim > h2->sim) ? -1 : 1;
+   return h1->id - h2->id;
+}
+
+static int collect (int search, Hit *hits)
+{
+   int n = 0;
+
+   while (bingoNext(search))
+   {
+      hits[n].id = bingoGetCurrentId(search);
+      hits[n].sim = bingoGetCurrentSimilarityValue(search);
+      n++;
+   }
+   bingoEndSearch(search);
+   return n;
+}
+
+int main (int argc, char **argv)
+{
+   int records = (argc > 1) ? atoi(argv[1]) : 100000;
+   int queries_count = (argc > 2) ? atoi(argv[2]) : 20;
+   const char *dir = (argc > 3) ? argv[3] : "bingo-topn-bench";
+   int db, i, m, l, q, *queries, *ids, n_ids, n_full;
+   Hit *full, *top;
+   double start, full_ms;
+
+   indigoSetErrorHandler(onError, 0);
+
+   db = bingoCreateDatabaseFile(dir, "molecule", "");
+
+   ids = (int *)malloc(records * sizeof(int));
+   srand(12345);
+   skip_errors = 1;
+   for (i = 0, n_ids = 0; i < records; i++)
+   {
+      int mol = randomMolecule();
+
+      if (mol > 0)
+      {
+         if ((ids[n_ids] = bingoInsertRecordObj(db, mol)) >= 0)
+            n_ids++;
+         indigoFree(mol);
+      }
+   }
+   skip_errors = 0;
+
+   // Deleted records must not get into the top
+   for (i = 0; i < n_ids; i += 7)
+      bingoDeleteRecord(db, ids[i]);
+
+   queries = (int *)malloc(queries_count * sizeof(int));
+   for (q = 0; q < queries_count; q++)
+      while ((queries[q] = randomMolecule()) < 0)
+         ;
+
+   full = (Hit *)malloc(records * sizeof(Hit));
+   top = (Hit *)malloc(records * sizeof(Hit));
+
+   printf("%d records (%d inserted, every 7th deleted), %d queries, ms per query\n", records, n_ids, queries_count);
+   printf("%-16s %8s %10s %10s %10s\n", "metric", "k", "top-n", "full+sort", "mismatches");
+
+   for (m = 0; m < COUNT(metrics); m++)
+   {
+      for (l = 0; l < COUNT(limits); l++)
+      {
+         double top_ms = 0;
+         int mismatches = 0;
+
+         full_ms = 0;
+         for (q = 0; q < queries_count; q++)
+         {
+            int n_top;
+
+            start = benchNow();
+            n_top = collect(bingoSearchSimTopN(db, queries[q], limits[l], 0, metrics[m]), top);
+            top_ms += (benchNow() - start) * 1000;
+
+            start = benchNow();
+            n_full = collect(bingoSearchSim(db, queries[q], 0, 1, metrics[m]), full);
+            qsort(full, n_full, sizeof(Hit), hitsCmp);
+            full_ms += (benchNow() - start) * 1000;
+
+            if (n_top != ((n_full < limits[l]) ? n_full : limits[l]))
+               mismatches++;
+            else
+            {
+               for (i = 0; i < n_top; i++)
+                  if (top[i].id != full[i].id || top[i].sim != full[i].sim)
+                     break;
+               mismatches += (i < n_top);
+            }
+         }
+
+         printf("%-16s %8d %10.1f %10.1f %10d\n", metrics[m], limits[l], top_ms / queries_count,
+                full_ms / queries_count, mismatches);
+      }
+   }
+
+   for (q = 0; q < queries_count; q++)
+      indigoFree(queries[q]);
+   free(queries);
+   free(ids);
+   free(full);
+   free(top);
+   bingoCloseDatabase(db);
+   return 0;
+}
@@ -16,7 +16,7 @@ import sys
 import os
 import platform
 from array import array
-from ctypes import c_int, c_char_p, c_float, POINTER, pointer, CDLL, RTLD_GLOBAL, c_ulonglong, c_byte, c_double
+from ctypes import c_int, c_char_p, c_float, POINTER, pointer, CDLL, RTLD_GLOBAL, c_ulonglong, c_longlong, c_byte, c_double, c_uint, memmove
 
 DECODE_ENCODING = 'utf-8'
 ENCODE_ENCODING = 'utf-8'
@@ -1140,6 +1140,10 @@ class IndigoObject(object):
         self.dispatcher._setSessionId()
         return self.dispatcher._checkResult(Indigo._lib.indigoLayout(self.id))
 
+    def layoutBatch(self, threads=0, timeout=0):
+        self.dispatcher._setSessionId()
+        return self.dispatcher._checkResultString(Indigo._lib.indigoLayoutBatch(self.id, threads, timeout))
+
     def smiles(self):
         self.dispatcher._setSessionId()
         return self.dispatcher._checkResultString(Indigo._lib.indigoSmiles(self.id))
@@ -1209,6 +1213,33 @@ class IndigoObject(object):
         self.dispatcher._setSessionId()
         return self.dispatcher._checkResult(Indigo._lib.indigoCountBits(self.id))
 
+    def sparseFingerprint(self, type=''):
+        if type is None:
+            type = ''
+        self.dispatcher._setSessionId()
+        return self.dispatcher.IndigoObject(self.dispatcher, self.dispatcher._checkResult(Indigo._lib.indigoSparseFingerprint(self.id, type.encode(ENCODE_ENCODING))))
+
+    def foldFingerprint(self, bits):
+        self.dispatcher._setSessionId()
+        return self.dispatcher.IndigoObject(self.dispatcher, self.dispatcher._checkResult(Indigo._lib.indigoFoldFingerprint(self.id, bits)))
+
+    def sparseFingerprintsCSR(self):
+        """Returns (indptr, hashes, counts) arrays of the sparse fingerprints"""
+        c_rows = c_int()
+        c_nnz = c_int()
+        c_indptr = POINTER(c_int)()
+        c_hashes = POINTER(c_uint)()
+        c_counts = POINTER(c_int)()
+        self.dispatcher._setSessionId()
+        self.dispatcher._checkResult(Indigo._lib.indigoSparseFingerprintsCSR(self.id, pointer(c_rows), pointer(c_nnz), pointer(c_indptr), pointer(c_hashes), pointer(c_counts)))
+        res = []
+        for ptr, code, size in ((c_indptr, 'i', c_rows.value + 1), (c_hashes, 'I', c_nnz.value), (c_counts, 'i', c_nnz.value)):
+            arr = array(code, [0]) * size
+            if size > 0:
+                memmove(arr.buffer_info()[0], ptr, size * arr.itemsize)
+            res.append(arr)
+        return tuple(res)
+
     def rawData(self):
         self.dispatcher._setSessionId()
         return self.dispatcher._checkResultString(Indigo._lib.indigoRawData(self.id))
@@ -1297,6 +1328,19 @@ class IndigoObject(object):
         self.dispatcher._setSessionId()
         return self.dispatcher._checkResult(Indigo._lib.indigoCountMatches(self.id, query.id))
 
+    def querySetAdd(self, query):
+        self.dispatcher._setSessionId()
+        return self.dispatcher._checkResult(Indigo._lib.indigoQuerySetAdd(self.id, query.id))
+
+    def querySetMatch(self, target):
+        c_size = c_int()
+        self.dispatcher._setSessionId()
+        c_buf = self.dispatcher._checkResultPtr(Indigo._lib.indigoQuerySetMatch(self.id, target.id, pointer(c_size)))
+        res = array("i")
+        for i in range(c_size.value):
+            res.append(c_buf[i])
+        return res
+
     def countMatchesWithLimit(self, query, embeddings_limit):
         self.dispatcher._setSessionId()
         return self.dispatcher._checkResult(Indigo._lib.indigoCountMatchesWithLimit(self.id, query.id, embeddings_limit))
@@ -1612,6 +1656,14 @@ class Indigo(object):
         Indigo._lib.indigoUnserialize.argtypes = [POINTER(c_byte), c_int]
         Indigo._lib.indigoCommonBits.restype = c_int
         Indigo._lib.indigoCommonBits.argtypes = [c_int, c_int]
+        Indigo._lib.indigoSparseFingerprint.restype = c_int
+        Indigo._lib.indigoSparseFingerprint.argtypes = [c_int, c_char_p]
+        Indigo._lib.indigoFoldFingerprint.restype = c_int
+        Indigo._lib.indigoFoldFingerprint.argtypes = [c_int, c_int]
+        Indigo._lib.indigoSparseFingerprints.restype = c_int
+        Indigo._lib.indigoSparseFingerprints.argtypes = [c_int, c_char_p]
+        Indigo._lib.indigoSparseFingerprintsCSR.restype = c_int
+        Indigo._lib.indigoSparseFingerprintsCSR.argtypes = [c_int, POINTER(c_int), POINTER(c_int), POINTER(POINTER(c_int)), POINTER(POINTER(c_uint)), POINTER(POINTER(c_int))]
         Indigo._lib.indigoSimilarity.restype = c_float
         Indigo._lib.indigoSimilarity.argtypes = [c_int, c_int, c_char_p]
         Indigo._lib.indigoIterateSDF.restype = c_int
@@ -1654,10 +1706,16 @@ class Indigo(object):
         Indigo._lib.indigoCreateDecomposer.argtypes = [c_int]
         Indigo._lib.indigoReactionProductEnumerate.restype = c_int
         Indigo._lib.indigoReactionProductEnumerate.argtypes = [c_int, c_int]
+        Indigo._lib.indigoIterateEnumeratedProducts.restype = c_int
+        Indigo._lib.indigoIterateEnumeratedProducts.argtypes = [c_int, c_int]
         Indigo._lib.indigoTransform.restype = c_int
         Indigo._lib.indigoTransform.argtypes = [c_int, c_int]
         Indigo._lib.indigoDbgBreakpoint.restype = None
         Indigo._lib.indigoDbgBreakpoint.argtypes = None
+        Indigo._lib.indigoDbgProfilingGetCounter.restype = c_longlong
+        Indigo._lib.indigoDbgProfilingGetCounter.argtypes = [c_char_p, c_int]
+        Indigo._lib.indigoDbgProfilingJson.restype = c_char_p
+        Indigo._lib.indigoDbgProfilingJson.argtypes = [c_int]
         Indigo._lib.indigoClone.restype = c_int
         Indigo._lib.indigoClone.argtypes = [c_int]
         Indigo._lib.indigoClose.restype = c_int
@@ -2120,6 +2178,8 @@ class Indigo(object):
         Indigo._lib.indigoUnfoldHydrogens.argtypes = [c_int]
         Indigo._lib.indigoLayout.restype = c_int
         Indigo._lib.indigoLayout.argtypes = [c_int]
+        Indigo._lib.indigoLayoutBatch.restype = c_char_p
+        Indigo._lib.indigoLayoutBatch.argtypes = [c_int, c_int, c_int]
         Indigo._lib.indigoClean2d.restype = c_int
         Indigo._lib.indigoClean2d.argtypes = [c_int]
         Indigo._lib.indigoSmiles.restype = c_char_p
@@ -2202,6 +2262,12 @@ class Indigo(object):
         Indigo._lib.indigoMatch.argtypes = [c_int, c_int]
         Indigo._lib.indigoCountMatches.restype = c_int
         Indigo._lib.indigoCountMatches.argtypes = [c_int, c_int]
+        Indigo._lib.indigoCreateQuerySet.restype = c_int
+        Indigo._lib.indigoCreateQuerySet.argtypes = None
+        Indigo._lib.indigoQuerySetAdd.restype = c_int
+        Indigo._lib.indigoQuerySetAdd.argtypes = [c_int, c_int]
+        Indigo._lib.indigoQuerySetMatch.restype = POINTER(c_int)
+        Indigo._lib.indigoQuerySetMatch.argtypes = [c_int, c_int, POINTER(c_int)]
         Indigo._lib.indigoCountMatchesWithLimit.restype = c_int
         Indigo._lib.indigoCountMatchesWithLimit.argtypes = [c_int, c_int, c_int]
         Indigo._lib.indigoIterateMatches.restype = c_int
@@ -2347,6 +2413,14 @@ class Indigo(object):
         self._setSessionId()
         return Indigo._lib.indigoDbgBreakpoint()
 
+    def dbgProfilingGetCounter(self, name, whole_session=False):
+        self._setSessionId()
+        return self._checkResult(Indigo._lib.indigoDbgProfilingGetCounter(name.encode(ENCODE_ENCODING), whole_session))
+
+    def dbgProfilingJson(self, whole_session=False):
+        self._setSessionId()
+        return self._checkResultString(Indigo._lib.indigoDbgProfilingJson(whole_session))
+
     def version(self):
         self._setSessionId()
         return self._checkResultString(Indigo._lib.indigoVersion())
@@ -2548,6 +2622,13 @@ class Indigo(object):
         self._setSessionId()
         return self._checkResultFloat(Indigo._lib.indigoSimilarity(item1.id, item2.id, metrics.encode(ENCODE_ENCODING)))
 
+    def sparseFingerprints(self, molecules, type=''):
+        if type is None:
+            type = ''
+        self._setSessionId()
+        molecules = self.convertToArray(molecules)
+        return self.IndigoObject(self, self._checkResult(Indigo._lib.indigoSparseFingerprints(molecules.id, type.encode(ENCODE_ENCODING))))
+
     def iterateSDFile(self, filename):
         self._setSessionId()
         return self.IndigoObject(self, self._checkResult(Indigo._lib.indigoIterateSDFile(filename.encode(ENCODE_ENCODING))))
@@ -2580,6 +2661,10 @@ class Indigo(object):
         self._setSessionId()
         return self.IndigoObject(self, self._checkResult(Indigo._lib.indigoCreateArray()))
 
+    def createQuerySet(self):
+        self._setSessionId()
+        return self.IndigoObject(self, self._checkResult(Indigo._lib.indigoCreateQuerySet()))
+
     def substructureMatcher(self, target, mode=''):
         if mode is None:
             mode = ''
@@ -2631,6 +2716,11 @@ class Indigo(object):
         monomers = self.convertToArray(monomers)
         return self.IndigoObject(self, self._checkResult(Indigo._lib.indigoReactionProductEnumerate(replacedaction.id, monomers.id)), replacedaction)
 
+    def iterateEnumeratedProducts(self, reaction, monomers):
+        self._setSessionId()
+        monomers = self.convertToArray(monomers)
+        return self.IndigoObject(self, self._checkResult(Indigo._lib.indigoIterateEnumeratedProducts(reaction.id, monomers.id)), reaction)
+
     def transform(self, reaction, monomers):
         self._setSessionId()
         newobj = self._checkResult(Indigo._lib.indigoTransform(reaction.id, monomers.id))
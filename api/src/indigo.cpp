@@ -18,6 +18,7 @@
 #include "base_cpp/output.h"
 #include "base_cpp/profiling.h"
 #include "base_cpp/temporary_thread_obj.h"
+#include "gzip/gzip_scanner.h"
 #include "molecule/molecule_fingerprint.h"
 #include "reaction/rxnfile_saver.h"
 #include "molecule/molfile_saver.h"
@@ -50,6 +51,12 @@ void Indigo::init ()
    molfile_saving_mode = 0;
    molfile_saving_no_chiral = false;
    filename_encoding = ENCODING_ASCII;
+   mmap_files = true;
+   parsing_threads = 0;
+   gzip_index = false;
+   gzip_checkpoint_span = GZipScanner::DEFAULT_CHECKPOINT_SPAN;
+   record_index = false;
+   query_set_fingerprints = false;
    fp_params.any_qwords = 15;
    fp_params.sim_qwords = 8;
    fp_params.tau_qwords = 10;
@@ -73,6 +80,9 @@ void Indigo::init ()
    smiles_saving_smarts_mode = false;
 
    aam_cancellation_timeout = 0;
+   mcs_threads = 0;
+   mcs_timeout = 0;
+   mcs_maximum_only = false;
    cancellation_timeout = 0;
 
    preserve_ordering_in_serialize = false;
@@ -97,20 +107,19 @@ void Indigo::init ()
 }
 
 
-Indigo::Indigo (): _next_id(1001)
+Indigo::Indigo ()
 {
    init();
 }
 
 void Indigo::removeAllObjects ()
 {
-   OsLocker lock(_objects_lock);
-   int i;
+   Array<IndigoObject *> objects;
 
-   for (i = _objects.begin(); i != _objects.end(); i = _objects.next(i))
-      delete _objects.value(i);
+   _objects.removeAll(objects);
 
-   _objects.clear();
+   for (int i = 0; i < objects.size(); i++)
+      delete objects[i];
 }
 
 void Indigo::updateCancellationHandler ()
@@ -221,40 +230,30 @@ CEXPORT void indigoSetErrorMessage (const char *message)
 
 int Indigo::addObject (IndigoObject *obj)
 {
-   OsLocker lock(_objects_lock);
-   int id = _next_id++;
-   _objects.insert(id, obj);
+   int id = _objects.add(obj);
+   if (id == -1)
+      throw IndigoError("can not add object: there are already %d objects", IndigoHandleTable::MAX_OBJECTS);
    return id;
 }
 
 void Indigo::removeObject (int id)
 {
-   OsLocker lock(_objects_lock);
-   if (_objects.at2(id) == 0)
-      return;
-   delete _objects.at(id);
-   _objects.remove(id);
+   delete _objects.remove(id);
 }
 
 IndigoObject & Indigo::getObject (int handle)
 {
-   OsLocker lock(_objects_lock);
+   IndigoObject *obj = _objects.get(handle);
 
-   try
-   {
-      return *_objects.at(handle);
-   }
-   catch (RedBlackMap<int, IndigoObject *>::Error &e)
-   {
-      throw IndigoError("can not access object #%d: %s", handle, e.message());
-   }
+   if (obj == 0)
+      throw IndigoError("can not access object #%d: no such object", handle);
+
+   return *obj;
 }
 
 int Indigo::countObjects ()
 {
-   OsLocker lock(_objects_lock);
-
-   return _objects.size();
+   return _objects.count();
 }
 
 static TemporaryThreadObjManager<Indigo::TmpData> _indigo_temporary_obj_manager;
@@ -374,3 +373,17 @@ CEXPORT qword indigoDbgProfilingGetCounter (const char *name, int whole_session)
    INDIGO_END(-1);
 }
 
+CEXPORT const char * indigoDbgProfilingJson (int whole_session)
+{
+   INDIGO_BEGIN
+   {
+      auto &tmp = self.getThreadTmpData();
+      ArrayOutput out(tmp.string);
+      indigo::ProfilingSystem::getInstance().getStatisticsJson(out, whole_session != 0);
+
+      tmp.string.push(0);
+      return tmp.string.ptr();
+   }
+   INDIGO_END(0);
+}
+
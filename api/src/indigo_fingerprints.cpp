@@ -16,6 +16,7 @@
 
 #include <math.h>
 #include "molecule/molecule_fingerprint.h"
+#include "molecule/molecule_morgan_fingerprint_builder.h"
 #include "base_cpp/output.h"
 #include "base_c/bitarray.h"
 #include "reaction/reaction_fingerprint.h"
@@ -25,6 +26,7 @@
 #include "indigo_reaction.h"
 #include "base_cpp/scanner.h"
 #include "indigo_io.h"
+#include "indigo_array.h"
 
 IndigoFingerprint::IndigoFingerprint () : IndigoObject(FINGERPRINT)
 {
@@ -205,12 +207,8 @@ void IndigoFingerprint::toBuffer (Array<char> &buf)
    buf.copy((char *)bytes.ptr(), bytes.size());
 }
 
-static float _indigoSimilarity2 (const byte *arr1, const byte *arr2, int size, const char *metrics)
+static float _indigoSimilarityByCounts (int common_ones, int ones1, int ones2, const char *metrics)
 {
-   int ones1 = bitGetOnesCount(arr1, size);
-   int ones2 = bitGetOnesCount(arr2, size);
-   int common_ones = bitCommonOnes(arr1, arr2, size);
-
    if (metrics == 0 || metrics[0] == 0 || strcasecmp(metrics, "tanimoto") == 0)
    {
       if (common_ones == 0)
@@ -218,6 +216,13 @@ static float _indigoSimilarity2 (const byte *arr1, const byte *arr2, int size, c
 
       return (float)common_ones / (ones1 + ones2 - common_ones);
    }
+   else if (strcasecmp(metrics, "dice") == 0)
+   {
+      if (common_ones == 0)
+         return 0;
+
+      return 2.f * common_ones / (ones1 + ones2);
+   }
    else if (strlen(metrics) >= 7 && strncasecmp(metrics, "tversky", 7) == 0)
    {
       float alpha = 0.5f, beta = 0.5f;
@@ -254,6 +259,47 @@ static float _indigoSimilarity2 (const byte *arr1, const byte *arr2, int size, c
       throw IndigoError("unknown metrics: %s", metrics);
 }
 
+static float _indigoSimilarity2 (const byte *arr1, const byte *arr2, int size, const char *metrics)
+{
+   int ones1, ones2;
+   int common_ones = bitCommonOnesWithCounts(arr1, arr2, size, &ones1, &ones2);
+
+   return _indigoSimilarityByCounts(common_ones, ones1, ones2, metrics);
+}
+
+// The counts of the features are taken for the numbers of the bits: the
+// common part of two features is the least of their counts
+static float _indigoSparseSimilarity (IndigoSparseFingerprint &fp1, IndigoSparseFingerprint &fp2,
+                                      const char *metrics)
+{
+   const dword *hashes1 = fp1.hashes.ptr(), *hashes2 = fp2.hashes.ptr();
+   const int *counts1 = fp1.counts.ptr(), *counts2 = fp2.counts.ptr();
+   int size1 = fp1.hashes.size(), size2 = fp2.hashes.size();
+   int i = 0, j = 0;
+   int common = 0, total1 = 0, total2 = 0;
+
+   while (i < size1 && j < size2)
+   {
+      if (hashes1[i] < hashes2[j])
+         total1 += counts1[i++];
+      else if (hashes1[i] > hashes2[j])
+         total2 += counts2[j++];
+      else
+      {
+         common += __min(counts1[i], counts2[j]);
+         total1 += counts1[i++];
+         total2 += counts2[j++];
+      }
+   }
+
+   while (i < size1)
+      total1 += counts1[i++];
+   while (j < size2)
+      total2 += counts2[j++];
+
+   return _indigoSimilarityByCounts(common, total1, total2, metrics);
+}
+
 static float _indigoSimilarity (Array<byte> &arr1, Array<byte> &arr2, const char *metrics)
 {
    int size = arr1.size();
@@ -403,7 +449,7 @@ CEXPORT float indigoSimilarity (int item1, int item2, const char *metrics)
       IndigoObject &obj1 = self.getObject(item1);
       IndigoObject &obj2 = self.getObject(item2);
 
-      if (strcasecmp(metrics, "normalized-edit") == 0)
+      if (metrics != 0 && strcasecmp(metrics, "normalized-edit") == 0)
       {
          return _indigoSimilarityNormalizedEdit(obj1.getBaseMolecule(), obj2.getBaseMolecule());
       }
@@ -449,6 +495,13 @@ CEXPORT float indigoSimilarity (int item1, int item2, const char *metrics)
 
          return _indigoSimilarity(fp1.bytes, fp2.bytes, metrics);
       }
+      else if (obj1.type == IndigoObject::SPARSE_FINGERPRINT)
+      {
+         IndigoSparseFingerprint &fp1 = IndigoSparseFingerprint::cast(obj1);
+         IndigoSparseFingerprint &fp2 = IndigoSparseFingerprint::cast(obj2);
+
+         return _indigoSparseSimilarity(fp1, fp2, metrics);
+      }
       else
          throw IndigoError("indigoSimilarity(): can not accept %s", obj1.debugInfo());
    }
@@ -501,4 +554,169 @@ CEXPORT const char* indigoOneBitsList (int fingerprint) {
       return tmp.string.ptr();
    }
    INDIGO_END(0);
-}
\ No newline at end of file
+}
+
+IndigoSparseFingerprint::IndigoSparseFingerprint () : IndigoObject(SPARSE_FINGERPRINT)
+{
+}
+
+IndigoSparseFingerprint::~IndigoSparseFingerprint ()
+{
+}
+
+IndigoSparseFingerprint & IndigoSparseFingerprint::cast (IndigoObject &obj)
+{
+   if (obj.type == IndigoObject::SPARSE_FINGERPRINT)
+      return (IndigoSparseFingerprint &)obj;
+   throw IndigoError("%s is not a sparse fingerprint", obj.debugInfo());
+}
+
+void IndigoSparseFingerprint::toString (Array<char> &str)
+{
+   ArrayOutput output(str);
+   int i;
+
+   for (i = 0; i < hashes.size(); i++)
+      output.printf(i == 0 ? "%u:%d" : " %u:%d", hashes[i], counts[i]);
+}
+
+IndigoSparseFingerprints::IndigoSparseFingerprints () : IndigoObject(SPARSE_FINGERPRINTS)
+{
+}
+
+IndigoSparseFingerprints::~IndigoSparseFingerprints ()
+{
+}
+
+IndigoSparseFingerprints & IndigoSparseFingerprints::cast (IndigoObject &obj)
+{
+   if (obj.type == IndigoObject::SPARSE_FINGERPRINTS)
+      return (IndigoSparseFingerprints &)obj;
+   throw IndigoError("%s is not a set of sparse fingerprints", obj.debugInfo());
+}
+
+static SimilarityType _indigoParseSparseFingerprintType (const char *type)
+{
+   if (type == 0 || *type == 0)
+      return SimilarityType::ECFP4;
+
+   SimilarityType similarity_type = MoleculeFingerprintBuilder::parseSimilarityType(type);
+
+   if (MoleculeFingerprintBuilder::getSimilarityTypeOrder(similarity_type) <= 0)
+      throw IndigoError("sparse fingerprints are of the Morgan types only, got %s", type);
+
+   return similarity_type;
+}
+
+static void _indigoCountMorganFeatures (Molecule &mol, SimilarityType type,
+                                        Array<dword> &hashes, Array<int> &counts)
+{
+   MoleculeMorganFingerprintBuilder builder(mol);
+   int order = MoleculeFingerprintBuilder::getSimilarityTypeOrder(type);
+
+   if (type >= SimilarityType::FCFP2)
+      builder.countFeaturesFCFP(order, hashes, counts);
+   else
+      builder.countFeaturesECFP(order, hashes, counts);
+}
+
+CEXPORT int indigoSparseFingerprint (int molecule, const char *type)
+{
+   INDIGO_BEGIN
+   {
+      Molecule &mol = self.getObject(molecule).getMolecule();
+      SimilarityType similarity_type = _indigoParseSparseFingerprintType(type);
+
+      AutoPtr<IndigoSparseFingerprint> fp(new IndigoSparseFingerprint());
+      _indigoCountMorganFeatures(mol, similarity_type, fp->hashes, fp->counts);
+      return self.addObject(fp.release());
+   }
+   INDIGO_END(-1);
+}
+
+CEXPORT int indigoFoldFingerprint (int sparse_fingerprint, int bits)
+{
+   INDIGO_BEGIN
+   {
+      IndigoSparseFingerprint &sparse = IndigoSparseFingerprint::cast(self.getObject(sparse_fingerprint));
+
+      if (bits <= 0)
+         throw IndigoError("indigoFoldFingerprint(): bad number of bits: %d", bits);
+
+      AutoPtr<IndigoFingerprint> fp(new IndigoFingerprint());
+      fp->bytes.clear_resize((bits + 7) / 8);
+      fp->bytes.zerofill();
+
+      for (int i = 0; i < sparse.hashes.size(); i++)
+         bitSetBit(fp->bytes.ptr(), MoleculeMorganFingerprintBuilder::foldedBit(sparse.hashes[i], bits), 1);
+
+      return self.addObject(fp.release());
+   }
+   INDIGO_END(-1);
+}
+
+static void _indigoAddSparseFingerprint (IndigoSparseFingerprints &fps, Molecule &mol, SimilarityType type)
+{
+   QS_DEF(Array<dword>, hashes);
+   QS_DEF(Array<int>, counts);
+
+   _indigoCountMorganFeatures(mol, type, hashes, counts);
+
+   fps.hashes.concat(hashes);
+   fps.counts.concat(counts);
+   fps.indptr.push(fps.hashes.size());
+}
+
+CEXPORT int indigoSparseFingerprints (int molecules, const char *type)
+{
+   INDIGO_BEGIN
+   {
+      IndigoObject &obj = self.getObject(molecules);
+      SimilarityType similarity_type = _indigoParseSparseFingerprintType(type);
+
+      AutoPtr<IndigoSparseFingerprints> fps(new IndigoSparseFingerprints());
+      fps->indptr.push(0);
+
+      if (IndigoArray::is(obj))
+      {
+         IndigoArray &arr = IndigoArray::cast(obj);
+
+         for (int i = 0; i < arr.objects.size(); i++)
+            _indigoAddSparseFingerprint(fps.ref(), arr.objects[i]->getMolecule(), similarity_type);
+      }
+      else
+      {
+         // The molecules of an iterator are not kept, so a loader of any
+         // size takes only the memory of the fingerprints
+         AutoPtr<IndigoObject> item;
+
+         while (true)
+         {
+            item.reset(obj.next());
+            if (item.get() == 0)
+               break;
+            _indigoAddSparseFingerprint(fps.ref(), item->getMolecule(), similarity_type);
+         }
+      }
+
+      return self.addObject(fps.release());
+   }
+   INDIGO_END(-1);
+}
+
+CEXPORT int indigoSparseFingerprintsCSR (int fingerprints, int *rows, int *nnz, const int **indptr,
+                                         const unsigned int **hashes, const int **counts)
+{
+   INDIGO_BEGIN
+   {
+      IndigoSparseFingerprints &fps = IndigoSparseFingerprints::cast(self.getObject(fingerprints));
+
+      *rows = fps.indptr.size() - 1;
+      *nnz = fps.hashes.size();
+      *indptr = fps.indptr.ptr();
+      *hashes = fps.hashes.ptr();
+      *counts = fps.counts.ptr();
+      return 1;
+   }
+   INDIGO_END(-1);
+}
@@ -36,6 +36,39 @@ public:
    Array<byte> bytes;
 };
 
+// Morgan fingerprint that is not folded: the feature hashes in ascending
+// order with the number of the features with each of them
+class DLLEXPORT IndigoSparseFingerprint : public IndigoObject
+{
+public:
+   IndigoSparseFingerprint ();
+   virtual ~IndigoSparseFingerprint ();
+
+   // "hash:count" pairs separated by spaces
+   virtual void toString (Array<char> &str);
+
+   static IndigoSparseFingerprint & cast (IndigoObject &obj);
+
+   Array<dword> hashes;
+   Array<int> counts;
+};
+
+// Sparse fingerprints of many molecules in the compressed sparse row
+// format: the features of the i-th molecule are hashes[indptr[i]] up to
+// hashes[indptr[i + 1]] (exclusive), with the counts at the same positions
+class DLLEXPORT IndigoSparseFingerprints : public IndigoObject
+{
+public:
+   IndigoSparseFingerprints ();
+   virtual ~IndigoSparseFingerprints ();
+
+   static IndigoSparseFingerprints & cast (IndigoObject &obj);
+
+   Array<int> indptr;
+   Array<dword> hashes;
+   Array<int> counts;
+};
+
 #ifdef _WIN32
 #pragma warning(pop)
 #endif
@@ -0,0 +1,181 @@
+/****************************************************************************
+ * Copyright (C) 2009-2015 EPAM Systems
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * This file may be distributed and/or modified under the terms of the
+ * GNU General Public License version 3 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.
+ *
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ ***************************************************************************/
+
+#include "indigo_handle_table.h"
+
+using namespace indigo;
+
+IndigoHandleTable::IndigoHandleTable ()
+{
+   for (int i = 0; i < CHUNKS_COUNT; i++)
+      _chunks[i].store(0);
+
+   _slots_count = 0;
+   _free_head = _free_tail = -1;
+   _free_count = 0;
+   _retired_head = -1;
+   _objects_count.store(0);
+}
+
+IndigoHandleTable::~IndigoHandleTable ()
+{
+   for (int i = 0; i < CHUNKS_COUNT; i++)
+      delete [] _chunks[i].load();
+}
+
+IndigoHandleTable::Slot & IndigoHandleTable::_getSlot (int slot_idx) const
+{
+   return _chunks[slot_idx >> CHUNK_BITS].load(std::memory_order_acquire)[slot_idx & (CHUNK_SIZE - 1)];
+}
+
+int IndigoHandleTable::add (IndigoObject *obj)
+{
+   OsLocker locker(_lock);
+   int slot_idx;
+
+   if (_free_count == 0 && _slots_count == MAX_OBJECTS)
+      _reuseRetiredSlots();
+
+   if (_free_count >= MIN_FREE_SLOTS || (_slots_count == MAX_OBJECTS && _free_count > 0))
+   {
+      slot_idx = _free_head;
+      _free_head = _getSlot(slot_idx).next_free;
+      if (_free_head == -1)
+         _free_tail = -1;
+      _free_count--;
+   }
+   else if (_slots_count < MAX_OBJECTS)
+   {
+      slot_idx = _slots_count++;
+
+      std::atomic<Slot *> &chunk = _chunks[slot_idx >> CHUNK_BITS];
+      if (chunk.load() == 0)
+      {
+         Slot *slots = new Slot[CHUNK_SIZE];
+         for (int i = 0; i < CHUNK_SIZE; i++)
+         {
+            slots[i].obj.store(0);
+            slots[i].generation.store(1);
+            slots[i].next_free = -1;
+         }
+         chunk.store(slots, std::memory_order_release);
+      }
+   }
+   else
+      return -1;
+
+   Slot &slot = _getSlot(slot_idx);
+   slot.obj.store(obj, std::memory_order_release);
+   _objects_count++;
+
+   return (slot.generation.load() << SLOT_BITS) | slot_idx;
+}
+
+IndigoObject * IndigoHandleTable::get (int handle) const
+{
+   if (handle <= 0)
+      return 0;
+
+   int slot_idx = handle & ((1 << SLOT_BITS) - 1);
+   if (_chunks[slot_idx >> CHUNK_BITS].load(std::memory_order_acquire) == 0)
+      return 0;
+
+   Slot &slot = _getSlot(slot_idx);
+   IndigoObject *obj = slot.obj.load(std::memory_order_acquire);
+   if (obj == 0 || slot.generation.load(std::memory_order_acquire) != (handle >> SLOT_BITS))
+      return 0;
+
+   return obj;
+}
+
+IndigoObject * IndigoHandleTable::remove (int handle)
+{
+   OsLocker locker(_lock);
+
+   IndigoObject *obj = get(handle);
+   if (obj == 0)
+      return 0;
+
+   _freeSlot(handle & ((1 << SLOT_BITS) - 1));
+   return obj;
+}
+
+void IndigoHandleTable::removeAll (Array<IndigoObject *> &objects)
+{
+   OsLocker locker(_lock);
+
+   for (int i = 0; i < _slots_count; i++)
+   {
+      IndigoObject *obj = _getSlot(i).obj.load();
+      if (obj != 0)
+      {
+         objects.push(obj);
+         _freeSlot(i);
+      }
+   }
+}
+
+void IndigoHandleTable::_freeSlot (int slot_idx)
+{
+   Slot &slot = _getSlot(slot_idx);
+
+   slot.obj.store(0, std::memory_order_release);
+   _objects_count--;
+
+   // Generation is never zero, so the handles are always positive. Zero
+   // marks a retired slot that no handle resolves to.
+   int generation = slot.generation.load() + 1;
+   if (generation == (1 << GENERATION_BITS))
+   {
+      slot.generation.store(0, std::memory_order_release);
+      slot.next_free = _retired_head;
+      _retired_head = slot_idx;
+      return;
+   }
+   slot.generation.store(generation, std::memory_order_release);
+
+   slot.next_free = -1;
+   if (_free_tail == -1)
+      _free_head = slot_idx;
+   else
+      _getSlot(_free_tail).next_free = slot_idx;
+   _free_tail = slot_idx;
+   _free_count++;
+}
+
+void IndigoHandleTable::_reuseRetiredSlots ()
+{
+   // All the handle values have been issued, the next round starts
+   while (_retired_head != -1)
+   {
+      int slot_idx = _retired_head;
+      Slot &slot = _getSlot(slot_idx);
+
+      _retired_head = slot.next_free;
+      slot.generation.store(1, std::memory_order_release);
+      slot.next_free = -1;
+
+      if (_free_tail == -1)
+         _free_head = slot_idx;
+      else
+         _getSlot(_free_tail).next_free = slot_idx;
+      _free_tail = slot_idx;
+      _free_count++;
+   }
+}
+
+int IndigoHandleTable::count () const
+{
+   return _objects_count.load();
+}
@@ -0,0 +1,101 @@
+/****************************************************************************
+ * Copyright (C) 2009-2015 EPAM Systems
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * This file may be distributed and/or modified under the terms of the
+ * GNU General Public License version 3 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.
+ *
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ ***************************************************************************/
+
+#ifndef __indigo_handle_table__
+#define __indigo_handle_table__
+
+#include "base_cpp/array.h"
+#include "base_cpp/os_sync_wrapper.h"
+
+#include <atomic>
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable:4251)
+#endif
+
+class IndigoObject;
+
+// Table of the objects that are accessible through the C API handles.
+// A handle is a slot index tagged with the generation of the slot, so a handle
+// of a removed object is not resolved to the object that reuses the slot.
+// A slot whose generations are used up is retired. Retired slots are reused
+// only when no new slot can be added, so every handle value is issued once
+// before any of them is issued again.
+// Slots are stored in chunks that are never moved or freed, so the lookup
+// doesn't take the lock. Adding and removing objects is serialized.
+class DLLEXPORT IndigoHandleTable
+{
+public:
+   IndigoHandleTable ();
+   ~IndigoHandleTable ();
+
+   // Returns the handle of the object or -1 if there are MAX_OBJECTS of them
+   int add (IndigoObject *obj);
+
+   // Returns the object or null if the handle is not valid
+   IndigoObject * get (int handle) const;
+
+   // Detaches the object from the table and returns it, or null if the handle is not valid
+   IndigoObject * remove (int handle);
+
+   // Detaches all the objects from the table and appends them to the array
+   void removeAll (indigo::Array<IndigoObject *> &objects);
+
+   int count () const;
+
+   enum
+   {
+      SLOT_BITS = 24,
+      GENERATION_BITS = 31 - SLOT_BITS,
+      MAX_OBJECTS = 1 << SLOT_BITS
+   };
+
+private:
+   enum
+   {
+      CHUNK_BITS = 12,
+      CHUNK_SIZE = 1 << CHUNK_BITS,
+      CHUNKS_COUNT = 1 << (SLOT_BITS - CHUNK_BITS),
+      // Freed slots are reused only when there are at least that many of them,
+      // so a slot goes through its generations slowly
+      MIN_FREE_SLOTS = 1024
+   };
+
+   struct Slot
+   {
+      std::atomic<IndigoObject *> obj;
+      std::atomic<int> generation;
+      int next_free;
+   };
+
+   Slot & _getSlot (int slot_idx) const;
+   void _freeSlot (int slot_idx);
+   void _reuseRetiredSlots ();
+
+   std::atomic<Slot *> _chunks[CHUNKS_COUNT];
+
+   int _slots_count;
+   int _free_head, _free_tail, _free_count;
+   int _retired_head;
+   std::atomic<int> _objects_count;
+
+   indigo::OsLock _lock;
+};
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif
@@ -44,6 +44,8 @@
  * compatibility. */
 #include "indigo_version.h"
 
+#include "indigo_handle_table.h"
+
 using namespace indigo;
 
 namespace indigo
@@ -157,6 +159,10 @@ public:
       TGROUP,
       TGROUPS_ITER,
       GROSS_REACTION,
+      QUERY_SET,
+      ENUMERATED_PRODUCTS_ITER,
+      SPARSE_FINGERPRINT,
+      SPARSE_FINGERPRINTS,
       INDIGO_OBJECT_LAST_TYPE         // must be the last element in the enum
    };
 
@@ -239,6 +245,8 @@ struct DLLEXPORT ProductEnumeratorParams
       transform_is_layout = true;
       max_deep_level = 2;
       max_product_count = 1000;
+      threads = 0;
+      dedup_exact = true;
    }
 
    bool is_multistep_reactions;
@@ -248,6 +256,8 @@ struct DLLEXPORT ProductEnumeratorParams
    bool transform_is_layout;
    int max_deep_level;
    int max_product_count;
+   int threads;      // build the products of indigoIterateEnumeratedProducts ahead in the worker threads, 0 - on the access
+   bool dedup_exact; // compare the SMILES of the enumerated products, not only their hashes
 };
 
 class DLLEXPORT Indigo
@@ -310,9 +320,15 @@ public:
    bool smiles_saving_smarts_mode;
 
    Encoding filename_encoding;
+   bool mmap_files; // map regular files into memory instead of reading them with stdio
+   int parsing_threads; // parse the records of the SDF and SMILES files ahead of indigoNext, 0 - on the access
+   bool gzip_index; // keep the checkpoint index of the .sdf.gz files in <file>.gzidx
+   int gzip_checkpoint_span; // uncompressed bytes between the gzip checkpoints
+   bool record_index; // keep the record offsets of the SDF, RDF and SMILES files in <file>.idx
 
    bool embedding_edges_uniqueness, find_unique_embeddings;
    int max_embeddings;
+   bool query_set_fingerprints; // screen the queries of a query set by the fingerprints
 
    int layout_max_iterations; // default is zero -- no limit
    bool smart_layout = false;
@@ -322,6 +338,10 @@ public:
 
    int aam_cancellation_timeout; //default is zero - no timeout
 
+   int mcs_threads; // threads of the exact MCS search, 0 - in the calling thread
+   int mcs_timeout; // time limit of the exact MCS search in ms, the best solution found by then is taken
+   bool mcs_maximum_only; // scaffold detection keeps only the largest common subgraphs of each pair
+
    int cancellation_timeout; // default is 0 seconds - no timeout
 
    void updateCancellationHandler ();
@@ -343,10 +363,7 @@ public:
 
 protected:
 
-   RedBlackMap<int, IndigoObject *> _objects;
-
-   int    _next_id;
-   OsLock _objects_lock;
+   IndigoHandleTable _objects;
 
    int _indigo_id;
 };
@@ -86,7 +86,7 @@ CEXPORT int indigoReadFile (const char *filename)
 {
    INDIGO_BEGIN
    {
-      return self.addObject(new IndigoScanner(new FileScanner(self.filename_encoding, filename)));
+      return self.addObject(new IndigoScanner(new FileScanner(self.filename_encoding, filename, self.mmap_files)));
    }
    INDIGO_END(-1)
 }
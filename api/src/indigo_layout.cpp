@@ -20,89 +20,330 @@
 #include "indigo_molecule.h"
 #include "indigo_reaction.h"
 #include "layout/molecule_cleaner_2d.h"
+#include "indigo_array.h"
+#include "base_c/nano.h"
+#include "base_cpp/os_thread_wrapper.h"
+#include "base_cpp/output.h"
 #include <vector>
 #include <algorithm>
 
-CEXPORT int indigoLayout (int object)
+namespace
 {
-   INDIGO_BEGIN
+   // Layout options of the session. The batch worker threads run in their
+   // own sessions, so the options are copied before the batch starts.
+   struct LayoutSettings
    {
-      IndigoObject &obj = self.getObject(object);
-      int i;
-
-      if (IndigoBaseMolecule::is(obj)) {
-         BaseMolecule *mol = &obj.getBaseMolecule();
-         Filter f;
-         if (obj.type == IndigoObject::SUBMOLECULE) {
-            IndigoSubmolecule &submol = (IndigoSubmolecule &)obj;
-            mol = &submol.getOriginalMolecule();
-            f.initNone(mol->vertexEnd());
-            for (int i = 0; i < submol.vertices.size(); i++) {
-               f.unhide(submol.vertices[i]);
-            }
-         }
-         MoleculeLayout ml(*mol, self.smart_layout);
-         
-         if (obj.type == IndigoObject::SUBMOLECULE) {
-            ml.filter = &f;
-         }
-         
-         ml.max_iterations = self.layout_max_iterations;
-         ml.bond_length = 1.6f;
-         ml.layout_orientation = (layout_orientation_value) self.layout_orientation;
+      explicit LayoutSettings (Indigo &self) :
+         smart_layout(self.smart_layout),
+         max_iterations(self.layout_max_iterations),
+         orientation(self.layout_orientation),
+         horintervalfactor(self.layout_horintervalfactor)
+      {
+      }
 
-         TimeoutCancellationHandler cancellation(self.cancellation_timeout);
-         ml.setCancellationHandler(&cancellation);
+      bool smart_layout;
+      int max_iterations;
+      int orientation;
+      float horintervalfactor;
+   };
+}
 
-         ml.make();
+static void _layoutObject (IndigoObject &obj, const LayoutSettings &settings, CancellationHandler *cancellation)
+{
+   int i;
+
+   if (IndigoBaseMolecule::is(obj)) {
+      BaseMolecule *mol = &obj.getBaseMolecule();
+      Filter f;
+      if (obj.type == IndigoObject::SUBMOLECULE) {
+         IndigoSubmolecule &submol = (IndigoSubmolecule &)obj;
+         mol = &submol.getOriginalMolecule();
+         f.initNone(mol->vertexEnd());
+         for (int i = 0; i < submol.vertices.size(); i++) {
+            f.unhide(submol.vertices[i]);
+         }
+      }
+      MoleculeLayout ml(*mol, settings.smart_layout);
       
-         if (obj.type != IndigoObject::SUBMOLECULE)
+      if (obj.type == IndigoObject::SUBMOLECULE) {
+         ml.filter = &f;
+      }
+      
+      ml.max_iterations = settings.max_iterations;
+      ml.bond_length = 1.6f;
+      ml.layout_orientation = (layout_orientation_value) settings.orientation;
+
+      ml.setCancellationHandler(cancellation);
+
+      ml.make();
+   
+      if (obj.type != IndigoObject::SUBMOLECULE)
+      {
+         // Not for submolecule yet
+         mol->clearBondDirections();
+         try
          {
-            // Not for submolecule yet
-            mol->clearBondDirections();
-            try
-            {
-               mol->stereocenters.markBonds();
-               mol->allene_stereo.markBonds();
-            } catch (Exception e) {}
-            for (i = 1; i <= mol->rgroups.getRGroupCount(); i++)
-            {
-               RGroup &rgp = mol->rgroups.getRGroup(i);
+            mol->stereocenters.markBonds();
+            mol->allene_stereo.markBonds();
+         } catch (Exception e) {}
+         for (i = 1; i <= mol->rgroups.getRGroupCount(); i++)
+         {
+            RGroup &rgp = mol->rgroups.getRGroup(i);
 
-               for (int j = rgp.fragments.begin(); j != rgp.fragments.end();
-                        j = rgp.fragments.next(j))
+            for (int j = rgp.fragments.begin(); j != rgp.fragments.end();
+                     j = rgp.fragments.next(j))
+            {
+               rgp.fragments[j]->clearBondDirections();
+               try
                {
-                  rgp.fragments[j]->clearBondDirections();
-                  try
-                  {
-                     rgp.fragments[j]->stereocenters.markBonds();
-                     rgp.fragments[j]->allene_stereo.markBonds();
-                  } catch (Exception e) {}
-               }
+                  rgp.fragments[j]->stereocenters.markBonds();
+                  rgp.fragments[j]->allene_stereo.markBonds();
+               } catch (Exception e) {}
             }
          }
-      } else if (IndigoBaseReaction::is(obj)) {
-         BaseReaction &rxn = obj.getBaseReaction();
-         ReactionLayout rl(rxn, self.smart_layout);
-         rl.max_iterations = self.layout_max_iterations;
-         rl.layout_orientation = (layout_orientation_value) self.layout_orientation;
-         rl.bond_length = 1.6f;
-         rl.horizontal_interval_factor = self.layout_horintervalfactor;
-
-         rl.make();
-         try
-         {
-            rxn.markStereocenterBonds();
-         } catch (Exception e) {}
-     
-      } else {
-         throw IndigoError("The object provided is neither a molecule, nor a reaction");
       }
+   } else if (IndigoBaseReaction::is(obj)) {
+      BaseReaction &rxn = obj.getBaseReaction();
+      ReactionLayout rl(rxn, settings.smart_layout);
+      rl.max_iterations = settings.max_iterations;
+      rl.layout_orientation = (layout_orientation_value) settings.orientation;
+      rl.bond_length = 1.6f;
+      rl.horizontal_interval_factor = settings.horintervalfactor;
+
+      rl.setCancellationHandler(cancellation);
+
+      rl.make();
+      try
+      {
+         rxn.markStereocenterBonds();
+      } catch (Exception e) {}
+  
+   } else {
+      throw IndigoError("The object provided is neither a molecule, nor a reaction");
+   }
+}
+
+CEXPORT int indigoLayout (int object)
+{
+   INDIGO_BEGIN
+   {
+      IndigoObject &obj = self.getObject(object);
+
+      TimeoutCancellationHandler cancellation(self.cancellation_timeout);
+      _layoutObject(obj, LayoutSettings(self), &cancellation);
+
       return 0;
    }
    INDIGO_END(-1)
 }
 
+namespace
+{
+   enum
+   {
+      LAYOUT_BATCH_OK,
+      LAYOUT_BATCH_FALLBACK,
+      LAYOUT_BATCH_ERROR
+   };
+
+   struct LayoutBatchItem
+   {
+      int status;
+      float time;
+      Array<char> message;
+   };
+
+   // Lays out the batch items in the worker threads. Every command takes one
+   // item, so a thread that got a slow molecule does not hold up the others.
+   // Each item is written into its own slot, so no locking is needed.
+   class LayoutBatchDispatcher : public OsCommandDispatcher
+   {
+   public:
+      LayoutBatchDispatcher (const Array<IndigoObject *> &objects, const LayoutSettings &settings,
+                             int timeout_ms, ObjArray<LayoutBatchItem> &items) :
+         OsCommandDispatcher(HANDLING_ORDER_ANY, false),
+         _objects(objects), _settings(settings), _timeout_ms(timeout_ms), _items(items)
+      {
+         _next_item = 0;
+      }
+
+      void layoutItem (int idx);
+
+   protected:
+      virtual OsCommand * _allocateCommand ();
+
+      virtual bool _setupCommand (OsCommand &command);
+
+   private:
+      const Array<IndigoObject *> &_objects;
+      LayoutSettings _settings;
+      int _timeout_ms;
+      ObjArray<LayoutBatchItem> &_items;
+      int _next_item;
+   };
+
+   class LayoutBatchCommand : public OsCommand
+   {
+   public:
+      virtual void clear ()
+      {
+         idx = -1;
+      }
+
+      virtual void execute (OsCommandResult &result)
+      {
+         dispatcher->layoutItem(idx);
+      }
+
+      LayoutBatchDispatcher *dispatcher;
+      int idx;
+   };
+}
+
+void LayoutBatchDispatcher::layoutItem (int idx)
+{
+   LayoutBatchItem &item = _items[idx];
+   qword start = nanoClock();
+
+   if (_objects[idx] == 0)
+      return;
+
+   IndigoObject &obj = *_objects[idx];
+   TimeoutCancellationHandler cancellation(_timeout_ms);
+
+   try
+   {
+      _layoutObject(obj, _settings, &cancellation);
+      item.status = LAYOUT_BATCH_OK;
+   }
+   catch (Exception &e)
+   {
+      item.status = LAYOUT_BATCH_ERROR;
+      item.message.readString(e.message(), true);
+
+      // The smart layout (including the macrocycle search) is out of the
+      // time budget, the fast one is used without a deadline
+      if (_settings.smart_layout && cancellation.isCancelled())
+      {
+         LayoutSettings fast_settings(_settings);
+
+         fast_settings.smart_layout = false;
+         try
+         {
+            _layoutObject(obj, fast_settings, 0);
+            item.status = LAYOUT_BATCH_FALLBACK;
+         }
+         catch (Exception &e)
+         {
+            item.message.readString(e.message(), true);
+         }
+      }
+   }
+
+   item.time = nanoHowManySeconds(nanoClock() - start);
+}
+
+OsCommand * LayoutBatchDispatcher::_allocateCommand ()
+{
+   LayoutBatchCommand *command = new LayoutBatchCommand();
+   command->dispatcher = this;
+   return command;
+}
+
+bool LayoutBatchDispatcher::_setupCommand (OsCommand &command)
+{
+   if (_next_item >= _objects.size())
+      return false;
+
+   ((LayoutBatchCommand &)command).idx = _next_item++;
+   return true;
+}
+
+static void _writeJsonString (Output &output, const char *str)
+{
+   output.writeChar('"');
+   for (const char *c = str; *c != 0; c++)
+   {
+      if (*c == '"' || *c == '\\')
+         output.printf("\\%c", *c);
+      else if ((unsigned char)*c < 0x20)
+         output.printf("\\u%04x", *c);
+      else
+         output.writeChar(*c);
+   }
+   output.writeChar('"');
+}
+
+CEXPORT const char * indigoLayoutBatch (int objects, int threads, int per_item_timeout_ms)
+{
+   INDIGO_BEGIN
+   {
+      IndigoObject &obj = self.getObject(objects);
+
+      if (!IndigoArray::is(obj))
+         throw IndigoError("indigoLayoutBatch(): array expected, got %s", obj.debugInfo());
+
+      IndigoArray &arr = IndigoArray::cast(obj);
+      Array<IndigoObject *> batch;
+      ObjArray<LayoutBatchItem> items;
+
+      for (int i = 0; i < arr.objects.size(); i++)
+      {
+         IndigoObject *item_obj = arr.objects[i];
+         LayoutBatchItem &item = items.push();
+
+         item.status = LAYOUT_BATCH_ERROR;
+         item.time = 0;
+
+         // Lazy loaded objects are parsed here, as the loader options
+         // are bound to the current Indigo session
+         try
+         {
+            if (IndigoBaseMolecule::is(*item_obj))
+               item_obj->getBaseMolecule();
+            else if (IndigoBaseReaction::is(*item_obj))
+               item_obj->getBaseReaction();
+         }
+         catch (Exception &e)
+         {
+            item.message.readString(e.message(), true);
+            item_obj = 0;
+         }
+         batch.push(item_obj);
+      }
+
+      int timeout_ms = per_item_timeout_ms > 0 ? per_item_timeout_ms : self.cancellation_timeout;
+      LayoutBatchDispatcher dispatcher(batch, LayoutSettings(self), timeout_ms, items);
+
+      dispatcher.run(threads > 0 ? threads : osGetProcessorsCount());
+
+      auto &tmp = self.getThreadTmpData();
+      ArrayOutput out(tmp.string);
+      static const char *statuses[] = {"ok", "fallback", "error"};
+
+      out.writeChar('[');
+      for (int i = 0; i < items.size(); i++)
+      {
+         LayoutBatchItem &item = items[i];
+
+         if (i > 0)
+            out.writeChar(',');
+         out.printf("{\"status\": \"%s\", \"time\": %g", statuses[item.status], item.time);
+         if (item.message.size() > 0)
+         {
+            out.printf(", \"message\": ");
+            _writeJsonString(out, item.message.ptr());
+         }
+         out.writeChar('}');
+      }
+      out.writeChar(']');
+
+      tmp.string.push(0);
+      return tmp.string.ptr();
+   }
+   INDIGO_END(0)
+}
+
 CEXPORT int indigoClean2d(int object)
 {
     INDIGO_BEGIN
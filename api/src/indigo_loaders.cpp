@@ -14,10 +14,12 @@
 
 #include "indigo_loaders.h"
 #include "indigo_io.h"
+#include "indigo_parse_pipeline.h"
 #include "indigo_molecule.h"
 #include "indigo_reaction.h"
 #include "molecule/sdf_loader.h"
 #include "molecule/rdf_loader.h"
+#include "gzip/gzip_scanner.h"
 #include "molecule/molfile_loader.h"
 #include "molecule/smiles_loader.h"
 #include "reaction/rsmiles_loader.h"
@@ -30,12 +32,93 @@
 #include "molecule/multiple_cdx_loader.h"
 #include "molecule/molecule_cdx_loader.h"
 #include "reaction/reaction_cdx_loader.h"
+#include "base_cpp/os_thread_wrapper.h"
 
 #include <limits>
 
+static void _checkNoPipeline (AutoPtr<IndigoParsePipeline> &pipeline, const char *method)
+{
+   if (pipeline.get() != 0)
+      throw IndigoError("%s: random access is not available while the records are parsed in parallel", method);
+}
+
+IndigoLoaderSettings::IndigoLoaderSettings (Indigo &self) :
+   stereochemistry_options(self.stereochemistry_options),
+   treat_x_as_pseudoatom(self.treat_x_as_pseudoatom),
+   skip_3d_chirality(self.skip_3d_chirality),
+   ignore_noncritical_query_features(self.ignore_noncritical_query_features),
+   ignore_no_chiral_flag(self.ignore_no_chiral_flag),
+   ignore_bad_valence(self.ignore_bad_valence)
+{
+}
+
+IndigoRecordIndexFile::IndigoRecordIndexFile ()
+{
+   encoding = ENCODING_ASCII;
+   source.format = 0;
+   source.length = 0;
+   source.mtime = 0;
+   up_to_date = false;
+}
+
+void IndigoRecordIndexFile::init (const char *source_filename, FileScanner &source_scanner, char format)
+{
+   Indigo &self = indigoGetInstance();
+
+   if (!self.record_index)
+      return;
+
+   encoding = self.filename_encoding;
+   source.format = format;
+   source.length = source_scanner.length();
+   source.mtime = source_scanner.modificationTime();
+   filename.readString(source_filename, false);
+   filename.appendString(".idx", true);
+}
+
+template <typename Loader> static void _loadRecordIndex (Loader &loader, IndigoRecordIndexFile &file)
+{
+   if (file.filename.size() == 0)
+      return;
+
+   try
+   {
+      FileScanner input(file.encoding, file.filename.ptr());
+      loader.loadIndex(input, file.source);
+      file.up_to_date = true;
+   }
+   catch (Exception &)
+   {
+      // There is no index yet or it is stale, it is rebuilt on the first
+      // indigoCount() or indigoAt()
+   }
+}
+
+// Finds the offsets of all records and saves them if the index is used
+template <typename Loader> static void _buildRecordIndex (Loader &loader, IndigoRecordIndexFile &file)
+{
+   loader.buildIndex(osGetProcessorsCount());
+
+   if (file.filename.size() == 0 || file.up_to_date)
+      return;
+
+   try
+   {
+      FileOutput output(file.encoding, file.filename.ptr());
+      loader.saveIndex(output, file.source);
+   }
+   catch (Exception &)
+   {
+      // Like the gzip index, a file that can not be written is not an error
+   }
+   file.up_to_date = true;
+}
+
 IndigoSdfLoader::IndigoSdfLoader (Scanner &scanner) :
 IndigoObject(SDF_LOADER)
 {
+   // The scanner belongs to another object, so it is read on the demand only
+   _parsing_threads = 0;
    sdf_loader.reset(new SdfLoader(scanner));
 }
 
@@ -43,12 +126,66 @@ IndigoSdfLoader::IndigoSdfLoader (const char *filename) :
 IndigoObject(SDF_LOADER)
 {
    // AutoPtr guard in case of exception in SdfLoader (happens in case of empty file)
-   _own_scanner.reset(new FileScanner(indigoGetInstance().filename_encoding, filename));
+   _own_scanner.reset(new FileScanner(indigoGetInstance().filename_encoding, filename, indigoGetInstance().mmap_files));
    sdf_loader.reset(new SdfLoader(_own_scanner.ref()));
+   _parsing_threads = indigoGetInstance().parsing_threads;
+   _loadGZipIndex(filename);
+   _record_index.init(filename, (FileScanner &)_own_scanner.ref(), 'S');
+   _loadRecordIndex(sdf_loader.ref(), _record_index);
 }
 
 IndigoSdfLoader::~IndigoSdfLoader ()
 {
+   // Stop the splitting thread before the loader is destroyed
+   _pipeline.reset(0);
+   _saveGZipIndex();
+}
+
+void IndigoSdfLoader::_loadGZipIndex (const char *filename)
+{
+   Indigo &self = indigoGetInstance();
+   GZipScanner *gzip = sdf_loader->getGZipScanner();
+
+   if (gzip == 0)
+      return;
+
+   gzip->setCheckpointSpan(self.gzip_checkpoint_span);
+
+   if (!self.gzip_index)
+      return;
+
+   _filename_encoding = self.filename_encoding;
+   _gzip_index_filename.readString(filename, false);
+   _gzip_index_filename.appendString(".gzidx", true);
+
+   try
+   {
+      FileScanner index(_filename_encoding, _gzip_index_filename.ptr());
+      gzip->loadIndex(index);
+   }
+   catch (Exception &)
+   {
+      // There is no index yet or it is stale, it is built while reading
+   }
+}
+
+void IndigoSdfLoader::_saveGZipIndex ()
+{
+   GZipScanner *gzip = sdf_loader->getGZipScanner();
+
+   if (gzip == 0 || _gzip_index_filename.size() == 0 || !gzip->isIndexChanged())
+      return;
+
+   try
+   {
+      FileOutput output(_filename_encoding, _gzip_index_filename.ptr());
+      gzip->saveIndex(output);
+   }
+   catch (Exception &)
+   {
+      // The index only speeds up the random access, a file that can not
+      // be written is not an error
+   }
 }
 
 IndigoRdfData::IndigoRdfData (int type, Array<char> &data, int index, long long offset) :
@@ -78,6 +215,32 @@ IndigoRdfData::~IndigoRdfData ()
 {
 }
 
+void IndigoRdfData::preload (const IndigoLoaderSettings &settings)
+{
+   if (_loaded)
+      return;
+
+   try
+   {
+      _load(settings);
+   }
+   catch (Exception &e)
+   {
+      _load_error.reset(e.clone());
+   }
+}
+
+void IndigoRdfData::_ensureLoaded ()
+{
+   if (_loaded)
+      return;
+
+   if (_load_error.get() != 0)
+      _load_error->throwSelf();
+
+   _load(IndigoLoaderSettings(indigoGetInstance()));
+}
+
 Array<char> & IndigoRdfData::getRawData ()
 {
    return _data;
@@ -102,23 +265,23 @@ IndigoRdfData(RDF_MOLECULE, data, properties, index, offset)
 
 Molecule & IndigoRdfMolecule::getMolecule ()
 {
-   if (!_loaded)
-   {
-      Indigo &self = indigoGetInstance();
-      BufferScanner scanner(_data);
-      MolfileLoader loader(scanner);
+   _ensureLoaded();
+   return _mol;
+}
 
-      loader.stereochemistry_options = self.stereochemistry_options;
-      loader.treat_x_as_pseudoatom = self.treat_x_as_pseudoatom;
-      loader.skip_3d_chirality = self.skip_3d_chirality;
-      loader.ignore_noncritical_query_features = self.ignore_noncritical_query_features;
-      loader.ignore_no_chiral_flag = self.ignore_no_chiral_flag;
-      loader.ignore_bad_valence = self.ignore_bad_valence;
-      loader.loadMolecule(_mol);
-      _loaded = true;
-   }
+void IndigoRdfMolecule::_load (const IndigoLoaderSettings &settings)
+{
+   BufferScanner scanner(_data);
+   MolfileLoader loader(scanner);
 
-   return _mol;
+   loader.stereochemistry_options = settings.stereochemistry_options;
+   loader.treat_x_as_pseudoatom = settings.treat_x_as_pseudoatom;
+   loader.skip_3d_chirality = settings.skip_3d_chirality;
+   loader.ignore_noncritical_query_features = settings.ignore_noncritical_query_features;
+   loader.ignore_no_chiral_flag = settings.ignore_no_chiral_flag;
+   loader.ignore_bad_valence = settings.ignore_bad_valence;
+   loader.loadMolecule(_mol);
+   _loaded = true;
 }
 
 BaseMolecule & IndigoRdfMolecule::getBaseMolecule ()
@@ -157,22 +320,22 @@ IndigoRdfData(RDF_REACTION, data, properties, index, offset)
 
 Reaction & IndigoRdfReaction::getReaction ()
 {
-   if (!_loaded)
-   {
-      Indigo &self = indigoGetInstance();
-      BufferScanner scanner(_data);
-      RxnfileLoader loader(scanner);
+   _ensureLoaded();
+   return _rxn;
+}
 
-      loader.stereochemistry_options = self.stereochemistry_options;
-      loader.treat_x_as_pseudoatom = self.treat_x_as_pseudoatom;
-      loader.ignore_noncritical_query_features = self.ignore_noncritical_query_features;
-      loader.ignore_no_chiral_flag = self.ignore_no_chiral_flag;
-      loader.ignore_bad_valence = self.ignore_bad_valence;
-      loader.loadReaction(_rxn);
-      _loaded = true;
-   }
+void IndigoRdfReaction::_load (const IndigoLoaderSettings &settings)
+{
+   BufferScanner scanner(_data);
+   RxnfileLoader loader(scanner);
 
-   return _rxn;
+   loader.stereochemistry_options = settings.stereochemistry_options;
+   loader.treat_x_as_pseudoatom = settings.treat_x_as_pseudoatom;
+   loader.ignore_noncritical_query_features = settings.ignore_noncritical_query_features;
+   loader.ignore_no_chiral_flag = settings.ignore_no_chiral_flag;
+   loader.ignore_bad_valence = settings.ignore_bad_valence;
+   loader.loadReaction(_rxn);
+   _loaded = true;
 }
 
 BaseReaction & IndigoRdfReaction::getBaseReaction ()
@@ -207,7 +370,7 @@ IndigoRdfReaction::~IndigoRdfReaction ()
 {
 }
 
-IndigoObject * IndigoSdfLoader::next ()
+IndigoRdfData * IndigoSdfLoader::_readNext ()
 {
    if (sdf_loader->isEOF())
       return 0;
@@ -221,21 +384,65 @@ IndigoObject * IndigoSdfLoader::next ()
                                 counter, offset);
 }
 
+void IndigoSdfLoader::_startPipeline ()
+{
+   if (_pipeline.get() != 0)
+      return;
+
+   _pipeline.reset(new IndigoParsePipeline([this] (long long &end_offset) {
+      IndigoRdfData *item = _readNext();
+      end_offset = sdf_loader->tell();
+      return item;
+   }, _parsing_threads));
+
+   _pipeline->start(sdf_loader->tell());
+}
+
+IndigoObject * IndigoSdfLoader::next ()
+{
+   if (_parsing_threads > 0)
+   {
+      _startPipeline();
+      return _pipeline->next();
+   }
+
+   return _readNext();
+}
+
 IndigoObject * IndigoSdfLoader::at (int index)
 {
+   _checkNoPipeline(_pipeline, "indigoAt()");
+   if (_record_index.filename.size() > 0)
+      _buildRecordIndex(sdf_loader.ref(), _record_index);
    sdf_loader->readAt(index);
 
    return new IndigoRdfMolecule(sdf_loader->data, sdf_loader->properties,
                                 index, 0LL);
 }
 
+int IndigoSdfLoader::count ()
+{
+   _checkNoPipeline(_pipeline, "indigoCount()");
+   _buildRecordIndex(sdf_loader.ref(), _record_index);
+   return sdf_loader->count();
+}
+
 bool IndigoSdfLoader::hasNext ()
 {
+   if (_parsing_threads > 0)
+   {
+      _startPipeline();
+      return _pipeline->hasNext();
+   }
+
    return !sdf_loader->isEOF();
 }
 
 long long IndigoSdfLoader::tell ()
 {
+   if (_pipeline.get() != 0)
+      return _pipeline->tell();
+
    return sdf_loader->tell();
 }
 
@@ -248,8 +455,10 @@ IndigoObject(RDF_LOADER)
 IndigoRdfLoader::IndigoRdfLoader (const char *filename) :
 IndigoObject(RDF_LOADER)
 {
-   _own_scanner.reset(new FileScanner(indigoGetInstance().filename_encoding, filename));
+   _own_scanner.reset(new FileScanner(indigoGetInstance().filename_encoding, filename, indigoGetInstance().mmap_files));
    rdf_loader.reset(new RdfLoader(_own_scanner.ref()));
+   _record_index.init(filename, (FileScanner &)_own_scanner.ref(), 'R');
+   _loadRecordIndex(rdf_loader.ref(), _record_index);
 }
 
 IndigoRdfLoader::~IndigoRdfLoader ()
@@ -276,6 +485,8 @@ IndigoObject * IndigoRdfLoader::next ()
 
 IndigoObject * IndigoRdfLoader::at (int index)
 {
+   if (_record_index.filename.size() > 0)
+      _buildRecordIndex(rdf_loader.ref(), _record_index);
    rdf_loader->readAt(index);
 
    if (rdf_loader->isMolecule())
@@ -286,6 +497,12 @@ IndigoObject * IndigoRdfLoader::at (int index)
 }
 
 
+int IndigoRdfLoader::count ()
+{
+   _buildRecordIndex(rdf_loader.ref(), _record_index);
+   return rdf_loader->count();
+}
+
 long long IndigoRdfLoader::tell ()
 {
    return rdf_loader->tell();
@@ -307,19 +524,20 @@ IndigoSmilesMolecule::~IndigoSmilesMolecule ()
 
 Molecule & IndigoSmilesMolecule::getMolecule ()
 {
-   Indigo &self = indigoGetInstance();
-   if (!_loaded)
-   {
-      BufferScanner scanner(_data);
-      SmilesLoader loader(scanner);
+   _ensureLoaded();
+   return _mol;
+}
 
-      loader.stereochemistry_options = self.stereochemistry_options;
-      loader.ignore_bad_valence = self.ignore_bad_valence;
+void IndigoSmilesMolecule::_load (const IndigoLoaderSettings &settings)
+{
+   BufferScanner scanner(_data);
+   SmilesLoader loader(scanner);
 
-      loader.loadMolecule(_mol);
-      _loaded = true;
-   }
-   return _mol;
+   loader.stereochemistry_options = settings.stereochemistry_options;
+   loader.ignore_bad_valence = settings.ignore_bad_valence;
+
+   loader.loadMolecule(_mol);
+   _loaded = true;
 }
 
 BaseMolecule & IndigoSmilesMolecule::getBaseMolecule ()
@@ -350,19 +568,20 @@ IndigoSmilesReaction::~IndigoSmilesReaction ()
 
 Reaction & IndigoSmilesReaction::getReaction ()
 {
-   Indigo &self = indigoGetInstance();
-   if (!_loaded)
-   {
-      BufferScanner scanner(_data);
-      RSmilesLoader loader(scanner);
+   _ensureLoaded();
+   return _rxn;
+}
 
-      loader.stereochemistry_options = self.stereochemistry_options;
-      loader.ignore_bad_valence = self.ignore_bad_valence;
+void IndigoSmilesReaction::_load (const IndigoLoaderSettings &settings)
+{
+   BufferScanner scanner(_data);
+   RSmilesLoader loader(scanner);
 
-      loader.loadReaction(_rxn);
-      _loaded = true;
-   }
-   return _rxn;
+   loader.stereochemistry_options = settings.stereochemistry_options;
+   loader.ignore_bad_valence = settings.ignore_bad_valence;
+
+   loader.loadReaction(_rxn);
+   _loaded = true;
 }
 
 BaseReaction & IndigoSmilesReaction::getBaseReaction ()
@@ -392,24 +611,38 @@ CP_INIT, TL_CP_GET(_offsets)
 
    _current_number = 0;
    _max_offset = 0LL;
+   _first_offset = _scanner->tell();
+   _index_complete = false;
    _offsets.clear();
+
+   // The scanner belongs to another object, so it is read on the demand only
+   _parsing_threads = 0;
 }
 
 IndigoMultilineSmilesLoader::IndigoMultilineSmilesLoader (const char *filename) :
 IndigoObject(MULTILINE_SMILES_LOADER),
 CP_INIT, TL_CP_GET(_offsets)
 {
-   _own_scanner.reset(new FileScanner(indigoGetInstance().filename_encoding, filename));
+   _own_scanner.reset(new FileScanner(indigoGetInstance().filename_encoding, filename, indigoGetInstance().mmap_files));
    _scanner = _own_scanner.get();
 
    _current_number = 0;
    _max_offset = 0LL;
+   _first_offset = 0LL;
+   _index_complete = false;
    _offsets.clear();
+
+   _parsing_threads = indigoGetInstance().parsing_threads;
+
+   _record_index.init(filename, (FileScanner &)_own_scanner.ref(), 'L');
+   _loadRecordIndex(*this, _record_index);
 }
 
 
 IndigoMultilineSmilesLoader::~IndigoMultilineSmilesLoader ()
 {
+   // Stop the splitting thread before the scanner is destroyed
+   _pipeline.reset(0);
 }
 
 void IndigoMultilineSmilesLoader::_advance ()
@@ -422,7 +655,7 @@ void IndigoMultilineSmilesLoader::_advance ()
       _max_offset = _scanner->tell();
 }
 
-IndigoObject * IndigoMultilineSmilesLoader::next ()
+IndigoRdfData * IndigoMultilineSmilesLoader::_readNext ()
 {
    if (_scanner->isEOF())
       return 0;
@@ -438,18 +671,97 @@ IndigoObject * IndigoMultilineSmilesLoader::next ()
       return new IndigoSmilesReaction(_str, counter, offset);
 }
 
+void IndigoMultilineSmilesLoader::_startPipeline ()
+{
+   if (_pipeline.get() != 0)
+      return;
+
+   _pipeline.reset(new IndigoParsePipeline([this] (long long &end_offset) {
+      IndigoRdfData *item = _readNext();
+      end_offset = _scanner->tell();
+      return item;
+   }, _parsing_threads));
+
+   _pipeline->start(_scanner->tell());
+}
+
+IndigoObject * IndigoMultilineSmilesLoader::next ()
+{
+   if (_parsing_threads > 0)
+   {
+      _startPipeline();
+      return _pipeline->next();
+   }
+
+   return _readNext();
+}
+
 bool IndigoMultilineSmilesLoader::hasNext ()
 {
+   if (_parsing_threads > 0)
+   {
+      _startPipeline();
+      return _pipeline->hasNext();
+   }
+
    return !_scanner->isEOF();
 }
 
 long long IndigoMultilineSmilesLoader::tell ()
 {
+   if (_pipeline.get() != 0)
+      return _pipeline->tell();
+
    return _scanner->tell();
 }
 
 int IndigoMultilineSmilesLoader::count ()
 {
+   _checkNoPipeline(_pipeline, "indigoCount()");
+   _buildRecordIndex(*this, _record_index);
+   return _offsets.size();
+}
+
+namespace
+{
+   // A record is a line
+   class SmilesLinesSplitter : public RecordSplitter
+   {
+   public:
+      virtual bool skipRecord (const char *data, long long size, long long &pos) const
+      {
+         long long line_end;
+
+         if (pos >= size)
+            return false;
+         pos = _nextLine(data, size, pos, line_end);
+         return true;
+      }
+
+      virtual long long findRecordStart (const char *data, long long size, long long pos) const
+      {
+         long long line_end;
+
+         return _nextLine(data, size, pos, line_end);
+      }
+   };
+}
+
+void IndigoMultilineSmilesLoader::buildIndex (int threads)
+{
+   if (_index_complete)
+      return;
+
+   long long size = 0;
+   const char *data = RecordIndex::getData(*_scanner, _first_offset, size);
+
+   if (data != 0)
+   {
+      RecordIndex::build(data, size, _first_offset, SmilesLinesSplitter(), threads, _offsets, _max_offset);
+      _index_complete = true;
+      return;
+   }
+
    long long offset = _scanner->tell();
    int cn = _current_number;
 
@@ -463,29 +775,59 @@ int IndigoMultilineSmilesLoader::count ()
       _advance();
 
    int res = _current_number;
+   _index_complete = true;
 
    if (res != cn)
    {
       _scanner->seek(offset, SEEK_SET);
       _current_number = cn;
    }
+}
+
+bool IndigoMultilineSmilesLoader::isIndexComplete ()
+{
+   return _index_complete;
+}
+
+void IndigoMultilineSmilesLoader::saveIndex (Output &output, const RecordIndex::Source &source)
+{
+   RecordIndex::save(output, source, _offsets, _max_offset);
+}
+
+void IndigoMultilineSmilesLoader::loadIndex (Scanner &input, const RecordIndex::Source &source)
+{
+   QS_DEF(Array<long long>, offsets);
+   long long end;
 
-   return res;
+   RecordIndex::load(input, source, offsets, end);
+   if (offsets.size() > 0 && offsets[0] != _first_offset)
+      throw IndigoError("the record index does not match the input");
+
+   _offsets.swap(offsets);
+   _max_offset = end;
+   _index_complete = true;
 }
 
 IndigoObject * IndigoMultilineSmilesLoader::at (int index)
 {
+   _checkNoPipeline(_pipeline, "indigoAt()");
+   if (_record_index.filename.size() > 0)
+      _buildRecordIndex(*this, _record_index);
+
    if (index < _offsets.size())
    {
       _scanner->seek(_offsets[index], SEEK_SET);
       _current_number = index;
-      return next();
+      return _readNext();
    }
+   if (_index_complete)
+      throw IndigoError("indigoAt(): no such record index: %d", index);
+
    _scanner->seek(_max_offset, SEEK_SET);
    _current_number = _offsets.size();
    while (index > _offsets.size())
       _advance();
-   return next();
+   return _readNext();
 }
 
 CEXPORT int indigoIterateSDF (int reader)
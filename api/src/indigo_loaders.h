@@ -20,6 +20,37 @@
 #include "molecule/molecule.h"
 #include "reaction/reaction.h"
 #include "base_cpp/properties_map.h"
+#include "base_cpp/record_index.h"
+
+class IndigoParsePipeline;
+
+// <file>.idx with the record offsets of a file, see the "record-index" option
+struct IndigoRecordIndexFile
+{
+   IndigoRecordIndexFile ();
+
+   // Does nothing if the option is off
+   void init (const char *source_filename, FileScanner &source_scanner, char format);
+
+   Array<char> filename; // empty if the index is not used
+   Encoding encoding;
+   RecordIndex::Source source;
+   bool up_to_date; // the file has the offsets of all records
+};
+
+// Loader options of the session. The parsing pipeline workers run in
+// their own sessions, so the options are copied when the pipeline starts.
+struct IndigoLoaderSettings
+{
+   explicit IndigoLoaderSettings (Indigo &self);
+
+   StereocentersOptions stereochemistry_options;
+   bool treat_x_as_pseudoatom;
+   bool skip_3d_chirality;
+   bool ignore_noncritical_query_features;
+   bool ignore_no_chiral_flag;
+   bool ignore_bad_valence;
+};
 
 class IndigoRdfData : public IndigoObject
 {
@@ -36,11 +67,21 @@ public:
    virtual int getIndex ();
    long long tell ();
 
+   // Parses the data ahead of the access. A parse error is kept and thrown
+   // when the object is accessed, like the lazy parsing does.
+   void preload (const IndigoLoaderSettings &settings);
+
 protected:
+   // Parses the data and sets _loaded. The data that is parsed on the
+   // access only is left as is.
+   virtual void _load (const IndigoLoaderSettings &settings) {}
+   void _ensureLoaded ();
+
    Array<char> _data;
    
    PropertiesMap _properties;
    bool _loaded;
+   AutoPtr<Exception> _load_error;
    int _index;
    long long _offset;
 };
@@ -58,6 +99,8 @@ public:
    virtual IndigoObject * clone ();
 
 protected:
+   virtual void _load (const IndigoLoaderSettings &settings);
+
    Molecule _mol;
 };
 
@@ -74,6 +117,8 @@ public:
    virtual IndigoObject * clone ();
 
 protected:
+   virtual void _load (const IndigoLoaderSettings &settings);
+
    Reaction _rxn;
 };
 
@@ -89,6 +134,7 @@ public:
    virtual bool hasNext ();
 
    IndigoObject * at (int index);
+   int count ();
 
    long long tell ();
 
@@ -96,6 +142,23 @@ public:
 
 protected:
    AutoPtr<Scanner>  _own_scanner;
+
+   IndigoRdfData * _readNext ();
+
+   // Records are parsed in parallel if the "parsing-threads" option is set
+   void _startPipeline ();
+
+   int _parsing_threads;
+   AutoPtr<IndigoParsePipeline> _pipeline;
+
+   // Checkpoint index of a gzipped file, see the "gzip-index" option
+   void _loadGZipIndex (const char *filename);
+   void _saveGZipIndex ();
+
+   Array<char> _gzip_index_filename;
+   Encoding _filename_encoding;
+
+   IndigoRecordIndexFile _record_index;
 };
 
 class IndigoRdfLoader : public IndigoObject
@@ -109,12 +172,15 @@ public:
    virtual bool hasNext ();
 
    IndigoObject * at (int index);
+   int count ();
 
    long long tell ();
 
    AutoPtr<RdfLoader> rdf_loader;
 protected:
    AutoPtr<Scanner>  _own_scanner;
+
+   IndigoRecordIndexFile _record_index;
 };
 
 class IndigoSmilesMolecule : public IndigoRdfData
@@ -129,6 +195,8 @@ public:
    virtual IndigoObject * clone ();
 
 protected:
+   virtual void _load (const IndigoLoaderSettings &settings);
+
    Molecule _mol;
 };
 
@@ -144,6 +212,8 @@ public:
    virtual IndigoObject * clone ();
 
 protected:
+   virtual void _load (const IndigoLoaderSettings &settings);
+
    Reaction _rxn;
 };
 
@@ -162,17 +232,34 @@ public:
    IndigoObject * at (int index);
    int count ();
 
+   // Record offsets, see RecordIndex
+   void buildIndex (int threads);
+   bool isIndexComplete ();
+   void saveIndex (Output &output, const RecordIndex::Source &source);
+   void loadIndex (Scanner &input, const RecordIndex::Source &source);
+
 protected:
    Scanner    *_scanner;
    Array<char> _str;
    AutoPtr<Scanner>      _own_scanner;
 
    void _advance ();
+   IndigoRdfData * _readNext ();
+
+   // Records are parsed in parallel if the "parsing-threads" option is set
+   void _startPipeline ();
+
+   int _parsing_threads;
+   AutoPtr<IndigoParsePipeline> _pipeline;
 
    CP_DECL;
    TL_CP_DECL(Array<long long>, _offsets);
    int _current_number;
    long long _max_offset;
+   long long _first_offset;
+   bool _index_complete;
+
+   IndigoRecordIndexFile _record_index;
 };
 
 namespace indigo
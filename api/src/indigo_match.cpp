@@ -1039,6 +1039,74 @@ int indigoIterateMatches (int target_matcher, int query)
    INDIGO_END(-1)
 }
 
+IndigoQuerySet::IndigoQuerySet (const MoleculeFingerprintParameters &fp_params) :
+   IndigoObject(QUERY_SET),
+   query_set(fp_params)
+{
+}
+
+IndigoQuerySet::~IndigoQuerySet ()
+{
+}
+
+const char * IndigoQuerySet::debugInfo ()
+{
+   return "<query set>";
+}
+
+IndigoQuerySet & IndigoQuerySet::cast (IndigoObject &obj)
+{
+   if (obj.type != IndigoObject::QUERY_SET)
+      throw IndigoError("%s is not a query set", obj.debugInfo());
+
+   return (IndigoQuerySet &)obj;
+}
+
+CEXPORT int indigoCreateQuerySet ()
+{
+   INDIGO_BEGIN
+   {
+      return self.addObject(new IndigoQuerySet(self.fp_params));
+   }
+   INDIGO_END(-1)
+}
+
+CEXPORT int indigoQuerySetAdd (int query_set, int query)
+{
+   INDIGO_BEGIN
+   {
+      IndigoQuerySet &set = IndigoQuerySet::cast(self.getObject(query_set));
+
+      return set.query_set.add(self.getObject(query).getQueryMolecule());
+   }
+   INDIGO_END(-1)
+}
+
+CEXPORT const int * indigoQuerySetMatch (int query_set, int target, int *count_out)
+{
+   INDIGO_BEGIN
+   {
+      IndigoQuerySet &set = IndigoQuerySet::cast(self.getObject(query_set));
+      Molecule &mol = self.getObject(target).getMolecule();
+      QS_DEF(Array<int>, ids);
+
+      set.query_set.arom_options = self.arom_options;
+      set.query_set.use_fingerprints = self.query_set_fingerprints;
+      set.query_set.match(mol, ids);
+
+      // Not zero even if no queries match, zero is an error
+      auto &tmp = self.getThreadTmpData();
+      tmp.string.reserve(ids.sizeInBytes() + sizeof(int));
+      tmp.string.copy((const char *)ids.ptr(), ids.sizeInBytes());
+
+      if (count_out != 0)
+         *count_out = ids.size();
+
+      return (const int *)tmp.string.ptr();
+   }
+   INDIGO_END(0)
+}
+
 const char * IndigoReactionSubstructureMatcher::debugInfo ()
 {
    return "<reaction substructure matcher>";
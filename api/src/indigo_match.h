@@ -22,6 +22,7 @@
 #include "reaction/reaction_substructure_matcher.h"
 #include "reaction/reaction.h"
 #include "molecule/molecule_neighbourhood_counters.h"
+#include "molecule/molecule_query_set.h"
 
 class IndigoQueryMolecule;
 
@@ -169,6 +170,20 @@ public:
    Array<int> mol_mapping;
 };
 
+// Set of queries matched against a target at once
+class DLLEXPORT IndigoQuerySet : public IndigoObject
+{
+public:
+   IndigoQuerySet (const MoleculeFingerprintParameters &fp_params);
+   virtual ~IndigoQuerySet ();
+
+   static IndigoQuerySet & cast (IndigoObject &obj);
+
+   const char * debugInfo ();
+
+   MoleculeQuerySet query_set;
+};
+
 DLLEXPORT bool _indigoParseTautomerFlags (const char *flags, IndigoTautomerParams &params);
 DLLEXPORT int _indigoParseExactFlags (const char *flags, bool reaction, float *rms_threshold);
 
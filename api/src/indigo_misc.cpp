@@ -627,10 +627,10 @@ CEXPORT int indigoCount (int item)
          return IndigoArray::cast(obj).objects.size();
 
       if (obj.type == IndigoObject::SDF_LOADER)
-         return ((IndigoSdfLoader &)obj).sdf_loader->count();
+         return ((IndigoSdfLoader &)obj).count();
 
       if (obj.type == IndigoObject::RDF_LOADER)
-         return ((IndigoRdfLoader &)obj).rdf_loader->count();
+         return ((IndigoRdfLoader &)obj).count();
 
       if (obj.type == IndigoObject::MULTILINE_SMILES_LOADER)
          return ((IndigoMultilineSmilesLoader &)obj).count();
@@ -613,7 +613,7 @@ CEXPORT int indigoLoadStructureFromFile(const char *filename, const char * param
 {
     INDIGO_BEGIN
     {
-        FileScanner scanner(self.filename_encoding, filename);
+        FileScanner scanner(self.filename_encoding, filename, self.mmap_files);
         Array<char> arr;
         MoleculeAutoLoader::readAllDataToString(scanner, arr);
 
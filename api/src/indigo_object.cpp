@@ -116,6 +116,10 @@ IndigoObjectTypes::IndigoObjectTypes() {
    emplace(IndigoObject::TGROUP, "TGroup");
    emplace(IndigoObject::TGROUPS_ITER, "TGroupsIterator");
    emplace(IndigoObject::GROSS_REACTION, "GrossReaction");
+   emplace(IndigoObject::QUERY_SET, "QuerySet");
+   emplace(IndigoObject::ENUMERATED_PRODUCTS_ITER, "EnumeratedProductsIterator");
+   emplace(IndigoObject::SPARSE_FINGERPRINT, "SparseFingerprint");
+   emplace(IndigoObject::SPARSE_FINGERPRINTS, "SparseFingerprints");
 
    if(size() != IndigoObject::INDIGO_OBJECT_LAST_TYPE - 1) {
       throw Exception("IndigoObject type name dictionary is inconsistent");
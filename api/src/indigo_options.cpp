@@ -14,6 +14,7 @@
 
 #include "indigo_internal.h"
 #include "molecule/molfile_saver.h"
+#include "base_cpp/profiling.h"
 
 static void setStrValue(const char* source, char* dest, int len)
 {
@@ -227,12 +228,21 @@ _IndigoBasicOptionsHandlersSetter::_IndigoBasicOptionsHandlersSetter ()
    mgr.setOptionHandlerBool("molfile-saving-add-implicit-h", SETTER_GETTER_BOOL_OPTION(indigo.molfile_saving_add_implicit_h));
    mgr.setOptionHandlerBool("smiles-saving-write-name", SETTER_GETTER_BOOL_OPTION(indigo.smiles_saving_write_name));
    mgr.setOptionHandlerString("filename-encoding", indigoSetFilenameEncoding, indigoGetFilenameEncoding);
+   mgr.setOptionHandlerBool("mmap-files", SETTER_GETTER_BOOL_OPTION(indigo.mmap_files));
+   mgr.setOptionHandlerInt("parsing-threads", SETTER_GETTER_INT_OPTION(indigo.parsing_threads));
+   mgr.setOptionHandlerBool("gzip-index", SETTER_GETTER_BOOL_OPTION(indigo.gzip_index));
+   mgr.setOptionHandlerInt("gzip-checkpoint-span", SETTER_GETTER_INT_OPTION(indigo.gzip_checkpoint_span));
+   mgr.setOptionHandlerBool("record-index", SETTER_GETTER_BOOL_OPTION(indigo.record_index));
    mgr.setOptionHandlerInt("fp-ord-qwords", SETTER_GETTER_INT_OPTION(indigo.fp_params.ord_qwords));
    mgr.setOptionHandlerInt("fp-sim-qwords", SETTER_GETTER_INT_OPTION(indigo.fp_params.sim_qwords));
    mgr.setOptionHandlerInt("fp-any-qwords", SETTER_GETTER_INT_OPTION(indigo.fp_params.any_qwords));
    mgr.setOptionHandlerInt("fp-tau-qwords", SETTER_GETTER_INT_OPTION(indigo.fp_params.tau_qwords));
    mgr.setOptionHandlerBool("fp-ext-enabled", SETTER_GETTER_BOOL_OPTION(indigo.fp_params.ext));
    mgr.setOptionHandlerBool("smart-layout", SETTER_GETTER_BOOL_OPTION(indigo.smart_layout));
+   // Profiling is switched for the whole process, not for the session
+   mgr.setOptionHandlerBool("profiling",
+                            [](int enabled) { ProfilingSystem::setEnabled(enabled != 0); },
+                            [](int &enabled) { enabled = ProfilingSystem::isEnabled() ? 1 : 0; });
    mgr.setOptionHandlerString("layout-orientation", indigoSetLayoutOrientation, indigoGetLayoutOrientation);
    mgr.setOptionHandlerString("similarity-type",
                               [](const char *value) {
@@ -247,12 +257,16 @@ _IndigoBasicOptionsHandlersSetter::_IndigoBasicOptionsHandlersSetter ()
 
    mgr.setOptionHandlerString("embedding-uniqueness", indigoSetEmbeddingUniqueness, indigoGetEmbeddingUniqueness);
    mgr.setOptionHandlerInt("max-embeddings", indigoSetMaxEmbeddings, indigoGetMaxEmbeddings);
+   mgr.setOptionHandlerBool("query-set-fingerprints", SETTER_GETTER_BOOL_OPTION(indigo.query_set_fingerprints));
 
    mgr.setOptionHandlerInt("layout-max-iterations", SETTER_GETTER_INT_OPTION(indigo.layout_max_iterations));
 
    mgr.setOptionHandlerFloat("layout-horintervalfactor", indigoSetLayoutHorIntervalFactor, indigoGetLayoutHorIntervalFactor);
 
    mgr.setOptionHandlerInt("aam-timeout", SETTER_GETTER_INT_OPTION(indigo.aam_cancellation_timeout));
+   mgr.setOptionHandlerInt("mcs-threads", SETTER_GETTER_INT_OPTION(indigo.mcs_threads));
+   mgr.setOptionHandlerInt("mcs-timeout", SETTER_GETTER_INT_OPTION(indigo.mcs_timeout));
+   mgr.setOptionHandlerBool("mcs-maximum-only", SETTER_GETTER_BOOL_OPTION(indigo.mcs_maximum_only));
    mgr.setOptionHandlerInt("timeout", SETTER_GETTER_INT_OPTION(indigo.cancellation_timeout));
 
    mgr.setOptionHandlerBool("serialize-preserve-ordering", SETTER_GETTER_BOOL_OPTION(indigo.preserve_ordering_in_serialize));
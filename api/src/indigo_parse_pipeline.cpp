@@ -0,0 +1,250 @@
+/****************************************************************************
+ * Copyright (C) 2009-2015 EPAM Systems
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * This file may be distributed and/or modified under the terms of the
+ * GNU General Public License version 3 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.
+ *
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ ***************************************************************************/
+
+#include "indigo_parse_pipeline.h"
+
+#include "base_cpp/tlscont.h"
+#include "base_cpp/profiling.h"
+
+// Maximum number of parsed items that are waiting for the indigoNext call
+static const int _MAX_QUEUED_ITEMS = 256;
+
+// Records are passed to the workers in batches, a command per record
+// costs more than parsing a short SMILES
+static const int _RECORDS_PER_COMMAND = 64;
+
+namespace
+{
+   class ParseCommand : public OsCommand
+   {
+   public:
+      virtual void clear ()
+      {
+         items.clear();
+         end_offsets.clear();
+      }
+
+      virtual void execute (OsCommandResult &result);
+
+      IndigoParsePipeline *pipeline;
+      PtrArray<IndigoRdfData> items;
+      Array<long long> end_offsets;
+   };
+
+   class ParseResult : public OsCommandResult
+   {
+   public:
+      virtual void clear ()
+      {
+         items.clear();
+         end_offsets.clear();
+      }
+
+      PtrArray<IndigoRdfData> items;
+      Array<long long> end_offsets;
+   };
+
+   void ParseCommand::execute (OsCommandResult &result)
+   {
+      ParseResult &parsed = (ParseResult &)result;
+
+      for (int i = 0; i < items.size(); i++)
+      {
+         pipeline->parseItem(*items[i]);
+         parsed.items.add(items.release(i));
+      }
+      parsed.end_offsets.copy(end_offsets);
+      items.clear();
+   }
+}
+
+IndigoParsePipeline::IndigoParsePipeline (const ReadRecord &read_record, int threads_count) :
+   OsCommandDispatcher(HANDLING_ORDER_SERIAL, false),
+   _read_record(read_record), _threads_count(threads_count),
+   _settings(indigoGetInstance())
+{
+   _finished = false;
+   _cancelled = false;
+   _offset = 0LL;
+}
+
+IndigoParsePipeline::~IndigoParsePipeline ()
+{
+   {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      _cancelled = true;
+   }
+   _queue_cond.notify_all();
+
+   if (_producer.joinable())
+      _producer.join();
+
+   for (size_t i = 0; i < _queue.size(); i++)
+      delete _queue[i].item;
+}
+
+void IndigoParsePipeline::start (long long offset)
+{
+   _offset = offset;
+   _producer = std::thread(&IndigoParsePipeline::_produce, this);
+}
+
+void IndigoParsePipeline::_produce ()
+{
+   qword session_id = TL_GET_SESSION_ID();
+
+   AutoPtr<Exception> exception;
+   try
+   {
+      run(_threads_count);
+   }
+   catch (Exception &e)
+   {
+      exception.reset(e.clone());
+   }
+   catch (...)
+   {
+      exception.reset(Exception("IndigoParsePipeline: unknown exception").clone());
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      if (exception.get() != 0 && _exception.get() == 0)
+         _exception.reset(exception.release());
+      _finished = true;
+   }
+   _queue_cond.notify_all();
+
+   TL_RELEASE_SESSION_ID(session_id);
+}
+
+IndigoObject * IndigoParsePipeline::next ()
+{
+   std::unique_lock<std::mutex> lock(_queue_mutex);
+   _queue_cond.wait(lock, [this] { return !_queue.empty() || _finished; });
+
+   if (_queue.empty())
+   {
+      if (_exception.get() != 0)
+      {
+         // Like the lazy iterator, throw the error once and stop there
+         AutoPtr<Exception> exception(_exception.release());
+         exception->throwSelf();
+      }
+      return 0;
+   }
+
+   QueuedItem queued = _queue.front();
+   _queue.pop_front();
+
+   // The splitting thread waits for the room in the queue. It is woken
+   // when half of the queue is free, not on every item.
+   bool wake = (_queue.size() == (size_t)_MAX_QUEUED_ITEMS / 2);
+   lock.unlock();
+
+   if (wake)
+      _queue_cond.notify_all();
+
+   _offset = queued.end_offset;
+   return queued.item;
+}
+
+bool IndigoParsePipeline::hasNext ()
+{
+   std::unique_lock<std::mutex> lock(_queue_mutex);
+   _queue_cond.wait(lock, [this] { return !_queue.empty() || _finished; });
+
+   return !_queue.empty() || _exception.get() != 0;
+}
+
+long long IndigoParsePipeline::tell ()
+{
+   return _offset;
+}
+
+void IndigoParsePipeline::parseItem (IndigoRdfData &item)
+{
+   profTimerStart(t, "parse_pipeline_item");
+   item.preload(_settings);
+}
+
+OsCommand * IndigoParsePipeline::_allocateCommand ()
+{
+   ParseCommand *command = new ParseCommand();
+   command->pipeline = this;
+   return command;
+}
+
+OsCommandResult * IndigoParsePipeline::_allocateResult ()
+{
+   return new ParseResult();
+}
+
+bool IndigoParsePipeline::_setupCommand (OsCommand &command)
+{
+   {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      // Nothing is read after a splitting error
+      if (_cancelled || _exception.get() != 0)
+         return false;
+   }
+
+   ParseCommand &parse = (ParseCommand &)command;
+
+   // A splitting error is thrown to the consumer after the items that
+   // precede it. The dispatcher main loop must not be left with an
+   // exception while the worker threads are running.
+   try
+   {
+      while (parse.items.size() < _RECORDS_PER_COMMAND)
+      {
+         long long end_offset;
+         IndigoRdfData *item = _read_record(end_offset);
+
+         if (item == 0)
+            break;
+
+         parse.items.add(item);
+         parse.end_offsets.push(end_offset);
+      }
+   }
+   catch (Exception &e)
+   {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      _exception.reset(e.clone());
+   }
+
+   return parse.items.size() > 0;
+}
+
+void IndigoParsePipeline::_handleResult (OsCommandResult &result)
+{
+   ParseResult &parsed = (ParseResult &)result;
+
+   std::unique_lock<std::mutex> lock(_queue_mutex);
+   _queue_cond.wait(lock, [this] { return _cancelled || _queue.size() < (size_t)_MAX_QUEUED_ITEMS; });
+   if (_cancelled)
+      return;
+
+   for (int i = 0; i < parsed.items.size(); i++)
+   {
+      QueuedItem queued;
+      queued.item = parsed.items.release(i);
+      queued.end_offset = parsed.end_offsets[i];
+      _queue.push_back(queued);
+   }
+   lock.unlock();
+
+   _queue_cond.notify_all();
+}
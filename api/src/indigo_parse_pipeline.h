@@ -0,0 +1,89 @@
+/****************************************************************************
+ * Copyright (C) 2009-2015 EPAM Systems
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * This file may be distributed and/or modified under the terms of the
+ * GNU General Public License version 3 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.
+ *
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ ***************************************************************************/
+
+#ifndef __indigo_parse_pipeline__
+#define __indigo_parse_pipeline__
+
+#include "indigo_loaders.h"
+
+#include "base_cpp/os_thread_wrapper.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Parses the records of a file iterator ahead of the indigoNext calls.
+// The dispatcher main loop runs in a separate thread that splits the file
+// into records, the worker threads parse them, and the parsed items are
+// passed in the original order through a bounded queue. A parse error is
+// kept in its item and thrown when the item is accessed.
+class IndigoParsePipeline : public OsCommandDispatcher
+{
+public:
+   // Returns the next record of the file and the file position after it,
+   // or 0 at the end of the file. It is called in the splitting thread only.
+   typedef std::function<IndigoRdfData * (long long &end_offset)> ReadRecord;
+
+   IndigoParsePipeline (const ReadRecord &read_record, int threads_count);
+   virtual ~IndigoParsePipeline ();
+
+   // Starts splitting from the current position of the file. The record
+   // source must not be used by the caller until the pipeline is destroyed.
+   void start (long long offset);
+
+   // Waits for the next item. Returns 0 when the file is over.
+   IndigoObject * next ();
+   bool hasNext ();
+
+   // Position in the file after the last item returned by next()
+   long long tell ();
+
+   void parseItem (IndigoRdfData &item);
+
+protected:
+   virtual OsCommand * _allocateCommand ();
+   virtual OsCommandResult * _allocateResult ();
+
+   virtual bool _setupCommand (OsCommand &command);
+   virtual void _handleResult (OsCommandResult &result);
+
+private:
+   struct QueuedItem
+   {
+      IndigoObject *item;
+      long long end_offset;
+   };
+
+   void _produce ();
+
+   ReadRecord _read_record;
+   int _threads_count;
+   IndigoLoaderSettings _settings;
+
+   std::thread _producer;
+
+   std::deque<QueuedItem> _queue;
+   std::mutex _queue_mutex;
+   std::condition_variable _queue_cond;
+   bool _finished;
+   bool _cancelled;
+   AutoPtr<Exception> _exception;
+
+   // Accessed by the consumer only
+   long long _offset;
+};
+
+#endif // __indigo_parse_pipeline__
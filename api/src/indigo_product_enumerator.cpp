@@ -12,7 +12,7 @@
  * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
  ***************************************************************************/
 
-#include "indigo_internal.h"
+#include "indigo_product_enumerator.h"
 #include "indigo_reaction.h"
 #include "indigo_array.h"
 #include "base_cpp/scanner.h"
@@ -151,6 +151,452 @@ CEXPORT int indigoReactionProductEnumerate (int reaction, int monomers)
    INDIGO_END(-1)
 }
 
+// A command builds one part, a part often has hundreds of products, and the
+// results of all the commands that are run are kept until they are handled
+static const int _PARTS_PER_COMMAND = 1;
+
+// Maximum number of products that are waiting for the indigoNext call
+static const int _MAX_QUEUED_PRODUCTS = 256;
+
+// FNV-1a hash of the canonical SMILES
+static qword _smilesHash (const Array<char> &smiles)
+{
+   qword hash = 14695981039346656037ULL;
+
+   for (int i = 0; i < smiles.size(); i++)
+   {
+      hash ^= (byte)smiles[i];
+      hash *= 1099511628211ULL;
+   }
+   return hash;
+}
+
+IndigoProductsIter::IndigoProductsIter (QueryReaction &reaction, IndigoArray &monomers) :
+IndigoObject(ENUMERATED_PRODUCTS_ITER)
+{
+   Indigo &self = indigoGetInstance();
+
+   if (monomers.objects.size() < reaction.reactantsCount())
+      throw IndigoError("Too small monomers array");
+
+   _reaction.clone(reaction, NULL, NULL, NULL);
+
+   bool has_coord = false;
+
+   for (int i = reaction.reactantBegin(); i != reaction.reactantEnd(); i = reaction.reactantNext(i))
+   {
+      IndigoArray &reactant_monomers = IndigoArray::cast(*monomers.objects[i]);
+
+      for (int j = 0; j < reactant_monomers.objects.size(); j++)
+      {
+         IndigoObject &object = *reactant_monomers.objects[j];
+         _monomers_properties.push().copy(object.getProperties());
+
+         Molecule &monomer = object.getMolecule();
+         _monomers.push().clone(monomer, NULL, NULL);
+         _monomers_reactants.push(i);
+         if (monomer.have_xyz)
+            has_coord = true;
+      }
+   }
+
+   // The options are taken now, the worker threads have their own sessions
+   _params = self.rpe_params;
+   _arom_options = self.arom_options;
+   _layout = has_coord && _params.is_layout;
+   _smart_layout = self.smart_layout;
+   _layout_orientation = self.layout_orientation;
+
+   _products_count = 0;
+   _next_part = 0;
+   _ready_pos = 0;
+
+   _builder.reset(new Builder(*this));
+   _parts_count = _builder->partsCount();
+}
+
+IndigoProductsIter::~IndigoProductsIter ()
+{
+}
+
+const char * IndigoProductsIter::debugInfo ()
+{
+   return "<enumerated products iterator>";
+}
+
+bool IndigoProductsIter::limitReached () const
+{
+   return _products_count >= _params.max_product_count;
+}
+
+bool IndigoProductsIter::acceptProduct (const Array<char> &smiles)
+{
+   if (limitReached())
+      return false;
+
+   // No SMILES if the enumerator keeps all of the products
+   if (smiles.size() > 1)
+   {
+      if (_params.dedup_exact)
+      {
+         if (_smiles.find(smiles.ptr()))
+            return false;
+         _smiles.insert(smiles.ptr(), 0);
+      }
+      else if (!_hashes.insert(_smilesHash(smiles)).second)
+         return false;
+   }
+
+   _products_count++;
+   return true;
+}
+
+void IndigoProductsIter::_fill ()
+{
+   QS_DEF(ObjArray< Array<char> >, smiles);
+   PtrArray<IndigoObject> items;
+
+   while (_ready_pos >= _ready.size() && _next_part < _parts_count && !limitReached())
+   {
+      _ready.clear();
+      _ready_pos = 0;
+
+      smiles.clear();
+      _builder->build(_next_part++, items, smiles);
+
+      for (int i = 0; i < items.size(); i++)
+         if (acceptProduct(smiles[i]))
+            _ready.add(items.release(i));
+      items.clear();
+   }
+}
+
+IndigoObject * IndigoProductsIter::next ()
+{
+   if (_params.threads > 0)
+   {
+      if (_pipeline.get() == 0)
+      {
+         _pipeline.reset(new IndigoProductsPipeline(*this, _params.threads));
+         _pipeline->start();
+      }
+      return _pipeline->next();
+   }
+
+   _fill();
+
+   if (_ready_pos >= _ready.size())
+      return 0;
+
+   return _ready.release(_ready_pos++);
+}
+
+bool IndigoProductsIter::hasNext ()
+{
+   if (_params.threads > 0)
+   {
+      if (_pipeline.get() == 0)
+      {
+         _pipeline.reset(new IndigoProductsPipeline(*this, _params.threads));
+         _pipeline->start();
+      }
+      return _pipeline->hasNext();
+   }
+
+   _fill();
+
+   return _ready_pos < _ready.size();
+}
+
+IndigoProductsIter::Builder::Builder (IndigoProductsIter &iter) :
+_iter(iter), _rpe(_reaction)
+{
+   std::lock_guard<std::mutex> lock(iter._clone_lock);
+
+   _reaction.clone(iter._reaction, NULL, NULL, NULL);
+   for (int i = 0; i < iter._monomers.size(); i++)
+      _rpe.addMonomer(iter._monomers_reactants[i], iter._monomers[i]);
+
+   _rpe.arom_options = iter._arom_options;
+   _rpe.is_multistep_reaction = iter._params.is_multistep_reactions;
+   _rpe.is_one_tube = iter._params.is_one_tube;
+   _rpe.is_self_react = iter._params.is_self_react;
+   _rpe.max_deep_level = iter._params.max_deep_level;
+   _rpe.max_product_count = iter._params.max_product_count;
+   _rpe.product_proc = _productProc;
+   _rpe.userdata = this;
+
+   _items = 0;
+   _smiles = 0;
+}
+
+long long IndigoProductsIter::Builder::partsCount ()
+{
+   return _rpe.partsCount();
+}
+
+void IndigoProductsIter::Builder::build (long long part, PtrArray<IndigoObject> &items, ObjArray< Array<char> > &smiles)
+{
+   _items = &items;
+   _smiles = &smiles;
+   _rpe.buildPart(part);
+}
+
+void IndigoProductsIter::Builder::_productProc (Molecule &product, Array<int> &monomers_indices,
+                                                Array<int> &mapping, void *userdata)
+{
+   Builder &builder = *(Builder *)userdata;
+   IndigoProductsIter &iter = builder._iter;
+
+   AutoPtr<IndigoReaction> item(new IndigoReaction());
+   Reaction &reaction = item->rxn;
+
+   for (int i = 0; i < monomers_indices.size(); i++)
+      reaction.addReactantCopy(builder._rpe.getMonomer(monomers_indices[i]), NULL, NULL);
+
+   reaction.addProductCopy(product, NULL, NULL);
+   reaction.name.copy(product.name);
+
+   if (iter._layout)
+   {
+      ReactionLayout layout(reaction, iter._smart_layout);
+      layout.layout_orientation = (layout_orientation_value)iter._layout_orientation;
+      layout.make();
+      reaction.markStereocenterBonds();
+   }
+
+   for (int i = 0; i < monomers_indices.size(); i++)
+      if (monomers_indices[i] < iter._monomers_properties.size())
+         item->_monomersProperties.push().copy(iter._monomers_properties[monomers_indices[i]]);
+
+   builder._smiles->push().readString(builder._rpe.productSmiles(), true);
+   builder._items->add(item.release());
+}
+
+namespace
+{
+   class ProductsCommand : public OsCommand
+   {
+   public:
+      virtual void clear ()
+      {
+         parts.clear();
+      }
+
+      virtual void execute (OsCommandResult &result);
+
+      IndigoProductsPipeline *pipeline;
+      Array<long long> parts;
+   };
+
+   class ProductsResult : public OsCommandResult
+   {
+   public:
+      virtual void clear ()
+      {
+         items.clear();
+         smiles.clear();
+      }
+
+      PtrArray<IndigoObject> items;
+      ObjArray< Array<char> > smiles;
+   };
+
+   void ProductsCommand::execute (OsCommandResult &result)
+   {
+      ProductsResult &products = (ProductsResult &)result;
+
+      for (int i = 0; i < parts.size(); i++)
+         pipeline->buildPart(parts[i], products.items, products.smiles);
+   }
+}
+
+IndigoProductsPipeline::IndigoProductsPipeline (IndigoProductsIter &iter, int threads_count) :
+   OsCommandDispatcher(HANDLING_ORDER_SERIAL, false),
+   _iter(iter), _threads_count(threads_count)
+{
+   _next_part = 0;
+   _finished = false;
+   _cancelled = false;
+}
+
+IndigoProductsPipeline::~IndigoProductsPipeline ()
+{
+   {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      _cancelled = true;
+   }
+   _queue_cond.notify_all();
+
+   if (_producer.joinable())
+      _producer.join();
+
+   for (size_t i = 0; i < _queue.size(); i++)
+      delete _queue[i];
+}
+
+void IndigoProductsPipeline::start ()
+{
+   _producer = std::thread(&IndigoProductsPipeline::_produce, this);
+}
+
+void IndigoProductsPipeline::_produce ()
+{
+   qword session_id = TL_GET_SESSION_ID();
+
+   AutoPtr<Exception> exception;
+   try
+   {
+      run(_threads_count);
+   }
+   catch (Exception &e)
+   {
+      exception.reset(e.clone());
+   }
+   catch (...)
+   {
+      exception.reset(Exception("IndigoProductsPipeline: unknown exception").clone());
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      if (exception.get() != 0)
+         _exception.reset(exception.release());
+      _finished = true;
+   }
+   _queue_cond.notify_all();
+
+   TL_RELEASE_SESSION_ID(session_id);
+}
+
+IndigoObject * IndigoProductsPipeline::next ()
+{
+   std::unique_lock<std::mutex> lock(_queue_mutex);
+   _queue_cond.wait(lock, [this] { return !_queue.empty() || _finished; });
+
+   if (_queue.empty())
+   {
+      if (_exception.get() != 0)
+      {
+         AutoPtr<Exception> exception(_exception.release());
+         exception->throwSelf();
+      }
+      return 0;
+   }
+
+   IndigoObject *item = _queue.front();
+   _queue.pop_front();
+
+   bool wake = (_queue.size() == (size_t)_MAX_QUEUED_PRODUCTS / 2);
+   lock.unlock();
+
+   if (wake)
+      _queue_cond.notify_all();
+
+   return item;
+}
+
+bool IndigoProductsPipeline::hasNext ()
+{
+   std::unique_lock<std::mutex> lock(_queue_mutex);
+   _queue_cond.wait(lock, [this] { return !_queue.empty() || _finished; });
+
+   return !_queue.empty() || _exception.get() != 0;
+}
+
+void IndigoProductsPipeline::buildPart (long long part, PtrArray<IndigoObject> &items, ObjArray< Array<char> > &smiles)
+{
+   IndigoProductsIter::Builder *builder;
+
+   {
+      std::lock_guard<std::mutex> lock(_builders_mutex);
+      builder = _builders.at(std::this_thread::get_id());
+   }
+
+   builder->build(part, items, smiles);
+}
+
+void IndigoProductsPipeline::_prepareThread ()
+{
+   // The enumerator is created and destroyed in its own thread
+   IndigoProductsIter::Builder *builder = new IndigoProductsIter::Builder(_iter);
+
+   std::lock_guard<std::mutex> lock(_builders_mutex);
+   _builders[std::this_thread::get_id()] = builder;
+}
+
+void IndigoProductsPipeline::_cleanupThread ()
+{
+   IndigoProductsIter::Builder *builder;
+
+   {
+      std::lock_guard<std::mutex> lock(_builders_mutex);
+      builder = _builders.at(std::this_thread::get_id());
+      _builders.erase(std::this_thread::get_id());
+   }
+
+   delete builder;
+}
+
+OsCommand * IndigoProductsPipeline::_allocateCommand ()
+{
+   ProductsCommand *command = new ProductsCommand();
+   command->pipeline = this;
+   return command;
+}
+
+OsCommandResult * IndigoProductsPipeline::_allocateResult ()
+{
+   return new ProductsResult();
+}
+
+bool IndigoProductsPipeline::_setupCommand (OsCommand &command)
+{
+   {
+      std::lock_guard<std::mutex> lock(_queue_mutex);
+      if (_cancelled || _iter.limitReached())
+         return false;
+   }
+
+   ProductsCommand &products = (ProductsCommand &)command;
+
+   while (products.parts.size() < _PARTS_PER_COMMAND && _next_part < _iter.partsCount())
+      products.parts.push(_next_part++);
+
+   return products.parts.size() > 0;
+}
+
+void IndigoProductsPipeline::_handleResult (OsCommandResult &result)
+{
+   ProductsResult &products = (ProductsResult &)result;
+
+   std::unique_lock<std::mutex> lock(_queue_mutex);
+   for (int i = 0; i < products.items.size(); i++)
+   {
+      _queue_cond.wait(lock, [this] { return _cancelled || _queue.size() < (size_t)_MAX_QUEUED_PRODUCTS; });
+      if (_cancelled)
+         return;
+
+      if (!_iter.acceptProduct(products.smiles[i]))
+         continue;
+
+      _queue.push_back(products.items.release(i));
+      _queue_cond.notify_all();
+   }
+}
+
+CEXPORT int indigoIterateEnumeratedProducts (int reaction, int monomers)
+{
+   INDIGO_BEGIN
+   {
+      QueryReaction &query_rxn = self.getObject(reaction).getQueryReaction();
+      IndigoArray &monomers_object = IndigoArray::cast(self.getObject(monomers));
+
+      return self.addObject(new IndigoProductsIter(query_rxn, monomers_object));
+   }
+   INDIGO_END(-1)
+}
+
 CEXPORT int indigoTransform (int reaction, int monomers)
 {
    INDIGO_BEGIN
@@ -281,6 +727,8 @@ _IndigoRPEOptionsHandlersSetter::_IndigoRPEOptionsHandlersSetter ()
    mgr.setOptionHandlerInt("rpe-max-depth", SETTER_GETTER_INT_OPTION(indigo.rpe_params.max_deep_level));
    mgr.setOptionHandlerInt("rpe-max-products-count", SETTER_GETTER_INT_OPTION(indigo.rpe_params.max_product_count));
    mgr.setOptionHandlerBool("rpe-layout", SETTER_GETTER_BOOL_OPTION(indigo.rpe_params.is_layout));
+   mgr.setOptionHandlerInt("rpe-threads", SETTER_GETTER_INT_OPTION(indigo.rpe_params.threads));
+   mgr.setOptionHandlerBool("rpe-dedup-exact", SETTER_GETTER_BOOL_OPTION(indigo.rpe_params.dedup_exact));
    mgr.setOptionHandlerBool("transform-layout", SETTER_GETTER_BOOL_OPTION(indigo.rpe_params.transform_is_layout));
 }
 
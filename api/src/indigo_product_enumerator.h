@@ -0,0 +1,162 @@
+/****************************************************************************
+ * Copyright (C) 2009-2015 EPAM Systems
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * This file may be distributed and/or modified under the terms of the
+ * GNU General Public License version 3 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.
+ *
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ ***************************************************************************/
+
+#ifndef __indigo_product_enumerator__
+#define __indigo_product_enumerator__
+
+#include "indigo_array.h"
+
+#include "base_cpp/os_thread_wrapper.h"
+#include "base_cpp/red_black.h"
+#include "molecule/molecule.h"
+#include "reaction/query_reaction.h"
+#include "reaction/reaction_product_enumerator.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+class IndigoProductsPipeline;
+
+// Products of a reaction for the given monomers, the same as
+// indigoReactionProductEnumerate returns, one by one. The products are built
+// by the parts of ReactionProductEnumerator, ahead of the indigoNext calls in
+// the worker threads if the "rpe-threads" option is set, and only the
+// products waiting in the queue are kept in memory. The duplicates are
+// skipped by the canonical SMILES, or by its 64-bit hash if the
+// "rpe-dedup-exact" option is reset. The products come in the same order
+// for any number of threads.
+class IndigoProductsIter : public IndigoObject
+{
+public:
+   IndigoProductsIter (QueryReaction &reaction, IndigoArray &monomers);
+   virtual ~IndigoProductsIter ();
+
+   virtual IndigoObject * next ();
+   virtual bool hasNext ();
+
+   virtual const char * debugInfo ();
+
+   // Enumerator over the own copies of the reaction and the monomers. It
+   // must be destroyed in the thread it was created in.
+   class Builder
+   {
+   public:
+      explicit Builder (IndigoProductsIter &iter);
+
+      long long partsCount ();
+      void build (long long part, PtrArray<IndigoObject> &items, ObjArray< Array<char> > &smiles);
+
+   private:
+      static void _productProc (Molecule &product, Array<int> &monomers_indices,
+                                Array<int> &mapping, void *userdata);
+
+      IndigoProductsIter &_iter;
+      QueryReaction _reaction;
+      ReactionProductEnumerator _rpe;
+
+      PtrArray<IndigoObject> *_items;
+      ObjArray< Array<char> > *_smiles;
+   };
+
+   long long partsCount () const { return _parts_count; }
+
+   // Called for the products in their order, returns false for the
+   // duplicates and for the products over the limit
+   bool acceptProduct (const Array<char> &smiles);
+   bool limitReached () const;
+
+private:
+   void _fill ();
+
+   friend class Builder;
+
+   QueryReaction _reaction;
+   ObjArray<Molecule> _monomers;
+   Array<int> _monomers_reactants;
+   ObjArray<PropertiesMap> _monomers_properties;
+
+   ProductEnumeratorParams _params;
+   AromaticityOptions _arom_options;
+   bool _layout;
+   bool _smart_layout;
+   int _layout_orientation;
+   std::mutex _clone_lock;
+
+   long long _parts_count;
+   int _products_count;
+   std::unordered_set<qword> _hashes;
+   RedBlackStringMap<int> _smiles;
+
+   // Building the parts in the calling thread
+   AutoPtr<Builder> _builder;
+   long long _next_part;
+   PtrArray<IndigoObject> _ready;
+   int _ready_pos;
+
+   AutoPtr<IndigoProductsPipeline> _pipeline;
+};
+
+// Builds the parts of the iterator in the worker threads and passes the
+// products in the order of the parts through a bounded queue
+class IndigoProductsPipeline : public OsCommandDispatcher
+{
+public:
+   IndigoProductsPipeline (IndigoProductsIter &iter, int threads_count);
+   virtual ~IndigoProductsPipeline ();
+
+   void start ();
+
+   // Waits for the next product. Returns 0 when there are no more products.
+   IndigoObject * next ();
+   bool hasNext ();
+
+   void buildPart (long long part, PtrArray<IndigoObject> &items, ObjArray< Array<char> > &smiles);
+
+protected:
+   virtual OsCommand * _allocateCommand ();
+   virtual OsCommandResult * _allocateResult ();
+
+   virtual bool _setupCommand (OsCommand &command);
+   virtual void _handleResult (OsCommandResult &result);
+
+   virtual void _prepareThread ();
+   virtual void _cleanupThread ();
+
+private:
+   void _produce ();
+
+   IndigoProductsIter &_iter;
+   int _threads_count;
+
+   std::unordered_map<std::thread::id, IndigoProductsIter::Builder *> _builders;
+   std::mutex _builders_mutex;
+
+   // Accessed by the dispatcher main loop only
+   long long _next_part;
+
+   std::thread _producer;
+
+   std::deque<IndigoObject *> _queue;
+   std::mutex _queue_mutex;
+   std::condition_variable _queue_cond;
+   bool _finished;
+   bool _cancelled;
+   AutoPtr<Exception> _exception;
+};
+
+#endif // __indigo_product_enumerator__
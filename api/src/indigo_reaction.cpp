@@ -592,6 +592,8 @@ CEXPORT int indigoAutomap (int reaction, const char *mode)
       BaseReaction &rxn = self.getObject(reaction).getBaseReaction();
       ReactionAutomapper ram(rxn);
       ram.arom_options = self.arom_options;
+      ram.mcs_threads = self.mcs_threads;
+      ram.mcs_timeout = self.mcs_timeout;
       /*
        * Read options
        */
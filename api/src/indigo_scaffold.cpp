@@ -76,6 +76,9 @@ CEXPORT int indigoExtractCommonScaffold (int structures, const char* options)
       }
       if(max_iterations > 0)
          msd.maxIterations = max_iterations;
+      msd.threads = self.mcs_threads;
+      msd.timeout = self.mcs_timeout;
+      msd.maximumOnly = self.mcs_maximum_only;
 
       if (approximate)
          msd.extractApproximateScaffold(scaf->max_scaffold);
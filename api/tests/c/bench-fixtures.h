@@ -0,0 +1,77 @@
+#ifndef __bench_fixtures_h__
+#define __bench_fixtures_h__
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Molecules and helpers shared by the benchmarks in tests/c and in the
+// tests of the plugins
+
+#define COUNT(arr) (int)(sizeof(arr) / sizeof(arr[0]))
+
+// Fragments of the generated molecules, see benchRandomSmiles()
+static const char *bench_fragments[] =
+{
+    "C", "CC", "N", "O", "C(=O)", "c1ccccc1", "C(Cl)", "CN", "OC", "C1CC1", "S", "c1ccncc1",
+    "C(F)(F)", "C(Br)", "C#N", "C1CCNCC1", "c1ccoc1", "C=C", "C(=O)N", "c1ccc2ccccc2c1"
+};
+
+// Drugs and other molecules of different sizes and ring systems
+static const char *bench_targets[] =
+{
+    "CC(=O)Oc1ccccc1C(=O)O",
+    "CN1C=NC2=C1C(=O)N(C(=O)N2C)C",
+    "CC(C)Cc1ccc(cc1)C(C)C(=O)O",
+    "CC(=O)Nc1ccc(O)cc1",
+    "CC1(C)SC2C(NC(=O)Cc3ccccc3)C(=O)N2C1C(=O)O",
+    "CC(C)c1c(C(=O)Nc2ccccc2)c(-c2ccccc2)c(-c2ccc(F)cc2)n1CCC(O)CC(O)CC(=O)O",
+    "CN1CCC23C4C1CC5=C2C(=C(C=C5)O)OC3C(C=C4)O",
+    "COc1ccc2[nH]cc(CCNC(C)=O)c2c1",
+    "CN(C)CCCN1c2ccccc2CCc2ccccc21",
+    "Clc1ccc(cc1)C(c1ccccc1)N1CCN(CC1)CCOCC(=O)O",
+    "CC(C)NCC(O)COc1cccc2ccccc12",
+    "OC(=O)CCCc1ccc(N(CCCl)CCCl)cc1",
+    "CC12CCC3C(CCC4=CC(=O)CCC34C)C1CCC2O",
+    "CC(=O)NC1=NN=C(S1)S(N)(=O)=O",
+    "NS(=O)(=O)c1cc2c(cc1Cl)NCNS2(=O)=O",
+    "CC(C)(C)NCC(O)c1ccc(O)c(CO)c1",
+    "CCN(CC)C(=O)C1CN(C)C2CC3=CNC4=CC=CC(=C34)C2=C1",
+    "CC1=C(C(=O)OC)C(c2cccc(c2)[N+](=O)[O-])C(C(=O)OC)=C(C)N1",
+    "OCC1OC(O)C(O)C(O)C1O",
+    "N[C@@H](Cc1c[nH]c2ccccc12)C(=O)O",
+    "FC(F)(F)c1ccc(Oc2ccc(cc2)N)cc1",
+    "CCOP(=S)(OCC)Oc1ccc(cc1)[N+]([O-])=O",
+    "Oc1ccc(cc1)C=Cc1cc(O)cc(O)c1",
+    "CN(C)C(=N)N=C(N)N",
+    "CC(C)C[C@H](NC(=O)[C@@H](Cc1ccccc1)NC(=O)c1ccccc1)B(O)O",
+    "COc1cc2c(cc1OC)C(=O)C(CC1CCN(Cc3ccccc3)CC1)C2",
+    "C[C@H]1CN(CCN1c1ccc(cc1)C(F)(F)F)C(=O)c1ccc(cc1)S(C)(=O)=O",
+    "O=C(O)c1cn(C2CC2)c2cc(N3CCNCC3)c(F)cc2c1=O",
+    "CCCCCCCCCCCCCCCC(=O)OCC(COP(=O)([O-])OCC[N+](C)(C)C)OC(=O)CCCCCCCCCCCCCCC",
+    "[Na+].[O-]C(=O)c1ccccc1"
+};
+
+// Names of the bit array implementations, by BIT_IMPL_* of base_c/bitarray.h
+static const char *bench_bit_implementations[] = {"portable", "popcnt", "avx2", "avx512"};
+
+static double benchNow ()
+{
+    struct timespec ts;
+
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// SMILES of 2 to 9 random fragments, the molecules follow srand()
+static void benchRandomSmiles (char *smiles)
+{
+    int j, n = 2 + rand() % 8;
+
+    smiles[0] = 0;
+    for (j = 0; j < n; j++)
+        strcat(smiles, bench_fragments[rand() % COUNT(bench_fragments)]);
+}
+
+#endif
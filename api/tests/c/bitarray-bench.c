@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "base_c/bitarray.h"
+#include "bench-fixtures.h"
+
+// Timing of the bit counting functions with every implementation the CPU
+// supports, on the fingerprint sizes. The results are checked against the
+// portable implementation.
+// Usage: bitarray-bench [calls per function]
+
+#define PAIRS 256
+#define SUBSETS 16
+#define MAX_BYTES 1024
+
+static const int sizes[] = {64, 128, 512, 1024};
+enum
+{
+    F_ONES_COUNT,
+    F_COMMON_ONES,
+    F_UNIQUE_ONES,
+    F_DIFFERENT_ONES,
+    F_UNION_ONES,
+    F_IDENTICAL_BITS,
+    F_COMMON_ONES_WITH_COUNTS,
+    F_TEST_ONES,
+    F_TEST_ONES_ARRAY,
+    F_COMMON_ONES_ARRAY,
+    F_COMMON_ONES_INDICES,
+    F_COUNT
+};
+
+static const char *functions[] =
+{
+    "bitGetOnesCount", "bitCommonOnes", "bitUniqueOnes", "bitDifferentOnes", "bitUnionOnes",
+    "bitIdecticalBits", "bitCommonOnesWithCounts", "bitTestOnes", "bitTestOnesArray",
+    "bitCommonOnesArray", "bitCommonOnesIndices"
+};
+
+static byte fps[PAIRS][MAX_BYTES];
+static byte patterns[PAIRS][MAX_BYTES];
+static int passed[PAIRS];
+static int indices[MAX_BYTES * 8];
+
+// Fingerprints with about a quarter of the bits set, the patterns are
+// subsets of every SUBSETS-th fingerprint, the other ones fail in the
+// middle of the array
+static void fill ()
+{
+    int i, j;
+
+    srand(12345);
+    for (i = 0; i < PAIRS; i++)
+        for (j = 0; j < MAX_BYTES; j++)
+        {
+            fps[i][j] = (byte)(rand() & rand());
+            patterns[i][j] = (byte)(fps[i][j] & rand() & rand());
+        }
+    for (i = 0; i < PAIRS; i++)
+        if (i % SUBSETS != 0)
+            patterns[i][MAX_BYTES / 2 - 1] |= (byte)~fps[i][MAX_BYTES / 2 - 1];
+}
+
+// Common ones of the pair by their indices
+static long indicesSum (const byte *a, const byte *b, int n_bytes)
+{
+    const byte *arrays[2];
+    long sum;
+    int k, n;
+
+    arrays[0] = a;
+    arrays[1] = b;
+    n = bitCommonOnesIndices(arrays, 2, n_bytes, indices);
+    for (sum = n, k = 0; k < n; k++)
+        sum += (long)indices[k] * (k + 1);
+    return sum;
+}
+
+// Calls the function for all the pairs and returns the sum of the results
+static long call (int f, int n_bytes, int pair_offset)
+{
+    long sum = 0;
+    int i;
+
+    for (i = 0; i < PAIRS; i++)
+    {
+        const byte *a = fps[i];
+        const byte *b = fps[(i + pair_offset) % PAIRS];
+        int ones1, ones2;
+
+        switch (f)
+        {
+        case F_ONES_COUNT:      sum += bitGetOnesCount(a, n_bytes); break;
+        case F_COMMON_ONES:     sum += bitCommonOnes(a, b, n_bytes); break;
+        case F_UNIQUE_ONES:     sum += bitUniqueOnes(a, b, n_bytes); break;
+        case F_DIFFERENT_ONES:  sum += bitDifferentOnes(a, b, n_bytes); break;
+        case F_UNION_ONES:      sum += bitUnionOnes(a, b, n_bytes); break;
+        case F_IDENTICAL_BITS:  sum += bitIdecticalBits(a, b, n_bytes); break;
+        case F_COMMON_ONES_WITH_COUNTS:
+            sum += bitCommonOnesWithCounts(a, b, n_bytes, &ones1, &ones2);
+            sum += ones1 * 3 + ones2 * 7;
+            break;
+        case F_TEST_ONES:
+            sum += bitTestOnes(patterns[i], a, n_bytes) * (i + 1);
+            break;
+        case F_TEST_ONES_ARRAY:
+            // The candidates are the rows of a MAX_BYTES-wide table, so the
+            // test is over the whole row width
+            if (i == 0)
+            {
+                int k, n = bitTestOnesArray(patterns[pair_offset % PAIRS], fps[0], MAX_BYTES, PAIRS, passed);
+
+                for (k = 0; k < n; k++)
+                    sum += passed[k] + 1;
+            }
+            break;
+        case F_COMMON_ONES_ARRAY:
+            // The rows are n_bytes wide here
+            if (i == 0)
+            {
+                int k;
+
+                bitCommonOnesArray(fps[pair_offset % PAIRS], fps[0], n_bytes, PAIRS, passed);
+                for (k = 0; k < PAIRS; k++)
+                    sum += passed[k] * (k + 1);
+            }
+            break;
+        case F_COMMON_ONES_INDICES:
+        {
+            // Like the columns of the fingerprint screening: a few of them
+            // leave almost no bits
+            const byte *arrays[8];
+            int k, n;
+
+            for (k = 0; k < 8; k++)
+                arrays[k] = fps[(i + pair_offset * k) % PAIRS];
+            n = bitCommonOnesIndices(arrays, 8, n_bytes, indices);
+            for (k = 0; k < n; k++)
+                sum += indices[k] * (k + 1);
+            break;
+        }
+        }
+    }
+    return sum;
+}
+
+int main (int argc, char **argv)
+{
+    int calls = (argc > 1) ? atoi(argv[1]) : 2000;
+    long reference[F_COUNT][COUNT(sizes)];
+    double portable[F_COUNT][COUNT(sizes)];
+    int impl, f, s, r, failed = 0;
+
+    fill();
+
+    for (impl = BIT_IMPL_PORTABLE; impl <= BIT_IMPL_AVX512; impl++)
+    {
+        if (!bitSetImplementation(impl))
+        {
+            printf("%s: not supported\n", bench_bit_implementations[impl]);
+            continue;
+        }
+        printf("%s\n", bench_bit_implementations[impl]);
+
+        for (f = 0; f < F_COUNT; f++)
+        {
+            printf("  %-24s", functions[f]);
+            for (s = 0; s < COUNT(sizes); s++)
+            {
+                long sum = 0;
+                double start = benchNow(), ns;
+
+                for (r = 0; r < calls; r++)
+                    sum += call(f, sizes[s], r + 1);
+                ns = (benchNow() - start) * 1e9 / ((double)calls * PAIRS);
+
+                if (impl == BIT_IMPL_PORTABLE)
+                {
+                    reference[f][s] = sum;
+                    portable[f][s] = ns;
+                    printf(" %4d B %7.1f ns", sizes[s], ns);
+                }
+                else
+                {
+                    printf(" %4d B %7.1f ns x%4.1f", sizes[s], ns, portable[f][s] / ns);
+                    if (sum != reference[f][s])
+                    {
+                        printf(" MISMATCH");
+                        failed = 1;
+                    }
+                }
+            }
+            printf("\n");
+        }
+    }
+
+    // Odd sizes and offsets for the tails
+    for (impl = BIT_IMPL_PORTABLE; impl <= BIT_IMPL_AVX512; impl++)
+    {
+        int n_bytes, offset, mismatches = 0;
+
+        for (n_bytes = 0; n_bytes <= 200; n_bytes++)
+            for (offset = 0; offset < 8; offset++)
+            {
+                const byte *a = fps[1] + offset, *b = fps[2] + 8 - offset;
+                long c[F_COUNT];
+                int ones1, ones2;
+
+                bitSetImplementation(BIT_IMPL_PORTABLE);
+                c[0] = bitGetOnesCount(a, n_bytes);
+                c[1] = bitCommonOnes(a, b, n_bytes);
+                c[2] = bitUniqueOnes(a, b, n_bytes);
+                c[3] = bitDifferentOnes(a, b, n_bytes);
+                c[4] = bitUnionOnes(a, b, n_bytes);
+                c[5] = bitIdecticalBits(a, b, n_bytes);
+                c[6] = bitCommonOnesWithCounts(a, b, n_bytes, &ones1, &ones2) + ones1 * 3 + ones2 * 7;
+                c[7] = bitTestOnes(patterns[1] + offset, a, n_bytes);
+                c[8] = indicesSum(a, b, n_bytes);
+
+                if (!bitSetImplementation(impl))
+                    continue;
+                if (c[0] != bitGetOnesCount(a, n_bytes) ||
+                    c[1] != bitCommonOnes(a, b, n_bytes) ||
+                    c[2] != bitUniqueOnes(a, b, n_bytes) ||
+                    c[3] != bitDifferentOnes(a, b, n_bytes) ||
+                    c[4] != bitUnionOnes(a, b, n_bytes) ||
+                    c[5] != bitIdecticalBits(a, b, n_bytes) ||
+                    c[6] != bitCommonOnesWithCounts(a, b, n_bytes, &ones1, &ones2) + ones1 * 3 + ones2 * 7 ||
+                    c[7] != bitTestOnes(patterns[1] + offset, a, n_bytes) ||
+                    c[8] != indicesSum(a, b, n_bytes))
+                {
+                    if (mismatches++ == 0)
+                        printf("%s: mismatch at %d bytes, offset %d\n", bench_bit_implementations[impl], n_bytes, offset);
+                    failed = 1;
+                }
+            }
+    }
+
+    return failed;
+}
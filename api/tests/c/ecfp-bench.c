@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "indigo.h"
+#include "bench-fixtures.h"
+
+// Molecules per second for the ECFP fingerprints of every radius, and a
+// checksum of the fingerprints to compare the builds.
+// Usage: ecfp-bench [rounds] [file with SMILES]
+
+static const char *types[] = { "ECFP2", "ECFP4", "ECFP6", "ECFP8" };
+
+void onError (const char *message, void *context)
+{
+    fprintf(stderr, "Error: %s\n", message);
+    exit(-1);
+}
+
+int main (int argc, char **argv)
+{
+    int rounds = (argc > 1) ? atoi(argv[1]) : 200;
+    int *mols;
+    int n_mols = 0, max_mols = 1024;
+    int i, r, t;
+
+    indigoSetErrorHandler(onError, 0);
+
+    mols = (int *)malloc(max_mols * sizeof(int));
+    if (argc > 2)
+    {
+        int iter = indigoIterateSmilesFile(argv[2]), item;
+
+        while ((item = indigoNext(iter)) != 0)
+        {
+            if (n_mols == max_mols)
+            {
+                max_mols *= 2;
+                mols = (int *)realloc(mols, max_mols * sizeof(int));
+            }
+            mols[n_mols] = indigoClone(item);
+            indigoFree(item);
+            n_mols++;
+        }
+        indigoFree(iter);
+    }
+    else
+    {
+        for (i = 0; i < COUNT(bench_targets); i++)
+            mols[n_mols++] = indigoLoadMoleculeFromString(bench_targets[i]);
+    }
+
+    for (t = 0; t < COUNT(types); t++)
+    {
+        unsigned long long checksum = 14695981039346656037ULL;
+        clock_t start;
+        double seconds;
+
+        indigoSetOption("similarity-type", types[t]);
+
+        start = clock();
+        for (r = 0; r < rounds; r++)
+        {
+            for (i = 0; i < n_mols; i++)
+            {
+                int fp = indigoFingerprint(mols[i], "sim");
+
+                if (r == 0)
+                {
+                    char *buf;
+                    int size, k;
+
+                    indigoToBuffer(fp, &buf, &size);
+                    for (k = 0; k < size; k++)
+                    {
+                        checksum ^= (unsigned char)buf[k];
+                        checksum *= 1099511628211ULL;
+                    }
+                }
+                indigoFree(fp);
+            }
+        }
+        seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        printf("%s: %d molecules x %d rounds, %.3f s, %.0f molecules/s, checksum %016llx\n",
+               types[t], n_mols, rounds, seconds, (double)n_mols * rounds / seconds, checksum);
+    }
+
+    for (i = 0; i < n_mols; i++)
+        indigoFree(mols[i]);
+    free(mols);
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "indigo.h"
+#include "bench-fixtures.h"
+
+// Time of the graph algorithms that walk the neighbors of the atoms: the
+// subgraph and cycle enumeration of the fingerprints, the substructure
+// search, the SSSR and the aromatization of fresh copies of the molecules.
+// The checksums of the results are printed to compare the builds.
+// Usage: graph-bench [rounds] [file with SMILES]
+
+static const char *queries[] =
+{
+    "c1ccccc1",
+    "C(=O)[OH]",
+    "[#6]~[#7]",
+    "[R2]",
+    "*~*~*~*",
+    "[#6;R]@[#6;R]@[#6;R]",
+    "C-N-C=O",
+    "[!#1]1~[!#1]~[!#1]~[!#1]~[!#1]~[!#1]~1"
+};
+
+static unsigned long long checksum;
+
+void onError (const char *message, void *context)
+{
+    fprintf(stderr, "Error: %s\n", message);
+    exit(-1);
+}
+
+static void hash (unsigned long long value)
+{
+    int k;
+
+    for (k = 0; k < 8; k++)
+    {
+        checksum ^= (value >> (k * 8)) & 0xFF;
+        checksum *= 1099511628211ULL;
+    }
+}
+
+static void hashFingerprint (int fp)
+{
+    char *buf;
+    int size, k;
+
+    indigoToBuffer(fp, &buf, &size);
+    for (k = 0; k < size; k++)
+    {
+        checksum ^= (unsigned char)buf[k];
+        checksum *= 1099511628211ULL;
+    }
+}
+
+static void report (const char *name, int count, int rounds, clock_t start)
+{
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("%-14s %d x %d rounds, %.3f s, %.0f per second, checksum %016llx\n",
+           name, count, rounds, seconds, (double)count * rounds / seconds, checksum);
+}
+
+int main (int argc, char **argv)
+{
+    int rounds = (argc > 1) ? atoi(argv[1]) : 100;
+    int *mols, qmols[COUNT(queries)];
+    int n_mols = 0, max_mols = 1024;
+    int i, j, r;
+    clock_t start;
+
+    indigoSetErrorHandler(onError, 0);
+
+    mols = (int *)malloc(max_mols * sizeof(int));
+    if (argc > 2)
+    {
+        int iter = indigoIterateSmilesFile(argv[2]), item;
+
+        while ((item = indigoNext(iter)) != 0)
+        {
+            if (n_mols == max_mols)
+            {
+                max_mols *= 2;
+                mols = (int *)realloc(mols, max_mols * sizeof(int));
+            }
+            mols[n_mols] = indigoClone(item);
+            indigoFree(item);
+            n_mols++;
+        }
+        indigoFree(iter);
+    }
+    else
+    {
+        for (i = 0; i < COUNT(bench_targets); i++)
+            mols[n_mols++] = indigoLoadMoleculeFromString(bench_targets[i]);
+    }
+
+    for (i = 0; i < COUNT(queries); i++)
+        qmols[i] = indigoLoadSmartsFromString(queries[i]);
+
+    // Subtrees and cycles of the "sim" fingerprints
+    indigoSetOption("similarity-type", "sim");
+    checksum = 14695981039346656037ULL;
+    start = clock();
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < n_mols; i++)
+        {
+            int fp = indigoFingerprint(mols[i], "sim");
+
+            if (r == 0)
+                hashFingerprint(fp);
+            indigoFree(fp);
+        }
+    report("sim fp", n_mols, rounds, start);
+
+    // The same with the larger subtrees and cycles of the "sub" ones
+    checksum = 14695981039346656037ULL;
+    start = clock();
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < n_mols; i++)
+        {
+            int fp = indigoFingerprint(mols[i], "sub");
+
+            if (r == 0)
+                hashFingerprint(fp);
+            indigoFree(fp);
+        }
+    report("sub fp", n_mols, rounds, start);
+
+    // All of the embeddings of every query
+    checksum = 14695981039346656037ULL;
+    start = clock();
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < n_mols; i++)
+        {
+            int matcher = indigoSubstructureMatcher(mols[i], "");
+
+            for (j = 0; j < COUNT(queries); j++)
+            {
+                int count = indigoCountMatchesWithLimit(matcher, qmols[j], 1000);
+
+                if (r == 0)
+                    hash(count);
+            }
+            indigoFree(matcher);
+        }
+    report("substructure", n_mols * COUNT(queries), rounds, start);
+
+    // SSSR of the copies, the molecules keep it once found
+    checksum = 14695981039346656037ULL;
+    start = clock();
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < n_mols; i++)
+        {
+            int copy = indigoClone(mols[i]);
+            int count = indigoCountSSSR(copy);
+
+            if (r == 0)
+                hash(count);
+            indigoFree(copy);
+        }
+    report("sssr", n_mols, rounds, start);
+
+    // Aromatization of the Kekule structures, it enumerates the cycles
+    checksum = 14695981039346656037ULL;
+    for (i = 0; i < n_mols; i++)
+        indigoDearomatize(mols[i]);
+    start = clock();
+    for (r = 0; r < rounds; r++)
+        for (i = 0; i < n_mols; i++)
+        {
+            int copy = indigoClone(mols[i]);
+
+            indigoAromatize(copy);
+            if (r == 0)
+            {
+                const char *smiles = indigoCanonicalSmiles(copy);
+
+                while (*smiles)
+                    hash(*smiles++);
+            }
+            indigoFree(copy);
+        }
+    report("aromatize", n_mols, rounds, start);
+
+    for (i = 0; i < COUNT(queries); i++)
+        indigoFree(qmols[i]);
+    for (i = 0; i < n_mols; i++)
+        indigoFree(mols[i]);
+    free(mols);
+    return 0;
+}
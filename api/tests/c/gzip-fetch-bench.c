@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "zlib.h"
+#include "indigo.h"
+#include "bench-fixtures.h"
+
+// Latency of the random record fetch (indigoAt + indigoRawData) from an
+// SDF iterator on a gzipped file, for the different checkpoint spans and
+// with the checkpoint index file reused ("gzip-index" option). Without a
+// file an SDF with generated molecules is written and gzipped to the
+// current directory, and the fetched records are checked against it.
+// Usage: gzip-fetch-bench [file.sdf.gz] [fetches]
+
+typedef struct
+{
+    const char *title;
+    int span_mb;
+    int index;
+} Setup;
+
+// The last setup reads the index written by the previous one
+static const Setup setups[] =
+{
+    {"span 1 MB", 1, 0},
+    {"span 4 MB", 4, 0},
+    {"span 16 MB", 16, 0},
+    {"span 4 MB, new index", 4, 1},
+    {"span 4 MB, saved index", 4, 1}
+};
+
+void onError (const char *message, void *context)
+{
+    fprintf(stderr, "Error: %s\n", message);
+    exit(-1);
+}
+
+static int doubleCmp (const void *a, const void *b)
+{
+    double d1 = *(const double *)a, d2 = *(const double *)b;
+
+    return (d1 < d2) ? -1 : (d1 > d2);
+}
+
+static void generate (const char *filename, const char *gz_filename, int records)
+{
+    int saver = indigoWriteFile(filename), i, n;
+    char buf[65536];
+    FILE *in;
+    gzFile out;
+
+    srand(12345);
+    for (i = 0; i < records; i++)
+    {
+        char smiles[1024];
+        int mol;
+
+        benchRandomSmiles(smiles);
+        mol = indigoLoadMoleculeFromString(smiles);
+        indigoSetProperty(mol, "index", smiles);
+        indigoSdfAppend(saver, mol);
+        indigoFree(mol);
+    }
+    indigoClose(saver);
+    indigoFree(saver);
+
+    in = fopen(filename, "rb");
+    out = gzopen(gz_filename, "wb");
+    while ((n = (int)fread(buf, 1, sizeof(buf), in)) > 0)
+        gzwrite(out, buf, n);
+    gzclose(out);
+    fclose(in);
+}
+
+int main (int argc, char **argv)
+{
+    const char *filename = "gzip-fetch-bench.sdf";
+    const char *gz_filename = (argc > 1) ? argv[1] : "gzip-fetch-bench.sdf.gz";
+    int fetches = (argc > 2) ? atoi(argv[2]) : 200;
+    int plain_iter = 0, s, i;
+    double *latencies = (double *)malloc(fetches * sizeof(double));
+    char index_filename[1024];
+
+    indigoSetErrorHandler(onError, 0);
+
+    if (argc <= 1)
+    {
+        generate(filename, gz_filename, 100000);
+        plain_iter = indigoIterateSDFile(filename);
+        indigoCount(plain_iter);
+    }
+
+    snprintf(index_filename, sizeof(index_filename), "%s.gzidx", gz_filename);
+    remove(index_filename);
+
+    printf("%d random fetches, ms\n", fetches);
+    printf("%-24s %10s %8s %8s %8s %8s %10s\n", "", "count, s", "avg", "median", "p99", "max", "mismatches");
+
+    for (s = 0; s < COUNT(setups); s++)
+    {
+        char span[32];
+        int iter, count, mismatches = 0;
+        double start, count_seconds, sum = 0;
+
+        snprintf(span, sizeof(span), "%d", setups[s].span_mb * 1048576);
+        indigoSetOption("gzip-checkpoint-span", span);
+        indigoSetOption("gzip-index", setups[s].index ? "true" : "false");
+
+        start = benchNow();
+        iter = indigoIterateSDFile(gz_filename);
+        count = indigoCount(iter);
+        count_seconds = benchNow() - start;
+
+        srand(54321);
+        for (i = 0; i < fetches; i++)
+        {
+            int idx = (int)(((double)rand() / ((double)RAND_MAX + 1)) * count);
+            int item;
+            const char *data;
+
+            start = benchNow();
+            item = indigoAt(iter, idx);
+            data = indigoRawData(item);
+            latencies[i] = (benchNow() - start) * 1000;
+            sum += latencies[i];
+
+            if (plain_iter != 0)
+            {
+                int plain_item = indigoAt(plain_iter, idx);
+
+                mismatches += (strcmp(data, indigoRawData(plain_item)) != 0);
+                indigoFree(plain_item);
+            }
+            indigoFree(item);
+        }
+        // The index is saved when the iterator is closed
+        indigoFree(iter);
+
+        qsort(latencies, fetches, sizeof(double), doubleCmp);
+        printf("%-24s %10.2f %8.2f %8.2f %8.2f %8.2f %10d\n", setups[s].title, count_seconds, sum / fetches,
+               latencies[fetches / 2], latencies[fetches * 99 / 100], latencies[fetches - 1], mismatches);
+    }
+
+    if (plain_iter != 0)
+        indigoFree(plain_iter);
+    free(latencies);
+    return 0;
+}
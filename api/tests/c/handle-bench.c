@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "indigo.h"
+#include "bench-fixtures.h"
+
+// C API calls per second on the object handles: atoms are iterated and each
+// of them is indexed and freed, with a number of other handles kept alive.
+// Every handle issued is also checked to differ from the ones issued before,
+// so a stale handle can't resolve to a new object.
+// Usage: handle-bench [rounds]
+
+static const int live_counts[] = {1, 1000, 100000, 1000000};
+
+#define ISSUED_BITS 24
+#define ISSUED_SIZE (1 << ISSUED_BITS)
+
+static int issued[ISSUED_SIZE];
+static int issued_count, reissued_count;
+
+void onError (const char *message, void *context)
+{
+    fprintf(stderr, "Error: %s\n", message);
+    exit(-1);
+}
+
+// Remembers the handle in the open addressing set, until it is half full
+static void checkIssued (int handle)
+{
+    unsigned int i = ((unsigned int)handle * 2654435761u) >> (32 - ISSUED_BITS);
+
+    if (issued_count >= ISSUED_SIZE / 2)
+        return;
+
+    while (issued[i] != 0)
+    {
+        if (issued[i] == handle)
+        {
+            reissued_count++;
+            return;
+        }
+        i = (i + 1) & (ISSUED_SIZE - 1);
+    }
+    issued[i] = handle;
+    issued_count++;
+}
+
+int main (int argc, char **argv)
+{
+    int rounds = (argc > 1) ? atoi(argv[1]) : 20000;
+    int mol, *live, i, k, r, n_atoms;
+    double total_calls = 0, total_seconds = 0;
+
+    indigoSetErrorHandler(onError, 0);
+
+    mol = indigoLoadMoleculeFromString("CC(C)Cc1ccc(cc1)C(C)C(=O)O");
+    n_atoms = indigoCountAtoms(mol);
+    live = (int *)malloc(live_counts[COUNT(live_counts) - 1] * sizeof(int));
+
+    printf("%-12s %12s %12s\n", "live", "calls", "Mcalls/s");
+    for (k = 0; k < COUNT(live_counts); k++)
+    {
+        double calls = 0, start, seconds;
+        int checksum = 0;
+
+        for (i = 0; i < live_counts[k]; i++)
+            live[i] = indigoIterateAtoms(mol);
+
+        start = benchNow();
+        for (r = 0; r < rounds; r++)
+        {
+            int iter = indigoIterateAtoms(mol), atom;
+
+            while ((atom = indigoNext(iter)) != 0)
+            {
+                checkIssued(atom);
+                checksum += indigoIndex(atom);
+                indigoFree(atom);
+                calls += 3;
+            }
+            indigoFree(iter);
+            calls += 3;
+        }
+        seconds = benchNow() - start;
+
+        for (i = 0; i < live_counts[k]; i++)
+            indigoFree(live[i]);
+
+        printf("%-12d %12.0f %12.2f\n", live_counts[k], calls, calls / seconds * 1e-6);
+        total_calls += calls;
+        total_seconds += seconds;
+
+        if (checksum != rounds * n_atoms * (n_atoms - 1) / 2)
+        {
+            printf("wrong atom indices\n");
+            return 1;
+        }
+    }
+    printf("%-12s %12.0f %12.2f\n", "total", total_calls, total_calls / total_seconds * 1e-6);
+    printf("%d handles checked, %d issued again\n", issued_count, reissued_count);
+
+    indigoFree(mol);
+    free(live);
+    return reissued_count != 0;
+}
@@ -2,8 +2,17 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "zlib.h"
 #include "indigo.h"
 
+#define COUNT(arr) (int)(sizeof(arr) / sizeof(arr[0]))
+
+static const char *test_smiles[] =
+{
+    "O=Cc1ccccc1NC", "OC(=O)C1CCNCC1", "ClCCOC1=CC=NC=C1", "C#CC1CC1N", "FC(F)(F)c1ccc2ccccc2c1",
+    "CC(C)(C)OC(=O)N", "Brc1ccoc1", "NC(=O)C=CC(=O)O", "S=C(N)Nc1ccccc1", "CCCCCCCCCCC"
+};
+
 void onError (const char *message, void *context)
 {
     fprintf(stderr, "Error: %s\n", message);
@@ -24,6 +33,235 @@ void testTransform ()
     indigoFree(transformation);
 }
 
+static void fail (const char *test, const char *message)
+{
+    printf("%s: %s\n", test, message);
+    exit(-1);
+}
+
+// Writes an SDF with the index of every record in the "index" property
+static void writeSdf (const char *filename, int records)
+{
+    int saver = indigoWriteFile(filename), i;
+
+    for (i = 0; i < records; i++)
+    {
+        int mol = indigoLoadMoleculeFromString(test_smiles[i % COUNT(test_smiles)]);
+        char index[16];
+
+        snprintf(index, sizeof(index), "%d", i);
+        indigoSetProperty(mol, "index", index);
+        indigoSdfAppend(saver, mol);
+        indigoFree(mol);
+    }
+    indigoClose(saver);
+    indigoFree(saver);
+}
+
+// Checks the random access to the records of an SDF iterator
+static void checkRecords (const char *test, int iter, int records)
+{
+    int i;
+
+    if (indigoCount(iter) != records)
+        fail(test, "wrong number of records");
+
+    for (i = 0; i < records; i += 37)
+    {
+        int idx = records - 1 - i;
+        int item = indigoAt(iter, idx);
+
+        if (atoi(indigoGetProperty(item, "index")) != idx)
+            fail(test, "wrong record");
+        indigoFree(item);
+    }
+}
+
+void testRecordIndex ()
+{
+    const char *filename = "indigo-test-index.sdf";
+    const char *index_filename = "indigo-test-index.sdf.idx";
+    int iter;
+    FILE *index;
+
+    writeSdf(filename, 1000);
+    remove(index_filename);
+    indigoSetOption("record-index", "true");
+
+    // The first count writes the index and the next iterator reads it
+    iter = indigoIterateSDFile(filename);
+    checkRecords("Record index", iter, 1000);
+    indigoFree(iter);
+
+    index = fopen(index_filename, "rb");
+    if (index == 0)
+        fail("Record index", "the index file is not written");
+    fclose(index);
+
+    iter = indigoIterateSDFile(filename);
+    checkRecords("Record index", iter, 1000);
+    indigoFree(iter);
+
+    indigoSetOption("record-index", "false");
+    remove(index_filename);
+    remove(filename);
+}
+
+void testGZipSeek ()
+{
+    const char *filename = "indigo-test-gzip.sdf";
+    const char *gz_filename = "indigo-test-gzip.sdf.gz";
+    const char *index_filename = "indigo-test-gzip.sdf.gz.gzidx";
+    char buf[65536];
+    int iter, pass, n;
+    FILE *in;
+    gzFile out;
+
+    writeSdf(filename, 2000);
+    in = fopen(filename, "rb");
+    out = gzopen(gz_filename, "wb");
+    while ((n = (int)fread(buf, 1, sizeof(buf), in)) > 0)
+        gzwrite(out, buf, n);
+    gzclose(out);
+    fclose(in);
+    remove(index_filename);
+
+    // The smallest checkpoint span, the second pass reads the saved checkpoints
+    indigoSetOption("gzip-checkpoint-span", "1");
+    indigoSetOption("gzip-index", "true");
+    for (pass = 0; pass < 2; pass++)
+    {
+        iter = indigoIterateSDFile(gz_filename);
+        checkRecords("GZip seek", iter, 2000);
+        indigoFree(iter);
+    }
+    indigoSetOption("gzip-index", "false");
+    indigoSetOptionInt("gzip-checkpoint-span", 16777216);
+
+    remove(index_filename);
+    remove(gz_filename);
+    remove(filename);
+}
+
+void testQuerySet ()
+{
+    static const char *queries[] = {"c1ccccc1", "CN", "Cl", "C=O", "C#C", "c1ccncc1"};
+    int query_set = indigoCreateQuerySet();
+    int i, j;
+
+    for (i = 0; i < COUNT(queries); i++)
+    {
+        int query = indigoLoadQueryMoleculeFromString(queries[i]);
+
+        if (indigoQuerySetAdd(query_set, query) != i)
+            fail("Query set", "wrong query index");
+        indigoFree(query);
+    }
+
+    // The matches must be the ones of the substructure matcher
+    for (i = 0; i < COUNT(test_smiles); i++)
+    {
+        int target = indigoLoadMoleculeFromString(test_smiles[i]);
+        int matcher = indigoSubstructureMatcher(target, "");
+        int count, k = 0;
+        const int *matched = indigoQuerySetMatch(query_set, target, &count);
+
+        for (j = 0; j < COUNT(queries); j++)
+        {
+            int query = indigoLoadQueryMoleculeFromString(queries[j]);
+            int match = indigoMatch(matcher, query);
+
+            if (match != 0)
+            {
+                if (k >= count || matched[k] != j)
+                    fail("Query set", test_smiles[i]);
+                k++;
+                indigoFree(match);
+            }
+            indigoFree(query);
+        }
+        if (k != count)
+            fail("Query set", test_smiles[i]);
+        indigoFree(matcher);
+        indigoFree(target);
+    }
+    indigoFree(query_set);
+}
+
+void testLayoutBatch ()
+{
+    int arr = indigoCreateArray();
+    int i;
+    const char *result;
+
+    for (i = 0; i < COUNT(test_smiles); i++)
+    {
+        int mol = indigoLoadMoleculeFromString(test_smiles[i]);
+
+        indigoArrayAdd(arr, mol);
+        indigoFree(mol);
+    }
+
+    result = indigoLayoutBatch(arr, 2, 0);
+    if (strstr(result, "\"error\"") != 0)
+        fail("Layout batch", result);
+
+    for (i = 0; i < COUNT(test_smiles); i++)
+    {
+        int mol = indigoAt(arr, i);
+
+        if (!indigoHasCoord(mol))
+            fail("Layout batch", test_smiles[i]);
+        indigoFree(mol);
+    }
+    indigoFree(arr);
+}
+
+void testSparseFingerprint ()
+{
+    int arr = indigoCreateArray();
+    int i, fps, rows, nnz, qwords;
+    const int *indptr, *counts;
+    const unsigned int *hashes;
+
+    indigoGetOptionInt("fp-sim-qwords", &qwords);
+    indigoSetOption("similarity-type", "ecfp4");
+    for (i = 0; i < COUNT(test_smiles); i++)
+    {
+        int mol = indigoLoadMoleculeFromString(test_smiles[i]);
+        int sparse = indigoSparseFingerprint(mol, "ecfp4");
+        int fp = indigoFingerprint(mol, "sim");
+        int folded = indigoFoldFingerprint(sparse, qwords * 64);
+
+        // The folded fingerprint has the bits of the ECFP4 similarity one
+        if (strcmp(indigoToString(folded), indigoToString(fp)) != 0)
+            fail("Sparse fingerprint", test_smiles[i]);
+        if (indigoSimilarity(sparse, sparse, "tanimoto") != 1)
+            fail("Sparse fingerprint", test_smiles[i]);
+
+        indigoArrayAdd(arr, mol);
+        indigoFree(folded);
+        indigoFree(fp);
+        indigoFree(sparse);
+        indigoFree(mol);
+    }
+    indigoSetOption("similarity-type", "sim");
+
+    fps = indigoSparseFingerprints(arr, "ecfp4");
+    indigoSparseFingerprintsCSR(fps, &rows, &nnz, &indptr, &hashes, &counts);
+    if (rows != COUNT(test_smiles) || indptr[0] != 0 || indptr[rows] != nnz)
+        fail("Sparse fingerprints", "wrong CSR layout");
+    for (i = 0; i < rows; i++)
+        if (indptr[i + 1] <= indptr[i])
+            fail("Sparse fingerprints", test_smiles[i]);
+    for (i = 0; i < nnz; i++)
+        if (counts[i] <= 0)
+            fail("Sparse fingerprints", "wrong count");
+
+    indigoFree(fps);
+    indigoFree(arr);
+}
+
 int main (void)
 {
     int m;
@@ -53,6 +291,11 @@ int main (void)
     indigoFree(m);
 
     testTransform();
+    testRecordIndex();
+    testGZipSeek();
+    testQuerySet();
+    testLayoutBatch();
+    testSparseFingerprint();
 
     r = indigoLoadReactionFromString("C.CC>>CC.C");
     gf = indigoGrossFormula(r);
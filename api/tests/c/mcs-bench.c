@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "indigo.h"
+#include "bench-fixtures.h"
+
+// Exact maximum common substructure of molecule pairs with the different
+// settings of the search: in the calling thread, keeping only the largest
+// common substructures, in several threads and with a time limit.
+// Usage: mcs-bench [threads] [timeout ms]
+
+static const char *pairs[][2] =
+{
+    {"CC(=O)Oc1ccccc1C(=O)O", "OC(=O)c1ccccc1O"},
+    {"CN1C=NC2=C1C(=O)N(C(=O)N2C)C", "CN1C(=O)N(C)c2[nH]cnc2C1=O"},
+    {"CC(C)Cc1ccc(cc1)C(C)C(=O)O", "COc1ccc2cc(ccc2c1)C(C)C(=O)O"},
+    {"CN1CCC23C4C1CC5=C2C(=C(C=C5)O)OC3C(C=C4)O", "COc1ccc2CC3N(C)CCC45C(Oc1c24)C(=O)CCC35O"},
+    {"CN(C)CCCN1c2ccccc2CCc2ccccc21", "CN(C)CCC=C1c2ccccc2CCc2ccccc12"},
+    {"CC12CCC3C(CCC4=CC(=O)CCC34C)C1CCC2O", "CC12CCC3c4ccc(O)cc4CCC3C1CCC2O"},
+    {"CC(C)NCC(O)COc1cccc2ccccc12", "CC(C)NCC(O)COc1ccc(CC(N)=O)cc1"},
+    {"CC1=C(C(=O)OC)C(c2cccc(c2)[N+](=O)[O-])C(C(=O)OC)=C(C)N1", "CCOC(=O)C1=C(COCCN)NC(C)=C(C(=O)OC)C1c1ccccc1Cl"},
+    {"CC(C)c1c(C(=O)Nc2ccccc2)c(-c2ccccc2)c(-c2ccc(F)cc2)n1CCC(O)CC(O)CC(=O)O",
+     "CC(C)c1nc(N(C)S(C)(=O)=O)nc(-c2ccc(F)cc2)c1C=CC(O)CC(O)CC(=O)O"},
+    {"CC1(C)SC2C(NC(=O)Cc3ccccc3)C(=O)N2C1C(=O)O", "CC1(C)SC2C(NC(=O)C(N)c3ccccc3)C(=O)N2C1C(=O)O"},
+    {"CCN(CC)C(=O)C1CN(C)C2CC3=CNC4=CC=CC(=C34)C2=C1", "CN1CC(C=C2C1CC1=CNC3=CC=CC2=C13)C(=O)NC(C)CO"},
+    {"Clc1ccc(cc1)C(c1ccccc1)N1CCN(CC1)CCOCC(=O)O", "Cc1cccc(CN2CCN(CC2)C(c2ccccc2)c2ccc(Cl)cc2)c1"}
+};
+
+struct Settings
+{
+    const char *name;
+    int threads;
+    int timeout;
+    int maximum_only;
+};
+
+void onError (const char *message, void *context)
+{
+    fprintf(stderr, "Error: %s\n", message);
+    exit(-1);
+}
+
+// Runs the search for all the pairs, writes the number of bonds in the
+// largest common substructure of each pair
+static double run (const struct Settings *settings, int *bonds)
+{
+    double start, total = 0;
+    int i;
+
+    indigoSetOptionInt("mcs-threads", settings->threads);
+    indigoSetOptionInt("mcs-timeout", settings->timeout);
+    indigoSetOptionBool("mcs-maximum-only", settings->maximum_only);
+
+    for (i = 0; i < COUNT(pairs); i++)
+    {
+        int arr = indigoCreateArray();
+        int m1 = indigoLoadMoleculeFromString(pairs[i][0]);
+        int m2 = indigoLoadMoleculeFromString(pairs[i][1]);
+        int scaffold;
+
+        indigoArrayAdd(arr, m1);
+        indigoArrayAdd(arr, m2);
+
+        start = benchNow();
+        scaffold = indigoExtractCommonScaffold(arr, "exact");
+        total += benchNow() - start;
+
+        bonds[i] = indigoCountBonds(scaffold);
+
+        indigoFree(scaffold);
+        indigoFree(m1);
+        indigoFree(m2);
+        indigoFree(arr);
+    }
+    return total;
+}
+
+int main (int argc, char **argv)
+{
+    int threads = (argc > 1) ? atoi(argv[1]) : 4;
+    int timeout = (argc > 2) ? atoi(argv[2]) : 5;
+    int reference[COUNT(pairs)], bonds[COUNT(pairs)];
+    int i, s, failed = 0;
+    struct Settings settings[] =
+    {
+        {"maximum only", 0, 0, 1},
+        {"maximum only, threads", threads, 0, 1},
+        {"all maximal, threads", threads, 0, 0},
+        {"maximum only, time limit", 0, timeout, 1}
+    };
+    struct Settings sequential = {"all maximal", 0, 0, 0};
+    double seconds;
+
+    indigoSetErrorHandler(onError, 0);
+
+    seconds = run(&sequential, reference);
+    printf("%-26s %8.3f s\n", sequential.name, seconds);
+
+    for (s = 0; s < COUNT(settings); s++)
+    {
+        int smaller = 0;
+
+        seconds = run(&settings[s], bonds);
+
+        for (i = 0; i < COUNT(pairs); i++)
+            if (bonds[i] != reference[i])
+                smaller++;
+
+        printf("%-26s %8.3f s, %d of %d pairs with a smaller result\n",
+               settings[s].name, seconds, smaller, COUNT(pairs));
+
+        // Only the search with the time limit may stop before the largest
+        // common substructure is found
+        if (smaller > 0 && settings[s].timeout == 0)
+            failed = 1;
+    }
+
+    return failed;
+}
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "indigo.h"
+#include "bench-fixtures.h"
+
+// Combinatorial library of amides, first with indigoReactionProductEnumerate,
+// then with the products iterator with and without the worker threads. The
+// iterators must give the same products in the same order, and the same set
+// of products as the array.
+// Usage: rpe-bench [monomers per reactant] [threads]
+
+static const char *groups[] =
+{
+    "c1ccccc1", "Cc1ccccc1", "C1CCCCC1", "C1CCOCC1", "c1ccc(F)cc1",
+    "c1ccc(Cl)cc1", "c1ccc(OC)cc1", "c1ccsc1", "C1CC1", "CC(C)",
+    "CC(C)(C)", "C#C", "c1ccc2ccccc2c1", "OCC", "C(C#N)",
+    "CC(F)(F)", "c1ccoc1", "C1CCN(C)CC1", "COC(=O)", "CS(=O)(=O)"
+};
+
+void onError (const char *message, void *context)
+{
+    fprintf(stderr, "Error: %s\n", message);
+    exit(-1);
+}
+
+static int compareStrings (const void *a, const void *b)
+{
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+static char * productSmiles (int reaction)
+{
+    int products = indigoIterateProducts(reaction);
+    int product = indigoNext(products);
+    char *smiles = strdup(indigoCanonicalSmiles(product));
+
+    indigoFree(product);
+    indigoFree(products);
+    return smiles;
+}
+
+static void monomer (char *buf, int idx, const char *tail)
+{
+    int i, len = 0;
+
+    // The chain makes the monomers with the same group different
+    for (i = 0; i < idx / COUNT(groups); i++)
+        buf[len++] = 'C';
+    strcpy(buf + len, groups[idx % COUNT(groups)]);
+    strcat(buf, tail);
+}
+
+static char ** iterate (int reaction, int monomers, int threads, int *count, double *seconds)
+{
+    int iter, item, n = 0, max = 1024;
+    char **smiles = (char **)malloc(max * sizeof(char *));
+    clock_t start = clock();
+
+    indigoSetOptionInt("rpe-threads", threads);
+    iter = indigoIterateEnumeratedProducts(reaction, monomers);
+
+    while ((item = indigoNext(iter)) != 0)
+    {
+        if (n == max)
+        {
+            max *= 2;
+            smiles = (char **)realloc(smiles, max * sizeof(char *));
+        }
+        smiles[n++] = productSmiles(item);
+        indigoFree(item);
+    }
+    indigoFree(iter);
+
+    *seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    *count = n;
+    return smiles;
+}
+
+static int sameLists (char **a, int na, char **b, int nb)
+{
+    int i;
+
+    if (na != nb)
+        return 0;
+    for (i = 0; i < na; i++)
+        if (strcmp(a[i], b[i]) != 0)
+            return 0;
+    return 1;
+}
+
+int main (int argc, char **argv)
+{
+    int n = (argc > 1) ? atoi(argv[1]) : 40;
+    int threads = (argc > 2) ? atoi(argv[2]) : 4;
+    int reaction, monomers, acids, amines;
+    int mode, i, failed = 0;
+    char buf[256];
+
+    indigoSetErrorHandler(onError, 0);
+    indigoSetOptionInt("rpe-max-products-count", 1000000);
+
+    reaction = indigoLoadQueryReactionFromString("[C:1](=[O:2])[OH].[NH2:3]>>[C:1](=[O:2])[NH:3]");
+
+    monomers = indigoCreateArray();
+    acids = indigoCreateArray();
+    amines = indigoCreateArray();
+    for (i = 0; i < n; i++)
+    {
+        int mol;
+
+        monomer(buf, i, "C(=O)O");
+        mol = indigoLoadMoleculeFromString(buf);
+        indigoArrayAdd(acids, mol);
+        indigoFree(mol);
+
+        monomer(buf, i, "CN");
+        mol = indigoLoadMoleculeFromString(buf);
+        indigoArrayAdd(amines, mol);
+        indigoFree(mol);
+    }
+    indigoArrayAdd(monomers, acids);
+    indigoArrayAdd(monomers, amines);
+
+    for (mode = 0; mode < 2; mode++)
+    {
+        int array, count, n0, nt;
+        char **legacy, **serial, **parallel;
+        double seconds, serial_seconds, parallel_seconds;
+        clock_t start;
+
+        indigoSetOption("rpe-mode", mode == 0 ? "grid" : "one-tube");
+
+        start = clock();
+        array = indigoReactionProductEnumerate(reaction, monomers);
+        count = indigoCount(array);
+        legacy = (char **)malloc((count + 1) * sizeof(char *));
+        for (i = 0; i < count; i++)
+        {
+            int item = indigoAt(array, i);
+
+            legacy[i] = productSmiles(item);
+            indigoFree(item);
+        }
+        indigoFree(array);
+        seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        serial = iterate(reaction, monomers, 0, &n0, &serial_seconds);
+        parallel = iterate(reaction, monomers, threads, &nt, &parallel_seconds);
+
+        printf("%s, %d x %d monomers: array %d products %.3f s, iterator %d products %.3f s, "
+               "%d threads %d products %.3f s CPU\n", mode == 0 ? "grid" : "one-tube", n, n,
+               count, seconds, n0, serial_seconds, threads, nt, parallel_seconds);
+
+        if (!sameLists(serial, n0, parallel, nt))
+        {
+            printf("the threads change the products\n");
+            failed = 1;
+        }
+
+        qsort(legacy, count, sizeof(char *), compareStrings);
+        qsort(serial, n0, sizeof(char *), compareStrings);
+        if (!sameLists(legacy, count, serial, n0))
+        {
+            printf("the iterator and the array have different products\n");
+            failed = 1;
+        }
+
+        for (i = 0; i < count; i++)
+            free(legacy[i]);
+        for (i = 0; i < n0; i++)
+            free(serial[i]);
+        for (i = 0; i < nt; i++)
+            free(parallel[i]);
+        free(legacy);
+        free(serial);
+        free(parallel);
+    }
+
+    indigoFree(monomers);
+    indigoFree(acids);
+    indigoFree(amines);
+    indigoFree(reaction);
+    return failed;
+}
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "indigo.h"
+#include "bench-fixtures.h"
+
+// MB per second of indigoIterateSDFile + indigoRawData with the memory
+// mapped files ("mmap-files" option) and with the buffered stdio reading.
+// Both modes must return the same records. Without a file an SDF with
+// generated molecules is written to the current directory.
+// Usage: sdf-read-bench [file.sdf] [records to generate]
+
+static const char *modes[] = {"true", "false"};
+
+#define ROUNDS 3
+
+// An older library may not know the option
+static int option_failed = 0;
+
+void onError (const char *message, void *context)
+{
+    if (context != 0)
+    {
+        option_failed = 1;
+        return;
+    }
+    fprintf(stderr, "Error: %s\n", message);
+    exit(-1);
+}
+
+static void generate (const char *filename, int records)
+{
+    int saver = indigoWriteFile(filename), i;
+
+    srand(12345);
+    for (i = 0; i < records; i++)
+    {
+        char smiles[1024];
+        int mol;
+
+        benchRandomSmiles(smiles);
+        mol = indigoLoadMoleculeFromString(smiles);
+        indigoSetProperty(mol, "index", smiles);
+        indigoSdfAppend(saver, mol);
+        indigoFree(mol);
+    }
+    indigoClose(saver);
+    indigoFree(saver);
+}
+
+int main (int argc, char **argv)
+{
+    const char *filename = (argc > 1) ? argv[1] : "sdf-read-bench.sdf";
+    int records = (argc > 2) ? atoi(argv[2]) : 100000;
+    int m, r;
+
+    indigoSetErrorHandler(onError, 0);
+
+    if (argc <= 1)
+        generate(filename, records);
+
+    for (m = 0; m < COUNT(modes); m++)
+    {
+        unsigned long long checksum = 0, bytes = 0;
+        double best = 0;
+        int count = 0;
+
+        option_failed = 0;
+        indigoSetErrorHandler(onError, &option_failed);
+        indigoSetOption("mmap-files", modes[m]);
+        indigoSetErrorHandler(onError, 0);
+
+        for (r = 0; r < ROUNDS; r++)
+        {
+            double start = benchNow(), seconds;
+            int iter = indigoIterateSDFile(filename), item;
+
+            checksum = 14695981039346656037ULL;
+            bytes = 0;
+            count = 0;
+            while ((item = indigoNext(iter)) != 0)
+            {
+                const char *data = indigoRawData(item);
+
+                for (; *data != 0; data++, bytes++)
+                {
+                    checksum ^= (unsigned char)*data;
+                    checksum *= 1099511628211ULL;
+                }
+                count++;
+                indigoFree(item);
+            }
+            indigoFree(iter);
+
+            seconds = benchNow() - start;
+            if (r == 0 || seconds < best)
+                best = seconds;
+        }
+
+        printf("mmap-files=%-5s %s%d records, %.1f MB, best of %d: %.3f s, %.0f MB/s, checksum %016llx\n",
+               modes[m], option_failed ? "(option is not supported) " : "", count, bytes / 1048576.0,
+               ROUNDS, best, bytes / 1048576.0 / best, checksum);
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "indigo.h"
+#include "bench-fixtures.h"
+
+// Substructure search with common reactive group and functional group
+// filters, first with a matcher per molecule, then with a query set.
+// Usage: smarts-filter-bench [rounds] [file with SMILES]
+
+static const char *filters[] =
+{
+    "[CX3](=O)[OX2H1]",
+    "[CX3](=O)[OX1-]",
+    "[NX3;H2,H1;!$(NC=O)]",
+    "[NX3;H2;!$(NC=[O,S,N])][#6]",
+    "[SX2H]",
+    "[CX3](=O)[Cl,Br,I]",
+    "[$([NX3](=O)=O),$([NX3+](=O)[O-])][!#8]",
+    "[CX3H1](=O)[#6]",
+    "C1OC1",
+    "[N-]=[N+]=N",
+    "N=C=O",
+    "[CH2]=[CH]C(=O)",
+    "C=CC(=O)[#6,#7,#8]",
+    "[Cl,Br,I][CX4]",
+    "[NX3][NX3]",
+    "S(=O)(=O)[F,Cl,Br,I]",
+    "C(=O)OC(=O)",
+    "[OH]c1ccccc1",
+    "c1ccc2ccccc2c1",
+    "[#6]C(=O)[#6]",
+    "[R2]",
+    "[r5,r6;a]",
+    "[D4;#6]",
+    "[X4;!R;#6]",
+    "[#7;a]",
+    "[#16;X4](=O)(=O)[#7]",
+    "[CX4][OX2][CX4]",
+    "O=C1C=CC(=O)C=C1",
+    "[B](O)O",
+    "[P](=S)",
+    "[#6;!$([#6]=O)][OX2H]",
+    "[NX3;H0;!$(NC=O);!$(N-a)]([#6])([#6])[#6]",
+    "[$(C=O);!$(C(=O)[OH])][#7]",
+    "[c;$(c[Cl,Br,I])]",
+    "[#6]-[#7]=[#7]-[#6]",
+    "[N;R][C;R](=O)",
+    "[CX4;H3][CX4;H2]",
+    "[#8;!H0]",
+    "[!#6;!#1]~[!#6;!#1]",
+    "[C;$(C(=O)N);!R]"
+};
+
+static const char *targets[] =
+{
+    "CC(=O)Oc1ccccc1C(=O)O",
+    "CN1C=NC2=C1C(=O)N(C(=O)N2C)C",
+    "CC(C)Cc1ccc(cc1)C(C)C(=O)O",
+    "CC(=O)Nc1ccc(O)cc1",
+    "CC1(C)SC2C(NC(=O)Cc3ccccc3)C(=O)N2C1C(=O)O",
+    "CC(C)c1c(C(=O)Nc2ccccc2)c(-c2ccccc2)c(-c2ccc(F)cc2)n1CCC(O)CC(O)CC(=O)O",
+    "CN1CCC23C4C1CC5=C2C(=C(C=C5)O)OC3C(C=C4)O",
+    "COc1ccc2[nH]cc(CCNC(C)=O)c2c1",
+    "CN(C)CCCN1c2ccccc2CCc2ccccc21",
+    "Clc1ccc(cc1)C(c1ccccc1)N1CCN(CC1)CCOCC(=O)O",
+    "CC(C)NCC(O)COc1cccc2ccccc12",
+    "OC(=O)CCCc1ccc(N(CCCl)CCCl)cc1",
+    "CC12CCC3C(CCC4=CC(=O)CCC34C)C1CCC2O",
+    "CC(=O)NC1=NN=C(S1)S(N)(=O)=O",
+    "NS(=O)(=O)c1cc2c(cc1Cl)NCNS2(=O)=O",
+    "CC(C)(C)NCC(O)c1ccc(O)c(CO)c1",
+    "CCN(CC)C(=O)C1CN(C)C2CC3=CNC4=CC=CC(=C34)C2=C1",
+    "CC1=C(C(=O)OC)C(c2cccc(c2)[N+](=O)[O-])C(C(=O)OC)=C(C)N1",
+    "C=CC(=O)N1CCC(CC1)Oc1ccccc1",
+    "O=C(Cl)c1ccccc1",
+    "C1OC1c1ccccc1",
+    "[N-]=[N+]=NCc1ccccc1"
+};
+
+void onError (const char *message, void *context)
+{
+    fprintf(stderr, "Error: %s\n", message);
+    exit(-1);
+}
+
+int main (int argc, char **argv)
+{
+    int rounds = (argc > 1) ? atoi(argv[1]) : 20;
+    int queries[COUNT(filters)];
+    int *mols;
+    int n_mols = 0, max_mols = 1024;
+    int i, j, r, hits = 0, set_hits = 0;
+    int query_set;
+    clock_t start;
+    double seconds;
+
+    indigoSetErrorHandler(onError, 0);
+
+    for (i = 0; i < COUNT(filters); i++)
+        queries[i] = indigoLoadSmartsFromString(filters[i]);
+
+    mols = (int *)malloc(max_mols * sizeof(int));
+    if (argc > 2)
+    {
+        int iter = indigoIterateSmilesFile(argv[2]), item;
+
+        while ((item = indigoNext(iter)) != 0)
+        {
+            if (n_mols == max_mols)
+            {
+                max_mols *= 2;
+                mols = (int *)realloc(mols, max_mols * sizeof(int));
+            }
+            mols[n_mols] = indigoClone(item);
+            indigoFree(item);
+            n_mols++;
+        }
+        indigoFree(iter);
+    }
+    else
+    {
+        for (i = 0; i < COUNT(targets); i++)
+            mols[n_mols++] = indigoLoadMoleculeFromString(targets[i]);
+    }
+
+    for (i = 0; i < n_mols; i++)
+        indigoAromatize(mols[i]);
+
+    start = clock();
+    for (r = 0; r < rounds; r++)
+    {
+        for (i = 0; i < n_mols; i++)
+        {
+            int matcher = indigoSubstructureMatcher(mols[i], "");
+
+            for (j = 0; j < COUNT(filters); j++)
+            {
+                int match = indigoMatch(matcher, queries[j]);
+
+                if (match != 0)
+                {
+                    hits++;
+                    indigoFree(match);
+                }
+            }
+            indigoFree(matcher);
+        }
+    }
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("%d filters x %d molecules x %d rounds: %d hits, %.3f s, %.2f us per match\n",
+           COUNT(filters), n_mols, rounds, hits, seconds,
+           seconds * 1e6 / ((double)COUNT(filters) * n_mols * rounds));
+
+    query_set = indigoCreateQuerySet();
+    for (j = 0; j < COUNT(filters); j++)
+        indigoQuerySetAdd(query_set, queries[j]);
+
+    start = clock();
+    for (r = 0; r < rounds; r++)
+    {
+        for (i = 0; i < n_mols; i++)
+        {
+            int count;
+
+            indigoQuerySetMatch(query_set, mols[i], &count);
+            set_hits += count;
+        }
+    }
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("query set: %d hits, %.3f s, %.2f us per match\n", set_hits, seconds,
+           seconds * 1e6 / ((double)COUNT(filters) * n_mols * rounds));
+
+    indigoFree(query_set);
+
+    for (i = 0; i < n_mols; i++)
+        indigoFree(mols[i]);
+    for (i = 0; i < COUNT(filters); i++)
+        indigoFree(queries[i]);
+    free(mols);
+    return (hits == set_hits) ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include "base_cpp/record_index.h"
+
+using namespace indigo;
+
+// Checks that RecordIndex::build() joins the chunks into the offsets of the
+// sequential scan even when the guessed record starts are wrong. The records
+// are given by a table of boundaries, the data itself is never read.
+
+class TableSplitter : public RecordSplitter
+{
+public:
+    Array<long long> bounds; // record starts and the end of the last record
+    int wrong_percent;
+
+    virtual bool skipRecord (const char *data, long long size, long long &pos) const
+    {
+        const long long *first = bounds.ptr(), *last = first + bounds.size();
+
+        if (pos >= bounds.top())
+            return false;
+
+        // From a position that is not a boundary the scan is out of sync
+        // for a while, like a loader that has taken a data line for a header
+        if (!std::binary_search(first, last, pos) && pos % 3 != 0)
+        {
+            pos = __min(pos + 7, size);
+            return true;
+        }
+        pos = *std::upper_bound(first, last, pos);
+        return true;
+    }
+
+    virtual long long findRecordStart (const char *data, long long size, long long pos) const
+    {
+        const long long *first = bounds.ptr(), *last = first + bounds.size();
+
+        if (rand() % 100 < wrong_percent)
+            return __min(pos + rand() % 50, size);
+        return __min(*std::lower_bound(first, last, pos), size);
+    }
+};
+
+static int testBuild (int trial)
+{
+    static const char data[1] = {0};
+    static const long long base = 10;
+    TableSplitter splitter;
+    Array<long long> offsets;
+    long long size = 16000000 + rand() % 24000000, pos = 0, end;
+    // Every fifth trial has records longer than a chunk
+    int max_length = (trial % 5 == 0) ? 3000000 : 2000;
+    int i;
+
+    splitter.wrong_percent = trial % 4 * 33;
+    while (pos < size - 2000)
+    {
+        splitter.bounds.push(pos);
+        pos += 1 + rand() % max_length;
+    }
+    splitter.bounds.push(pos);
+
+    RecordIndex::build(data, size, base, splitter, 1 + trial % 9, offsets, end);
+
+    if (offsets.size() != splitter.bounds.size() - 1 || end != pos + base)
+    {
+        printf("Trial %d: %d records up to %lld, %d up to %lld expected\n", trial, offsets.size(), end,
+               splitter.bounds.size() - 1, pos + base);
+        return 0;
+    }
+    for (i = 0; i < offsets.size(); i++)
+        if (offsets[i] != splitter.bounds[i] + base)
+        {
+            printf("Trial %d: record %d at %lld, %lld expected\n", trial, i, offsets[i], splitter.bounds[i] + base);
+            return 0;
+        }
+    return 1;
+}
+
+int main (void)
+{
+    int trial;
+
+    srand(12345);
+    try
+    {
+        for (trial = 0; trial < 40; trial++)
+            if (!testBuild(trial))
+                return -1;
+    }
+    catch (Exception &e)
+    {
+        printf("Error: %s\n", e.message());
+        return -1;
+    }
+    printf("Record index: OK\n");
+    return 0;
+}
@@ -17,6 +17,11 @@
 
 #include "base_c/bitarray.h"
 
+#if (defined __GNUC__ || defined __clang__) && (defined __x86_64__ || defined __i386__)
+   #define BIT_X86
+   #include <immintrin.h>
+#endif
+
 int bitGetBit (const void *bitarray, int bitno)
 {
    return ((((char *)bitarray)[bitno / 8] & (char)(1 << (bitno % 8))) == 0) ? 0 : 1;
@@ -136,14 +141,6 @@ int bitGetOnesCountQword (qword value)
    return bitGetOnesCountDword((dword)value) + bitGetOnesCountDword((dword)(value >> 32));
 }
 
-int bitGetOnesCount (const byte *data, int size)
-{
-   int count = 0;
-   while (size-- > 0)
-      count += bitGetOnesCountByte(*data++);
-   return count;
-}
-
 int bitGetOneHOIndex  (byte value)
 {
    static const int oneHOIndex[] =
@@ -193,193 +190,672 @@ int bitGetSize (int nbits)
    return (nbits + 7) / 8;
 }
 
-int bitTestOnes (const byte *pattern, const byte *candidate, int n_bytes)
+//
+// Counting and testing kernels. Every function has an implementation for
+// each level of the CPU features, the best one the CPU supports is chosen
+// when the library is loaded. A kernel is written once as an inline
+// function taking the bitwise operation, and the exported functions are
+// its instances with the constant operation.
+//
+
+enum
 {
-   int qwords_count = n_bytes / sizeof(qword);
-   int bytes_left = n_bytes - qwords_count * sizeof(qword);
+   BIT_OP_FIRST,   // a
+   BIT_OP_AND,     // a & b
+   BIT_OP_AND_NOT, // a & ~b
+   BIT_OP_XOR,     // a ^ b
+   BIT_OP_OR,      // a | b
+   BIT_OP_XNOR     // ~(a ^ b)
+};
+
+static qword _bitLoad (const byte *ptr)
+{
+   qword value;
 
-   const qword *pattern_ptr = (const qword *)pattern;
-   const qword *candidate_ptr = (const qword *)candidate;
-   while (qwords_count-- > 0)
+   memcpy(&value, ptr, sizeof(qword));
+   return value;
+}
+
+static qword _bitOp (qword a, qword b, int op)
+{
+   switch (op)
+   {
+   case BIT_OP_AND:     return a & b;
+   case BIT_OP_AND_NOT: return a & ~b;
+   case BIT_OP_XOR:     return a ^ b;
+   case BIT_OP_OR:      return a | b;
+   case BIT_OP_XNOR:    return ~(a ^ b);
+   default:             return a;
+   }
+}
+
+static int _bitPopcountQword (qword v)
+{
+   v = v - ((v >> 1) & 0x5555555555555555ULL);
+   v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+   return (int)((((v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL) * 0x0101010101010101ULL) >> 56);
+}
+
+// The bytes after the last whole qword
+static int _bitCountTail (const byte *bit1, const byte *bit2, int n_bytes, int op)
+{
+   int count = 0;
+
+   while (n_bytes-- > 0)
+      count += bitGetOnesCountByte((byte)_bitOp(*bit1++, *bit2++, op));
+   return count;
+}
+
+static int _bitTestTail (const byte *pattern, const byte *candidate, int n_bytes)
+{
+   while (n_bytes-- > 0)
    {
-      if ((*candidate_ptr & *pattern_ptr) != *pattern_ptr)
+      if ((*candidate & *pattern) != *pattern)
          return 0;
-      pattern_ptr++;
-      candidate_ptr++;
+      pattern++;
+      candidate++;
    }
+   return 1;
+}
 
-   if (bytes_left != 0)
+static int _bitTestQwords (const byte *pattern, const byte *candidate, int from, int n_bytes)
+{
+   int i;
+
+   for (i = from; i + 8 <= n_bytes; i += 8)
    {
-      qword mask = ~(qword)0 >> (64 - 8 * bytes_left);
+      qword p = _bitLoad(pattern + i);
 
-      if ((*candidate_ptr & *pattern_ptr & mask) != (*pattern_ptr & mask))
+      if ((_bitLoad(candidate + i) & p) != p)
          return 0;
    }
-   return 1;
+   return _bitTestTail(pattern + i, candidate + i, n_bytes - i);
 }
 
-int bitIdecticalBits (const byte *bit1, const byte *bit2, int n_bytes)
+static int _bitLowestOne (qword v)
 {
-   int qwords_count = n_bytes / sizeof(qword);
-   int bytes_left = n_bytes - qwords_count * sizeof(qword);
+#if defined __GNUC__ || defined __clang__
+   return __builtin_ctzll(v);
+#else
+   int idx = 0;
 
-   int count = 0;
-   const qword *bit1_ptr = (const qword *)bit1;
-   const qword *bit2_ptr = (const qword *)bit2;
-   while (qwords_count-- > 0)
+   while ((v & 1) == 0)
    {
-      qword id = ~(*bit1_ptr ^ *bit2_ptr);
-      count += bitGetOnesCountQword(id);
+      v >>= 1;
+      idx++;
+   }
+   return idx;
+#endif
+}
+
+static int _bitExtractOnes (qword v, int first, int *indices)
+{
+   int n = 0;
+
+   for (; v != 0; v &= v - 1)
+      indices[n++] = first + _bitLowestOne(v);
+   return n;
+}
 
-      bit1_ptr++;
-      bit2_ptr++;
+// The bytes from the given one, qword by qword and then byte by byte
+static int _bitIndicesQwords (const byte **arrays, int count, int from, int n_bytes, int *indices)
+{
+   int n = 0, i, j;
+
+   for (i = from; i + 8 <= n_bytes; i += 8)
+   {
+      qword acc = _bitLoad(arrays[0] + i);
+
+      for (j = 1; j < count && acc != 0; j++)
+         acc &= _bitLoad(arrays[j] + i);
+      if (acc != 0)
+         n += _bitExtractOnes(acc, i * 8, indices + n);
+   }
+   for (; i < n_bytes; i++)
+   {
+      qword acc = arrays[0][i];
+
+      for (j = 1; j < count && acc != 0; j++)
+         acc &= arrays[j][i];
+      if (acc != 0)
+         n += _bitExtractOnes(acc, i * 8, indices + n);
    }
+   return n;
+}
+
+//
+// Portable
+//
+
+static int _bitCountPortable (const byte *bit1, const byte *bit2, int n_bytes, int op)
+{
+   int count = 0, i;
+
+   for (i = 0; i + 8 <= n_bytes; i += 8)
+      count += _bitPopcountQword(_bitOp(_bitLoad(bit1 + i), _bitLoad(bit2 + i), op));
+   return count + _bitCountTail(bit1 + i, bit2 + i, n_bytes - i, op);
+}
 
-   if (bytes_left != 0)
+static int _bitCountsPortable (const byte *bit1, const byte *bit2, int n_bytes, int *ones1, int *ones2)
+{
+   int common = 0, count1 = 0, count2 = 0, i;
+
+   for (i = 0; i + 8 <= n_bytes; i += 8)
    {
-      qword mask = ~(qword)0 >> (64 - 8 * bytes_left);
-      qword id = (~(*bit1_ptr ^ *bit2_ptr)) & mask;
-      count += bitGetOnesCountQword(id);
+      qword a = _bitLoad(bit1 + i), b = _bitLoad(bit2 + i);
+
+      count1 += _bitPopcountQword(a);
+      count2 += _bitPopcountQword(b);
+      common += _bitPopcountQword(a & b);
    }
-   return count;
+   *ones1 = count1 + _bitCountTail(bit1 + i, bit1 + i, n_bytes - i, BIT_OP_FIRST);
+   *ones2 = count2 + _bitCountTail(bit2 + i, bit2 + i, n_bytes - i, BIT_OP_FIRST);
+   return common + _bitCountTail(bit1 + i, bit2 + i, n_bytes - i, BIT_OP_AND);
 }
 
-int bitCommonOnes (const byte *bit1, const byte *bit2, int n_bytes)
+static int _bitTestPortable (const byte *pattern, const byte *candidate, int n_bytes)
 {
-   int qwords_count = n_bytes / sizeof(qword);
-   int bytes_left = n_bytes - qwords_count * sizeof(qword);
+   return _bitTestQwords(pattern, candidate, 0, n_bytes);
+}
 
-   int count = 0;
-   const qword *bit1_ptr = (const qword *)bit1;
-   const qword *bit2_ptr = (const qword *)bit2;
-   while (qwords_count-- > 0)
+static int _bitIndicesPortable (const byte **arrays, int count, int n_bytes, int *indices)
+{
+   return _bitIndicesQwords(arrays, count, 0, n_bytes, indices);
+}
+
+#ifdef BIT_X86
+
+//
+// POPCNT
+//
+
+#define BIT_POPCNT_INLINE static __inline__ __attribute__((always_inline, target("popcnt")))
+
+BIT_POPCNT_INLINE int _bitCountPopcnt (const byte *bit1, const byte *bit2, int n_bytes, int op)
+{
+   int count = 0, i;
+
+   for (i = 0; i + 8 <= n_bytes; i += 8)
+      count += __builtin_popcountll(_bitOp(_bitLoad(bit1 + i), _bitLoad(bit2 + i), op));
+   return count + _bitCountTail(bit1 + i, bit2 + i, n_bytes - i, op);
+}
+
+BIT_POPCNT_INLINE int _bitCountsPopcnt (const byte *bit1, const byte *bit2, int n_bytes, int *ones1, int *ones2)
+{
+   int common = 0, count1 = 0, count2 = 0, i;
+
+   for (i = 0; i + 8 <= n_bytes; i += 8)
    {
-      qword id = *bit1_ptr & *bit2_ptr;
-      count += bitGetOnesCountQword(id);
+      qword a = _bitLoad(bit1 + i), b = _bitLoad(bit2 + i);
 
-      bit1_ptr++;
-      bit2_ptr++;
+      count1 += __builtin_popcountll(a);
+      count2 += __builtin_popcountll(b);
+      common += __builtin_popcountll(a & b);
    }
+   *ones1 = count1 + _bitCountTail(bit1 + i, bit1 + i, n_bytes - i, BIT_OP_FIRST);
+   *ones2 = count2 + _bitCountTail(bit2 + i, bit2 + i, n_bytes - i, BIT_OP_FIRST);
+   return common + _bitCountTail(bit1 + i, bit2 + i, n_bytes - i, BIT_OP_AND);
+}
+
+BIT_POPCNT_INLINE int _bitTestPopcnt (const byte *pattern, const byte *candidate, int n_bytes)
+{
+   return _bitTestQwords(pattern, candidate, 0, n_bytes);
+}
+
+BIT_POPCNT_INLINE int _bitIndicesPopcnt (const byte **arrays, int count, int n_bytes, int *indices)
+{
+   return _bitIndicesQwords(arrays, count, 0, n_bytes, indices);
+}
+
+//
+// AVX2: nibble lookup popcount (vpshufb) of 32-byte vectors, summed up by
+// vpsadbw. The Harley-Seal carry-save tree needs 16 vectors (512 bytes) a
+// step and pays off on the arrays of many kilobytes, the fingerprints are
+// shorter.
+//
 
-   if (bytes_left != 0)
+#define BIT_AVX2_INLINE static __inline__ __attribute__((always_inline, target("avx2,popcnt")))
+
+BIT_AVX2_INLINE __m256i _bitOpAvx2 (__m256i a, __m256i b, int op)
+{
+   switch (op)
    {
-      qword mask = ~(qword)0 >> (64 - 8 * bytes_left);
-      qword id = *bit1_ptr & *bit2_ptr & mask;
-      count += bitGetOnesCountQword(id);
+   case BIT_OP_AND:     return _mm256_and_si256(a, b);
+   case BIT_OP_AND_NOT: return _mm256_andnot_si256(b, a);
+   case BIT_OP_XOR:     return _mm256_xor_si256(a, b);
+   case BIT_OP_OR:      return _mm256_or_si256(a, b);
+   case BIT_OP_XNOR:    return _mm256_xor_si256(_mm256_xor_si256(a, b), _mm256_set1_epi8(-1));
+   default:             return a;
    }
-   return count;
 }
 
-int bitUniqueOnes (const byte *bit1, const byte *bit2, int n_bytes)
+// Ones in each qword of the vector
+BIT_AVX2_INLINE __m256i _bitPopcountAvx2 (__m256i v)
 {
-   int qwords_count = n_bytes / sizeof(qword);
-   int bytes_left = n_bytes - qwords_count * sizeof(qword);
+   const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+   const __m256i low_mask = _mm256_set1_epi8(0x0F);
+   __m256i lo = _mm256_and_si256(v, low_mask);
+   __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+   __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+
+   return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
 
-   int count = 0;
-   const qword *bit1_ptr = (const qword *)bit1;
-   const qword *bit2_ptr = (const qword *)bit2;
-   while (qwords_count-- > 0)
+BIT_AVX2_INLINE int _bitSumAvx2 (__m256i v)
+{
+   qword lanes[4];
+
+   _mm256_storeu_si256((__m256i *)lanes, v);
+   return (int)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
+
+BIT_AVX2_INLINE int _bitCountAvx2 (const byte *bit1, const byte *bit2, int n_bytes, int op)
+{
+   __m256i acc = _mm256_setzero_si256();
+   int count, i;
+
+   for (i = 0; i + 32 <= n_bytes; i += 32)
+   {
+      __m256i a = _mm256_loadu_si256((const __m256i *)(bit1 + i));
+      __m256i b = _mm256_loadu_si256((const __m256i *)(bit2 + i));
+
+      acc = _mm256_add_epi64(acc, _bitPopcountAvx2(_bitOpAvx2(a, b, op)));
+   }
+   count = _bitSumAvx2(acc);
+
+   for (; i + 8 <= n_bytes; i += 8)
+      count += __builtin_popcountll(_bitOp(_bitLoad(bit1 + i), _bitLoad(bit2 + i), op));
+   return count + _bitCountTail(bit1 + i, bit2 + i, n_bytes - i, op);
+}
+
+BIT_AVX2_INLINE int _bitCountsAvx2 (const byte *bit1, const byte *bit2, int n_bytes, int *ones1, int *ones2)
+{
+   __m256i acc1 = _mm256_setzero_si256(), acc2 = _mm256_setzero_si256(), acc = _mm256_setzero_si256();
+   int common, count1, count2, i;
+
+   for (i = 0; i + 32 <= n_bytes; i += 32)
    {
-      qword id = *bit1_ptr & ~*bit2_ptr;
-      count += bitGetOnesCountQword(id);
+      __m256i a = _mm256_loadu_si256((const __m256i *)(bit1 + i));
+      __m256i b = _mm256_loadu_si256((const __m256i *)(bit2 + i));
 
-      bit1_ptr++;
-      bit2_ptr++;
+      acc1 = _mm256_add_epi64(acc1, _bitPopcountAvx2(a));
+      acc2 = _mm256_add_epi64(acc2, _bitPopcountAvx2(b));
+      acc = _mm256_add_epi64(acc, _bitPopcountAvx2(_mm256_and_si256(a, b)));
    }
+   count1 = _bitSumAvx2(acc1);
+   count2 = _bitSumAvx2(acc2);
+   common = _bitSumAvx2(acc);
 
-   if (bytes_left != 0)
+   for (; i + 8 <= n_bytes; i += 8)
    {
-      qword mask = ~(qword)0 >> (64 - 8 * bytes_left);
-      qword id = *bit1_ptr & ~*bit2_ptr & mask;
-      count += bitGetOnesCountQword(id);
+      qword a = _bitLoad(bit1 + i), b = _bitLoad(bit2 + i);
+
+      count1 += __builtin_popcountll(a);
+      count2 += __builtin_popcountll(b);
+      common += __builtin_popcountll(a & b);
    }
-   return count;
+   *ones1 = count1 + _bitCountTail(bit1 + i, bit1 + i, n_bytes - i, BIT_OP_FIRST);
+   *ones2 = count2 + _bitCountTail(bit2 + i, bit2 + i, n_bytes - i, BIT_OP_FIRST);
+   return common + _bitCountTail(bit1 + i, bit2 + i, n_bytes - i, BIT_OP_AND);
 }
 
-int bitDifferentOnes (const byte *bit1, const byte *bit2, int n_bytes)
+BIT_AVX2_INLINE int _bitTestAvx2 (const byte *pattern, const byte *candidate, int n_bytes)
 {
-   int qwords_count = n_bytes / sizeof(qword);
-   int bytes_left = n_bytes - qwords_count * sizeof(qword);
+   int i;
 
-   int count = 0;
-   const qword *bit1_ptr = (const qword *)bit1;
-   const qword *bit2_ptr = (const qword *)bit2;
-   while (qwords_count-- > 0)
+   for (i = 0; i + 32 <= n_bytes; i += 32)
    {
-      qword id = *bit1_ptr ^ *bit2_ptr;
-      count += bitGetOnesCount((byte*)&id, sizeof(qword));
+      __m256i p = _mm256_loadu_si256((const __m256i *)(pattern + i));
+      __m256i c = _mm256_loadu_si256((const __m256i *)(candidate + i));
 
-      bit1_ptr++;
-      bit2_ptr++;
+      // ~c & p == 0
+      if (!_mm256_testc_si256(c, p))
+         return 0;
    }
+   return _bitTestQwords(pattern, candidate, i, n_bytes);
+}
+
+// The arrays are ANDed a vector at a time until the vector becomes zero
+BIT_AVX2_INLINE int _bitIndicesAvx2 (const byte **arrays, int count, int n_bytes, int *indices)
+{
+   int n = 0, i, j, w;
 
-   if (bytes_left != 0)
+   for (i = 0; i + 32 <= n_bytes; i += 32)
    {
-      qword mask = ~(qword)0 >> (64 - 8 * bytes_left);
-      qword id = (*bit1_ptr ^ *bit2_ptr) & mask;
-      count += bitGetOnesCountQword(id);
+      __m256i acc = _mm256_loadu_si256((const __m256i *)(arrays[0] + i));
+      qword words[4];
+
+      for (j = 1; j < count && !_mm256_testz_si256(acc, acc); j++)
+         acc = _mm256_and_si256(acc, _mm256_loadu_si256((const __m256i *)(arrays[j] + i)));
+      if (_mm256_testz_si256(acc, acc))
+         continue;
+
+      _mm256_storeu_si256((__m256i *)words, acc);
+      for (w = 0; w < 4; w++)
+         n += _bitExtractOnes(words[w], (i + w * 8) * 8, indices + n);
    }
-   return count;
+   return n + _bitIndicesQwords(arrays, count, i, n_bytes, indices + n);
 }
 
-int bitUnionOnes (const byte *bit1, const byte *bit2, int n_bytes)
+//
+// AVX-512 with VPOPCNTDQ
+//
+
+#define BIT_AVX512_INLINE static __inline__ __attribute__((always_inline, target("avx512f,avx512vpopcntdq,popcnt")))
+
+BIT_AVX512_INLINE __m512i _bitOpAvx512 (__m512i a, __m512i b, int op)
 {
-   int qwords_count = n_bytes / sizeof(qword);
-   int bytes_left = n_bytes - qwords_count * sizeof(qword);
+   switch (op)
+   {
+   case BIT_OP_AND:     return _mm512_and_si512(a, b);
+   case BIT_OP_AND_NOT: return _mm512_andnot_si512(b, a);
+   case BIT_OP_XOR:     return _mm512_xor_si512(a, b);
+   case BIT_OP_OR:      return _mm512_or_si512(a, b);
+   case BIT_OP_XNOR:    return _mm512_ternarylogic_epi64(a, b, b, 0x81);
+   default:             return a;
+   }
+}
 
-   int count = 0;
-   const qword *bit1_ptr = (const qword *)bit1;
-   const qword *bit2_ptr = (const qword *)bit2;
-   while (qwords_count-- > 0)
+// The whole qwords are loaded with a mask, the bytes after them are counted
+// one by one
+BIT_AVX512_INLINE int _bitCountAvx512 (const byte *bit1, const byte *bit2, int n_bytes, int op)
+{
+   __m512i acc = _mm512_setzero_si512();
+   int qwords = n_bytes / 8, i;
+
+   for (i = 0; i < qwords; i += 8)
    {
-      qword id = *bit1_ptr | *bit2_ptr;
-      count += bitGetOnesCountQword(id);
+      __mmask8 mask = (qwords - i >= 8) ? (__mmask8)0xFF : (__mmask8)((1 << (qwords - i)) - 1);
+      __m512i a = _mm512_maskz_loadu_epi64(mask, bit1 + i * 8);
+      __m512i b = _mm512_maskz_loadu_epi64(mask, bit2 + i * 8);
 
-      bit1_ptr++;
-      bit2_ptr++;
+      acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_maskz_mov_epi64(mask, _bitOpAvx512(a, b, op))));
    }
+   return (int)_mm512_reduce_add_epi64(acc) + _bitCountTail(bit1 + qwords * 8, bit2 + qwords * 8, n_bytes - qwords * 8, op);
+}
+
+BIT_AVX512_INLINE int _bitCountsAvx512 (const byte *bit1, const byte *bit2, int n_bytes, int *ones1, int *ones2)
+{
+   __m512i acc1 = _mm512_setzero_si512(), acc2 = _mm512_setzero_si512(), acc = _mm512_setzero_si512();
+   int qwords = n_bytes / 8, tail = qwords * 8, i;
 
-   if (bytes_left != 0)
+   for (i = 0; i < qwords; i += 8)
    {
-      qword mask = ~(qword)0 >> (64 - 8 * bytes_left);
-      qword id = (*bit1_ptr | *bit2_ptr) & mask;
-      count += bitGetOnesCountQword(id);
+      __mmask8 mask = (qwords - i >= 8) ? (__mmask8)0xFF : (__mmask8)((1 << (qwords - i)) - 1);
+      __m512i a = _mm512_maskz_loadu_epi64(mask, bit1 + i * 8);
+      __m512i b = _mm512_maskz_loadu_epi64(mask, bit2 + i * 8);
+
+      acc1 = _mm512_add_epi64(acc1, _mm512_popcnt_epi64(a));
+      acc2 = _mm512_add_epi64(acc2, _mm512_popcnt_epi64(b));
+      acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_and_si512(a, b)));
    }
-   return count;
+   *ones1 = (int)_mm512_reduce_add_epi64(acc1) + _bitCountTail(bit1 + tail, bit1 + tail, n_bytes - tail, BIT_OP_FIRST);
+   *ones2 = (int)_mm512_reduce_add_epi64(acc2) + _bitCountTail(bit2 + tail, bit2 + tail, n_bytes - tail, BIT_OP_FIRST);
+   return (int)_mm512_reduce_add_epi64(acc) + _bitCountTail(bit1 + tail, bit2 + tail, n_bytes - tail, BIT_OP_AND);
+}
+
+BIT_AVX512_INLINE int _bitTestAvx512 (const byte *pattern, const byte *candidate, int n_bytes)
+{
+   int i;
+
+   for (i = 0; i + 64 <= n_bytes; i += 64)
+   {
+      __m512i p = _mm512_loadu_si512(pattern + i);
+      __m512i c = _mm512_loadu_si512(candidate + i);
+
+      if (_mm512_test_epi64_mask(_mm512_andnot_si512(c, p), p) != 0)
+         return 0;
+   }
+   return _bitTestQwords(pattern, candidate, i, n_bytes);
+}
+
+BIT_AVX512_INLINE int _bitIndicesAvx512 (const byte **arrays, int count, int n_bytes, int *indices)
+{
+   int n = 0, i, j, w;
+
+   for (i = 0; i + 64 <= n_bytes; i += 64)
+   {
+      __m512i acc = _mm512_loadu_si512(arrays[0] + i);
+      __mmask8 nonzero = _mm512_test_epi64_mask(acc, acc);
+      qword words[8];
+
+      for (j = 1; j < count && nonzero != 0; j++)
+      {
+         acc = _mm512_and_si512(acc, _mm512_loadu_si512(arrays[j] + i));
+         nonzero = _mm512_test_epi64_mask(acc, acc);
+      }
+      if (nonzero == 0)
+         continue;
+
+      _mm512_storeu_si512(words, acc);
+      for (w = 0; w < 8; w++)
+         if (nonzero & (1 << w))
+            n += _bitExtractOnes(words[w], (i + w * 8) * 8, indices + n);
+   }
+   return n + _bitIndicesQwords(arrays, count, i, n_bytes, indices + n);
+}
+
+#endif
+
+//
+// Instances of the kernels for every level
+//
+
+typedef struct
+{
+   int (*onesCount)     (const byte *data, int size);
+   int (*commonOnes)    (const byte *bit1, const byte *bit2, int n_bytes);
+   int (*uniqueOnes)    (const byte *bit1, const byte *bit2, int n_bytes);
+   int (*differentOnes) (const byte *bit1, const byte *bit2, int n_bytes);
+   int (*unionOnes)     (const byte *bit1, const byte *bit2, int n_bytes);
+   int (*identicalBits) (const byte *bit1, const byte *bit2, int n_bytes);
+   int (*commonOnesWithCounts) (const byte *bit1, const byte *bit2, int n_bytes, int *ones1, int *ones2);
+   int (*testOnes)      (const byte *pattern, const byte *candidate, int n_bytes);
+   int (*testOnesArray) (const byte *pattern, const byte *candidates, int n_bytes, int count, int *passed);
+   void (*commonOnesArray) (const byte *pattern, const byte *candidates, int n_bytes, int count, int *common);
+   int (*commonOnesIndices) (const byte **arrays, int count, int n_bytes, int *indices);
+} BitKernels;
+
+#define BIT_DEFINE_KERNELS(level, attr) \
+   attr static int _bitOnesCount##level (const byte *data, int size) \
+      { return _bitCount##level(data, data, size, BIT_OP_FIRST); } \
+   attr static int _bitCommonOnes##level (const byte *bit1, const byte *bit2, int n_bytes) \
+      { return _bitCount##level(bit1, bit2, n_bytes, BIT_OP_AND); } \
+   attr static int _bitUniqueOnes##level (const byte *bit1, const byte *bit2, int n_bytes) \
+      { return _bitCount##level(bit1, bit2, n_bytes, BIT_OP_AND_NOT); } \
+   attr static int _bitDifferentOnes##level (const byte *bit1, const byte *bit2, int n_bytes) \
+      { return _bitCount##level(bit1, bit2, n_bytes, BIT_OP_XOR); } \
+   attr static int _bitUnionOnes##level (const byte *bit1, const byte *bit2, int n_bytes) \
+      { return _bitCount##level(bit1, bit2, n_bytes, BIT_OP_OR); } \
+   attr static int _bitIdenticalBits##level (const byte *bit1, const byte *bit2, int n_bytes) \
+      { return _bitCount##level(bit1, bit2, n_bytes, BIT_OP_XNOR); } \
+   attr static int _bitCommonOnesWithCounts##level (const byte *bit1, const byte *bit2, int n_bytes, int *ones1, int *ones2) \
+      { return _bitCounts##level(bit1, bit2, n_bytes, ones1, ones2); } \
+   attr static int _bitTestOnes##level (const byte *pattern, const byte *candidate, int n_bytes) \
+      { return _bitTest##level(pattern, candidate, n_bytes); } \
+   attr static int _bitTestOnesArray##level (const byte *pattern, const byte *candidates, int n_bytes, int count, int *passed) \
+   { \
+      int i, n_passed = 0; \
+      for (i = 0; i < count; i++) \
+         if (_bitTest##level(pattern, candidates + (size_t)i * n_bytes, n_bytes)) \
+            passed[n_passed++] = i; \
+      return n_passed; \
+   } \
+   attr static void _bitCommonOnesArray##level (const byte *pattern, const byte *candidates, int n_bytes, int count, int *common) \
+   { \
+      int i; \
+      for (i = 0; i < count; i++) \
+         common[i] = _bitCount##level(candidates + (size_t)i * n_bytes, pattern, n_bytes, BIT_OP_AND); \
+   } \
+   attr static int _bitCommonOnesIndices##level (const byte **arrays, int count, int n_bytes, int *indices) \
+      { return _bitIndices##level(arrays, count, n_bytes, indices); } \
+   static const BitKernels _bitKernels##level = \
+   { \
+      _bitOnesCount##level, _bitCommonOnes##level, _bitUniqueOnes##level, \
+      _bitDifferentOnes##level, _bitUnionOnes##level, _bitIdenticalBits##level, \
+      _bitCommonOnesWithCounts##level, _bitTestOnes##level, _bitTestOnesArray##level, \
+      _bitCommonOnesArray##level, _bitCommonOnesIndices##level \
+   };
+
+BIT_DEFINE_KERNELS(Portable, )
+
+#ifdef BIT_X86
+BIT_DEFINE_KERNELS(Popcnt, __attribute__((target("popcnt"))))
+BIT_DEFINE_KERNELS(Avx2, __attribute__((target("avx2,popcnt"))))
+BIT_DEFINE_KERNELS(Avx512, __attribute__((target("avx512f,avx512vpopcntdq,popcnt"))))
+#endif
+
+static const BitKernels *_bit_kernels = &_bitKernelsPortable;
+static int _bit_implementation = BIT_IMPL_PORTABLE;
+
+static int _bitIsSupported (int impl)
+{
+#ifdef BIT_X86
+   __builtin_cpu_init();
+   switch (impl)
+   {
+   case BIT_IMPL_PORTABLE: return 1;
+   case BIT_IMPL_POPCNT:   return __builtin_cpu_supports("popcnt");
+   case BIT_IMPL_AVX2:     return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+   case BIT_IMPL_AVX512:   return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq") &&
+                                  __builtin_cpu_supports("popcnt");
+   }
+   return 0;
+#else
+   return impl == BIT_IMPL_PORTABLE;
+#endif
+}
+
+int bitSetImplementation (int impl)
+{
+   if (!_bitIsSupported(impl))
+      return 0;
+
+   switch (impl)
+   {
+#ifdef BIT_X86
+   case BIT_IMPL_POPCNT: _bit_kernels = &_bitKernelsPopcnt; break;
+   case BIT_IMPL_AVX2:   _bit_kernels = &_bitKernelsAvx2; break;
+   case BIT_IMPL_AVX512: _bit_kernels = &_bitKernelsAvx512; break;
+#endif
+   default:              _bit_kernels = &_bitKernelsPortable; break;
+   }
+   _bit_implementation = impl;
+   return 1;
+}
+
+int bitGetImplementation (void)
+{
+   return _bit_implementation;
+}
+
+#ifdef BIT_X86
+// Before the constructors of the C++ code, which may count the bits already
+__attribute__((constructor(101))) static void _bitSelectImplementation (void)
+{
+   int impl;
+
+   for (impl = BIT_IMPL_AVX512; impl > BIT_IMPL_PORTABLE; impl--)
+      if (bitSetImplementation(impl))
+         break;
+}
+#endif
+
+int bitGetOnesCount (const byte *data, int size)
+{
+   return _bit_kernels->onesCount(data, size);
+}
+
+int bitTestOnes (const byte *pattern, const byte *candidate, int n_bytes)
+{
+   return _bit_kernels->testOnes(pattern, candidate, n_bytes);
+}
+
+int bitTestOnesArray (const byte *pattern, const byte *candidates, int n_bytes, int count, int *passed)
+{
+   return _bit_kernels->testOnesArray(pattern, candidates, n_bytes, count, passed);
+}
+
+void bitCommonOnesArray (const byte *pattern, const byte *candidates, int n_bytes, int count, int *common)
+{
+   _bit_kernels->commonOnesArray(pattern, candidates, n_bytes, count, common);
+}
+
+int bitCommonOnesIndices (const byte **arrays, int count, int n_bytes, int *indices)
+{
+   return _bit_kernels->commonOnesIndices(arrays, count, n_bytes, indices);
+}
+
+int bitIdecticalBits (const byte *bit1, const byte *bit2, int n_bytes)
+{
+   return _bit_kernels->identicalBits(bit1, bit2, n_bytes);
+}
+
+int bitCommonOnes (const byte *bit1, const byte *bit2, int n_bytes)
+{
+   return _bit_kernels->commonOnes(bit1, bit2, n_bytes);
+}
+
+int bitCommonOnesWithCounts (const byte *bit1, const byte *bit2, int n_bytes, int *ones1, int *ones2)
+{
+   return _bit_kernels->commonOnesWithCounts(bit1, bit2, n_bytes, ones1, ones2);
+}
+
+int bitUniqueOnes (const byte *bit1, const byte *bit2, int n_bytes)
+{
+   return _bit_kernels->uniqueOnes(bit1, bit2, n_bytes);
+}
+
+int bitDifferentOnes (const byte *bit1, const byte *bit2, int n_bytes)
+{
+   return _bit_kernels->differentOnes(bit1, bit2, n_bytes);
+}
+
+int bitUnionOnes (const byte *bit1, const byte *bit2, int n_bytes)
+{
+   return _bit_kernels->unionOnes(bit1, bit2, n_bytes);
 }
 
 // a &= b
 void bitAnd (byte *a, const byte *b, int nbytes)
 {
-   while (nbytes-- > 0)
+   int i;
+
+   for (i = 0; i + 8 <= nbytes; i += 8)
    {
-      *a = *a & *b;
-      a++;
-      b++;
+      qword value = _bitLoad(a + i) & _bitLoad(b + i);
+      memcpy(a + i, &value, sizeof(qword));
    }
+   for (; i < nbytes; i++)
+      a[i] &= b[i];
 }
 
 // a |= b
 void bitOr (byte *a, const byte *b, int nbytes)
 {
-   while (nbytes-- > 0)
+   int i;
+
+   for (i = 0; i + 8 <= nbytes; i += 8)
    {
-      *a = *a | *b;
-      a++;
-      b++;
+      qword value = _bitLoad(a + i) | _bitLoad(b + i);
+      memcpy(a + i, &value, sizeof(qword));
    }
+   for (; i < nbytes; i++)
+      a[i] |= b[i];
 }
 
 int bitIsAllZero (const void *bits, int nbytes)
 {
    const byte *a = (const byte *)bits;
+   int i;
 
-   while (nbytes-- > 0)
-   {
-      if (*a != 0)
+   for (i = 0; i + 8 <= nbytes; i += 8)
+      if (_bitLoad(a + i) != 0)
+         return 0;
+   for (; i < nbytes; i++)
+      if (a[i] != 0)
          return 0;
-      a++;
-   }
    return 1;
 }
 
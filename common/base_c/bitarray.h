@@ -45,13 +45,30 @@ DLLEXPORT int   bitGetOneLOIndex  (byte value);
 DLLEXPORT int   bitGetSize (int nbits);
 
 DLLEXPORT int bitTestOnes      (const byte *pattern, const byte *candidate, int n_bytes);
+// Tests the pattern against count candidates stored one after another and
+// writes the indices of those that contain it to passed. Returns the number
+// of the passed candidates.
+DLLEXPORT int bitTestOnesArray (const byte *pattern, const byte *candidates, int n_bytes,
+                                int count, int *passed);
 DLLEXPORT int bitIdecticalBits (const byte *bit1, const byte *bit2, int n_bytes);
 DLLEXPORT int bitCommonOnes    (const byte *bit1, const byte *bit2, int n_bytes);
 DLLEXPORT int bitUniqueOnes    (const byte *bit1, const byte *bit2, int n_bytes);
+// Common ones and the ones of each array in a single pass
+DLLEXPORT int bitCommonOnesWithCounts (const byte *bit1, const byte *bit2, int n_bytes,
+                                       int *ones1, int *ones2);
 
 DLLEXPORT int bitDifferentOnes (const byte *bit1, const byte *bit2, int n_bytes);
 DLLEXPORT int bitUnionOnes     (const byte *bit1, const byte *bit2, int n_bytes);
 
+// Common ones of the pattern and each of count candidates stored one after
+// another
+DLLEXPORT void bitCommonOnesArray (const byte *pattern, const byte *candidates, int n_bytes,
+                                   int count, int *common);
+// Writes the numbers of the bits that are set in all of the count arrays
+// to indices, in ascending order and numbered like bitGetBit does. The
+// indices must have room for n_bytes * 8 items. Returns the number of them.
+DLLEXPORT int bitCommonOnesIndices (const byte **arrays, int count, int n_bytes, int *indices);
+
 DLLEXPORT void bitAnd (byte *a, const byte *b, int n_bytes);
 DLLEXPORT void bitOr (byte *a, const byte *b, int nbytes);
 
@@ -60,6 +77,20 @@ DLLEXPORT int bitIsAllZero (const void *bits, int nbytes);
 
 DLLEXPORT int bitLog2Dword (dword input);
 
+// Implementations of the counting functions. The best one the CPU supports
+// is selected when the library is loaded.
+enum
+{
+   BIT_IMPL_PORTABLE,
+   BIT_IMPL_POPCNT,
+   BIT_IMPL_AVX2,
+   BIT_IMPL_AVX512 // AVX-512 with VPOPCNTDQ
+};
+
+DLLEXPORT int bitGetImplementation (void);
+// Returns 0 and keeps the current one if the CPU doesn't support it
+DLLEXPORT int bitSetImplementation (int impl);
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,9 +21,9 @@
 extern "C" {
 #endif
 
-qword nanoClock (void);
+DLLEXPORT qword nanoClock (void);
 
-float nanoHowManySeconds (qword val);
+DLLEXPORT float nanoHowManySeconds (qword val);
 
 #ifdef __cplusplus
 }
@@ -52,7 +52,8 @@ enum {
 // _handling_order is HANDLING_ORDER_SERIAL
 static const int _MAX_RESULTS = 1000;
 
-OsCommandDispatcher::OsCommandDispatcher (int handling_order, bool same_session_IDs)
+OsCommandDispatcher::OsCommandDispatcher (int handling_order, bool same_session_IDs) :
+   _exitedThreadsSem(0, 0x7FFFFFFF)
 {
    _storedResults.setSize(_MAX_RESULTS);
    _storedResults.zeroFill();
@@ -92,6 +93,7 @@ void OsCommandDispatcher::_run (int nthreads)
    _exception_to_forward = NULL;
 
    _left_thread_count = nthreads;
+   _threads_to_wait = 0;
 
    if (_left_thread_count == 0)
    {
@@ -104,6 +106,7 @@ void OsCommandDispatcher::_run (int nthreads)
    // Create handling threads
    for (int i = 0; i < _left_thread_count; i++)
       osThreadCreate(_threadFuncStatic, this);
+   _threads_to_wait = _left_thread_count;
 
    _mainLoop();
 }
@@ -127,6 +130,14 @@ void OsCommandDispatcher::_mainLoop ()
          _onMsgHandleException((Exception *)parameter);
    }
 
+   // Threads are detached, so wait until they stop using the dispatcher
+   // because it can be destroyed right after the run
+   while (_threads_to_wait > 0)
+   {
+      _exitedThreadsSem.Wait();
+      _threads_to_wait--;
+   }
+
    if (_exception_to_forward != NULL)
    {
       Exception *cur = _exception_to_forward;
@@ -404,6 +415,9 @@ void OsCommandDispatcher::_threadFunc (void)
 
    _cleanupThread();
 
+   // The dispatcher must not be accessed after this call
+   _exitedThreadsSem.Post();
+
    TL_RELEASE_SESSION_ID(initial_SID);
 }
 
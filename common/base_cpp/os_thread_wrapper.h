@@ -43,14 +43,14 @@
 
 namespace indigo {
 
-class OsCommandResult
+class DLLEXPORT OsCommandResult
 {
 public:
    virtual ~OsCommandResult () {};
    virtual void clear () {};
 };
 
-class OsCommand
+class DLLEXPORT OsCommand
 {
 public:
    virtual ~OsCommand () {};
@@ -62,7 +62,7 @@ public:
 
 class Exception;
 
-class OsCommandDispatcher
+class DLLEXPORT OsCommandDispatcher
 {
 public:
    enum { HANDLING_ORDER_ANY, HANDLING_ORDER_SERIAL };
@@ -126,6 +126,10 @@ private:
    OsMessageSystem _baseMessageSystem;
    OsMessageSystem _privateMessageSystem;
 
+   // Posted by a handling thread when it does not access the dispatcher anymore
+   OsSemaphore _exitedThreadsSem;
+   int _threads_to_wait;
+
    int _last_command_index;
    int _expected_command_index;
    int _handling_order;
@@ -140,6 +144,6 @@ private:
 
 }
 
-int osGetProcessorsCount (void);
+DLLEXPORT int osGetProcessorsCount (void);
 
 #endif // __cmd_thread_h__
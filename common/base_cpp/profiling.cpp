@@ -15,20 +15,115 @@
 #include "base_cpp/profiling.h"
 
 #include <math.h>
+#include <thread>
 #include "base_cpp/tlscont.h"
 #include "base_cpp/output.h"
 #include "base_cpp/reusable_obj_array.h"
 #include "base_cpp/smart_output.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#define _PROF_HAS_TSC
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define _PROF_HAS_TSC
+#endif
+
 using namespace indigo;
 
+//
+// Time stamp counter
+//
+// The counter is used only if it is invariant (runs at a constant rate
+// regardless of the frequency scaling and sleep states). The rate is taken
+// against nanoClock once the library has been loaded for a while, so the
+// calibration doesn't delay anything. Timers use nanoClock until then.
+//
+
+namespace
+{
+   const float _TSC_CALIBRATION_TIME = 0.05f;
+
+   std::atomic<double> _tsc_ratio(0);
+
+#ifdef _PROF_HAS_TSC
+   bool _tsc_supported;
+   qword _tsc_start, _clock_start;
+
+   bool _isTscInvariant ()
+   {
+      unsigned int regs[4] = {0, 0, 0, 0};
+#ifdef _MSC_VER
+      int info[4];
+      __cpuid(info, 0x80000000);
+      if ((unsigned int)info[0] < 0x80000007)
+         return false;
+      __cpuid(info, 0x80000007);
+      regs[3] = (unsigned int)info[3];
+#else
+      if (__get_cpuid_max(0x80000000, 0) < 0x80000007)
+         return false;
+      __get_cpuid(0x80000007, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+      return (regs[3] & (1 << 8)) != 0;
+   }
+
+   struct _TscInit
+   {
+      _TscInit ()
+      {
+         _tsc_supported = _isTscInvariant();
+         if (_tsc_supported)
+         {
+            _tsc_start = __rdtsc();
+            _clock_start = nanoClock();
+         }
+      }
+   } _tsc_init;
+
+   double _getTscRatio ()
+   {
+      double ratio = _tsc_ratio.load(std::memory_order_relaxed);
+      if (ratio > 0 || !_tsc_supported)
+         return ratio;
+
+      qword clock = nanoClock();
+      if (nanoHowManySeconds(clock - _clock_start) < _TSC_CALIBRATION_TIME)
+         return 0;
+
+      ratio = (double)(clock - _clock_start) / (double)(__rdtsc() - _tsc_start);
+      _tsc_ratio.store(ratio, std::memory_order_relaxed);
+      return ratio;
+   }
+
+   inline qword _readTsc ()
+   {
+      return __rdtsc();
+   }
+#else
+   double _getTscRatio ()
+   {
+      return 0;
+   }
+
+   inline qword _readTsc ()
+   {
+      return 0;
+   }
+#endif
+}
+
 //
 // _ProfilingTimer
 //
 _ProfilingTimer::_ProfilingTimer (int name_index)
 {
    _name_index = name_index;
-   _start_time = nanoClock();
+   _stopped = false;
+   _dt = 0;
+   _tsc = _getTscRatio() > 0;
+   _start_time = _tsc ? _readTsc() : nanoClock();
 }
 
 _ProfilingTimer::~_ProfilingTimer ()
@@ -36,23 +131,31 @@ _ProfilingTimer::~_ProfilingTimer ()
    stop();
 }
 
+qword _ProfilingTimer::_elapsed () const
+{
+   if (_tsc)
+      return (qword)((_readTsc() - _start_time) * _tsc_ratio.load(std::memory_order_relaxed));
+   return nanoClock() - _start_time;
+}
+
 qword _ProfilingTimer::stop ()
 {
-   if (_name_index == -1)
+   if (_stopped)
       return 0;
 
-   ProfilingSystem &inst = ProfilingSystem::getInstance();
-   _dt = nanoClock() - _start_time;
-   inst.addTimer(_name_index, _dt);
-   _name_index = -1;
+   _dt = _elapsed();
+   _stopped = true;
+
+   if (_name_index != -1)
+      ProfilingSystem::getInstance().addTimer(_name_index, _dt);
    return _dt;
 }
 
 qword _ProfilingTimer::getTime () const
 {
-   if (_name_index == -1)
+   if (_stopped)
       return _dt;
-   return nanoClock() - _start_time;
+   return _elapsed();
 }
 
 float _ProfilingTimer::getTimeSec () const
@@ -61,6 +164,206 @@ float _ProfilingTimer::getTimeSec () const
 }
 
 
+//
+// Per-thread shard of the records
+//
+// Only the owner thread writes the shard, so the values are updated by plain
+// atomic loads and stores. The merge may see a sample half-written, which is
+// acceptable for the statistics. Chunks of the records are never moved.
+//
+// The shard is referenced by the owner thread and by the profiling system
+// and is deleted by the last of them. When the thread exits the shard is
+// marked as retired, and the profiling system folds its records into the
+// shard of the exited threads.
+//
+
+struct ProfilingSystem::_Shard
+{
+   enum { CHUNK_SIZE = 64, MAX_CHUNKS = 1024 };
+
+   struct Data
+   {
+      std::atomic<qword> count, value, max_value;
+      std::atomic<double> square_sum;
+
+      Data ()
+      {
+         reset();
+      }
+
+      void reset ()
+      {
+         count.store(0, std::memory_order_relaxed);
+         value.store(0, std::memory_order_relaxed);
+         max_value.store(0, std::memory_order_relaxed);
+         square_sum.store(0, std::memory_order_relaxed);
+      }
+
+      void add (qword adding_value)
+      {
+         count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+         value.store(value.load(std::memory_order_relaxed) + adding_value, std::memory_order_relaxed);
+         if (adding_value > max_value.load(std::memory_order_relaxed))
+            max_value.store(adding_value, std::memory_order_relaxed);
+
+         double adding_value_dbl = (double)adding_value;
+         square_sum.store(square_sum.load(std::memory_order_relaxed) + adding_value_dbl * adding_value_dbl,
+                          std::memory_order_relaxed);
+      }
+
+      void mergeTo (Record::Data &data) const
+      {
+         data.merge(count.load(std::memory_order_relaxed), value.load(std::memory_order_relaxed),
+                    max_value.load(std::memory_order_relaxed), square_sum.load(std::memory_order_relaxed));
+      }
+
+      // Called under the profiling system lock for the shard of the exited threads
+      void addTo (Data &data) const
+      {
+         data.count.store(data.count.load() + count.load(), std::memory_order_relaxed);
+         data.value.store(data.value.load() + value.load(), std::memory_order_relaxed);
+         if (max_value.load() > data.max_value.load())
+            data.max_value.store(max_value.load(), std::memory_order_relaxed);
+         data.square_sum.store(data.square_sum.load() + square_sum.load(), std::memory_order_relaxed);
+      }
+   };
+
+   struct Record
+   {
+      Data current, total;
+      std::atomic<int> type;
+
+      Record () : type(ProfilingSystem::Record::TYPE_TIMER)
+      {
+      }
+   };
+
+   std::thread::id thread_id;
+   std::atomic<int> current_epoch, total_epoch;
+   std::atomic<int> refs;
+   std::atomic<bool> retired;
+   std::atomic<Record *> chunks[MAX_CHUNKS];
+
+   _Shard (int initial_refs) : current_epoch(0), total_epoch(0), refs(initial_refs), retired(false)
+   {
+      for (int i = 0; i < MAX_CHUNKS; i++)
+         chunks[i].store(0, std::memory_order_relaxed);
+   }
+
+   void release ()
+   {
+      if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+         delete this;
+   }
+
+   ~_Shard ()
+   {
+      for (int i = 0; i < MAX_CHUNKS; i++)
+         delete [] chunks[i].load();
+   }
+
+   // Called by the owner thread. Returns null if there are too many labels.
+   Record * getRecord (int name_index)
+   {
+      int chunk_idx = name_index / CHUNK_SIZE;
+      if (chunk_idx >= MAX_CHUNKS)
+         return 0;
+
+      Record *chunk = chunks[chunk_idx].load(std::memory_order_relaxed);
+      if (chunk == 0)
+      {
+         chunk = new Record[CHUNK_SIZE];
+         chunks[chunk_idx].store(chunk, std::memory_order_release);
+      }
+      return chunk + name_index % CHUNK_SIZE;
+   }
+
+   void reset (bool all)
+   {
+      for (int i = 0; i < MAX_CHUNKS; i++)
+      {
+         Record *chunk = chunks[i].load(std::memory_order_relaxed);
+         if (chunk == 0)
+            continue;
+
+         for (int j = 0; j < CHUNK_SIZE; j++)
+         {
+            chunk[j].current.reset();
+            if (all)
+               chunk[j].total.reset();
+         }
+      }
+   }
+
+   // Adds the records of a retired shard. Called under the profiling system lock.
+   void addFrom (const _Shard &other, bool with_current)
+   {
+      for (int i = 0; i < MAX_CHUNKS; i++)
+      {
+         Record *chunk = other.chunks[i].load(std::memory_order_acquire);
+         if (chunk == 0)
+            continue;
+
+         for (int j = 0; j < CHUNK_SIZE; j++)
+         {
+            if (chunk[j].total.count.load(std::memory_order_relaxed) == 0)
+               continue;
+
+            Record *rec = getRecord(i * CHUNK_SIZE + j);
+            if (rec == 0)
+               continue;
+
+            rec->type.store(chunk[j].type.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            chunk[j].total.addTo(rec->total);
+            if (with_current)
+               chunk[j].current.addTo(rec->current);
+         }
+      }
+   }
+};
+
+//
+// Shards of the current thread
+//
+// The shards are retired and released when the thread exits. Shards of the
+// destroyed profiling systems are released on the next shard lookup.
+//
+
+static thread_local bool _profiling_thread_exited = false;
+
+struct ProfilingSystem::_ThreadShards
+{
+   int cached_instance_id;
+   _Shard *cached_shard;
+   Array<_Shard *> shards;
+
+   _ThreadShards () : cached_instance_id(0), cached_shard(0)
+   {
+   }
+
+   ~_ThreadShards ()
+   {
+      _profiling_thread_exited = true;
+      for (int i = 0; i < shards.size(); i++)
+      {
+         shards[i]->retired.store(true, std::memory_order_release);
+         shards[i]->release();
+      }
+   }
+
+   void releaseOrphaned ()
+   {
+      for (int i = shards.size() - 1; i >= 0; i--)
+         if (shards[i]->refs.load(std::memory_order_acquire) == 1)
+         {
+            shards[i]->release();
+            shards.remove(i);
+         }
+      cached_instance_id = 0;
+      cached_shard = 0;
+   }
+};
+
 //
 // Profiling functionality
 //
@@ -72,15 +375,36 @@ namespace indigo
 DLLEXPORT OsLock _profiling_global_lock, _profiling_global_names_lock;
 }
 ObjArray< Array<char> > ProfilingSystem::_names;
+std::atomic<bool> ProfilingSystem::_enabled(true);
+
+static std::atomic<int> _profiling_instances_count(0);
 
 TL_DECL(ProfilingSystem, _profiling_system);
 
+ProfilingSystem::ProfilingSystem () : _current_epoch(0), _total_epoch(0)
+{
+   _instance_id = ++_profiling_instances_count;
+   _exited_threads_shard = new _Shard(1);
+}
+
+ProfilingSystem::~ProfilingSystem ()
+{
+   for (int i = 0; i < _shards.size(); i++)
+      _shards[i]->release();
+   _exited_threads_shard->release();
+}
+
 ProfilingSystem& ProfilingSystem::getInstance ()
 {
    TL_GET(ProfilingSystem, _profiling_system);
    return _profiling_system;
 }
 
+void ProfilingSystem::setEnabled (bool enabled)
+{
+   _enabled.store(enabled);
+}
+
 int ProfilingSystem::getNameIndex (const char *name, bool add_if_not_exists)
 {
    OsLocker locker(_profiling_global_names_lock);
@@ -96,33 +420,165 @@ int ProfilingSystem::getNameIndex (const char *name, bool add_if_not_exists)
    return _names.size() - 1;
 }
 
-void ProfilingSystem::addTimer (int name_index, qword dt)
+ProfilingSystem::_Shard * ProfilingSystem::_getShard ()
 {
+   // Samples taken by the destructors of other thread-local objects
+   // after the shards of the thread are released are dropped
+   if (_profiling_thread_exited)
+      return 0;
+
+   // The last used shard is cached. Instance ids are never reused, so the
+   // cache can't point to a shard of a destroyed instance.
+   static thread_local _ThreadShards thread_shards;
+
+   if (thread_shards.cached_instance_id == _instance_id)
+      return thread_shards.cached_shard;
+
+   thread_shards.releaseOrphaned();
+
    OsLocker locker(_lock);
+   // Thread ids can be reused, so the shards of the exited threads go first
+   _foldRetiredShardsLocked();
+
+   std::thread::id thread_id = std::this_thread::get_id();
+
+   _Shard *shard = 0;
+   for (int i = 0; i < _shards.size(); i++)
+      if (_shards[i]->thread_id == thread_id)
+         shard = _shards[i];
+
+   if (shard == 0)
+   {
+      shard = new _Shard(2);
+      shard->thread_id = thread_id;
+      shard->current_epoch.store(_current_epoch.load());
+      shard->total_epoch.store(_total_epoch.load());
+      _shards.push(shard);
+      thread_shards.shards.push(shard);
+   }
 
-   _ensureRecordExistanceLocked(name_index);
-   Record &rec = _records[name_index];
-   rec.type = Record::TYPE_TIMER;
-   rec.current.add(dt);
-   rec.total.add(dt);
+   thread_shards.cached_instance_id = _instance_id;
+   thread_shards.cached_shard = shard;
+   return shard;
 }
 
-void ProfilingSystem::addCounter (int name_index, int value)
+void ProfilingSystem::_syncShard (_Shard &shard)
 {
-   OsLocker locker(_lock);
+   int current_epoch = _current_epoch.load(std::memory_order_acquire);
+   int total_epoch = _total_epoch.load(std::memory_order_acquire);
+
+   if (shard.total_epoch.load(std::memory_order_relaxed) != total_epoch)
+      shard.reset(true);
+   else if (shard.current_epoch.load(std::memory_order_relaxed) != current_epoch)
+      shard.reset(false);
+   else
+      return;
 
-   _ensureRecordExistanceLocked(name_index);
-   Record &rec = _records[name_index];
-   rec.type = Record::TYPE_COUNTER;
-   rec.current.add(value);
-   rec.total.add(value);
+   shard.current_epoch.store(current_epoch, std::memory_order_release);
+   shard.total_epoch.store(total_epoch, std::memory_order_release);
+}
+
+void ProfilingSystem::_add (int name_index, qword value, int type)
+{
+   if (name_index < 0 || !isEnabled())
+      return;
+
+   _Shard *shard = _getShard();
+   if (shard == 0)
+      return;
+   _syncShard(*shard);
+
+   _Shard::Record *rec = shard->getRecord(name_index);
+   if (rec == 0)
+      return;
+
+   rec->type.store(type, std::memory_order_relaxed);
+   rec->current.add(value);
+   rec->total.add(value);
+}
+
+void ProfilingSystem::addTimer (int name_index, qword dt)
+{
+   _add(name_index, dt, Record::TYPE_TIMER);
+}
+
+void ProfilingSystem::addCounter (int name_index, int value)
+{
+   _add(name_index, value, Record::TYPE_COUNTER);
 }
 
 void ProfilingSystem::reset (bool all)
 {
-   OsLocker locker(_lock);
+   _current_epoch++;
+   if (all)
+      _total_epoch++;
+}
+
+void ProfilingSystem::_foldRetiredShardsLocked ()
+{
+   _Shard &exited = *_exited_threads_shard;
+   _syncShard(exited);
+
+   for (int i = _shards.size() - 1; i >= 0; i--)
+   {
+      _Shard *shard = _shards[i];
+      if (!shard->retired.load(std::memory_order_acquire))
+         continue;
+
+      // Data of the previous epochs is dropped
+      if (shard->total_epoch.load(std::memory_order_relaxed) == exited.total_epoch.load(std::memory_order_relaxed))
+         exited.addFrom(*shard, shard->current_epoch.load(std::memory_order_relaxed) == exited.current_epoch.load(std::memory_order_relaxed));
+
+      _shards.remove(i);
+      shard->release();
+   }
+}
+
+void ProfilingSystem::_mergeShardLocked (_Shard &shard, int current_epoch, int total_epoch)
+{
+   // Data of the previous epochs is cleared by the owner on its next sample
+   bool total_valid = (shard.total_epoch.load(std::memory_order_acquire) == total_epoch);
+   bool current_valid = total_valid && (shard.current_epoch.load(std::memory_order_acquire) == current_epoch);
+   if (!total_valid)
+      return;
+
+   for (int c = 0; c < _Shard::MAX_CHUNKS; c++)
+   {
+      _Shard::Record *chunk = shard.chunks[c].load(std::memory_order_acquire);
+      if (chunk == 0)
+         continue;
+
+      for (int j = 0; j < _Shard::CHUNK_SIZE; j++)
+      {
+         _Shard::Record &shard_rec = chunk[j];
+         if (shard_rec.total.count.load(std::memory_order_relaxed) == 0)
+            continue;
+
+         int name_index = c * _Shard::CHUNK_SIZE + j;
+         _ensureRecordExistanceLocked(name_index);
+         Record &rec = _records[name_index];
+
+         rec.type = shard_rec.type.load(std::memory_order_relaxed);
+         shard_rec.total.mergeTo(rec.total);
+         if (current_valid)
+            shard_rec.current.mergeTo(rec.current);
+      }
+   }
+}
+
+void ProfilingSystem::_mergeShardsLocked ()
+{
    for (int i = 0; i < _records.size(); i++)
-      _records[i].reset(all);
+      _records[i].reset(true);
+
+   _foldRetiredShardsLocked();
+
+   int current_epoch = _current_epoch.load(std::memory_order_acquire);
+   int total_epoch = _total_epoch.load(std::memory_order_acquire);
+
+   for (int s = 0; s < _shards.size(); s++)
+      _mergeShardLocked(*_shards[s], current_epoch, total_epoch);
+   _mergeShardLocked(*_exited_threads_shard, current_epoch, total_epoch);
 }
 
 int ProfilingSystem::_recordsCmp (int idx1, int idx2, void *context)
@@ -130,15 +586,22 @@ int ProfilingSystem::_recordsCmp (int idx1, int idx2, void *context)
    return strcmp(_names[idx1].ptr(), _names[idx2].ptr());
 }
 
+void ProfilingSystem::_sortRecordsLocked ()
+{
+   while (_sorted_records.size() < _records.size())
+      _sorted_records.push(_sorted_records.size());
+   _sorted_records.qsort(_recordsCmp, this);
+}
+
 void ProfilingSystem::getStatistics (Output &output, bool get_all)
 {
    OsLocker locker(_lock);
+   _mergeShardsLocked();
+
    OsLocker names_locker(_profiling_global_names_lock);
 
    // Print formatted statistics
-   while (_sorted_records.size() < _records.size())
-      _sorted_records.push(_sorted_records.size());
-   _sorted_records.qsort(_recordsCmp, this);
+   _sortRecordsLocked();
 
    // Find maximum name length
    int max_len = 0;
@@ -239,6 +702,9 @@ bool ProfilingSystem::hasLabel (const char *name)
    int name_index = getNameIndex(name, false);
    if (name_index == -1)
       return false;
+
+   OsLocker locker(_lock);
+   _mergeShardsLocked();
    return _hasLabelIndex(name_index);
 }
 
@@ -248,10 +714,53 @@ void ProfilingSystem::_ensureRecordExistanceLocked (int name_index)
       _records.push();
 }
 
+void ProfilingSystem::getStatisticsJson (Output &output, bool total)
+{
+   OsLocker locker(_lock);
+   _mergeShardsLocked();
+
+   OsLocker names_locker(_profiling_global_names_lock);
+   _sortRecordsLocked();
+
+   bool first = true;
+   output.printf("{");
+   for (int i = 0; i < _sorted_records.size(); i++)
+   {
+      int idx = _sorted_records[i];
+      if (!_hasLabelIndex(idx))
+         continue;
+      Record &rec = _records[idx];
+      const Record::Data &data = total ? rec.total : rec.current;
+      if (data.count == 0)
+         continue;
+
+      output.printf(first ? "\"" : ",\"");
+      first = false;
+      for (const char *c = _names[idx].ptr(); *c != 0; c++)
+      {
+         if (*c == '"' || *c == '\\')
+            output.printf("\\%c", *c);
+         else if ((unsigned char)*c >= 0x20)
+            output.printf("%c", *c);
+      }
+
+      double avg_value = (double)data.value / data.count;
+      if (rec.type == Record::TYPE_TIMER)
+         output.printf("\":{\"type\":\"timer\",\"count\":%0.0lf,\"total\":%lf,\"avg\":%lf,\"max\":%lf}",
+            (double)data.count, (double)nanoHowManySeconds(data.value),
+            (double)nanoHowManySeconds((qword)avg_value), (double)nanoHowManySeconds(data.max_value));
+      else
+         output.printf("\":{\"type\":\"counter\",\"count\":%0.0lf,\"total\":%0.0lf,\"avg\":%lf,\"max\":%0.0lf}",
+            (double)data.count, (double)data.value, avg_value, (double)data.max_value);
+   }
+   output.printf("}");
+}
+
 float ProfilingSystem::getLabelExecTime (const char *name, bool total)
 {
    int idx = getNameIndex(name);
    OsLocker locker(_lock);
+   _mergeShardsLocked();
    _ensureRecordExistanceLocked(idx);
 
    if (total)
@@ -264,6 +773,7 @@ qword ProfilingSystem::getLabelValue (const char *name, bool total)
 {
    int idx = getNameIndex(name);
    OsLocker locker(_lock);
+   _mergeShardsLocked();
    _ensureRecordExistanceLocked(idx);
    if (total)
       return _records[idx].total.value;
@@ -276,6 +786,7 @@ qword ProfilingSystem::getLabelCallCount (const char *name, bool total)
 {
    int idx = getNameIndex(name);
    OsLocker locker(_lock);
+   _mergeShardsLocked();
    _ensureRecordExistanceLocked(idx);
    if (total)
       return _records[idx].total.count;
@@ -317,3 +828,12 @@ void ProfilingSystem::Record::Data::add (qword adding_value)
    double adding_value_dbl = (double)adding_value;
    square_sum += adding_value_dbl * adding_value_dbl;
 }
+
+void ProfilingSystem::Record::Data::merge (qword adding_count, qword adding_value, qword adding_max_value,
+                                          double adding_square_sum)
+{
+   count += adding_count;
+   value += adding_value;
+   max_value = __max(max_value, adding_max_value);
+   square_sum += adding_square_sum;
+}
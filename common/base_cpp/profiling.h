@@ -20,14 +20,25 @@
 #include "base_cpp/array.h"
 #include "base_cpp/obj_array.h"
 
+#include <atomic>
+
 #ifdef _WIN32
 #pragma warning(push)
 #pragma warning(disable:4251)
 #endif
 
+// Probes are compiled out when INDIGO_PROFILING_DISABLED is defined and
+// are skipped at runtime when ProfilingSystem::setEnabled(false) is called.
+// Timers still measure the time for profTimerGetTime in both cases.
+#ifdef INDIGO_PROFILING_DISABLED
+#define _PROF_ENABLED() false
+#else
+#define _PROF_ENABLED() indigo::ProfilingSystem::isEnabled()
+#endif
+
 #define _PROF_GET_NAME_INDEX(var_name, name) \
    static int var_name##_name_index;                             \
-   if (var_name##_name_index == 0)                               \
+   if (_PROF_ENABLED() && var_name##_name_index == 0)            \
    {                                                             \
       indigo::OsLocker locker(indigo::_profiling_global_lock);   \
       if (var_name##_name_index == 0) {                          \
@@ -39,7 +50,7 @@
 
 #define profTimerStart(var_name, name) \
    _PROF_GET_NAME_INDEX(var_name, name)   \
-   indigo::_ProfilingTimer var_name##_timer(var_name##_name_index)
+   indigo::_ProfilingTimer var_name##_timer(_PROF_ENABLED() ? var_name##_name_index : -1)
 
 #define profTimerStop(var_name) \
    var_name##_timer.stop()
@@ -52,6 +63,8 @@
 
 #define profIncTimer(name, dt) \
    do {                               \
+      if (!_PROF_ENABLED())           \
+         break;                       \
       _PROF_GET_NAME_INDEX(var_name, name)   \
       indigo::ProfilingSystem &inst = indigo::ProfilingSystem::getInstance(); \
       inst.addTimer(var_name##_name_index, dt); \
@@ -59,6 +72,8 @@
 
 #define profIncCounter(name, count) \
    do {                                       \
+      if (!_PROF_ENABLED())                   \
+         break;                               \
       _PROF_GET_NAME_INDEX(var_name, name)   \
       indigo::ProfilingSystem &inst = indigo::ProfilingSystem::getInstance(); \
       inst.addCounter(var_name##_name_index, count); \
@@ -72,18 +87,35 @@
 namespace indigo {
 class Output;
 
+// Samples are written into per-thread shards without locking. The shards
+// are merged when the statistics are requested. Reset doesn't touch the
+// shards: it starts a new epoch, and each thread clears its own shard on its
+// next sample, while the merge skips the shards of the previous epochs.
 class DLLEXPORT ProfilingSystem
 {
 public:
+   ProfilingSystem ();
+   ~ProfilingSystem ();
+
    static ProfilingSystem& getInstance ();
 
    static int getNameIndex (const char *name, bool add_if_not_exists = true);
 
+   static void setEnabled (bool enabled);
+   static bool isEnabled ()
+   {
+      return _enabled.load(std::memory_order_relaxed);
+   }
+
    void addTimer      (int name_index, qword dt);
    void addCounter    (int name_index, int value);
    void reset         (bool all);
    void getStatistics (Output &output, bool get_all);
 
+   // Prints a JSON object with a member per label: type, count, total, avg
+   // and max. Timer values are in seconds.
+   void getStatisticsJson (Output &output, bool total);
+
    bool  hasLabel            (const char *name);
    float getLabelExecTime    (const char *name, bool total = false);
    qword getLabelValue       (const char *name, bool total = false);
@@ -104,6 +136,8 @@ private:
          void reset ();
 
          void add (qword value);
+
+         void merge (qword count, qword value, qword max_value, double square_sum);
       };
 
       Data current, total;
@@ -113,6 +147,9 @@ private:
       void reset (bool all);
    };
 
+   struct _Shard;
+   struct _ThreadShards;
+
    static int _recordsCmp (int idx1, int idx2, void *context);
 
    void _printTimerData (const Record::Data &data, Output &output);
@@ -121,10 +158,24 @@ private:
    bool _hasLabelIndex (int name_index);
    void _ensureRecordExistanceLocked (int name_index);
 
+   void _add (int name_index, qword value, int type);
+   _Shard * _getShard ();
+   void _syncShard (_Shard &shard);
+   void _foldRetiredShardsLocked ();
+   void _mergeShardLocked (_Shard &shard, int current_epoch, int total_epoch);
+   void _mergeShardsLocked ();
+   void _sortRecordsLocked ();
+
    ObjArray<Record> _records;
    Array<int> _sorted_records;
    OsLock _lock;
 
+   Array<_Shard *> _shards;
+   _Shard *_exited_threads_shard;
+   int _instance_id;
+   std::atomic<int> _current_epoch, _total_epoch;
+
+   static std::atomic<bool> _enabled;
    static ObjArray< Array<char> > _names;
 };
 
@@ -140,7 +191,12 @@ public:
    float getTimeSec () const;
 
 private:
+   qword _elapsed () const;
+
    int _name_index;
+   bool _stopped;
+   // Time is measured by the time stamp counter when it is calibrated
+   bool _tsc;
    qword _start_time, _dt;
 };
 
@@ -0,0 +1,314 @@
+/****************************************************************************
+ * Copyright (C) 2009-2015 EPAM Systems
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * This file may be distributed and/or modified under the terms of the
+ * GNU General Public License version 3 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.
+ *
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ ***************************************************************************/
+
+#include "base_cpp/record_index.h"
+
+#include "base_cpp/scanner.h"
+#include "base_cpp/output.h"
+#include "base_cpp/os_thread_wrapper.h"
+
+#include <string.h>
+#include <algorithm>
+
+using namespace indigo;
+
+IMPL_ERROR(RecordIndex, "record index");
+
+static const char _INDEX_SIGNATURE[4] = {'I', 'R', 'C', 'I'};
+static const int _INDEX_VERSION = 1;
+
+// Chunks smaller than that are not worth a thread
+static const long long _MIN_CHUNK_SIZE = 4194304;
+
+// Offsets are read and written by the blocks of this size
+static const int _IO_BLOCK = 1048576;
+
+namespace
+{
+   struct ChunkCommand : public OsCommand
+   {
+      virtual void execute (OsCommandResult &result);
+
+      const char *data;
+      long long size;
+      long long begin, limit;
+      const RecordSplitter *splitter;
+   };
+
+   struct ChunkResult : public OsCommandResult
+   {
+      virtual void clear () { starts.clear(); }
+
+      // Records that start in [begin, limit) when the scan starts at a
+      // guessed boundary not before begin
+      Array<long long> starts;
+      // Position where the scan stopped, the first record start not
+      // before limit or the end of the last record
+      long long end;
+      bool finished; // there are no records at end
+   };
+
+   // Joins the chunks in their order, see RecordIndex::build()
+   class ChunkDispatcher : public OsCommandDispatcher
+   {
+   public:
+      ChunkDispatcher (const char *data, long long size, const RecordSplitter &splitter,
+                       int chunks, Array<long long> &offsets) :
+         OsCommandDispatcher(HANDLING_ORDER_SERIAL, false),
+         _data(data), _size(size), _splitter(splitter), _chunks(chunks), _offsets(offsets)
+      {
+         _next_chunk = 0;
+         pos = 0;
+         done = false;
+      }
+
+      // The exact scan position
+      long long pos;
+      bool done;
+
+   protected:
+      virtual OsCommand * _allocateCommand () { return new ChunkCommand(); }
+      virtual OsCommandResult * _allocateResult () { return new ChunkResult(); }
+
+      virtual bool _setupCommand (OsCommand &command)
+      {
+         if (_next_chunk == _chunks)
+            return false;
+
+         ChunkCommand &cmd = (ChunkCommand &)command;
+
+         cmd.data = _data;
+         cmd.size = _size;
+         cmd.begin = _size * _next_chunk / _chunks;
+         cmd.limit = _size * (_next_chunk + 1) / _chunks;
+         cmd.splitter = &_splitter;
+         _next_chunk++;
+         return true;
+      }
+
+      virtual void _handleResult (OsCommandResult &result)
+      {
+         ChunkResult &chunk = (ChunkResult &)result;
+
+         while (!done)
+         {
+            if (pos >= chunk.end)
+            {
+               // The chunk has no records after pos
+               if (chunk.finished)
+                  done = true;
+               return;
+            }
+
+            int count = chunk.starts.size();
+            const long long *first = chunk.starts.ptr();
+            const long long *found = std::lower_bound(first, first + count, pos);
+
+            if (found != first + count && *found == pos)
+            {
+               // The guess turned out right, the rest of the chunk is exact
+               for (; found != first + count; found++)
+                  _offsets.push(*found);
+               pos = chunk.end;
+               if (chunk.finished)
+                  done = true;
+               return;
+            }
+
+            long long next = pos;
+
+            if (!_splitter.skipRecord(_data, _size, next))
+               done = true;
+            else
+            {
+               _offsets.push(pos);
+               pos = next;
+            }
+         }
+      }
+
+   private:
+      const char *_data;
+      long long _size;
+      const RecordSplitter &_splitter;
+      int _chunks;
+      int _next_chunk;
+      Array<long long> &_offsets;
+   };
+
+   void ChunkCommand::execute (OsCommandResult &result)
+   {
+      ChunkResult &chunk = (ChunkResult &)result;
+      long long pos = (begin == 0) ? 0 : splitter->findRecordStart(data, size, begin);
+
+      chunk.finished = false;
+      while (pos < limit)
+      {
+         long long next = pos;
+
+         if (!splitter->skipRecord(data, size, next))
+         {
+            chunk.finished = true;
+            break;
+         }
+         chunk.starts.push(pos);
+         pos = next;
+      }
+      chunk.end = pos;
+   }
+}
+
+long long RecordSplitter::_nextLine (const char *data, long long size, long long pos, long long &line_end)
+{
+   // The window grows, so that a file without '\n' is not scanned to the
+   // end for every line
+   long long window = 65536;
+
+   while (1)
+   {
+      long long length = __min(window, size - pos);
+      const char *begin = data + pos;
+      const char *eol = (const char *)memchr(begin, '\n', (size_t)length);
+      const char *cr = (const char *)memchr(begin, '\r', (size_t)(eol != 0 ? eol - begin : length));
+
+      if (cr != 0)
+         eol = cr;
+
+      if (eol != 0)
+      {
+         long long next = eol - data + 1;
+
+         line_end = eol - data;
+         if (*eol == '\r' && next < size && data[next] == '\n')
+            next++;
+         return next;
+      }
+
+      if (length == size - pos)
+      {
+         line_end = size;
+         return size;
+      }
+      window *= 4;
+   }
+}
+
+bool RecordSplitter::_startsWith (const char *line, long long length, const char *prefix)
+{
+   size_t n = strlen(prefix);
+
+   return length >= (long long)n && memcmp(line, prefix, n) == 0;
+}
+
+const char * RecordIndex::getData (Scanner &scanner, long long from, long long &size)
+{
+   long long pos = scanner.tell();
+   long long available = 0;
+   const char *data;
+
+   scanner.seek(from, SEEK_SET);
+   data = scanner.lookAhead(available);
+   scanner.seek(pos, SEEK_SET);
+
+   size = scanner.length() - from;
+   if (data == 0 || available != size)
+      return 0;
+   return data;
+}
+
+void RecordIndex::build (const char *data, long long size, long long base, const RecordSplitter &splitter,
+                         int threads, Array<long long> &offsets, long long &end)
+{
+   int chunks = (int)__min(size / _MIN_CHUNK_SIZE, (long long)threads * 4);
+
+   offsets.clear();
+
+   ChunkDispatcher dispatcher(data, size, splitter, chunks, offsets);
+
+   if (threads > 1 && chunks > 1)
+      dispatcher.run(threads);
+
+   // The tail after the last joined chunk, or everything if the data is
+   // scanned in one thread
+   long long pos = dispatcher.pos;
+
+   if (!dispatcher.done)
+   {
+      long long next = pos;
+
+      while (splitter.skipRecord(data, size, next))
+      {
+         offsets.push(pos);
+         pos = next;
+      }
+   }
+
+   for (int i = 0; i < offsets.size(); i++)
+      offsets[i] += base;
+   end = pos + base;
+}
+
+void RecordIndex::save (Output &output, const Source &source, const Array<long long> &offsets, long long end)
+{
+   output.write(_INDEX_SIGNATURE, sizeof(_INDEX_SIGNATURE));
+   output.writeBinaryInt(_INDEX_VERSION);
+   output.writeByte(source.format);
+   output.write(&source.length, sizeof(source.length));
+   output.write(&source.mtime, sizeof(source.mtime));
+   output.write(&end, sizeof(end));
+   output.writeBinaryInt(offsets.size());
+
+   // Fixed width offsets, the record i is at the header size + 8 * i
+   for (int i = 0; i < offsets.size(); i += _IO_BLOCK)
+   {
+      int count = __min(_IO_BLOCK, offsets.size() - i);
+      output.write(offsets.ptr() + i, count * (int)sizeof(long long));
+   }
+}
+
+void RecordIndex::load (Scanner &input, const Source &source, Array<long long> &offsets, long long &end)
+{
+   char signature[sizeof(_INDEX_SIGNATURE)];
+
+   input.read(sizeof(signature), signature);
+   if (memcmp(signature, _INDEX_SIGNATURE, sizeof(signature)) != 0 || input.readBinaryInt() != _INDEX_VERSION)
+      throw Error("not a record index");
+
+   char format = input.readChar();
+   long long length, mtime;
+
+   input.read(sizeof(length), &length);
+   input.read(sizeof(mtime), &mtime);
+   if (format != source.format || length != source.length || mtime != source.mtime)
+      throw Error("the index belongs to another file");
+
+   input.read(sizeof(end), &end);
+
+   int count = input.readBinaryInt();
+   if (count < 0)
+      throw Error("corrupted record index");
+
+   offsets.clear_resize(count);
+   for (int i = 0; i < count; i += _IO_BLOCK)
+   {
+      int block = __min(_IO_BLOCK, count - i);
+      input.read(block * (int)sizeof(long long), offsets.ptr() + i);
+   }
+
+   for (int i = 1; i < count; i++)
+      if (offsets[i] <= offsets[i - 1])
+         throw Error("corrupted record index");
+   if (count > 0 && (offsets[0] < 0 || end <= offsets[count - 1]))
+      throw Error("corrupted record index");
+}
@@ -0,0 +1,85 @@
+/****************************************************************************
+ * Copyright (C) 2009-2015 EPAM Systems
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * This file may be distributed and/or modified under the terms of the
+ * GNU General Public License version 3 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.
+ *
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ ***************************************************************************/
+
+#ifndef __record_index_h__
+#define __record_index_h__
+
+#include "base_cpp/array.h"
+#include "base_cpp/exception.h"
+
+namespace indigo {
+
+class Scanner;
+class Output;
+
+// Finds the record boundaries of a multi-record text format in memory.
+// skipRecord() must follow the loader of the format exactly, so that the
+// offsets it gives are the ones the loader would store.
+class DLLEXPORT RecordSplitter
+{
+public:
+   virtual ~RecordSplitter () {}
+
+   // Moves pos to the beginning of the next record. Returns false if
+   // there is no record at pos.
+   virtual bool skipRecord (const char *data, long long size, long long &pos) const = 0;
+
+   // Returns the first position not before pos where a record probably
+   // begins. The guess is verified with skipRecord() from a known boundary.
+   virtual long long findRecordStart (const char *data, long long size, long long pos) const = 0;
+
+protected:
+   // Finds the end of the line at pos like Scanner::readLine() does and
+   // returns the beginning of the next line
+   static long long _nextLine (const char *data, long long size, long long pos, long long &line_end);
+
+   static bool _startsWith (const char *line, long long length, const char *prefix);
+};
+
+// Offsets of all records of a file. build() splits the data into chunks
+// that are scanned in parallel: every chunk but the first one starts at a
+// guessed boundary, and the chunks are joined at the first offset that the
+// exact scan from the previous chunk reaches too.
+//
+// The offsets can be saved next to the source file to get the random
+// access from a cold start. The index keeps the source length and
+// modification time, load() throws if they don't match.
+class DLLEXPORT RecordIndex
+{
+public:
+   struct Source
+   {
+      char format; // the loader, the offsets of different formats differ
+      long long length;
+      long long mtime;
+   };
+
+   // Returns the whole input after from if it is in memory (mapped file or
+   // buffer), 0 otherwise. The scanner position is kept.
+   static const char * getData (Scanner &scanner, long long from, long long &size);
+
+   // Fills the offsets of the records of data, shifted by base. end is set
+   // to the end of the last record.
+   static void build (const char *data, long long size, long long base, const RecordSplitter &splitter,
+                      int threads, Array<long long> &offsets, long long &end);
+
+   static void save (Output &output, const Source &source, const Array<long long> &offsets, long long end);
+   static void load (Scanner &input, const Source &source, Array<long long> &offsets, long long &end);
+
+   DECL_ERROR;
+};
+
+}
+
+#endif
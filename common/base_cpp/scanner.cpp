@@ -25,6 +25,18 @@
 
 #include <limits>
 
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+
 using namespace indigo;
 
 enum { MAX_LINE_LENGTH = 1048576 };
@@ -349,6 +361,12 @@ bool Scanner::skipLine ()
    return false;
 }
 
+const char * Scanner::lookAhead (long long &available)
+{
+   available = 0;
+   return 0;
+}
+
 void Scanner::read (int length, Array<char> &buf)
 {
    buf.resize(length);
@@ -378,6 +396,39 @@ void Scanner::appendLine (Array<char> &out, bool append_zero)
 
    do
    {
+      long long available;
+      const char *chunk = lookAhead(available);
+
+      if (chunk != 0 && available > 0)
+      {
+         // Look for the line end in the buffered bytes instead of
+         // reading them one by one
+         int size = (int)__min(available, (long long)MAX_LINE_LENGTH + 1);
+         const char *eol = (const char *)memchr(chunk, '\n', size);
+         const char *cr = (const char *)memchr(chunk, '\r', eol != 0 ? (int)(eol - chunk) : size);
+
+         if (cr != 0)
+            eol = cr;
+
+         int length = (eol != 0) ? (int)(eol - chunk) : size;
+         out.concat(chunk, length);
+
+         if (out.size() > MAX_LINE_LENGTH)
+            throw Error("Line length is too long. Probably the file format is not correct.");
+
+         if (eol == 0)
+         {
+            skip(length);
+            continue;
+         }
+
+         char terminator = *eol;
+         skip(length + 1);
+         if (terminator == '\r' && lookNext() == '\n')
+            skip(1);
+         break;
+      }
+
       char c = readChar();
 
       if (c == '\r')
@@ -508,7 +559,12 @@ bool Scanner::isSingleLine (Scanner &scanner)
 
 FileScanner::FileScanner (Encoding filename_encoding, const char *filename)
 {
-   _init(filename_encoding, filename);
+   _init(filename_encoding, filename, true);
+}
+
+FileScanner::FileScanner (Encoding filename_encoding, const char *filename, bool use_mmap)
+{
+   _init(filename_encoding, filename, use_mmap);
 }
 
 FileScanner::FileScanner (const char *format, ...)
@@ -521,13 +577,18 @@ FileScanner::FileScanner (const char *format, ...)
    vsnprintf(filename, sizeof(filename), format, args);
    va_end(args);
 
-   _init(ENCODING_ASCII, filename);
+   _init(ENCODING_ASCII, filename, true);
 }
 
-void FileScanner::_init (Encoding filename_encoding, const char *filename)
+void FileScanner::_init (Encoding filename_encoding, const char *filename, bool use_mmap)
 {
    _file = 0;
    _file_len = 0LL;
+   _mapping = 0;
+   _mapping_pos = 0LL;
+#ifdef _WIN32
+   _mapping_handle = 0;
+#endif
 
    if (filename == 0)
       throw Error("null filename");
@@ -546,11 +607,84 @@ void FileScanner::_init (Encoding filename_encoding, const char *filename)
    _file_len = ftello(_file);
    fseeko(_file, 0LL, SEEK_SET);
 #endif
+
+   if (use_mmap && _file_len > 0)
+      _map();
+
+   if (_mapping == 0)
+      _cache.resize(CACHE_SIZE);
    _invalidateCache();
 }
 
+// Maps the whole file if it is a regular one. The stdio reading
+// is used if anything goes wrong.
+void FileScanner::_map ()
+{
+   if ((unsigned long long)_file_len > (unsigned long long)std::numeric_limits<size_t>::max())
+      return;
+
+#ifdef _WIN32
+   HANDLE file = (HANDLE)_get_osfhandle(_fileno(_file));
+
+   if (file == INVALID_HANDLE_VALUE || GetFileType(file) != FILE_TYPE_DISK)
+      return;
+
+   HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+   if (mapping == NULL)
+      return;
+
+   void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+   if (view == NULL)
+   {
+      CloseHandle(mapping);
+      return;
+   }
+
+   _mapping_handle = mapping;
+   _mapping = (const char *)view;
+#else
+   int fd = fileno(_file);
+   struct stat st;
+
+   if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size != _file_len)
+      return;
+
+   void *view = mmap(0, (size_t)_file_len, PROT_READ, MAP_PRIVATE, fd, 0);
+
+   if (view == MAP_FAILED)
+      return;
+
+   madvise(view, (size_t)_file_len, MADV_SEQUENTIAL);
+   _mapping = (const char *)view;
+#endif
+}
+
+void FileScanner::_unmap ()
+{
+   if (_mapping == 0)
+      return;
+
+#ifdef _WIN32
+   UnmapViewOfFile(_mapping);
+   CloseHandle((HANDLE)_mapping_handle);
+   _mapping_handle = 0;
+#else
+   munmap((void *)_mapping, (size_t)_file_len);
+#endif
+   _mapping = 0;
+}
+
 int FileScanner::lookNext ()
 {
+   if (_mapping != 0)
+   {
+      if (_mapping_pos >= _file_len)
+         return -1;
+      return (unsigned char)_mapping[_mapping_pos];
+   }
+
    _validateCache();
    if (_cache_pos == _max_cache)
       return -1;
@@ -569,13 +703,16 @@ void FileScanner::_validateCache ()
    if (_cache_pos < _max_cache)
       return;
 
-   size_t nread = fread(_cache, 1, NELEM(_cache), _file);
+   size_t nread = fread(_cache.ptr(), 1, _cache.size(), _file);
    _max_cache = static_cast<int>(nread);
    _cache_pos = 0;
 }
 
 long long FileScanner::tell ()
 {
+   if (_mapping != 0)
+      return _mapping_pos;
+
    _validateCache();
 #ifdef _WIN32
    return _ftelli64(_file) - _max_cache + _cache_pos;
@@ -586,8 +723,18 @@ long long FileScanner::tell ()
 
 void FileScanner::read (int length, void *res)
 {
+   if (_mapping != 0)
+   {
+      if (length > _file_len - _mapping_pos)
+         throw Error("FileScanner::read() error");
+
+      memcpy(res, _mapping + _mapping_pos, length);
+      _mapping_pos += length;
+      return;
+   }
+
    int to_read_from_cache = __min(length, _max_cache - _cache_pos);
-   memcpy(res, _cache + _cache_pos, to_read_from_cache);
+   memcpy(res, _cache.ptr() + _cache_pos, to_read_from_cache);
    _cache_pos += to_read_from_cache;
 
    if (to_read_from_cache != length)
@@ -604,6 +751,8 @@ bool FileScanner::isEOF ()
 {
    if (_file == NULL)
       return true;
+   if (_mapping != 0)
+      return _mapping_pos >= _file_len;
    if (_cache_pos < _max_cache)
       return false;
 
@@ -612,6 +761,17 @@ bool FileScanner::isEOF ()
 
 void FileScanner::skip (int n)
 {
+   if (_mapping != 0)
+   {
+      if (n > _file_len - _mapping_pos)
+      {
+         _mapping_pos = _file_len;
+         throw Error("skip() passes after end of file");
+      }
+      _mapping_pos += n;
+      return;
+   }
+
    _validateCache();
    _cache_pos += n;
 
@@ -632,6 +792,18 @@ void FileScanner::skip (int n)
 
 void FileScanner::seek (long long pos, int from)
 {
+   if (_mapping != 0)
+   {
+      if (from == SEEK_CUR)
+         pos += _mapping_pos;
+      else if (from == SEEK_END)
+         pos += _file_len;
+
+      if (pos >= 0)
+         _mapping_pos = pos;
+      return;
+   }
+
 #ifdef _WIN32
    if (from == SEEK_CUR)
       _fseeki64(_file, pos - _max_cache + _cache_pos, from);
@@ -651,16 +823,53 @@ long long FileScanner::length ()
    return _file_len;
 }
 
+long long FileScanner::modificationTime ()
+{
+#ifdef _WIN32
+   struct _stat64 st;
+
+   if (_fstat64(_fileno(_file), &st) != 0)
+#else
+   struct stat st;
+
+   if (fstat(fileno(_file), &st) != 0)
+#endif
+      throw Error("can not get the file status: %s", strerror(errno));
+
+   return (long long)st.st_mtime;
+}
+
 char FileScanner::readChar ()
 {
+   if (_mapping != 0)
+   {
+      if (_mapping_pos >= _file_len)
+         throw Error("readChar() passes after end of file");
+      return _mapping[_mapping_pos++];
+   }
+
    _validateCache();
    if (_cache_pos == _max_cache)
       throw Error("readChar() passes after end of file");
    return _cache[_cache_pos++];
 }
 
+const char * FileScanner::lookAhead (long long &available)
+{
+   if (_mapping != 0)
+   {
+      available = __max(_file_len - _mapping_pos, 0LL);
+      return _mapping + _mapping_pos;
+   }
+
+   _validateCache();
+   available = _max_cache - _cache_pos;
+   return (const char *)_cache.ptr() + _cache_pos;
+}
+
 FileScanner::~FileScanner ()
 {
+   _unmap();
    if (_file != NULL)
       fclose(_file);
 }
@@ -740,6 +949,18 @@ long long BufferScanner::tell ()
    return _offset;
 }
 
+const char * BufferScanner::lookAhead (long long &available)
+{
+   if (_size < 0)
+   {
+      available = 0;
+      return 0;
+   }
+
+   available = __max(_size - _offset, 0);
+   return _buffer + _offset;
+}
+
 const void * BufferScanner::curptr ()
 {
    return _buffer + _offset;
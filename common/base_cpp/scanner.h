@@ -41,6 +41,11 @@ public:
    virtual byte readByte ();
    virtual void readAll (Array<char> &arr);
 
+   // Returns the bytes from the current position on that are already in
+   // memory, or 0 if the scanner has no such buffer. The pointer is valid
+   // until the next call that moves the position.
+   virtual const char * lookAhead (long long &available);
+
    void read (int length, Array<char> &buf);
 
    void readLine (Array<char> &out, bool append_zero);
@@ -86,7 +91,10 @@ protected:
 class DLLEXPORT FileScanner : public Scanner
 {
 public:
+   // Regular files are memory-mapped by default. The mapped file must not be
+   // truncated while the scanner is alive.
    FileScanner (Encoding filename_encoding, const char *filename);
+   FileScanner (Encoding filename_encoding, const char *filename, bool use_mmap);
    explicit FileScanner (const char *format, ...);
    virtual ~FileScanner ();
 
@@ -99,16 +107,36 @@ public:
    virtual long long tell ();
 
    virtual char readChar ();
+   virtual const char * lookAhead (long long &available);
+
+   bool isMapped () const { return _mapping != 0; }
+
+   // Last modification time of the file, in seconds since the epoch
+   long long modificationTime ();
 private:
+   enum
+   {
+      CACHE_SIZE = 65536
+   };
+
    FILE *_file;
    long long _file_len;
 
-   unsigned char _cache[1024];
+   // The whole file if it is mapped
+   const char *_mapping;
+   long long _mapping_pos;
+#ifdef _WIN32
+   void *_mapping_handle;
+#endif
+
+   Array<unsigned char> _cache;
    int _cache_pos, _max_cache;
 
    void _validateCache ();
    void _invalidateCache ();
-   void _init (Encoding filename_encoding, const char *filename);
+   void _init (Encoding filename_encoding, const char *filename, bool use_mmap);
+   void _map ();
+   void _unmap ();
 
    // no implicit copy
    FileScanner (const FileScanner &);
@@ -131,6 +159,7 @@ public:
    virtual long long length ();
    virtual long long tell ();
    virtual byte readByte ();
+   virtual const char * lookAhead (long long &available);
 
    const void * curptr ();
 private:
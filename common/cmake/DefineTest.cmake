@@ -9,3 +9,17 @@ macro (DEFINE_TEST test files libs)
 	set_property(TARGET ${test} PROPERTY FOLDER "tests")
 	add_test(NAME ${test} COMMAND ${test})
 endmacro()
+
+# Benchmarks are built with the tests but are not run by ctest. The shared
+# fixtures of the benchmarks are in bench-fixtures.h under api/tests/c
+function (ADD_INDIGO_BENCH bench source)
+	add_executable(${bench} ${source})
+	set_property(TARGET ${bench} APPEND PROPERTY INCLUDE_DIRECTORIES ${Indigo_SOURCE_DIR}/tests/c)
+	target_link_libraries(${bench} ${ARGN} indigo-shared)
+
+	if(UNIX OR APPLE)
+		target_link_libraries(${bench} pthread)
+	endif()
+
+	set_property(TARGET ${bench} PROPERTY FOLDER "tests")
+endfunction()
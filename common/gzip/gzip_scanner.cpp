@@ -20,6 +20,12 @@ IMPL_ERROR(GZipScanner, "GZip scanner");
 
 CP_DEF(GZipScanner);
 
+static const char _INDEX_SIGNATURE[4] = {'I', 'G', 'Z', 'I'};
+static const int _INDEX_VERSION = 1;
+
+// Size of the data at the beginning of the source that identifies it
+static const int _SIGNATURE_DATA_SIZE = 4096;
+
 GZipScanner::GZipScanner (Scanner &source) :
 _source(source),
 CP_INIT,
@@ -43,13 +49,18 @@ TL_CP_GET(_outbuf)
 
    _outbuf.clear_resize(CHUNK_SIZE);
    _inbuf.clear_resize(CHUNK_SIZE);
+   _outbuf_begin = 0;
    _outbuf_start = 0;
-   _inbuf_end = 0;
-   _uncompressed_total = 0;
+   _outbuf_end = 0;
+   _outbuf_full = false;
+   _position = 0;
    _eof = false;
 
-   _zstream.avail_out = _outbuf.size();
-   _zstream.next_out = _outbuf.ptr();
+   _source_start = _source.tell();
+   _checkpoint_span = DEFAULT_CHECKPOINT_SPAN;
+   _index_complete = false;
+   _index_changed = false;
+   _total_length = 0;
 }
 
 GZipScanner::~GZipScanner ()
@@ -57,98 +68,241 @@ GZipScanner::~GZipScanner ()
    inflateEnd(&_zstream);
 }
 
-void GZipScanner::read (int length, void *res)
+void GZipScanner::_readSource ()
 {
-   if (res == 0)
-      throw Error("zero pointer given");
+   long long available;
+   const char *chunk = _source.lookAhead(available);
+   int n = 0;
 
-   if (_outbuf_start < _outbuf.size() - (int)_zstream.avail_out)
+   if (chunk != 0 && available > 0)
    {
-      int n = __min(length, CHUNK_SIZE - (int)_zstream.avail_out - _outbuf_start);
-
-      memcpy(res, _outbuf.ptr() + _outbuf_start, n);
-      _outbuf_start += n;
-      _uncompressed_total += n;
-      length -= n;
-      res = (char *)res + n;
+      n = (int)__min(available, (long long)_inbuf.size());
+      memcpy(_inbuf.ptr(), chunk, n);
+      _source.skip(n);
+   }
+   else
+   {
+      do
+      {
+         _inbuf[n++] = _source.readChar();
+      } while (!_source.isEOF() && n < _inbuf.size());
    }
 
-   if (!_read(length, res))
-      throw Error("end of compressed data");
+   _zstream.avail_in = n;
+   _zstream.next_in = _inbuf.ptr();
 }
 
-bool GZipScanner::_read (int length, void *res)
+// Inflates the data that follows the consumed one. Returns false at
+// the end of the compressed stream.
+bool GZipScanner::_inflateNext ()
 {
-   while (length > 0)
+   while (!_eof)
    {
-      if (_eof)
-         return false;
-
-      if (_zstream.avail_in == 0)
+      if (_outbuf_end == _outbuf.size())
       {
-         _inbuf_end = 0;
-
-         if (_source.isEOF())
-            throw Error("end of file in source stream");
-
-         do
-         {
-            _inbuf[_inbuf_end++] = _source.readChar();
-         } while (!_source.isEOF() && _inbuf_end < _inbuf.size());
-         _zstream.avail_in = _inbuf_end;
-         _zstream.next_in = _inbuf.ptr();
+         _outbuf_end = 0;
+         _outbuf_full = true;
       }
 
-      _zstream.avail_out = _outbuf.size();
-      _zstream.next_out = _outbuf.ptr();
-      _outbuf_start = 0;
+      // Some output can be pending in the inflate state, so the end of
+      // the source is an error only if no progress is possible
+      if (_zstream.avail_in == 0 && !_source.isEOF())
+         _readSource();
 
-      int rc = inflate(&_zstream, Z_NO_FLUSH);
+      _zstream.avail_out = _outbuf.size() - _outbuf_end;
+      _zstream.next_out = _outbuf.ptr() + _outbuf_end;
+
+      // Z_BLOCK stops at the block boundaries, where the checkpoints are taken
+      int rc = inflate(&_zstream, Z_BLOCK);
 
       if (rc == Z_STREAM_ERROR)
          throw Error("inconsistent stream structure");
 
       if (rc == Z_NEED_DICT)
-      {
-         inflateEnd(&_zstream);
          throw Error("need a dictionary");
-      }
 
       if (rc == Z_MEM_ERROR)
-      {
-         inflateEnd(&_zstream);
          throw Error("not enough memory");
-      }
 
       if (rc == Z_DATA_ERROR)
-      {
-         inflateEnd(&_zstream);
          throw Error("corrupted input data");
-      }
 
       if (rc == Z_BUF_ERROR)
-         throw Error("Z_BUF_ERROR (workaround not implemented)");
+         throw Error("end of file in source stream");
 
       if (rc != Z_OK && rc != Z_STREAM_END)
          throw Error("unknown zlib error code: %d", rc);
 
-      int n = __min(length, CHUNK_SIZE - (int)_zstream.avail_out - _outbuf_start);
+      int produced = _outbuf.size() - _outbuf_end - (int)_zstream.avail_out;
 
-      if (n > 0 && res != 0)
+      if (produced > 0)
       {
-         memcpy(res, _outbuf.ptr(), n);
-         _outbuf_start += n;
-         _uncompressed_total += n;
-         res = (char *)res + n;
+         _outbuf_begin = _outbuf_end;
+         _outbuf_start = _outbuf_end;
+         _outbuf_end += produced;
       }
 
-      length -= n;
-      
+      long long out = _position + produced;
+
       if (rc == Z_STREAM_END)
+      {
          _eof = true;
+         if (!_index_complete)
+         {
+            _index_complete = true;
+            _index_changed = true;
+            _total_length = out;
+         }
+      }
+      else if ((_zstream.data_type & 128) && !(_zstream.data_type & 64))
+         _addCheckpoint(out);
+
+      if (produced > 0)
+         return true;
+   }
+
+   return false;
+}
+
+void GZipScanner::_addCheckpoint (long long out)
+{
+   long long last = (_checkpoints.size() > 0) ? _checkpoints.top().out : 0;
+
+   if (_index_complete || out - last < _checkpoint_span)
+      return;
+
+   Checkpoint &point = _checkpoints.push();
+
+   point.in = _source.tell() - _zstream.avail_in;
+   point.out = out;
+   point.bits = _zstream.data_type & 7;
+
+   // The window is the last CHUNK_SIZE bytes of the output
+   QS_DEF(Array<Bytef>, window);
+
+   if (_outbuf_full)
+   {
+      window.copy(_outbuf.ptr() + _outbuf_end, _outbuf.size() - _outbuf_end);
+      window.concat(_outbuf.ptr(), _outbuf_end);
+   }
+   else
+      window.copy(_outbuf.ptr(), _outbuf_end);
+
+   uLongf packed_size = compressBound(window.size());
+
+   point.window.resize((int)packed_size);
+   if (compress2(point.window.ptr(), &packed_size, window.ptr(), window.size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+      throw Error("can not compress the checkpoint window");
+   point.window.resize((int)packed_size);
+   point.window_size = window.size();
+
+   _index_changed = true;
+}
+
+int GZipScanner::_findCheckpoint (long long pos)
+{
+   // Last checkpoint at or before pos, -1 for the beginning of the stream
+   int lo = 0, hi = _checkpoints.size();
+
+   while (lo < hi)
+   {
+      int mid = (lo + hi) / 2;
+
+      if (_checkpoints[mid].out <= pos)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   return lo - 1;
+}
+
+void GZipScanner::_restart (int checkpoint)
+{
+   _zstream.avail_in = 0;
+   _zstream.next_in = Z_NULL;
+   _outbuf_begin = 0;
+   _outbuf_start = 0;
+   _outbuf_end = 0;
+   _outbuf_full = false;
+   _eof = false;
+
+   if (checkpoint < 0)
+   {
+      if (inflateReset2(&_zstream, 16 + MAX_WBITS) != Z_OK)
+         throw Error("can not reset the stream");
+      _source.seek(_source_start, SEEK_SET);
+      _position = 0;
+      return;
+   }
+
+   Checkpoint &point = _checkpoints[checkpoint];
+
+   // Raw deflate data from the block boundary
+   if (inflateReset2(&_zstream, -MAX_WBITS) != Z_OK)
+      throw Error("can not reset the stream");
+
+   if (point.bits > 0)
+   {
+      _source.seek(point.in - 1, SEEK_SET);
+      int ch = _source.readByte();
+      inflatePrime(&_zstream, point.bits, ch >> (8 - point.bits));
+   }
+   else
+      _source.seek(point.in, SEEK_SET);
+
+   // The window is unpacked right into the output buffer, so the
+   // following checkpoints take it from there
+   uLongf window_size = _outbuf.size();
+
+   if (uncompress(_outbuf.ptr(), &window_size, point.window.ptr(), point.window.size()) != Z_OK ||
+       (int)window_size != point.window_size)
+      throw Error("corrupted checkpoint at %lld", point.out);
+
+   inflateSetDictionary(&_zstream, _outbuf.ptr(), (uInt)window_size);
+
+   _outbuf_full = ((int)window_size == _outbuf.size());
+   _outbuf_end = _outbuf_full ? 0 : (int)window_size;
+   _outbuf_begin = _outbuf_end;
+   _outbuf_start = _outbuf_end;
+   _position = point.out;
+}
+
+void GZipScanner::_skipForward (long long length)
+{
+   while (length > 0)
+   {
+      if (_outbuf_start == _outbuf_end && !_inflateNext())
+         throw Error("end of compressed data");
+
+      int n = (int)__min(length, (long long)(_outbuf_end - _outbuf_start));
+
+      _outbuf_start += n;
+      _position += n;
+      length -= n;
+   }
+}
+
+void GZipScanner::read (int length, void *res)
+{
+   if (res == 0)
+      throw Error("zero pointer given");
+
+   char *out = (char *)res;
+
+   while (length > 0)
+   {
+      if (_outbuf_start == _outbuf_end && !_inflateNext())
+         throw Error("end of compressed data");
+
+      int n = __min(length, _outbuf_end - _outbuf_start);
+
+      memcpy(out, _outbuf.ptr() + _outbuf_start, n);
+      _outbuf_start += n;
+      _position += n;
+      out += n;
+      length -= n;
    }
-   
-   return true;
 }
 
 void GZipScanner::readAll (Array<char> &arr)
@@ -156,59 +310,214 @@ void GZipScanner::readAll (Array<char> &arr)
    arr.clear();
 
    while (!isEOF())
-      arr.push(readByte());
-}
+   {
+      int n = _outbuf_end - _outbuf_start;
 
+      arr.concat((char *)_outbuf.ptr() + _outbuf_start, n);
+      _outbuf_start += n;
+      _position += n;
+   }
+}
 
 void GZipScanner::skip (int length)
 {
-   QS_DEF(Array<char>, dummy);
-
-   dummy.clear_resize(length);
-   read(length, dummy.ptr());
+   _skipForward(length);
 }
 
 long long GZipScanner::tell ()
 {
-   return _uncompressed_total;
+   return _position;
 }
 
 bool GZipScanner::isEOF ()
 {
-   if ((unsigned)_outbuf_start + _zstream.avail_out == (unsigned)_outbuf.size())
-   {
-      if (_eof)
-         return true;
-      _read(1, 0);
-   }
-   return _eof && (unsigned)_outbuf_start + _zstream.avail_out == (unsigned)_outbuf.size();
+   if (_outbuf_start < _outbuf_end)
+      return false;
+
+   return !_inflateNext();
 }
 
 void GZipScanner::seek (long long pos, int from)
 {
-   throw Error("not implemented");
+   if (from == SEEK_CUR)
+      pos += _position;
+   else if (from == SEEK_END)
+      pos += length();
+
+   if (pos < 0)
+      throw Error("seek() before the beginning of the data");
+
+   // The target is in the last inflate output
+   long long begin = _position - (_outbuf_start - _outbuf_begin);
+   long long end = _position + (_outbuf_end - _outbuf_start);
+
+   if (pos >= begin && pos <= end)
+   {
+      _outbuf_start = _outbuf_begin + (int)(pos - begin);
+      _position = pos;
+      return;
+   }
+
+   int checkpoint = _findCheckpoint(pos);
+   long long checkpoint_out = (checkpoint >= 0) ? _checkpoints[checkpoint].out : 0;
+
+   if (pos < _position || checkpoint_out > _position)
+      _restart(checkpoint);
+
+   _skipForward(pos - _position);
 }
 
 int GZipScanner::lookNext ()
 {
-   if (_outbuf_start < _outbuf.size() - (int)_zstream.avail_out)
-      return _outbuf[_outbuf_start];
-
-   if (_eof)
+   if (_outbuf_start == _outbuf_end && !_inflateNext())
       return -1;
 
-   _read(1, 0);
-
-   if (_eof)
-      return -1;
+   return _outbuf[_outbuf_start];
+}
 
-   if (_outbuf_start < _outbuf.size() - (int)_zstream.avail_out)
-      return _outbuf[_outbuf_start];
+const char * GZipScanner::lookAhead (long long &available)
+{
+   if (_outbuf_start == _outbuf_end)
+      _inflateNext();
 
-   throw Error("internal");
+   available = _outbuf_end - _outbuf_start;
+   return (const char *)_outbuf.ptr() + _outbuf_start;
 }
 
 long long GZipScanner::length ()
 {
-   throw Error("not implemented");
+   if (!_index_complete)
+   {
+      // The length is known after the whole stream is decompressed once
+      long long pos = _position;
+
+      while (!isEOF())
+         _skipForward(_outbuf_end - _outbuf_start);
+
+      seek(pos, SEEK_SET);
+   }
+
+   return _total_length;
+}
+
+void GZipScanner::setCheckpointSpan (long long span)
+{
+   if (_position != 0 || _checkpoints.size() > 0)
+      throw Error("checkpoint span must be set before reading");
+
+   // A checkpoint needs a full window before it
+   _checkpoint_span = __max(span, (long long)CHUNK_SIZE);
+}
+
+bool GZipScanner::isIndexChanged ()
+{
+   return _index_changed;
+}
+
+dword GZipScanner::_sourceSignature ()
+{
+   QS_DEF(Array<char>, head);
+   long long pos = _source.tell();
+
+   _source.seek(_source_start, SEEK_SET);
+   head.clear();
+   while (head.size() < _SIGNATURE_DATA_SIZE && !_source.isEOF())
+      head.push(_source.readChar());
+   _source.seek(pos, SEEK_SET);
+
+   return (dword)crc32(0L, (const Bytef *)head.ptr(), head.size());
+}
+
+void GZipScanner::saveIndex (Output &output)
+{
+   long long source_length = _source.length() - _source_start;
+   dword source_signature = _sourceSignature();
+   byte complete = _index_complete ? 1 : 0;
+
+   output.write(_INDEX_SIGNATURE, sizeof(_INDEX_SIGNATURE));
+   output.writeBinaryInt(_INDEX_VERSION);
+   output.write(&source_length, sizeof(source_length));
+   output.writeBinaryDword(source_signature);
+   output.write(&_checkpoint_span, sizeof(_checkpoint_span));
+   output.writeByte(complete);
+   output.write(&_total_length, sizeof(_total_length));
+   output.writeBinaryInt(_checkpoints.size());
+
+   for (int i = 0; i < _checkpoints.size(); i++)
+   {
+      Checkpoint &point = _checkpoints[i];
+
+      output.write(&point.in, sizeof(point.in));
+      output.write(&point.out, sizeof(point.out));
+      output.writeByte((byte)point.bits);
+      output.writeBinaryInt(point.window_size);
+      output.writeBinaryInt(point.window.size());
+      output.write(point.window.ptr(), point.window.size());
+   }
+
+   _index_changed = false;
+}
+
+void GZipScanner::loadIndex (Scanner &input)
+{
+   char signature[sizeof(_INDEX_SIGNATURE)];
+
+   input.read(sizeof(signature), signature);
+   if (memcmp(signature, _INDEX_SIGNATURE, sizeof(signature)) != 0 || input.readBinaryInt() != _INDEX_VERSION)
+      throw Error("not a gzip index");
+
+   long long source_length, span, total_length;
+
+   input.read(sizeof(source_length), &source_length);
+   dword source_signature = input.readBinaryDword();
+   if (source_length != _source.length() - _source_start || source_signature != _sourceSignature())
+      throw Error("the index belongs to another file");
+
+   input.read(sizeof(span), &span);
+   if (span != _checkpoint_span)
+      throw Error("the index has checkpoint span %lld, expected %lld", span, _checkpoint_span);
+
+   bool complete = (input.readByte() != 0);
+   input.read(sizeof(total_length), &total_length);
+
+   int count = input.readBinaryInt();
+   ObjArray<Checkpoint> checkpoints;
+
+   for (int i = 0; i < count; i++)
+   {
+      Checkpoint &point = checkpoints.push();
+
+      input.read(sizeof(point.in), &point.in);
+      input.read(sizeof(point.out), &point.out);
+      point.bits = input.readByte();
+      point.window_size = input.readBinaryInt();
+
+      int packed_size = input.readBinaryInt();
+      if (point.bits > 7 || point.window_size > CHUNK_SIZE || packed_size < 0 ||
+          (i > 0 && point.out <= checkpoints[i - 1].out))
+         throw Error("corrupted gzip index");
+
+      point.window.resize(packed_size);
+      input.read(packed_size, point.window.ptr());
+   }
+
+   // Checkpoints the scanner has already found are replaced, they are the same
+   _checkpoints.clear();
+   for (int i = 0; i < checkpoints.size(); i++)
+   {
+      Checkpoint &point = _checkpoints.push();
+
+      point.in = checkpoints[i].in;
+      point.out = checkpoints[i].out;
+      point.bits = checkpoints[i].bits;
+      point.window_size = checkpoints[i].window_size;
+      point.window.copy(checkpoints[i].window);
+   }
+
+   if (complete)
+   {
+      _index_complete = true;
+      _total_length = total_length;
+   }
+   _index_changed = false;
 }
@@ -16,16 +16,27 @@
 #define __gzip_scanner__
 
 #include "base_cpp/scanner.h"
+#include "base_cpp/output.h"
+#include "base_cpp/obj_array.h"
 #include "base_cpp/tlscont.h"
 
 #include <zlib.h>
 
 namespace indigo {
 
+// Decompresses a gzip stream. The scanner is seekable: on the first pass
+// over the data it records checkpoints (the inflate state at a deflate
+// block boundary) every checkpoint span of the uncompressed data, and
+// seek() restarts the decompression from the nearest checkpoint before
+// the target. The checkpoint index can be saved and loaded to skip the
+// first pass over a large file.
 class GZipScanner : public Scanner
 {
 public:
+   // The output buffer keeps the last CHUNK_SIZE bytes, that is the
+   // deflate window for the checkpoints
    enum { CHUNK_SIZE = 32768 };
+   enum { DEFAULT_CHECKPOINT_SPAN = 4194304 };
 
    explicit GZipScanner (Scanner &source);
    virtual ~GZipScanner ();
@@ -38,21 +49,59 @@ public:
    virtual void skip (int length);
    virtual long long length ();
    virtual void readAll (Array<char> &arr);
+   virtual const char * lookAhead (long long &available);
+
+   // Sets the distance between the checkpoints. It must be set before
+   // the data is read.
+   void setCheckpointSpan (long long span);
+
+   // The index is bound to the compressed data: loadIndex() throws if
+   // it was saved for another file or with another span.
+   void saveIndex (Output &output);
+   void loadIndex (Scanner &input);
+
+   // True if checkpoints were added after the construction or loadIndex()
+   bool isIndexChanged ();
 
    DECL_ERROR;
 protected:
+   struct Checkpoint
+   {
+      long long in;  // offset of the first byte of the block in the source
+      long long out; // offset in the uncompressed data
+      int bits;      // bits of the byte at in - 1 that belong to the block
+      int window_size;
+      Array<Bytef> window; // deflate window, compressed
+   };
+
    Scanner  &_source;
    z_stream  _zstream;
+   long long _source_start;
+
+   bool _inflateNext ();
+   void _readSource ();
+   void _addCheckpoint (long long out);
+   void _restart (int checkpoint);
+   int  _findCheckpoint (long long pos);
+   void _skipForward (long long length);
+   dword _sourceSignature ();
 
-   bool _read (int length, void *res);
-   
    CP_DECL;
    TL_CP_DECL(Array<Bytef>, _inbuf);
+   // Filled cyclically, the inflate output is [_outbuf_begin, _outbuf_end)
    TL_CP_DECL(Array<Bytef>, _outbuf);
+   int  _outbuf_begin;
    int  _outbuf_start;
-   int  _inbuf_end;
-   int  _uncompressed_total;
+   int  _outbuf_end;
+   bool _outbuf_full;
+   long long _position;
    bool _eof;
+
+   ObjArray<Checkpoint> _checkpoints;
+   long long _checkpoint_span;
+   bool _index_complete;
+   bool _index_changed;
+   long long _total_length;
 };
 
 }
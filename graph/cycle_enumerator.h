@@ -16,10 +16,12 @@
 #define __cycle_enumerator_h__
 
 #include "base_cpp/array.h"
+#include "base_cpp/tlscont.h"
 
 namespace indigo {
 
 class Graph;
+class FrozenGraph;
 class SpanningTree;
 class Filter;
 
@@ -35,14 +37,26 @@ public:
 
    Filter *vfilter;
 
+   // Snapshot of the graph, if the caller has one. The enumerator makes its
+   // own snapshot if it is not set or the graph has changed.
+   const FrozenGraph *frozen_graph;
+
    bool (*cb_check_vertex)(Graph &graph, int v_idx, void *context);
    bool (*cb_handle_cycle)(Graph &graph, const Array<int> &vertices, const Array<int> &edges, void *context);
 
    bool process ();
 
 protected:
-   bool _pathFinder (const SpanningTree &spt, int ext_v1, int ext_v2, int ext_e);
+   bool _pathFinder (int ext_v1, int ext_v2, int ext_e);
    Graph &_graph;
+
+   // Spanning tree with the edges that close the cycles, in the graph indices
+   CP_DECL;
+   TL_CP_DECL(Array<int>, _tree_offsets);
+   TL_CP_DECL(Array<int>, _tree_degrees);
+   TL_CP_DECL(Array<int>, _tree_nei_vertices);
+   TL_CP_DECL(Array<int>, _tree_nei_edges);
+
 private:
    CycleEnumerator (const CycleEnumerator &); // no implicit copy
 };
@@ -24,7 +24,7 @@
 #include "base_cpp/list.h"
 #include "base_cpp/tlscont.h"
 #include "base_cpp/obj_array.h"
-#include "graph/graph_fast_access.h"
+#include "graph/frozen_graph.h"
 
 namespace indigo {
 
@@ -68,6 +68,11 @@ public:
 
    void setSubgraph (Graph &subgraph);
 
+   // Snapshot of the supergraph made by the caller, to share it between
+   // the enumerators over the same supergraph. It is not used if the
+   // supergraph has changed since, and the enumerator makes its own one.
+   void setFrozenSupergraph (const FrozenGraph *frozen);
+
    void ignoreSubgraphVertex (int idx);
    void ignoreSupergraphVertex (int idx);
 
@@ -116,8 +121,15 @@ protected:
 
    TL_CP_DECL(Pool<RedBlackSet<int>::Node>, _s_pool);
 
-   TL_CP_DECL(GraphFastAccess, _g1_fast);
-   TL_CP_DECL(GraphFastAccess, _g2_fast);
+   // Snapshots of the graphs used by the search, made by _freeze()
+   const FrozenGraph *_fg1;
+   const FrozenGraph *_fg2;
+   const FrozenGraph *_fg2_shared;
+
+   TL_CP_DECL(FrozenGraph, _g1_frozen);
+   TL_CP_DECL(FrozenGraph, _g2_frozen);
+
+   void _freeze ();
 
    void _terminatePreviousMatch ();
 
@@ -0,0 +1,108 @@
+/****************************************************************************
+ * Copyright (C) 2009-2015 EPAM Systems
+ * 
+ * This file is part of Indigo toolkit.
+ * 
+ * This file may be distributed and/or modified under the terms of the
+ * GNU General Public License version 3 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.
+ * 
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ ***************************************************************************/
+
+#ifndef __frozen_graph_h__
+#define __frozen_graph_h__
+
+#include "base_cpp/array.h"
+#include "base_cpp/non_copyable.h"
+#include "graph/graph.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable:4251)
+#endif
+
+namespace indigo {
+
+// Snapshot of a graph in the compressed sparse row form, for the algorithms
+// that only read the graph. The neighbors of a vertex are kept in one block
+// of the contiguous arrays, in the same order as Vertex::neiBegin() gives
+// them, so an algorithm visits the vertices in the same order on a frozen
+// graph as on the graph itself. The vertex and edge indices are the ones of
+// the graph. For small graphs the edges can also be found by a table
+// indexed by the pair of vertices.
+//
+// The snapshot does not follow the changes of the graph, it has to be built
+// again after them.
+class DLLEXPORT FrozenGraph : public NonCopyable
+{
+public:
+   FrozenGraph ();
+   ~FrozenGraph ();
+
+   void build (const Graph &graph);
+   void clear ();
+
+   // Table for findEdgeIndex() if the graph has up to 64 vertices, for the
+   // algorithms that look up the edges often. It is dropped by build().
+   void buildEdgeTable ();
+
+   const Graph & graph () const;
+
+   // False if the snapshot was not built from this graph or the numbers of
+   // its vertices and edges have changed since
+   bool isSnapshotOf (const Graph &graph) const;
+
+   int vertexBegin ()      const { return _vertices.size() > 0 ? _vertices[0] : _vertex_end; }
+   int vertexEnd   ()      const { return _vertex_end; }
+   int vertexNext  (int i) const { return _next_vertex[i]; }
+   int vertexCount ()      const { return _vertices.size(); }
+
+   // Vertices in the order of vertexBegin() and vertexNext()
+   const int * vertices () const { return _vertices.ptr(); }
+
+   int edgeEnd   () const { return _edges.size(); }
+   int edgeCount () const { return _edge_count; }
+
+   // Both ends are -1 for the indices that are not used by the graph
+   const Edge & getEdge (int idx) const { return _edges[idx]; }
+
+   int degree (int v) const { return _offsets[v + 1] - _offsets[v]; }
+
+   const int * neiVertices (int v) const { return _nei_vertices.ptr() + _offsets[v]; }
+   const int * neiEdges    (int v) const { return _nei_edges.ptr() + _offsets[v]; }
+
+   // Same as Graph::findEdgeIndex()
+   int  findEdgeIndex (int beg, int end) const;
+   bool haveEdge (int beg, int end) const { return findEdgeIndex(beg, end) != -1; }
+
+   DECL_ERROR;
+
+protected:
+   enum { _EDGE_TABLE_MAX_VERTICES = 64 };
+
+   const Graph *_graph;
+   int _vertex_end;
+   int _vertex_count;
+   int _edge_count;
+
+   Array<int> _vertices;
+   Array<int> _next_vertex;
+   Array<Edge> _edges;
+
+   Array<int> _offsets;      // the neighbors of v are from _offsets[v] to _offsets[v + 1]
+   Array<int> _nei_vertices;
+   Array<int> _nei_edges;
+
+   Array<int> _edge_table;   // vertexEnd() x vertexEnd(), empty if not built
+};
+
+}
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif
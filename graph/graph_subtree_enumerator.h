@@ -17,6 +17,7 @@
 
 #include "base_cpp/tlscont.h"
 #include "graph/graph.h"
+#include "graph/frozen_graph.h"
 #include "base_cpp/list.h"
 #include "base_cpp/obj_array.h"
 
@@ -32,6 +33,10 @@ public:
 
    Filter *vfilter;
 
+   // Snapshot of the graph to walk, if the caller has one. The enumerator
+   // makes its own snapshot if it is not set or the graph has changed.
+   const FrozenGraph *frozen_graph;
+
    void (*callback)(Graph &graph, const Array<int> &vertices, const Array<int> &edges, void *context);
 
    // Callback function that returns some value for subgraph.
@@ -54,6 +59,7 @@ public:
 
 protected:
    Graph &_graph;
+   const FrozenGraph *_fg;
 
    struct VertexEdgeParent
    {
@@ -72,6 +78,8 @@ protected:
 
    TL_CP_DECL(Array<int>, _v_processed); // from _graph to _subtree
 
+   TL_CP_DECL(FrozenGraph, _frozen);
+
    void _reverseSearch (int front_idx, int cur_maximal_criteria_value);
 
    VertexEdge _m1, _m2;
@@ -25,6 +25,8 @@
 #include "base_cpp/obj_list.h"
 #include "base_cpp/cancellation_handler.h"
 
+#include <atomic>
+
 #ifdef _WIN32
 #pragma warning(push)
 #pragma warning(disable:4251)
@@ -46,6 +48,10 @@ public:
    void findExactMCS();
    //approximate method for searching mcs. 2DOM algorithm used
    void findApproximateMCS();
+   //exact method with the approximate one as a fallback if the exact search is stopped.
+   //If it is stopped by the time limit, the solutions found by then are kept along with
+   //the approximate ones, and the best of all goes first
+   void findAnytimeMCS();
 
    //parameters for exact method
    struct ParametersForExact{
@@ -57,6 +63,16 @@ public:
       int numberOfSolutions;
       //throw error if input map is incorrect
       bool throw_error_for_incorrect_map;
+      //number of threads sharing the search, 0 or 1 - search in the calling thread
+      int threads;
+      //time limit in milliseconds, 0 - no limit. Like the max iteration number, it stops
+      //the search and the solutions found by then are kept
+      int timeout;
+      //boolean true if method reached the time limit
+      bool isTimedOut;
+      //keep only the solutions with the maximal number of edges. The branches that can't
+      //reach the size of the best solution found so far are cut off
+      bool maximumOnly;
    };
 
    //parameters for approximate algorithm
@@ -162,6 +178,12 @@ public:
       void clear();
       //sets maximum iterations number
       void setMaxIteration(int m) {_maxIteration = m; };
+      //sets time limit in milliseconds
+      void setTimeout(int ms) {_timeout = ms; };
+      //sets number of threads for the parsing
+      void setThreads(int n) {_threads = n; };
+      //keeps only the largest solutions
+      void setMaximumOnly(bool m) {_maximumOnly = m; };
       //set sizes for util variables
       void setSizes(int n1, int n2);
       //adds new RePoint to nodes set
@@ -178,8 +200,10 @@ public:
       int getPointIndex(int i, int j) const;
       //returns number of nodes (RePoints) in resolution graph
       int size() const {return _graph.size(); };
-      //returns true if algorithm has reached maximum iteration
+      //returns true if algorithm has reached maximum iteration or time limit
       bool stopped() { return _stop; };
+      //returns true if algorithm has reached time limit
+      bool timedOut() { return _timedOut; };
       //gets RePoint with index i
       RePoint *getPoint(int i) { return _graph[i]; };
 
@@ -208,14 +232,32 @@ public:
       CancellationHandler* cancellation_handler;
 
    protected:
+      class ParseDispatcher;
+      class ParseCommand;
+      class ParseResult;
+
       //list of ReGraph nodes each node keeping track of its  neighbours
       PtrArray<RePoint> _graph;
+      //nodes to parse: _graph, or the nodes of the main ReGraph for the parsing threads
+      PtrArray<RePoint> *_points;
       //size of ReGRaph
       int _size;
       // current number of iterations 
-      int _nbIteration;
+      std::atomic<int> _nbIteration;
       //maximal number of iterations before search break
       int _maxIteration;
+      //time limit in milliseconds and the start time of the current parsing
+      int _timeout;
+      qword _startTime;
+      //number of parsing threads
+      int _threads;
+      //flag to keep only the largest solutions and the number of edges in them
+      bool _maximumOnly;
+      std::atomic<int> _bestSize;
+      //main ReGraph keeping the state shared by the parsing threads, or this
+      ReGraph *_shared;
+      std::atomic<bool> _stopAll;
+      std::atomic<bool> _timedOut;
       // dimensions of the compared graphs
       int _firstGraphSize;
       int _secondGraphSize;
@@ -223,6 +265,16 @@ public:
       bool _findAllStructure;
       // flag to define if search was breaking
       bool _stop;
+
+      //parses the subtree of the top node, or whole ReGraph if it is -1
+      void _parse(int top_point);
+      //parses ReGraph in the threads, each thread takes a subtree of a top node
+      void _parseParallel();
+      //counts the iteration, checks the limits and the cancellation
+      void _nextIteration();
+      void _stopSearch();
+      //removes the solutions which are smaller than the best one
+      void _removeSmallSolutions();
       
       // Checks if a potantial solution is a real one 
       // (not included in a previous solution)
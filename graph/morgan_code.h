@@ -16,6 +16,7 @@
 #define __morgan_code_h__
 
 #include "graph/graph.h"
+#include "graph/frozen_graph.h"
 
 namespace indigo {
 
@@ -23,12 +24,14 @@ class MorganCode
 {
 public:
    explicit MorganCode (const Graph &g);
+   explicit MorganCode (const FrozenGraph &g);
 
    void calculate (Array<long> &codes, int coeff, int iteration_count);
 
 protected:
 
    const Graph &_g;
+   const FrozenGraph *_fg;
 };
 
 }
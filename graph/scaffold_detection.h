@@ -44,6 +44,11 @@ public:
    ObjArray<Graph>* basketStructures;
 
    int maxIterations;
+   //limits of the exact search for every pair of graphs, see MaxCommonSubgraph::ParametersForExact.
+   //The pair which runs out of time gives the common subgraphs found by then
+   int threads;
+   int timeout;
+   bool maximumOnly;
 
    DECL_ERROR;
 
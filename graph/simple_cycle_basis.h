@@ -19,6 +19,7 @@
 #include "base_cpp/red_black.h"
 #include "base_cpp/array.h"
 #include "graph/graph.h"
+#include "graph/frozen_graph.h"
 
 namespace indigo {
 
@@ -50,6 +51,7 @@ private:
     RedBlackMap<int, int> _edgeIndexMap;
 
     const Graph& _graph;
+    const FrozenGraph* _fg; // snapshot of _graph made by create()
 
     Array<int> _edgeList;
 
@@ -68,14 +70,14 @@ class AuxiliaryGraph: public Graph {
     // aux. edge to edge
     RedBlackMap<int, int> _auxEdgeMap;
 
-    const Graph& _graph;
+    const FrozenGraph& _graph;
     Array<bool>& _u;
     RedBlackMap<int, int>& _edgeIndexMap;
 
 
 public:
     
-    AuxiliaryGraph(const Graph& graph, Array<bool>& u, RedBlackMap<int, int>& edgeIndexMap) :
+    AuxiliaryGraph(const FrozenGraph& graph, Array<bool>& u, RedBlackMap<int, int>& edgeIndexMap) :
         _graph(graph),
         _u(u),
         _edgeIndexMap(edgeIndexMap)
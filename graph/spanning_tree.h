@@ -17,12 +17,14 @@
 
 #include "base_cpp/array.h"
 #include "graph/graph.h"
+#include "graph/frozen_graph.h"
 #include "base_cpp/tlscont.h"
 
 namespace indigo {
 
 class Filter;
 
+// Depth-first spanning forest of a graph, with the edges that are not in it
 class SpanningTree
 {
 public:
@@ -37,6 +39,11 @@ public:
 
    explicit SpanningTree (Graph &graph, const Filter *vertex_filter, const Filter *edge_filter = 0);
 
+   // The same tree, built by the snapshot of the graph
+   explicit SpanningTree (const FrozenGraph &graph, const Filter *vertex_filter, const Filter *edge_filter = 0);
+
+   // Edges that are not in the tree. Each of them goes from a vertex to
+   // its ancestor and closes a cycle.
    inline int            getEdgesNum ()
    {
       return _edges_list.size();
@@ -47,21 +54,21 @@ public:
       return _edges_list[i];
    }
 
-   void addEdge (int beg, int end, int ext_index);
-
-   inline const Vertex &getVertexFromExtIdx (int ext_idx) const
+   // Edges of the tree in the order they are found, from the parent to
+   // the child
+   inline int getTreeEdgesNum () const
    {
-      return _tree.getVertex(_inv_mapping[ext_idx]);
+      return _tree_edges.size();
    }
 
-   inline int getExtVertexIndex (int v_idx) const 
+   inline const ExtEdge & getTreeEdge (int i) const
    {
-      return _mapping[v_idx]; 
+      return _tree_edges[i];
    }
 
-   inline int getExtEdgeIndex (int e_idx) const 
+   inline int getExtVertexIndex (int v_idx) const 
    {
-      return _edge_mapping[e_idx]; 
+      return _mapping[v_idx]; 
    }
 
    void markAllEdgesInCycles (int *marks_out, int value);
@@ -70,27 +77,29 @@ public:
 protected:
    struct StackElem
    {
-      const Vertex *vertex;
       int vertex_idx;
-      int nei_idx;
+      int nei_idx;    // position in the row of the vertex in the snapshot
       int parent_idx;
    };
 
+   void _init ();
    void _build ();
 
    const Graph &_graph;
+   const FrozenGraph *_fg;
    const Filter *_vertex_filter;
    const Filter *_edge_filter;
 
    // these members made static for saving time of memory allocations
    CP_DECL;
    TL_CP_DECL(Array<ExtEdge>, _edges_list);
+   TL_CP_DECL(Array<ExtEdge>, _tree_edges);
    TL_CP_DECL(Array<int>, _depth_counters);
-   TL_CP_DECL(Graph, _tree);
+   TL_CP_DECL(Array<int>, _parent_edges);  // index in _tree_edges, -1 for the roots
    TL_CP_DECL(Array<int>, _mapping);
    TL_CP_DECL(Array<int>, _inv_mapping);
-   TL_CP_DECL(Array<int>, _edge_mapping);
    TL_CP_DECL(Array<StackElem>, _stack);
+   TL_CP_DECL(FrozenGraph, _frozen);
 
    int         _current_depth;
 };
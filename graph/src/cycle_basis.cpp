@@ -15,6 +15,7 @@
 #include "graph/simple_cycle_basis.h"
 #include "graph/cycle_basis.h"
 #include "graph/biconnected_decomposer.h"
+#include "graph/frozen_graph.h"
 #include "base_cpp/tlscont.h"
 
 using namespace indigo;
@@ -22,6 +23,10 @@ using namespace indigo;
 void CycleBasis::create(const Graph& graph)
 {
    QS_DEF(Array<int>, mapping_out);
+   QS_DEF(FrozenGraph, frozen);
+
+   // for the edge lookups of the cycles
+   frozen.build(graph);
 
    // using biconnected decomposer since components will contain smallest cycles
    
@@ -54,7 +59,7 @@ void CycleBasis::create(const Graph& graph)
                // cycle is edge list so we have to covert from subgraph edge list to graph edge list
                int source = subgraph.getEdge(cycle[j]).beg;
                int target = subgraph.getEdge(cycle[j]).end;
-               int edge_idx = graph.findEdgeIndex(mapping_out[source], mapping_out[target]);
+               int edge_idx = frozen.findEdgeIndex(mapping_out[source], mapping_out[target]);
                _cycleVertices.find_or_insert(mapping_out[source]);
                _cycleVertices.find_or_insert(mapping_out[target]);
                new_cycle.push(edge_idx);
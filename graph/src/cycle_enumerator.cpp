@@ -14,11 +14,19 @@
 
 #include "graph/cycle_enumerator.h"
 #include "graph/spanning_tree.h"
+#include "graph/frozen_graph.h"
 
 using namespace indigo;
 
+CP_DEF(CycleEnumerator);
+
 CycleEnumerator::CycleEnumerator (Graph &graph) :
-_graph(graph)
+_graph(graph),
+CP_INIT,
+TL_CP_GET(_tree_offsets),
+TL_CP_GET(_tree_degrees),
+TL_CP_GET(_tree_nei_vertices),
+TL_CP_GET(_tree_nei_edges)
 {
    min_length = 0;
    max_length = graph.vertexCount();
@@ -26,6 +34,7 @@ _graph(graph)
    cb_check_vertex = 0;
    cb_handle_cycle = 0;
    vfilter = 0;
+   frozen_graph = 0;
 }
 
 CycleEnumerator::~CycleEnumerator ()
@@ -34,8 +43,81 @@ CycleEnumerator::~CycleEnumerator ()
 
 bool CycleEnumerator::process ()
 {
-   int i;
-   SpanningTree spt(_graph, vfilter);
+   int i, k;
+
+   QS_DEF(FrozenGraph, frozen);
+   const FrozenGraph *graph = frozen_graph;
+
+   if (graph == 0 || !graph->isSnapshotOf(_graph))
+   {
+      frozen.build(_graph);
+      graph = &frozen;
+   }
+
+   SpanningTree spt(*graph, vfilter);
+
+   // The cycles through each of the edges that are not in the spanning tree
+   // are searched in the tree with the previous such edges added. The rows
+   // of the tree have the tree edges first and then these edges, both in the
+   // order they are added, so the search looks only at the first
+   // _tree_degrees[v] neighbors of v in the rows of the complete tree.
+   int n_tree_edges = spt.getTreeEdgesNum();
+   int n_edges = n_tree_edges + spt.getEdgesNum();
+   int n_vertices = graph->vertexEnd();
+
+   _tree_degrees.clear_resize(n_vertices);
+   _tree_degrees.zerofill();
+   _tree_offsets.clear_resize(n_vertices + 1);
+   _tree_offsets.zerofill();
+   _tree_nei_vertices.clear_resize(2 * n_edges);
+   _tree_nei_edges.clear_resize(2 * n_edges);
+
+   for (k = 0; k < n_tree_edges; k++)
+   {
+      const SpanningTree::ExtEdge &edge = spt.getTreeEdge(k);
+
+      _tree_degrees[edge.ext_beg_idx]++;
+      _tree_degrees[edge.ext_end_idx]++;
+   }
+
+   for (i = 0; i < spt.getEdgesNum(); i++)
+   {
+      const SpanningTree::ExtEdge &ext_edge = spt.getExtEdge(i);
+
+      _tree_offsets[ext_edge.ext_beg_idx]++;
+      _tree_offsets[ext_edge.ext_end_idx]++;
+   }
+
+   // Here the offsets hold the numbers of the edges closing the cycles, and
+   // are turned into the positions where the next neighbors go
+   int pos = 0;
+
+   for (i = 0; i < n_vertices; i++)
+   {
+      int closing = _tree_offsets[i];
+
+      _tree_offsets[i] = pos;
+      pos += _tree_degrees[i] + closing;
+   }
+   _tree_offsets[n_vertices] = pos;
+
+   QS_DEF(Array<int>, fill);
+
+   fill.copy(_tree_offsets);
+
+   for (k = 0; k < n_edges; k++)
+   {
+      const SpanningTree::ExtEdge &edge =
+         (k < n_tree_edges) ? spt.getTreeEdge(k) : spt.getExtEdge(k - n_tree_edges);
+
+      int beg = edge.ext_beg_idx;
+      int end = edge.ext_end_idx;
+
+      _tree_nei_vertices[fill[beg]] = end;
+      _tree_nei_edges[fill[beg]++] = edge.ext_edge_idx;
+      _tree_nei_vertices[fill[end]] = beg;
+      _tree_nei_edges[fill[end]++] = edge.ext_edge_idx;
+   }
 
    for (i = 0; i < spt.getEdgesNum(); i++)
    {
@@ -47,17 +129,18 @@ bool CycleEnumerator::process ()
 		if (cb_check_vertex == 0 ||
           (cb_check_vertex(_graph, v, context) && cb_check_vertex(_graph, w, context)))
       {
-		   if (!_pathFinder(spt, v, w, ext_edge.ext_edge_idx))
+		   if (!_pathFinder(v, w, ext_edge.ext_edge_idx))
             return true;
       }
 
-      spt.addEdge(ext_edge.beg_idx, ext_edge.end_idx, ext_edge.ext_edge_idx);
+      _tree_degrees[v]++;
+      _tree_degrees[w]++;
    }
 
    return false;
 }    
 
-bool CycleEnumerator::_pathFinder (const SpanningTree &spt, int ext_v1, int ext_v2, int ext_e)
+bool CycleEnumerator::_pathFinder (int ext_v1, int ext_v2, int ext_e)
 {
    
    QS_DEF(Array<int>, vertices);
@@ -76,25 +159,28 @@ bool CycleEnumerator::_pathFinder (const SpanningTree &spt, int ext_v1, int ext_
    flags[ext_v1] = 1;
    flags[ext_v2] = 1;
    edges.push(ext_e);
-   visited_vertices.clear_resize(spt.getVertexFromExtIdx(ext_v2).neiEnd());
+   visited_vertices.clear_resize(_tree_degrees[ext_v2]);
    visited_vertices.zerofill();
    
    // DFS all cycles with given edge
    while (vertices.size() > 1)
    {
-      const Vertex &v_vertex = spt.getVertexFromExtIdx(vertices.top());
+      int v = vertices.top();
+      const int *nei_vertices = _tree_nei_vertices.ptr() + _tree_offsets[v];
+      const int *nei_edges = _tree_nei_edges.ptr() + _tree_offsets[v];
+      int nei_count = _tree_degrees[v];
       bool no_push = true;
       
       if (vertices.size() <= max_length)
       {
-         for (int i = v_vertex.neiBegin(); i != v_vertex.neiEnd(); i = v_vertex.neiNext(i))
+         for (int i = 0; i < nei_count; i++)
          {
             if (visited_vertices[cur_start_idx + i])
                continue;
             visited_vertices[cur_start_idx + i] = 1;
             
-            int u = spt.getExtVertexIndex(v_vertex.neiVertex(i));
-            int e = spt.getExtEdgeIndex(v_vertex.neiEdge(i));
+            int u = nei_vertices[i];
+            int e = nei_edges[i];
             
             bool cycle = (vertices.size() > 2) && u == vertices[0];
             
@@ -121,11 +207,11 @@ bool CycleEnumerator::_pathFinder (const SpanningTree &spt, int ext_v1, int ext_
                vertices.push(u);
                flags[u] = 1;
 
-               cur_start_idx += v_vertex.neiEnd();
+               cur_start_idx += nei_count;
                
-               const Vertex &u_vertex = spt.getVertexFromExtIdx(u);
-               visited_vertices.expand(cur_start_idx + u_vertex.neiEnd());
-               memset(&visited_vertices[cur_start_idx], 0, u_vertex.neiEnd() * sizeof(int));
+               int u_count = _tree_degrees[u];
+               visited_vertices.expand(cur_start_idx + u_count);
+               memset(&visited_vertices[cur_start_idx], 0, u_count * sizeof(int));
                
                no_push = false;
                break;
@@ -138,7 +224,9 @@ bool CycleEnumerator::_pathFinder (const SpanningTree &spt, int ext_v1, int ext_
          if (edges.size() > 0)
             edges.pop();
          flags[vertices.pop()] = 0;
-         cur_start_idx -= v_vertex.neiEnd();
+         // The visited marks of the previous vertex are just before
+         if (vertices.size() > 0)
+            cur_start_idx -= _tree_degrees[vertices.top()];
       }
    }
    
@@ -34,12 +34,15 @@ EmbeddingEnumerator::EmbeddingEnumerator (Graph &supergraph) :
    TL_CP_GET(_term2),
    TL_CP_GET(_unterm2),
    TL_CP_GET(_s_pool),
-   TL_CP_GET(_g1_fast),
-   TL_CP_GET(_g2_fast),
+   TL_CP_GET(_g1_frozen),
+   TL_CP_GET(_g2_frozen),
    TL_CP_GET(_query_match_state),
    TL_CP_GET(_enumerators)
 {
    _g2 = &supergraph;
+   _g1 = 0;
+   _fg1 = 0;
+   _fg2_shared = 0;
    _core_2.clear();
    validate();
 
@@ -70,7 +73,37 @@ void EmbeddingEnumerator::validate ()
 {
    // _core_2 must be preserved because there might be fixed vertices
    _core_2.expandFill(_g2->vertexEnd(), -1);
-   _g2_fast.setGraph(*_g2);
+   _fg2 = 0;
+}
+
+void EmbeddingEnumerator::setFrozenSupergraph (const FrozenGraph *frozen)
+{
+   if (frozen == _fg2_shared)
+      return;
+
+   _fg2_shared = frozen;
+   _fg2 = 0;
+}
+
+void EmbeddingEnumerator::_freeze ()
+{
+   if (_fg1 == 0)
+   {
+      _g1_frozen.build(*_g1);
+      _fg1 = &_g1_frozen;
+   }
+
+   if (_fg2 == 0)
+   {
+      if (_fg2_shared != 0 && _fg2_shared->isSnapshotOf(*_g2))
+         _fg2 = _fg2_shared;
+      else
+      {
+         _g2_frozen.build(*_g2);
+         _g2_frozen.buildEdgeTable();
+         _fg2 = &_g2_frozen;
+      }
+   }
 }
 
 void EmbeddingEnumerator::setSubgraph (Graph &subgraph)
@@ -86,7 +119,7 @@ void EmbeddingEnumerator::setSubgraph (Graph &subgraph)
 
    _terminatePreviousMatch();
 
-   _g1_fast.setGraph(*_g1);
+   _fg1 = 0;
 }
 
 void EmbeddingEnumerator::ignoreSubgraphVertex (int idx)
@@ -123,11 +156,19 @@ void EmbeddingEnumerator::setEquivalenceHandler (GraphVertexEquivalence *equival
 
 bool EmbeddingEnumerator::fix (int node1, int node2)
 {
+   if (_g1 == 0)
+      throw Error("no subgraph");
+
+   _freeze();
    return _enumerators[0].fix(node1, node2, true);
 }
 
 bool EmbeddingEnumerator::unsafeFix (int node1, int node2)
 {
+   if (_g1 == 0)
+      throw Error("no subgraph");
+
+   _freeze();
    return _enumerators[0].fix(node1, node2, false);
 }
 
@@ -146,6 +187,8 @@ void EmbeddingEnumerator::processStart ()
    if (_g1 == 0)
       throw Error("subgraph not set");
 
+   _freeze();
+
    if (_equivalence_handler != NULL)
       _equivalence_handler->prepareForQueries();
 
@@ -173,12 +216,13 @@ void EmbeddingEnumerator::processStart ()
    while ((node1 = _getNextNode1()) != -1)
    {
       // Find node parent
-      const Vertex &v = _g1->getVertex(node1);
+      const int *node1_nei_v = _fg1->neiVertices(node1);
+      int node1_nei_count = _fg1->degree(node1);
 
       int parent = -1;
-      for (int j = v.neiBegin(); j != v.neiEnd(); j = v.neiNext(j))
+      for (int j = 0; j < node1_nei_count; j++)
       {
-         int nei_vertex = v.neiVertex(j);
+         int nei_vertex = node1_nei_v[j];
          if (_core_1[nei_vertex] >= 0)
          {
             parent = nei_vertex;
@@ -206,10 +250,12 @@ void EmbeddingEnumerator::_fixNode1 (int node1, int node2)
 
    _core_1[node1] = node2;
 
-   const Vertex &v1 = _g1->getVertex(node1);
-   for (int i = v1.neiBegin(); i != v1.neiEnd(); i = v1.neiNext(i))
+   const int *node1_nei_v = _fg1->neiVertices(node1);
+   int node1_nei_count = _fg1->degree(node1);
+
+   for (int i = 0; i < node1_nei_count; i++)
    {
-      int other1 = v1.neiVertex(i);
+      int other1 = node1_nei_v[i];
 
       if (_core_1[other1] == UNMAPPED)
       {
@@ -367,8 +413,9 @@ void EmbeddingEnumerator::_Enumerator::_addPairNode2 (int node1, int node2)
 
    if (_t1_len > 0)
    {
-      int node2_nei_count;
-      int *node2_nei_v = _context._g2_fast.getVertexNeiVertices(node2, node2_nei_count);
+      const int *node2_nei_v = _context._fg2->neiVertices(node2);
+      int node2_nei_count = _context._fg2->degree(node2);
+
       for (i = 0; i < node2_nei_count; i++)
       {
          int other2 = node2_nei_v[i];
@@ -445,9 +492,9 @@ bool EmbeddingEnumerator::_Enumerator::_checkPair (int node1, int node2)
    int j;
    bool needRemove = false;
 
-   int node1_nei_count;
-   int *node1_nei_v = _context._g1_fast.getVertexNeiVertices(node1, node1_nei_count);
-   int *node1_nei_e = _context._g1_fast.getVertexNeiEdges(node1, node1_nei_count);
+   const int *node1_nei_v = _context._fg1->neiVertices(node1);
+   const int *node1_nei_e = _context._fg1->neiEdges(node1);
+   int node1_nei_count = _context._fg1->degree(node1);
 
    for (j = 0; j < node1_nei_count; j++)
    {
@@ -457,7 +504,7 @@ bool EmbeddingEnumerator::_Enumerator::_checkPair (int node1, int node2)
       if (other2 >= 0)
       {
          int edge1 = node1_nei_e[j];
-         int edge2 = _context._g2_fast.findEdgeIndex(node2, other2);
+         int edge2 = _context._fg2->findEdgeIndex(node2, other2);
 
          if (edge2 == -1)
             break;
@@ -564,8 +611,8 @@ int EmbeddingEnumerator::_Enumerator::nextPair ()
 
    if (_t2_len == 0)
    {
-      int v2_count;
-      int *g2_vertices = _context._g2_fast.prepareVertices(v2_count);
+      const int *g2_vertices = _context._fg2->vertices();
+      int v2_count = _context._fg2->vertexCount();
 
       // If _current_node2_idx == -1 then _current_node2_idx will be 0
       _current_node2_idx++;
@@ -600,15 +647,13 @@ int EmbeddingEnumerator::_Enumerator::nextPair ()
             throw Error("_current_node2_parent < 0");
       }
 
-      int nei_count;
-      int node2_parent_nei_id = 
-         _context._g2_fast.prepareVertexNeiVertices(_current_node2_parent, nei_count);
+      const int *node2_parent_nei_v = _context._fg2->neiVertices(_current_node2_parent);
+      int nei_count = _context._fg2->degree(_current_node2_parent);
 
       _current_node2_nei_index++;
       for (; _current_node2_nei_index != nei_count; _current_node2_nei_index++)
       {
-         _current_node2 = 
-            _context._g2_fast.getVertexNeiVertiex(node2_parent_nei_id, _current_node2_nei_index);
+         _current_node2 = node2_parent_nei_v[_current_node2_nei_index];
 
          if (!_checkNode2(_current_node2, _current_node1))
             continue;
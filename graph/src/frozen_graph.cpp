@@ -0,0 +1,151 @@
+/****************************************************************************
+ * Copyright (C) 2009-2015 EPAM Systems
+ * 
+ * This file is part of Indigo toolkit.
+ * 
+ * This file may be distributed and/or modified under the terms of the
+ * GNU General Public License version 3 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.
+ * 
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ ***************************************************************************/
+
+#include "graph/frozen_graph.h"
+
+using namespace indigo;
+
+IMPL_ERROR(FrozenGraph, "frozen graph");
+
+FrozenGraph::FrozenGraph ()
+{
+   clear();
+}
+
+FrozenGraph::~FrozenGraph ()
+{
+}
+
+void FrozenGraph::clear ()
+{
+   _graph = 0;
+   _vertex_end = 0;
+   _vertex_count = 0;
+   _edge_count = 0;
+
+   _vertices.clear();
+   _next_vertex.clear();
+   _edges.clear();
+   _offsets.clear_resize(1);
+   _offsets[0] = 0;
+   _nei_vertices.clear();
+   _nei_edges.clear();
+   _edge_table.clear();
+}
+
+void FrozenGraph::build (const Graph &graph)
+{
+   int i, v, e;
+
+   _graph = &graph;
+   _vertex_end = graph.vertexEnd();
+   _vertex_count = graph.vertexCount();
+   _edge_count = graph.edgeCount();
+
+   // Every edge is in the rows of both of its ends
+   _vertices.clear_resize(_vertex_count);
+   _next_vertex.clear_resize(_vertex_end);
+   _offsets.clear_resize(_vertex_end + 1);
+   _nei_vertices.clear_resize(2 * _edge_count);
+   _nei_edges.clear_resize(2 * _edge_count);
+   _edge_table.clear();
+
+   int *vertices = _vertices.ptr();
+   int *next_vertex = _next_vertex.ptr();
+   int *offsets = _offsets.ptr();
+   int *nei_vertices = _nei_vertices.ptr();
+   int *nei_edges = _nei_edges.ptr();
+   int pos = 0, count = 0;
+
+   // The graph gives the vertices in ascending order, the vertices that
+   // are not used have no neighbors
+   i = 0;
+   for (v = graph.vertexBegin(); v != graph.vertexEnd(); v = graph.vertexNext(v))
+   {
+      while (i <= v)
+         offsets[i++] = pos;
+
+      const Vertex &vertex = graph.getVertex(v);
+
+      for (int j = vertex.neiBegin(); j != vertex.neiEnd(); j = vertex.neiNext(j))
+      {
+         nei_vertices[pos] = vertex.neiVertex(j);
+         nei_edges[pos++] = vertex.neiEdge(j);
+      }
+
+      if (count > 0)
+         next_vertex[vertices[count - 1]] = v;
+      vertices[count++] = v;
+   }
+   while (i <= _vertex_end)
+      offsets[i++] = pos;
+
+   if (count > 0)
+      next_vertex[vertices[count - 1]] = _vertex_end;
+
+   _edges.clear_resize(graph.edgeEnd());
+   _edges.fffill();
+   for (e = graph.edgeBegin(); e != graph.edgeEnd(); e = graph.edgeNext(e))
+      _edges[e] = graph.getEdge(e);
+}
+
+void FrozenGraph::buildEdgeTable ()
+{
+   _edge_table.clear();
+
+   if (_vertex_end > _EDGE_TABLE_MAX_VERTICES)
+      return;
+
+   _edge_table.clear_resize(_vertex_end * _vertex_end);
+   _edge_table.fffill();
+
+   // The first of the parallel edges is taken, as Graph::findEdgeIndex() does
+   for (int i = 0; i < _vertices.size(); i++)
+   {
+      int v = _vertices[i];
+      int *row = _edge_table.ptr() + v * _vertex_end;
+
+      for (int j = _offsets[v]; j < _offsets[v + 1]; j++)
+         if (row[_nei_vertices[j]] == -1)
+            row[_nei_vertices[j]] = _nei_edges[j];
+   }
+}
+
+const Graph & FrozenGraph::graph () const
+{
+   if (_graph == 0)
+      throw Error("not built");
+   return *_graph;
+}
+
+bool FrozenGraph::isSnapshotOf (const Graph &graph) const
+{
+   return _graph == &graph && _vertex_end == graph.vertexEnd() && _vertex_count == graph.vertexCount() &&
+          _edges.size() == graph.edgeEnd() && _edge_count == graph.edgeCount();
+}
+
+int FrozenGraph::findEdgeIndex (int beg, int end) const
+{
+   if (_edge_table.size() > 0)
+      return _edge_table[beg * _vertex_end + end];
+
+   const int *nei_vertices = neiVertices(beg);
+   int count = degree(beg);
+
+   for (int i = 0; i < count; i++)
+      if (nei_vertices[i] == end)
+         return neiEdges(beg)[i];
+
+   return -1;
+}
@@ -14,8 +14,6 @@
 
 #include "graph/graph_subtree_enumerator.h"
 
-#include "graph/graph_fast_access.h"
-
 using namespace indigo;
 
 CP_DEF(GraphSubtreeEnumerator);
@@ -26,7 +24,8 @@ CP_INIT,
 TL_CP_GET(_front),
 TL_CP_GET(_vertices),
 TL_CP_GET(_edges),
-TL_CP_GET(_v_processed)
+TL_CP_GET(_v_processed),
+TL_CP_GET(_frozen)
 {
    min_vertices = 1;
    max_vertices = graph.vertexCount();
@@ -35,6 +34,8 @@ TL_CP_GET(_v_processed)
    handle_maximal = false;
    maximal_critera_value_callback = 0;
    vfilter = 0;
+   frozen_graph = 0;
+   _fg = 0;
 }
 
 GraphSubtreeEnumerator::~GraphSubtreeEnumerator ()
@@ -43,6 +44,14 @@ GraphSubtreeEnumerator::~GraphSubtreeEnumerator ()
 
 void GraphSubtreeEnumerator::process ()
 {
+   if (frozen_graph != 0 && frozen_graph->isSnapshotOf(_graph))
+      _fg = frozen_graph;
+   else
+   {
+      _frozen.build(_graph);
+      _fg = &_frozen;
+   }
+
    _edges.clear();
    _vertices.clear();
 
@@ -55,14 +64,14 @@ void GraphSubtreeEnumerator::process ()
    _m1.v = _m2.v = -1;
 
    if (vfilter != 0)
-      for (int i = _graph.vertexBegin(); i < _graph.vertexEnd(); i = _graph.vertexNext(i))
+      for (int i = _fg->vertexBegin(); i < _fg->vertexEnd(); i = _fg->vertexNext(i))
       {
          if (!vfilter->valid(i))
             _v_processed[i] = 1;
       }
 
 
-   for (int i = _graph.vertexBegin(); i < _graph.vertexEnd(); i = _graph.vertexNext(i))
+   for (int i = _fg->vertexBegin(); i < _fg->vertexEnd(); i = _fg->vertexNext(i))
    {
       if (_v_processed[i] == 1)
          continue;
@@ -100,16 +109,19 @@ void GraphSubtreeEnumerator::_reverseSearch (int front_idx, int cur_maximal_crit
 
       // Update front
       int v = front_prev_value.v;
-      const Vertex &vertex = _graph.getVertex(v);
-      for (int i = vertex.neiBegin(); i != vertex.neiEnd(); i = vertex.neiNext(i))
+      const int *nei_vertices = _fg->neiVertices(v);
+      const int *nei_edges = _fg->neiEdges(v);
+      int nei_count = _fg->degree(v);
+
+      for (int i = 0; i < nei_count; i++)
       {
-         int nei_v = vertex.neiVertex(i);
+         int nei_v = nei_vertices[i];
          if (_v_processed[nei_v] == 1)
             continue;
 
          VertexEdgeParent &added = _front.push();
          added.v = nei_v;
-         added.e = vertex.neiEdge(i);
+         added.e = nei_edges[i];
          added.parent = v;
       }
       // Check if we can reuse front_idx front index
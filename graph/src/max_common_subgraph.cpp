@@ -12,8 +12,10 @@
  * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
  ***************************************************************************/
 
+#include "base_c/nano.h"
 #include "base_cpp/array.h"
 #include "base_cpp/cancellation_handler.h"
+#include "base_cpp/os_thread_wrapper.h"
 #include "graph/max_common_subgraph.h"
 #include "time.h"
 
@@ -35,6 +37,10 @@ MaxCommonSubgraph::MaxCommonSubgraph(Graph &subgraph, Graph &supergraph) :
    parametersForExact.maxIteration = -1;
    parametersForExact.numberOfSolutions = 0;
    parametersForExact.throw_error_for_incorrect_map = false;
+   parametersForExact.threads = 0;
+   parametersForExact.timeout = 0;
+   parametersForExact.isTimedOut = false;
+   parametersForExact.maximumOnly = false;
 
    parametersForApproximate.error = 0;
    parametersForApproximate.maxIteration = 1000;
@@ -136,14 +142,15 @@ void MaxCommonSubgraph::_addSolutionMap(Array<int>& v_map, Array<int>& e_map) {
 }
 
 void MaxCommonSubgraph::findExactMCS(){
+   parametersForExact.isStopped = false;
+   parametersForExact.isTimedOut = false;
    /*
     * Check for single input molecules
     */
    if(_findTrivialMcs()) 
       return;
    
-   ReGraph regraph;
-   regraph.setMaxIteration(parametersForExact.maxIteration);
+   ReGraph regraph(*this);
 
    ReCreation rc(regraph, *this);
    rc.createRegraph();
@@ -156,11 +163,42 @@ void MaxCommonSubgraph::findExactMCS(){
    regraph.parse(find_all_str);
 
    parametersForExact.isStopped = regraph.stopped();
+   parametersForExact.isTimedOut = regraph.timedOut();
    parametersForExact.numberOfSolutions = rc.createSolutionMaps();
 
 
 }
 
+void MaxCommonSubgraph::findAnytimeMCS(){
+   findExactMCS();
+
+   if(!parametersForExact.isStopped)
+      return;
+
+   if(!parametersForExact.isTimedOut) {
+      findApproximateMCS();
+      return;
+   }
+
+   /*
+    * The approximate search rewrites the solutions, keep the exact ones
+    */
+   QS_DEF(ObjArray< Array<int> >, exact_maps);
+   exact_maps.clear();
+   for(int i = 0; i < _vertEdgeSolMap.size(); ++i)
+      exact_maps.push().copy(_vertEdgeSolMap[i]);
+
+   findApproximateMCS();
+
+   for(int i = 0; i < exact_maps.size(); ++i)
+      _vertEdgeSolMap.push().copy(exact_maps[i]);
+
+   if(cbSolutionTerm == 0)
+      _vertEdgeSolMap.qsort(ringsSolutionTerm, 0);
+   else
+      _vertEdgeSolMap.qsort(cbSolutionTerm, userdata);
+}
+
 void MaxCommonSubgraph::findApproximateMCS(){
    int max_vsize = __max(_subgraph->vertexEnd(),_supergraph->vertexEnd());
    int max_esize = __max(_subgraph->edgeEnd(),_supergraph->edgeEnd());
@@ -574,12 +612,151 @@ void MaxCommonSubgraph::ReCreation::getSolutionListsSuper(ObjArray< Array<int> >
 
 
 //-------------------------------------------------------------------------------------------------------------
+// Parses the subtrees of the top ReGraph nodes in the threads. A thread starts
+// with a copy of the solutions merged so far, which cut off the branches giving
+// nothing new, and keeps its own solutions. They are merged into the main ReGraph
+// in the order of the top nodes. Besides, the threads share the iteration counter,
+// the stop flag and the size of the best solution
+class MaxCommonSubgraph::ReGraph::ParseDispatcher : public OsCommandDispatcher
+{
+public:
+   ParseDispatcher (ReGraph &regraph) :
+      OsCommandDispatcher(HANDLING_ORDER_SERIAL, false),
+      _regraph(regraph), _next_point(0)
+   {
+   }
+
+   void parseSubtree (ReGraph &worker, ParseCommand &command);
+
+protected:
+   virtual OsCommand * _allocateCommand ();
+   virtual OsCommandResult * _allocateResult ();
+   virtual bool _setupCommand (OsCommand &command);
+   virtual void _handleResult (OsCommandResult &result);
+
+private:
+   ReGraph &_regraph;
+   int _next_point;
+};
+
+class MaxCommonSubgraph::ReGraph::ParseCommand : public OsCommand
+{
+public:
+   virtual void clear ()
+   {
+      top_point = -1;
+      solutions.clear();
+   }
+
+   virtual void execute (OsCommandResult &result);
+
+   ParseDispatcher *dispatcher;
+   int top_point;
+   ObjArray<Solution> solutions;
+};
+
+class MaxCommonSubgraph::ReGraph::ParseResult : public OsCommandResult
+{
+public:
+   virtual void clear ()
+   {
+      worker.clear();
+   }
+
+   ReGraph worker;
+};
+
+void MaxCommonSubgraph::ReGraph::ParseCommand::execute (OsCommandResult &result)
+{
+   dispatcher->parseSubtree(((ParseResult &)result).worker, *this);
+}
+
+void MaxCommonSubgraph::ReGraph::ParseDispatcher::parseSubtree (ReGraph &worker, ParseCommand &command)
+{
+   worker._points = _regraph._points;
+   worker._size = _regraph._size;
+   worker._firstGraphSize = _regraph._firstGraphSize;
+   worker._secondGraphSize = _regraph._secondGraphSize;
+   worker._findAllStructure = _regraph._findAllStructure;
+   worker._maxIteration = _regraph._maxIteration;
+   worker._timeout = _regraph._timeout;
+   worker._startTime = _regraph._startTime;
+   worker._maximumOnly = _regraph._maximumOnly;
+   worker._shared = &_regraph;
+   worker._stop = false;
+   worker.cancellation_handler = _regraph.cancellation_handler;
+
+   for(int i = 0; i < command.solutions.size(); ++i) {
+      Solution& solution = command.solutions[i];
+      Solution& copy = worker._solutionObjList.at(worker._solutionObjList.add());
+      copy.reSolution.copy(solution.reSolution);
+      copy.solutionProj1.copy(solution.solutionProj1);
+      copy.solutionProj2.copy(solution.solutionProj2);
+      copy.numBits = solution.numBits;
+   }
+
+   worker._parse(command.top_point);
+}
+
+OsCommand * MaxCommonSubgraph::ReGraph::ParseDispatcher::_allocateCommand ()
+{
+   ParseCommand *command = new ParseCommand();
+   command->dispatcher = this;
+   return command;
+}
+
+OsCommandResult * MaxCommonSubgraph::ReGraph::ParseDispatcher::_allocateResult ()
+{
+   return new ParseResult();
+}
+
+bool MaxCommonSubgraph::ReGraph::ParseDispatcher::_setupCommand (OsCommand &command)
+{
+   if (_next_point >= _regraph._size || _regraph._stopAll)
+      return false;
+
+   ParseCommand &parse_command = (ParseCommand &)command;
+   ObjList<Solution>& solutions = _regraph._solutionObjList;
+
+   parse_command.top_point = _next_point++;
+
+   for(int i = solutions.begin(); i != solutions.end(); i = solutions.next(i)) {
+      Solution& solution = solutions.at(i);
+      Solution& copy = parse_command.solutions.push();
+      copy.reSolution.copy(solution.reSolution);
+      copy.solutionProj1.copy(solution.solutionProj1);
+      copy.solutionProj2.copy(solution.solutionProj2);
+      copy.numBits = solution.numBits;
+   }
+   return true;
+}
+
+void MaxCommonSubgraph::ReGraph::ParseDispatcher::_handleResult (OsCommandResult &result)
+{
+   ReGraph &worker = ((ParseResult &)result).worker;
+   ObjList<Solution>& solutions = worker._solutionObjList;
+
+   for(int i = solutions.begin(); i != solutions.end(); i = solutions.next(i)) {
+      Solution& solution = solutions.at(i);
+      _regraph._solution(solution.reSolution, solution.solutionProj1, solution.solutionProj2);
+   }
+}
+
 MaxCommonSubgraph::ReGraph::ReGraph():
    cbEmbedding(0),
    userdata(0),
    cancellation_handler(nullptr),
+   _points(&_graph),
    _nbIteration(0), 
    _maxIteration(-1),
+   _timeout(0),
+   _startTime(0),
+   _threads(0),
+   _maximumOnly(false),
+   _bestSize(0),
+   _shared(this),
+   _stopAll(false),
+   _timedOut(false),
    _firstGraphSize(0), 
    _secondGraphSize(0), 
    _findAllStructure(true), 
@@ -592,14 +769,26 @@ MaxCommonSubgraph::ReGraph::ReGraph(MaxCommonSubgraph& context):
 cbEmbedding(0),
    userdata(0),
    cancellation_handler(nullptr),
+   _points(&_graph),
    _nbIteration(0),
    _maxIteration(-1),
+   _timeout(0),
+   _startTime(0),
+   _threads(0),
+   _maximumOnly(false),
+   _bestSize(0),
+   _shared(this),
+   _stopAll(false),
+   _timedOut(false),
    _firstGraphSize(0),
    _secondGraphSize(0),
    _findAllStructure(true),
    _stop(false),
    _solutionObjList(_pool) {
    setMaxIteration(context.parametersForExact.maxIteration);
+   setTimeout(context.parametersForExact.timeout);
+   setThreads(context.parametersForExact.threads);
+   setMaximumOnly(context.parametersForExact.maximumOnly);
    cancellation_handler = getCancellationHandler();
 }
 
@@ -616,11 +805,42 @@ void MaxCommonSubgraph::ReGraph::clear(){
 }
 
 void MaxCommonSubgraph::ReGraph::parse(bool findAllStructure){
-   _size = _graph.size();
+   _size = _points->size();
    _findAllStructure = findAllStructure;
+   _nbIteration = 0;
+   _stop = false;
+   _stopAll = false;
+   _timedOut = false;
+   _startTime = nanoClock();
 
+   _bestSize = 0;
+   for(int i = _solutionObjList.begin(); i != _solutionObjList.end(); i = _solutionObjList.next(i)) {
+      if(_solutionObjList.at(i).numBits > _bestSize)
+         _bestSize = _solutionObjList.at(i).numBits;
+   }
 
+   /*
+    * The search with the input mapping keeps only the solutions which include
+    * the previous ones, so it depends on the order of the solutions and is not split
+    */
+   if(_threads > 1 && _findAllStructure && _size > 1)
+      _parseParallel();
+   else
+      _parse(-1);
 
+   if(_maximumOnly)
+      _removeSmallSolutions();
+}
+
+void MaxCommonSubgraph::ReGraph::_parseParallel(){
+   ParseDispatcher dispatcher(*this);
+
+   dispatcher.run(_threads);
+
+   _stop = _stopAll;
+}
+
+void MaxCommonSubgraph::ReGraph::_parse(int top_point){
    Dbitset pnode_g1(_firstGraphSize);
    Dbitset pnode_g2(_secondGraphSize);
 
@@ -654,7 +874,14 @@ void MaxCommonSubgraph::ReGraph::parse(bool findAllStructure){
       allowed_g2.push(_secondGraphSize);
       xk[i] = -1;
    }
-   extension[0].set();
+   if(top_point < 0) {
+      extension[0].set();
+   } else {
+      //the subtrees of the previous top nodes are parsed by the other threads
+      extension[0].set(top_point);
+      for(int i = 0; i < top_point; i++)
+         forbidden[0].set(i);
+   }
    allowed_g1[0].set();
    allowed_g2[0].set();
 
@@ -666,14 +893,14 @@ void MaxCommonSubgraph::ReGraph::parse(bool findAllStructure){
          next_level = level + 1;
          xk_level = xk[level];
 
-         forbidden[next_level].bsOrBs(forbidden[level], _graph.at(xk_level)->forbidden);
-         allowed_g1[next_level].bsAndBs(allowed_g1[level], _graph.at(xk_level)->allowed_g1);
-         allowed_g2[next_level].bsAndBs(allowed_g2[level], _graph.at(xk_level)->allowed_g2);
+         forbidden[next_level].bsOrBs(forbidden[level], _points->at(xk_level)->forbidden);
+         allowed_g1[next_level].bsAndBs(allowed_g1[level], _points->at(xk_level)->allowed_g1);
+         allowed_g2[next_level].bsAndBs(allowed_g2[level], _points->at(xk_level)->allowed_g2);
 
          if (traversed[level].isEmpty()) {
-            extension[next_level].bsAndNotBs(_graph.at(xk_level)->extension, forbidden[next_level]);
+            extension[next_level].bsAndNotBs(_points->at(xk_level)->extension, forbidden[next_level]);
          } else {
-            extension[next_level].bsOrBs(extension[level], _graph.at(xk_level)->extension);
+            extension[next_level].bsOrBs(extension[level], _points->at(xk_level)->extension);
             extension[next_level].andNotWith(forbidden[next_level]);
          }
 
@@ -682,8 +909,8 @@ void MaxCommonSubgraph::ReGraph::parse(bool findAllStructure){
 
          traversed_g1[next_level].copy(traversed_g1[level]);
          traversed_g2[next_level].copy(traversed_g2[level]);
-         traversed_g1[next_level].set(_graph.at(xk_level)->getid1());
-         traversed_g2[next_level].set(_graph.at(xk_level)->getid2());
+         traversed_g1[next_level].set(_points->at(xk_level)->getid1());
+         traversed_g2[next_level].set(_points->at(xk_level)->getid2());
 
          forbidden[level].set(xk_level);
 
@@ -701,15 +928,7 @@ void MaxCommonSubgraph::ReGraph::parse(bool findAllStructure){
             pnode_g2.bsOrBs(allowed_g2[level], traversed_g2[level]);
 
             if (_mustContinue(pnode_g1, pnode_g2)) {
-               ++_nbIteration;
-               if(_maxIteration > -1 && _nbIteration >= _maxIteration)
-                  _stop = true;
-               if(_nbIteration % 10 == 0) {
-                  if(cancellation_handler != nullptr) {
-                     if(cancellation_handler->isCancelled())
-                        throw Error("mcs search was cancelled: %s", cancellation_handler->cancelledRequestMessage());
-                  }
-               }
+               _nextIteration();
             } else { 
                xk[level] = -1;
                --level;
@@ -724,9 +943,44 @@ void MaxCommonSubgraph::ReGraph::parse(bool findAllStructure){
          break;
    }
 
-   //printf("iter = %d\n", _nbIteration);
+   //printf("iter = %d\n", _nbIteration.load());
    //printf("size = %d\n", _solutionObjList.size());
 }
+
+void MaxCommonSubgraph::ReGraph::_nextIteration(){
+   int iteration = ++_shared->_nbIteration;
+
+   if(_maxIteration > -1 && iteration >= _maxIteration)
+      _stopSearch();
+   if(iteration % 10 == 0) {
+      if(cancellation_handler != nullptr) {
+         if(cancellation_handler->isCancelled()) {
+            _stopSearch();
+            throw Error("mcs search was cancelled: %s", cancellation_handler->cancelledRequestMessage());
+         }
+      }
+      if(_timeout > 0 && nanoHowManySeconds(nanoClock() - _startTime) * 1000 > _timeout) {
+         _shared->_timedOut = true;
+         _stopSearch();
+      }
+   }
+   if(_shared->_stopAll)
+      _stop = true;
+}
+
+void MaxCommonSubgraph::ReGraph::_stopSearch(){
+   _stop = true;
+   _shared->_stopAll = true;
+}
+
+void MaxCommonSubgraph::ReGraph::_removeSmallSolutions(){
+   for(int i = _solutionObjList.begin(); i != _solutionObjList.end();) {
+      int next = _solutionObjList.next(i);
+      if(_solutionObjList.at(i).numBits < _bestSize)
+         _solutionObjList.remove(i);
+      i = next;
+   }
+}
 void MaxCommonSubgraph::ReGraph::insertSolution(int ins_index, bool ins_after, const Dbitset& sol, const Dbitset& sol_g1, const Dbitset& sol_g2, int num_bits) {
    
    if(_solutionObjList.size() == 0) {
@@ -743,16 +997,20 @@ void MaxCommonSubgraph::ReGraph::insertSolution(int ins_index, bool ins_after, c
    _solutionObjList.at(ins_index).solutionProj2.copy(sol_g2);
    _solutionObjList.at(ins_index).numBits = num_bits;
 
+   int best_size = _shared->_bestSize;
+   while(num_bits > best_size && !_shared->_bestSize.compare_exchange_weak(best_size, num_bits))
+      ;
+
    if(cbEmbedding != 0) {
       QS_DEF(Array<int>, sub_edge_map);
       sub_edge_map.resize(_firstGraphSize);
       sub_edge_map.zerofill();
 
       for(int x = sol.nextSetBit(0); x >= 0; x  = sol.nextSetBit(x+1)) {
-         sub_edge_map[_graph.at(x)->getid1()] = _graph.at(x)->getid2();
+         sub_edge_map[_points->at(x)->getid1()] = _points->at(x)->getid2();
       }
       if(!cbEmbedding(0, sub_edge_map.ptr(), 0, userdata))
-         _stop = true;
+         _stopSearch();
    }
 }
 
@@ -813,6 +1071,10 @@ bool MaxCommonSubgraph::ReGraph::_mustContinue (const Dbitset& pnode_g1, const D
    bool result = true;
    int num_bits = __min(pnode_g1.bitsNumber(), pnode_g2.bitsNumber());
 
+   //the branch can't give a solution as large as the best one
+   if(_maximumOnly && num_bits < _shared->_bestSize)
+      return false;
+
    for(int i = _solutionObjList.begin(); i != _solutionObjList.end(); i = _solutionObjList.next(i)) {
       Solution& solution = _solutionObjList.at(i);
       if(solution.numBits >= num_bits) {
@@ -18,34 +18,54 @@
 using namespace indigo;
 
 MorganCode::MorganCode (const Graph &g) :
-_g(g)
+_g(g),
+_fg(0)
+{
+}
+
+MorganCode::MorganCode (const FrozenGraph &g) :
+_g(g.graph()),
+_fg(&g)
 {
 }
 
 void MorganCode::calculate (Array<long> &codes, int coeff, int iteration_count)
 {
    QS_DEF(Array<long>, next_codes);
+   QS_DEF(FrozenGraph, frozen);
+
+   const FrozenGraph *g = _fg;
+
+   if (g == 0)
+   {
+      frozen.build(_g);
+      g = &frozen;
+   }
 
-   next_codes.clear_resize(_g.vertexEnd());
-   codes.clear_resize(_g.vertexEnd());
+   next_codes.clear_resize(g->vertexEnd());
+   codes.clear_resize(g->vertexEnd());
 
+   const int *vertices = g->vertices();
+   int vertex_count = g->vertexCount();
    int i, j, k;
 
-   for (i = _g.vertexBegin(); i < _g.vertexEnd(); i = _g.vertexNext(i))
-      codes[i] = _g.getVertex(i).degree();
+   for (i = 0; i < vertex_count; i++)
+      codes[vertices[i]] = g->degree(vertices[i]);
 
    for (j = 0; j < iteration_count; j++)
    {
-      for (i = _g.vertexBegin(); i < _g.vertexEnd(); i = _g.vertexNext(i))
+      for (i = 0; i < vertex_count; i++)
       {
-         next_codes[i] = coeff * codes[i];
+         int v = vertices[i];
+         const int *nei_vertices = g->neiVertices(v);
+         int degree = g->degree(v);
 
-         const Vertex &vertex = _g.getVertex(i);
+         next_codes[v] = coeff * codes[v];
 
-         for (k = vertex.neiBegin(); k < vertex.neiEnd(); k = vertex.neiNext(k)) 
-            next_codes[i] += codes[vertex.neiVertex(k)];
+         for (k = 0; k < degree; k++)
+            next_codes[v] += codes[nei_vertices[k]];
       }
 
-      memcpy(codes.ptr(), next_codes.ptr(), sizeof(long) * _g.vertexEnd());
+      memcpy(codes.ptr(), next_codes.ptr(), sizeof(long) * g->vertexEnd());
    }
 }
@@ -30,7 +30,10 @@ cbEmbedding(0),
 embeddingUserdata(0),
 searchStructures(graph_set),
 basketStructures(0),
-maxIterations(0) {
+maxIterations(0),
+threads(0),
+timeout(0),
+maximumOnly(false) {
 }
 
 void ScaffoldDetection::_searchScaffold(Graph& scaffold, bool approximate) {
@@ -71,6 +74,9 @@ void ScaffoldDetection::_searchExactScaffold(GraphBasket& basket) {
    mcs.userdata = userdata;
    if(maxIterations > 0)
       mcs.parametersForExact.maxIteration = maxIterations;
+   mcs.parametersForExact.threads = threads;
+   mcs.parametersForExact.timeout = timeout;
+   mcs.parametersForExact.maximumOnly = maximumOnly;
 
    basket.cbMatchEdges = cbEdgeWeight;
    basket.cbMatchVertices = cbVerticesColor;
@@ -97,7 +103,7 @@ void ScaffoldDetection::_searchExactScaffold(GraphBasket& basket) {
          /*
           * Throw an exception if max limit was reached
           */
-         if(regraph.stopped())
+         if(regraph.stopped() && !regraph.timedOut())
             throw Error("scaffold detection exact searching max iteration limit reached");
          
          build_graph.getSolutionListsSuper(v_lists, e_lists);
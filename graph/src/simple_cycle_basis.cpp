@@ -24,7 +24,7 @@
 using namespace indigo;
 
 SimpleCycleBasis::SimpleCycleBasis(const Graph& graph) :
-_graph(graph),_isMinimized(false) {
+_graph(graph),_fg(0),_isMinimized(false) {
 
 }
 
@@ -33,7 +33,10 @@ void SimpleCycleBasis::create()
    QS_DEF(Array<int>, vert_mapping);
 
    QS_DEF(ObjArray< Array<int> >, subgraph_cycles);
+   QS_DEF(FrozenGraph, frozen);
 
+   frozen.build(_graph);
+   _fg = &frozen;
 
    subgraph_cycles.clear();
 
@@ -176,13 +179,14 @@ void SimpleCycleBasis::create()
       for (int j = 0; j < cycle_edges.size(); ++j) {
          int edge_s = subgraph.getEdge(cycle_edges[j]).beg;
          int edge_t = subgraph.getEdge(cycle_edges[j]).end;
-         new_cycle_edges.push(_graph.findEdgeIndex(vert_mapping[edge_s], vert_mapping[edge_t]));
+         new_cycle_edges.push(_fg->findEdgeIndex(vert_mapping[edge_s], vert_mapping[edge_t]));
       }
    }
    _createEdgeIndexMap();
    
    _minimize(startIndex);
 
+   _fg = 0;
 
 }
 
@@ -225,23 +229,23 @@ void SimpleCycleBasis::_minimize(int startIndex) {
       constructKernelVector(u, a, cur_cycle);
 
       // Construct auxiliary graph gu
-      AuxiliaryGraph gu(_graph, u, _edgeIndexMap);
+      AuxiliaryGraph gu(*_fg, u, _edgeIndexMap);
 
-      AuxPathFinder path_finder(gu, _graph.vertexEnd()*2);
+      AuxPathFinder path_finder(gu, _fg->vertexEnd()*2);
 
       QS_DEF(ObjArray< Array<int> >, all_new_cycles);
       all_new_cycles.clear();
 
-      for (int v = _graph.vertexBegin(); v < _graph.vertexEnd(); v = _graph.vertexNext(v)) {
+      for (int v = _fg->vertexBegin(); v < _fg->vertexEnd(); v = _fg->vertexNext(v)) {
 
          // check if the vertex is incident to an edge with u[edge] == 1
          bool shouldSearchCycle = false;
 
-         const Vertex& vertex = _graph.getVertex(v);
+         const int* nei_edges = _fg->neiEdges(v);
          
-         for (int e = vertex.neiBegin(); e < vertex.neiEnd(); e = vertex.neiNext(e)) {
+         for (int e = 0; e < _fg->degree(v); e++) {
 
-            int edge = vertex.neiEdge(e);
+            int edge = nei_edges[e];
             
             int edge_index = _getEdgeIndex(edge);
             if (u[edge_index]) {
@@ -419,10 +423,11 @@ int AuxiliaryGraph::auxVertex1(int vertex) {
 }
 
 const Vertex& AuxiliaryGraph::getVertexAndBuild(int auxVertex) {
-   const Vertex& vertex = _graph.getVertex(_auxVertexMap.at(auxVertex));
+   int vertex = _auxVertexMap.at(auxVertex);
+   const int* nei_edges = _graph.neiEdges(vertex);
 
-   for (int i = vertex.neiBegin(); i != vertex.neiEnd(); i = vertex.neiNext(i)) {
-      int edge = vertex.neiEdge(i);
+   for (int i = 0; i < _graph.degree(vertex); i++) {
+      int edge = nei_edges[i];
 
       int vertex1 = _graph.getEdge(edge).beg;
       int vertex2 = _graph.getEdge(edge).end;
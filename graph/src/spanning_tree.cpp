@@ -25,36 +25,63 @@ CP_DEF(SpanningTree);
 SpanningTree::SpanningTree (Graph &graph, const Filter *vertex_filter, const Filter *edge_filter) : _graph(graph),
 CP_INIT,
 TL_CP_GET(_edges_list),
+TL_CP_GET(_tree_edges),
 TL_CP_GET(_depth_counters),
-TL_CP_GET(_tree),
+TL_CP_GET(_parent_edges),
 TL_CP_GET(_mapping),
 TL_CP_GET(_inv_mapping),
-TL_CP_GET(_edge_mapping),
-TL_CP_GET(_stack)
+TL_CP_GET(_stack),
+TL_CP_GET(_frozen)
 {
-   int i;
+   _vertex_filter = vertex_filter;
+   _edge_filter = edge_filter;
 
+   _frozen.build(graph);
+   _fg = &_frozen;
+   _init();
+}
+
+SpanningTree::SpanningTree (const FrozenGraph &graph, const Filter *vertex_filter, const Filter *edge_filter) :
+_graph(graph.graph()),
+CP_INIT,
+TL_CP_GET(_edges_list),
+TL_CP_GET(_tree_edges),
+TL_CP_GET(_depth_counters),
+TL_CP_GET(_parent_edges),
+TL_CP_GET(_mapping),
+TL_CP_GET(_inv_mapping),
+TL_CP_GET(_stack),
+TL_CP_GET(_frozen)
+{
    _vertex_filter = vertex_filter;
    _edge_filter = edge_filter;
 
-   _tree.clear();
+   _fg = &graph;
+   _init();
+}
+
+void SpanningTree::_init ()
+{
+   int i, n = 0;
+
    _edges_list.clear();
-   _mapping.clear_resize(_graph.vertexCount());
-   _edge_mapping.clear_resize(_graph.edgeCount());
-   _inv_mapping.clear_resize(_graph.vertexEnd());
+   _tree_edges.clear();
+   _mapping.clear_resize(_fg->vertexCount());
+   _inv_mapping.clear_resize(_fg->vertexEnd());
 
-   for (i = _graph.vertexBegin(); i < _graph.vertexEnd(); i = _graph.vertexNext(i))
+   for (i = _fg->vertexBegin(); i < _fg->vertexEnd(); i = _fg->vertexNext(i))
    {
-      if (vertex_filter != 0 && !vertex_filter->valid(i))
+      if (_vertex_filter != 0 && !_vertex_filter->valid(i))
          continue;
-      int idx = _tree.addVertex();
 
-      _mapping[idx] = i;
-      _inv_mapping[i] = idx;
+      _mapping[n] = i;
+      _inv_mapping[i] = n++;
    }
 
-   _depth_counters.clear_resize(_tree.vertexEnd());
+   _depth_counters.clear_resize(n);
    _depth_counters.zerofill();
+   _parent_edges.clear_resize(n);
+   _parent_edges.fffill();
    _current_depth = 0;
 
    int start = 0;
@@ -63,20 +90,17 @@ TL_CP_GET(_stack)
 
    while (1)
    {
-      for (; start < _tree.vertexEnd(); start = _tree.vertexNext(start))
+      for (; start < n; start++)
       {
-         if (vertex_filter != 0 && !vertex_filter->valid(_mapping[start]))
-            continue;
          if (_depth_counters[start] == 0)
             break;
       }
 
-      if (start == _tree.vertexEnd())
+      if (start == n)
          break;
 
       StackElem & elem = _stack.push();
-      elem.vertex = &_graph.getVertex(_mapping[start]);
-      elem.nei_idx = elem.vertex->neiBegin();
+      elem.nei_idx = 0;
       elem.vertex_idx = start;
       elem.parent_idx = -1;
       _depth_counters[start] = ++_current_depth;
@@ -92,37 +116,43 @@ void SpanningTree::_build ()
 
       int v = elem.vertex_idx;
       int i = elem.nei_idx;
+      int ext_v = _mapping[v];
 
-      if (i < elem.vertex->neiEnd())
+      if (i < _fg->degree(ext_v))
       {
-         elem.nei_idx = elem.vertex->neiNext(i);
+         elem.nei_idx++;
+
+         int nei_v = _fg->neiVertices(ext_v)[i];
+         int nei_edge = _fg->neiEdges(ext_v)[i];
 
-         int nei_v = elem.vertex->neiVertex(i);
          if (_vertex_filter != 0 && !_vertex_filter->valid(nei_v))
             continue;
 
          if (_edge_filter != 0)
          {
-            int nei_edge = elem.vertex->neiEdge(i);
             if (!_edge_filter->valid(nei_edge))
                continue;
          }
 
-         int w = _inv_mapping[elem.vertex->neiVertex(i)];
+         int w = _inv_mapping[nei_v];
 
          if (_depth_counters[w] == 0)
          {
-            int idx = _tree.addEdge(v, w);
+            ExtEdge &edge = _tree_edges.push();
 
-            _edge_mapping[idx] = elem.vertex->neiEdge(i);
+            edge.beg_idx = v;
+            edge.end_idx = w;
+            edge.ext_beg_idx = ext_v;
+            edge.ext_end_idx = nei_v;
+            edge.ext_edge_idx = nei_edge;
+            _parent_edges[w] = _tree_edges.size() - 1;
 
             StackElem &newelem = _stack.push();
 
             _depth_counters[w] = ++_current_depth;
             newelem.parent_idx = v;
             newelem.vertex_idx = w;
-            newelem.vertex = &_graph.getVertex(_mapping[w]);
-            newelem.nei_idx = newelem.vertex->neiBegin();
+            newelem.nei_idx = 0;
          }
          else if  (w != elem.parent_idx && _depth_counters[w] < _depth_counters[v])
          {
@@ -130,9 +160,9 @@ void SpanningTree::_build ()
 
             edge.beg_idx = v;
             edge.end_idx = w;
-            edge.ext_beg_idx = _mapping[v];
-            edge.ext_end_idx = _mapping[w];
-            edge.ext_edge_idx = elem.vertex->neiEdge(i);
+            edge.ext_beg_idx = ext_v;
+            edge.ext_end_idx = nei_v;
+            edge.ext_edge_idx = nei_edge;
             _edges_list.push(edge);
          }
       }
@@ -141,27 +171,28 @@ void SpanningTree::_build ()
    }
 }
 
-void SpanningTree::addEdge (int beg, int end, int ext_index)
-{
-   int idx = _tree.addEdge(beg, end);
-   _edge_mapping[idx] = ext_index;
-}
-
 void SpanningTree::markAllEdgesInCycles (int *marks_out, int value)
 {
-   int i, j;
-
-   QS_DEF(Array<int>, path);
+   int i;
 
    for (i = 0; i < _edges_list.size(); i++)
    {
       const ExtEdge &ext_edge = _edges_list[i];
 
-      if (!_tree.findPath(ext_edge.beg_idx, ext_edge.end_idx, path))
-         throw Error("markAllEdgesInCycles(): no path");
+      // The search is depth-first, so the end of the edge is an ancestor of
+      // its beginning and the path between them goes up the tree
+      int v = ext_edge.beg_idx;
 
-      for (j = 0; j < path.size(); j++)
-         marks_out[_edge_mapping[path[j]]] = value;
+      while (v != ext_edge.end_idx)
+      {
+         int e = _parent_edges[v];
+
+         if (e == -1)
+            throw Error("markAllEdgesInCycles(): no path");
+
+         marks_out[_tree_edges[e].ext_edge_idx] = value;
+         v = _tree_edges[e].beg_idx;
+      }
 
       marks_out[ext_edge.ext_edge_idx] = value;
    }
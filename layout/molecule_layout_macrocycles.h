@@ -124,6 +124,10 @@ namespace indigo {
       void setTargetAngle(int v, float angle);
       void setAngleImportance(int, float);
 
+      // Checked between the steps of the lattice search, the layout throws
+      // an Error when the handler reports cancellation
+      CancellationHandler* cancellation;
+
       class DLLEXPORT CycleLayout {
          CP_DECL;
       public:
@@ -171,6 +175,7 @@ namespace indigo {
       static const float SMOOTHING_MULTIPLIER;
       static const float CHANGE_FACTOR;
 
+      void _checkCancelled();
       void calculate_rotate_length();
       void rotate_cycle(int shift);
       void _rotate_ar_i(Array<int>& ar, Array<int>& tmp, int shift);
@@ -301,7 +306,8 @@ namespace indigo {
       CP_DECL;
       AnswerField(int len, int target_x, int target_y, float target_rotation, int* vertex_weight_link, int* vertex_stereo_link, int* edge_stereo_link);
 
-      void fill();
+      // The handler is checked once per cycle vertex
+      void fill(CancellationHandler* cancellation = 0);
       unsigned short& get_field(int len, answer_point p);
       unsigned short& get_field(answer_point p);
       void _restore_path(answer_point* point, answer_point finish);
@@ -15,6 +15,7 @@
 #ifndef __reaction_layout__
 
 #include "layout/metalayout.h"
+#include "base_cpp/cancellation_handler.h"
 
 namespace indigo {
 
@@ -28,6 +29,9 @@ public:
 
    void make ();
 
+   // The handler is passed to the layout of every reaction molecule
+   void setCancellationHandler (CancellationHandler* cancellation);
+
    float bond_length;
    float plus_interval_factor;
    float arrow_interval_factor;
@@ -51,6 +55,7 @@ private:
 
    BaseReaction& _r;
    Metalayout _ml;
+   CancellationHandler* _cancellation;
 };
 
 }
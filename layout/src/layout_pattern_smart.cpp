@@ -15,17 +15,17 @@
 #include "layout/layout_pattern_smart.h"
 
 #include "base_cpp/scanner.h"
-#include "base_cpp/os_sync_wrapper.h"
 #include "math/algebra.h"
 #include "graph/graph.h"
+#include "molecule/elements.h"
 #include "molecule/query_molecule.h"
-#include "molecule/molfile_loader.h"
 #include "molecule/molecule_substructure_matcher.h"
 #include "layout/molecule_layout_graph.h"
 
 #include "base_cpp/profiling.h"
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include "templates/layout_patterns.inc"
@@ -33,44 +33,142 @@
 using namespace indigo;
 using namespace std;
 
-class DLLEXPORT PatternLayoutSmart
-{      
-public:
-   QueryMolecule query_molecule;
-   MoleculeLayoutGraphSmart layout_graph;
-};
+namespace
+{
+   struct PatternKey
+   {
+      long morgan_code;
+      int vertex_count;
+      int edge_count;
 
-static vector<unique_ptr<PatternLayoutSmart>> _patterns;
-static OsLock _patterns_lock;
+      bool operator== (const PatternKey &other) const
+      {
+         return morgan_code == other.morgan_code && vertex_count == other.vertex_count &&
+                edge_count == other.edge_count;
+      }
+   };
 
-bool PatternLayoutFinder::tryToFindPattern (MoleculeLayoutGraphSmart &layout_graph)
+   struct PatternKeyHasher
+   {
+      size_t operator () (const PatternKey &key) const
+      {
+         size_t hash = (size_t)key.morgan_code;
+         hash = hash * 31 + (size_t)key.vertex_count;
+         hash = hash * 31 + (size_t)key.edge_count;
+         return hash;
+      }
+   };
+
+   // Layout templates indexed by the Morgan code and the graph size. The
+   // template molecules are not changed after the index is built, so the
+   // embeddings are searched from several threads without locking.
+   class PatternIndex
+   {
+   public:
+      PatternIndex ();
+
+      const vector<const QueryMolecule *> * find (const PatternKey &key) const;
+
+   private:
+      void _loadTemplate (BufferScanner &scanner, QueryMolecule &qm);
+
+      vector<unique_ptr<QueryMolecule>> _patterns;
+      unordered_map<PatternKey, vector<const QueryMolecule *>, PatternKeyHasher> _index;
+   };
+}
+
+PatternIndex::PatternIndex ()
 {
-   _initPatterns();
+   profTimerStart(t0, "layout.init-patterns");
 
-   layout_graph.calcMorganCode();
+   BufferScanner scanner(layout_templates, (int)sizeof(layout_templates));
+   int count = scanner.readBinaryWord();
 
-   for (auto & pattern : _patterns)
+   _patterns.reserve(count);
+   for (int i = 0; i < count; i++)
    {
-      MoleculeLayoutGraphSmart &plg = pattern->layout_graph;
+      _patterns.emplace_back(new QueryMolecule);
+      QueryMolecule &qm = *_patterns.back();
+
+      _loadTemplate(scanner, qm);
+
+      MoleculeLayoutGraphSmart layout_graph;
+      layout_graph.makeOnGraph(qm);
+      layout_graph.calcMorganCode();
+
+      PatternKey key = {layout_graph.getMorganCode(), layout_graph.vertexCount(), layout_graph.edgeCount()};
+      _index[key].push_back(&qm);
+   }
+}
 
-      // Compare morgan code and graph size
-      if (plg.getMorganCode() != layout_graph.getMorganCode())
-         continue;
+void PatternIndex::_loadTemplate (BufferScanner &scanner, QueryMolecule &qm)
+{
+   // The blob layout is described in templates/generate_layout_patterns.py.
+   // The atoms and bonds are the same the MolfileLoader makes of the template.
+   int atoms_count = scanner.readBinaryWord();
+   int bonds_count = scanner.readBinaryWord();
 
-      if (plg.vertexCount() != layout_graph.vertexCount())
-         continue;
+   for (int i = 0; i < atoms_count; i++)
+   {
+      char label[3] = {0, 0, 0};
+      scanner.readCharsFix(2, label);
+      float x = scanner.readBinaryInt() / 10000.f;
+      float y = scanner.readBinaryInt() / 10000.f;
 
-      if (plg.edgeCount() != layout_graph.edgeCount())
-         continue;
+      int idx = qm.addAtom(new QueryMolecule::Atom(QueryMolecule::ATOM_NUMBER, Element::fromString(label)));
+      qm.setAtomXyz(idx, x, y, 0);
+   }
 
-      OsLocker locker(_patterns_lock);
+   for (int i = 0; i < bonds_count; i++)
+   {
+      int beg = scanner.readBinaryWord();
+      int end = scanner.readBinaryWord();
+      int order = scanner.readByte();
+
+      // 8 is the 'any' molfile bond
+      if (order == 8)
+         qm.addBond(beg, end, new QueryMolecule::Bond());
+      else
+         qm.addBond(beg, end, new QueryMolecule::Bond(QueryMolecule::BOND_ORDER, order));
+   }
+}
 
+const vector<const QueryMolecule *> * PatternIndex::find (const PatternKey &key) const
+{
+   auto it = _index.find(key);
+   if (it == _index.end())
+      return nullptr;
+   return &it->second;
+}
+
+static const PatternIndex & _getPatterns ()
+{
+   // Thread-safe initialization on the first call
+   static const PatternIndex patterns;
+   return patterns;
+}
+
+bool PatternLayoutFinder::tryToFindPattern (MoleculeLayoutGraphSmart &layout_graph)
+{
+   const PatternIndex &patterns = _getPatterns();
+
+   layout_graph.calcMorganCode();
+
+   PatternKey key = {layout_graph.getMorganCode(), layout_graph.vertexCount(), layout_graph.edgeCount()};
+   const vector<const QueryMolecule *> *candidates = patterns.find(key);
+   if (candidates == nullptr)
+      return false;
+
+   for (const QueryMolecule *pattern : *candidates)
+   {
       profTimerStart(t0, "layout.find-pattern");
 
-      // Check if substructure matching found
+      // Check if substructure matching found. The enumerator and the match
+      // callbacks only read the template.
+      QueryMolecule &qm = const_cast<QueryMolecule &>(*pattern);
       EmbeddingEnumerator ee(layout_graph);
 
-      ee.setSubgraph(pattern->query_molecule);
+      ee.setSubgraph(qm);
       ee.cb_match_edge = _matchPatternBond;
       ee.cb_match_vertex = _matchPatternAtom;
 
@@ -78,7 +176,6 @@ bool PatternLayoutFinder::tryToFindPattern (MoleculeLayoutGraphSmart &layout_gra
       {
          // Embedding has been found -> copy coordinates
          const int *mapping = ee.getSubgraphMapping();
-         QueryMolecule &qm = pattern->query_molecule;
          int v0 = layout_graph.vertexBegin();
          for (int v = qm.vertexBegin(); v != qm.vertexEnd(); v = qm.vertexNext(v))
          {
@@ -99,39 +196,6 @@ bool PatternLayoutFinder::tryToFindPattern (MoleculeLayoutGraphSmart &layout_gra
    return false;
 }
 
-void PatternLayoutFinder::_initPatterns ()
-{
-   if (!_patterns.empty())
-      return;
-
-   OsLocker locker(_patterns_lock);
-   
-   if (!_patterns.empty())
-      return;
-
-   profTimerStart(t0, "layout.init-patterns");
-
-   _patterns.reserve(NELEM(layout_templates));
-   for (const char *tpl : layout_templates)
-   {
-      _patterns.emplace_back(new PatternLayoutSmart);
-      auto &pattern = _patterns.back();
-
-      BufferScanner scanner(tpl);
-      MolfileLoader loader(scanner);
-
-      loader.loadQueryMolecule(pattern->query_molecule);
-      pattern->layout_graph.makeOnGraph(pattern->query_molecule);
-
-      // Copy coordinates
-      QueryMolecule &qm = pattern->query_molecule;
-      for (int v = qm.vertexBegin(); v != qm.vertexEnd(); v = qm.vertexNext(v))
-         pattern->layout_graph.getPos(v) = qm.getAtomXyz(v).projectZ();
-
-      pattern->layout_graph.calcMorganCode();
-   }
-}
-
 bool PatternLayoutFinder::_matchPatternBond (Graph &subgraph, Graph &supergraph, int sub_idx, int super_idx, void *userdata)
 {
    MoleculeLayoutGraphSmart &target = (MoleculeLayoutGraphSmart &)supergraph;
@@ -411,6 +411,7 @@ void MoleculeLayout::make ()
                layout.max_iterations = max_iterations;
                layout.layout_orientation = layout_orientation;
                layout.bond_length = bond_length;
+               layout.setCancellationHandler(_layout_graph->cancellation);
                layout.make();
             }
             _pushMol(line, mol); // add molecule to metalayout AFTER its own layout is determined
@@ -91,6 +91,7 @@ void MoleculeLayoutGraphSimple::_assignAbsoluteCoordinates (float bond_length)
       bc_decom.getComponent(i, comp);
       std::unique_ptr<MoleculeLayoutGraph> tmp((MoleculeLayoutGraph *)getInstance());
       tmp->makeLayoutSubgraph(*this, comp);
+      tmp->cancellation = cancellation;
       bc_components.add(tmp.release()) ;
    }
    
@@ -78,6 +78,7 @@ void MoleculeLayoutGraphSmart::_assignAbsoluteCoordinates (float bond_length)
       bc_decom.getComponent(i, comp);
       std::unique_ptr<MoleculeLayoutGraph> current_component(getInstance());
       current_component->makeLayoutSubgraph(*this, comp);
+      current_component->cancellation = cancellation;
       bc_components.add(current_component.release());
    }
 
@@ -352,6 +353,7 @@ void MoleculeLayoutGraphSmart::_assignEveryCycle(const Cycle &cycle)
    _first_vertex_idx = cycle.getVertex(0);
 
    MoleculeLayoutMacrocyclesLattice layout(size);
+   layout.cancellation = cancellation;
 
    if (size <= 6)
 	   for (int i = 0; i < size; i++)
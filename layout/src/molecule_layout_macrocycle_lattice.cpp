@@ -90,7 +90,7 @@ TL_CP_GET(_vertex_drawn)
 
    _vertex_drawn.clear_resize(size);
 
-
+   cancellation = 0;
 }
 
 void MoleculeLayoutMacrocyclesLattice::doLayout() {
@@ -112,7 +112,7 @@ void MoleculeLayoutMacrocyclesLattice::doLayout() {
    rotate_cycle(rotate_length);
    AnswerField answfld(length, 0, 0, 0, _vertex_weight.ptr(), _vertex_stereo.ptr(), _edge_stereo.ptr());
 
-   answfld.fill();
+   answfld.fill(cancellation);
 
    QS_DEF(Array<answer_point>, points);
    points.clear_resize(0);
@@ -145,6 +145,7 @@ void MoleculeLayoutMacrocyclesLattice::doLayout() {
    Array<answer_point> path;
    path.clear_resize(length + 1);
    for (int i = 0; i < 100 && i < points.size(); i++) {
+      _checkCancelled();
       answfld._restore_path(path.ptr(), points[i]);
       cl.init(path.ptr());
       smoothing(cl);
@@ -176,6 +177,11 @@ void MoleculeLayoutMacrocyclesLattice::doLayout() {
 }
 
 
+void MoleculeLayoutMacrocyclesLattice::_checkCancelled() {
+   if (cancellation && cancellation->isCancelled())
+      throw Error("Macrocycle layout has been cancelled: %s", cancellation->cancelledRequestMessage());
+}
+
 void MoleculeLayoutMacrocyclesLattice::calculate_rotate_length() {
 
    rotate_length = 0;
@@ -585,8 +591,11 @@ TriangleLattice& AnswerField::getLattice(int l, int rot, int p) {
 
 
 
-void AnswerField::fill() {
+void AnswerField::fill(CancellationHandler* cancellation) {
    for (int l = 0; l <= length; l++) {
+      if (cancellation && cancellation->isCancelled())
+         throw Error("Macrocycle layout has been cancelled: %s", cancellation->cancelledRequestMessage());
+
       for (int rot = -l; rot <= l; rot++) {
          for (int p = 0; p < 2; p++) {
             TriangleLattice& lat = getLattice(l, rot, p);
@@ -603,6 +612,9 @@ void AnswerField::fill() {
 
 
    for (int l = 0; l < length; l++) {
+      if (cancellation && cancellation->isCancelled())
+         throw Error("Macrocycle layout has been cancelled: %s", cancellation->cancelledRequestMessage());
+
       for (int rot = -l; rot <= l; rot++) {
          for (int p = 0; p < 2; p++) {
             bool can[3];
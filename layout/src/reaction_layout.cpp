@@ -28,6 +28,12 @@ _r(r),
 _smart_layout(smart_layout)
 {
    max_iterations = 0;
+   _cancellation = 0;
+}
+
+void ReactionLayout::setCancellationHandler (CancellationHandler* cancellation)
+{
+   _cancellation = cancellation;
 }
 
 void ReactionLayout::make ()
@@ -41,6 +47,7 @@ void ReactionLayout::make ()
          molLayout.max_iterations = max_iterations;
          molLayout.layout_orientation = layout_orientation;
          molLayout.bond_length = bond_length;
+         molLayout.setCancellationHandler(_cancellation);
          molLayout.make();
       }
    }
@@ -1,39 +1,100 @@
 import os
+import struct
 
+# Templates are stored as a binary blob, so they are not parsed by the
+# MolfileLoader at runtime. The blob layout (little endian):
+#
+#   uint16 templates count
+#   for every template:
+#     uint16 atoms count, uint16 bonds count
+#     atoms: char[2] element label, int32 x * 10000, int32 y * 10000
+#            (z is dropped, the layout uses the projection only)
+#     bonds: uint16 begin, uint16 end, uint8 molfile bond type
+#
+# Only plain V2000 connection tables are supported: the templates must not
+# have charges, isotopes, stereo, bond topology or properties other than END.
 
-def process_ctab(fname, input, output, replace_header=True):
-    content = input.split("\n")
-    # replace first line with file name
-    if replace_header:
-        content[0] = fname
-    lines = ['  "' + line.strip('\n').strip('\r') + '\\n"' for line in content]
 
-    output.write('\n'.join(lines))
-    output.write(',\n\n')
+def parse_coord(value):
+    return int(round(float(value) * 10000))
+
+
+def parse_ctab(fname, content):
+    lines = content.split('\n')
+    counts = lines[3]
+    atoms_count = int(counts[0:3])
+    bonds_count = int(counts[3:6])
+
+    if 'V2000' not in counts:
+        raise ValueError('{}: only V2000 templates are supported'.format(fname))
+
+    atoms = []
+    for line in lines[4:4 + atoms_count]:
+        label = line[31:34].strip()
+        if len(label) > 2 or any(int(f) != 0 for f in line[34:].split()):
+            raise ValueError('{}: unsupported atom "{}"'.format(fname, line))
+        atoms.append((label, parse_coord(line[0:10]), parse_coord(line[10:20])))
+
+    bonds = []
+    for line in lines[4 + atoms_count:4 + atoms_count + bonds_count]:
+        beg, end, order = int(line[0:3]), int(line[3:6]), int(line[6:9])
+        if order not in (1, 2, 3, 4, 8) or any(int(f) != 0 for f in line[9:].split()):
+            raise ValueError('{}: unsupported bond "{}"'.format(fname, line))
+        bonds.append((beg - 1, end - 1, order))
+
+    for line in lines[4 + atoms_count + bonds_count:]:
+        if line.startswith('M  END'):
+            break
+        if line.startswith('M  '):
+            raise ValueError('{}: unsupported property "{}"'.format(fname, line))
+
+    return atoms, bonds
+
+
+def write_template(atoms, bonds, blob):
+    blob += struct.pack('<HH', len(atoms), len(bonds))
+    for label, x, y in atoms:
+        blob += struct.pack('<2sii', label.encode('ascii'), x, y)
+    for beg, end, order in bonds:
+        blob += struct.pack('<HHB', beg, end, order)
+
 
 names = sorted(list(os.listdir('molecules')), key=str.lower)
 
+templates = []
+for fname in names:
+    if fname.endswith('mol'):
+        print(fname)
+        with open(os.path.join('molecules', fname)) as content:
+            templates.append(parse_ctab(fname, content.read().replace('\r', '')))
+    elif fname.endswith('sdf'):
+        print(fname)
+        with open(os.path.join('molecules', fname)) as sdf:
+            reader = sdf.read().replace('\r', '')
+            for content in reader.split('$$$$'):
+                # Keep the (possibly empty) name line of the record
+                if content.startswith('\n'):
+                    content = content[1:]
+                if content.strip():
+                    templates.append(parse_ctab(fname, content))
+    else:
+        print("unknown molecule format")
+
+blob = bytearray(struct.pack('<H', len(templates)))
+for atoms, bonds in templates:
+    write_template(atoms, bonds, blob)
+
 with open('layout_patterns.inc', 'w') as templates_file:
+    templates_file.write('// Generated by generate_layout_patterns.py, do not edit.\n')
     templates_file.write('// Templates from the following files:\n')
     for fname in names:
         templates_file.write('//   {}\n'.format(fname))
 
-    templates_file.write('static const char* layout_templates[] =\n')
+    templates_file.write('static const unsigned char layout_templates[] =\n')
     templates_file.write('{\n')
 
-    for fname in names:
-        if fname.endswith('mol'):
-            print(fname)
-            with open(os.path.join('molecules', fname)) as content:
-                process_ctab(fname, content.read(), templates_file)
-        elif fname.endswith('sdf'):
-            print(fname)
-            with open(os.path.join('molecules', fname)) as sdf:
-                reader = sdf.read()
-                for i, content in enumerate(reader.split('$$$$')):
-                    # print(content)
-                    process_ctab(fname, content.strip(), templates_file, False)
-        else:
-            print("unknown molecule format")
+    for i in range(0, len(blob), 16):
+        chunk = blob[i:i + 16]
+        templates_file.write('  ' + ' '.join('0x{:02x},'.format(b) for b in chunk) + '\n')
 
     templates_file.write("};\n")
@@ -16,9 +16,8 @@
 #ifndef PROJECT_MOLECULE_MORGAN_FINGERPRINT_H
 #define PROJECT_MOLECULE_MORGAN_FINGERPRINT_H
 
-#include <set>
-#include <vector>
 #include <base_cpp/array.h>
+#include <base_cpp/tlscont.h>
 #include "base_c/defs.h"
 #include "base_molecule.h"
 
@@ -34,10 +33,20 @@ public:
    void packFingerprintECFP(int fp_depth, Array <byte> &res);
    void packFingerprintFCFP(int fp_depth, Array <byte> &res);
 
+   // Distinct feature hashes in ascending order and the number of the
+   // features with each of them
+   void countFeaturesECFP(int fp_depth, Array<dword> &hashes, Array<int> &counts);
+   void countFeaturesFCFP(int fp_depth, Array<dword> &hashes, Array<int> &counts);
+
+   // Bit of the feature hash in a fingerprint of the given number of bits.
+   // For a whole number of bytes it is the bit set by packFingerprint*().
+   static int foldedBit(dword hash, int bits);
+
 private:
    enum {MAGIC_HASH_NUMBER = 37};
 
    static void setBits(dword hash, byte *fp, int size);
+   void countFeatures(Array<dword> &hashes, Array<int> &counts);
 
    typedef dword (*InitialStateCallback)(BaseMolecule &mol, int idx);
 
@@ -74,26 +83,38 @@ private:
       int edge_idx;
    };
 
-   struct FeatureDescriptor{
-      dword hash;
-      std::set<int> bond_set;
-
-      bool operator==(const FeatureDescriptor &rhs) const;
-
-      bool operator<(const FeatureDescriptor &rhs) const;
-   };
+   int bondDescriptorCmp(const BondDescriptor & bd1, const BondDescriptor & bd2);
 
-   struct AtomDescriptor {
-      FeatureDescriptor descr;
-      FeatureDescriptor new_descr;
-      std::vector<BondDescriptor> bond_descriptors;
-   };
+   /**
+    * A feature is the hash of an atom neighbourhood and the set of its bonds.
+    * The bond sets are bitsets of bond_words qwords by the edge index, kept in
+    * the flat arrays, so that no memory is allocated per atom or feature.
+    * The features with the same bond set are the same feature.
+    *  */
+   qword *atomBonds(Array<qword> &bonds, int idx) { return bonds.ptr() + idx * bond_words; }
+   qword *featureBonds(int feature) { return feature_bonds.ptr() + feature * bond_words; }
+   bool sameBonds(const qword *bonds1, const qword *bonds2) const;
+   int bondsSlot(const qword *bonds, int table_size) const;
 
-   int bondDescriptorCmp(const BondDescriptor & bd1, const BondDescriptor & bd2);
+   void addNewFeature(int idx);
+   void addFeature(int idx);
 
    BaseMolecule& mol;
-   std::vector<FeatureDescriptor> features;
-   std::vector<AtomDescriptor> atom_descriptors;
+   int bond_words;
+
+   CP_DECL;
+   TL_CP_DECL(Array<int>, atoms);                         // vertices in the order of the molecule
+   TL_CP_DECL(Array<int>, bond_offsets);                  // range of bond_descriptors of a vertex
+   TL_CP_DECL(Array<BondDescriptor>, bond_descriptors);
+   TL_CP_DECL(Array<dword>, atom_hashes);                 // by the vertex index
+   TL_CP_DECL(Array<dword>, new_atom_hashes);
+   TL_CP_DECL(Array<qword>, atom_bonds);                  // by the vertex index
+   TL_CP_DECL(Array<qword>, new_atom_bonds);
+   TL_CP_DECL(Array<int>, new_features);                  // vertices of the features found at the iteration
+   TL_CP_DECL(Array<int>, new_features_table);            // hash table of new_features, vertex + 1
+   TL_CP_DECL(Array<dword>, feature_hashes);
+   TL_CP_DECL(Array<qword>, feature_bonds);
+   TL_CP_DECL(Array<int>, features_table);                // hash table of the features, feature + 1
 };
 
 };
@@ -0,0 +1,135 @@
+/****************************************************************************
+ * Copyright (C) 2009-2015 EPAM Systems
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * This file may be distributed and/or modified under the terms of the
+ * GNU General Public License version 3 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.
+ *
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ ***************************************************************************/
+
+#ifndef __molecule_query_program__
+#define __molecule_query_program__
+
+#include "molecule/query_molecule.h"
+#include "base_cpp/obj_array.h"
+#include "base_cpp/red_black.h"
+#include "base_cpp/tlscont.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable:4251)
+#endif
+
+namespace indigo {
+
+class AromaticityMatcher;
+
+// Atom and bond constraint trees of a query lowered into flat arrays of
+// instructions for the substructure matcher. Nested AND and OR nodes are
+// merged, NOT is pushed down to the leaves, and the element lists like
+// [C,N,O] become one bitmask check. The constraints that don't depend on
+// a single target value (pseudoatoms, templates, recursive SMARTS) are
+// checked by MoleculeSubstructureMatcher::matchQueryAtom() on the subtree.
+//
+// The result is the same as of matchQueryAtom() and matchQueryBond() with
+// the same flags. The program must be recompiled if the query is changed.
+// An atom or bond is compiled when it is matched for the first time, most
+// of the queries fail on a few first atoms.
+class DLLEXPORT MoleculeQueryProgram
+{
+public:
+   typedef ObjArray< RedBlackStringMap<int> > FragmentMatchCache;
+
+   MoleculeQueryProgram ();
+
+   void compile (QueryMolecule &query);
+   void clear ();
+
+   bool isCompiledFor (const QueryMolecule &query) const { return _query == &query; }
+
+   bool matchAtom (int sub_idx, BaseMolecule &target, int super_idx,
+                   FragmentMatchCache *fmcache, dword flags);
+   bool matchBond (int sub_idx, BaseMolecule &target, int super_idx,
+                   AromaticityMatcher *am, dword flags);
+
+   // False if the query atom can't match any atom with the given number.
+   // It is the cheapest check, the matcher does it first.
+   bool possibleAtomNumber (int sub_idx, int number);
+
+   // QueryMolecule::getAtomMinH() of the query atom, 0 if it can't be found
+   int atomMinH (int sub_idx);
+
+protected:
+   enum
+   {
+      _AND,           // conjunction of the next size - 1 instructions
+      _OR,            // disjunction of the next size - 1 instructions
+      _ATOM_VALUE,    // MoleculeSubstructureMatcher::matchAtomConstraint()
+      _ATOM_ELEMENTS, // target atom number is in the bitmask
+      _ATOM_TREE,     // MoleculeSubstructureMatcher::matchQueryAtom()
+      _BOND_VALUE     // MoleculeSubstructureMatcher::matchBondConstraint()
+   };
+
+   struct Instruction
+   {
+      int op;
+      int size;      // number of instructions in the subtree
+      int type;      // QueryMolecule::OpType of a leaf
+      int value_min;
+      int value_max;
+      bool negative; // the leaf is under odd number of NOT nodes
+      dword flags_xor;
+      qword elements[2];
+      QueryMolecule::Node *node;
+   };
+
+   // Atom numbers for which the subtree can be true. Numbers out of the
+   // bitmask range, like ELEM_PSEUDO, are in the set if others is set.
+   struct ElementSet
+   {
+      qword bits[2];
+      bool others;
+   };
+
+   struct Context
+   {
+      BaseMolecule *target;
+      int sub_idx;
+      int super_idx;
+      FragmentMatchCache *fmcache;
+      AromaticityMatcher *am;
+      dword flags;
+   };
+
+   void _compileAtom (int idx);
+   void _compileBond (int idx);
+   void _compile (QueryMolecule::Node *node, bool is_bond, bool negative, dword flags_xor);
+   void _compileGroup (QueryMolecule::Node *node, int op, bool is_bond, bool negative,
+                       dword flags_xor, int &elements_pos);
+   Instruction & _push (int op, bool negative, dword flags_xor);
+   void _possibleElements (const Instruction *ins, ElementSet &set);
+
+   bool _run (const Instruction *ins, const Context &context);
+
+   QueryMolecule *_query;
+
+   CP_DECL;
+   TL_CP_DECL(Array<Instruction>, _code);
+   TL_CP_DECL(Array<int>, _atom_start);
+   TL_CP_DECL(Array<int>, _bond_start);
+   TL_CP_DECL(Array<int>, _min_h);
+   TL_CP_DECL(Array<ElementSet>, _elements);
+};
+
+}
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif
@@ -0,0 +1,115 @@
+/****************************************************************************
+ * Copyright (C) 2009-2015 EPAM Systems
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * This file may be distributed and/or modified under the terms of the
+ * GNU General Public License version 3 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.
+ *
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ ***************************************************************************/
+
+#ifndef __molecule_query_set__
+#define __molecule_query_set__
+
+#include "molecule/molecule.h"
+#include "molecule/query_molecule.h"
+#include "molecule/molecule_arom.h"
+#include "molecule/molecule_fingerprint.h"
+#include "molecule/molecule_neighbourhood_counters.h"
+#include "molecule/molecule_substructure_matcher.h"
+#include "graph/frozen_graph.h"
+#include "base_cpp/obj_array.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable:4251)
+#endif
+
+namespace indigo {
+
+// Set of substructure queries, like structural alerts, that are checked
+// against a target together. The target is prepared once for all of the
+// queries: it is aromatized, its neighbourhood counters, element counts and
+// fingerprint are found, and the results of the recursive SMARTS are shared.
+// A query is matched only if the target has enough atoms of each element the
+// query needs and, if use_fingerprints is set, the fingerprint of the query
+// is a subset of the target one.
+//
+// The result for every query is the same as of the substructure matcher
+// with the same aromaticity options.
+class DLLEXPORT MoleculeQuerySet
+{
+public:
+   explicit MoleculeQuerySet (const MoleculeFingerprintParameters &fp_params);
+   ~MoleculeQuerySet ();
+
+   AromaticityOptions arom_options;
+
+   // Screen the queries by the fingerprints, false by default. The target
+   // fingerprint costs as much as tens of simple SMARTS matches, so it pays
+   // off only for large sets of big queries.
+   bool use_fingerprints;
+
+   // Adds a copy of the query and returns its index in the set
+   int add (QueryMolecule &query);
+   int size () const;
+   void clear ();
+
+   // Indices of the queries that are substructures of the target, in
+   // ascending order. The target itself is not changed.
+   void match (Molecule &target, Array<int> &ids);
+
+   // Number of the queries skipped by the screening at the last match()
+   int screenedOut () const { return _screened_out; }
+
+   DECL_ERROR;
+
+protected:
+   struct _Query
+   {
+      QueryMolecule query;
+      MoleculeAtomNeighbourhoodCounters nei_counters;
+      Array<byte> fingerprint;  // empty if the fingerprint has no bits
+      Array<int> elements;      // pairs of element and minimal count
+      int heavy_atoms;          // atoms that can't be hydrogens
+      bool h_unfold;
+   };
+
+   struct _Target
+   {
+      Molecule mol;
+      MoleculeAtomNeighbourhoodCounters nei_counters;
+      MoleculeSubstructureMatcher::FragmentMatchCache fmcache;
+      FrozenGraph frozen;       // made by the first query, after the hydrogens are unfolded
+      bool prepared;
+   };
+
+   void _prepare (Molecule &source, _Target &prepared, bool aromatize);
+   bool _screen (const _Query &query);
+
+   MoleculeFingerprintParameters _fp_params;
+
+   ObjArray<_Query> _queries;
+   bool _fingerprints_needed;
+
+   _Target _target, _target_h_unfolded;
+   Array<int> _element_counts;
+   int _heavy_atoms;
+   Array<byte> _fingerprint;
+   int _screened_out;
+
+private:
+   MoleculeQuerySet (const MoleculeQuerySet &); // no implicit copy
+};
+
+}
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif
@@ -19,6 +19,7 @@
 #include "molecule/query_molecule.h"
 #include "molecule/molecule_pi_systems_matcher.h"
 #include "molecule/molecule_arom_match.h"
+#include "molecule/molecule_query_program.h"
 #include "graph/embedding_enumerator.h"
 #include "graph/embeddings_storage.h"
 #include "base_cpp/auto_ptr.h"
@@ -71,6 +72,10 @@ public:
 
    FragmentMatchCache *fmcache;
 
+   // Snapshot of the target shared by the matchers, see
+   // EmbeddingEnumerator::setFrozenSupergraph()
+   const FrozenGraph *frozen_target;
+
    bool highlight;
 
    bool disable_unfolding_implicit_h;
@@ -150,6 +155,13 @@ public:
    static bool matchQueryBond (QueryMolecule::Bond *query,
              BaseMolecule &target, int sub_idx, int super_idx, AromaticityMatcher *am, dword flags);
 
+   // Single leaf constraints of the query atom and bond trees
+   static bool matchAtomConstraint (int type, int value_min, int value_max,
+                  BaseMolecule &target, int super_idx, dword flags);
+
+   static bool matchBondConstraint (int type, int value,
+             BaseMolecule &target, int sub_idx, int super_idx, AromaticityMatcher *am, dword flags);
+
    static void makeTransposition (BaseMolecule &mol, Array<int> &transposition);
 
    DECL_ERROR;
@@ -219,6 +231,9 @@ protected:
    Obj<AromaticityMatcher> _am;
    Obj<MoleculePiSystemsMatcher> _pi_systems_matcher;
 
+   // Compiled atom and bond constraints of the query, see find()
+   MoleculeQueryProgram _program;
+
    bool _h_unfold; // implicit target hydrogens unfolded
 
    CP_DECL;
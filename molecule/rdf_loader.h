@@ -18,10 +18,12 @@
 #include "base_cpp/tlscont.h"
 #include "base_cpp/obj.h"
 #include "base_cpp/properties_map.h"
+#include "base_cpp/record_index.h"
 
 namespace indigo {
 
 class Scanner;
+class Output;
 /*
  * RD files loader
  * An RDfile (reaction-data file) consists of a set of editable “records.” Each record defines a
@@ -45,6 +47,15 @@ public:
    int currentNumber ();
    int count ();
 
+   /*
+    * Finds the offsets of all records without parsing them, see RecordIndex
+    */
+   void buildIndex (int threads);
+   bool isIndexComplete ();
+
+   void saveIndex (Output &output, const RecordIndex::Source &source);
+   void loadIndex (Scanner &input, const RecordIndex::Source &source);
+
    CP_DECL;
    /*
     * Data buffer with reaction or molecule for current record
@@ -67,12 +78,22 @@ protected:
    bool _readIdentifiers(bool);
    inline Scanner& _getScanner() const;
    static bool _readLine(Scanner&, Array<char>&);
+   /*
+    * Reads the next line of the input into the inner buffer
+    */
+   bool _readInnerLine();
+   /*
+    * The record header is read ahead, so the next record begins at the
+    * header line if it is in the inner buffer
+    */
+   long long _nextRecordOffset() const;
 
    inline bool _startsWith(const char* str) const {
       return ((size_t)_innerBuffer.size() >= strlen(str) && strncmp(_innerBuffer.ptr(), str, strlen(str))==0);
    }
 
    TL_CP_DECL(Array<char>, _innerBuffer);
+   long long _innerBufferOffset;
    bool _ownScanner;
    Scanner *_scanner;
    bool _isMolecule;
@@ -80,6 +101,8 @@ protected:
    TL_CP_DECL(Array<long long>, _offsets);
    int _current_number;
    long long _max_offset;
+   long long _first_offset;
+   bool _index_complete;
 };
 
 }
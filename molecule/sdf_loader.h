@@ -18,10 +18,13 @@
 #include "base_cpp/tlscont.h"
 #include "base_cpp/red_black.h"
 #include "base_cpp/properties_map.h"
+#include "base_cpp/record_index.h"
 
 namespace indigo {
 
 class Scanner;
+class Output;
+class GZipScanner;
 
 class SdfLoader
 {
@@ -42,6 +45,19 @@ public:
 
    void readAt (int index);
 
+   // Finds the offsets of all records without parsing them, in parallel
+   // over the chunks of a mapped file. Gzipped input is read record by
+   // record.
+   void buildIndex (int threads);
+   // True if the offsets of all records are known
+   bool isIndexComplete ();
+
+   void saveIndex (Output &output, const RecordIndex::Source &source);
+   void loadIndex (Scanner &input, const RecordIndex::Source &source);
+
+   // Decompressing scanner if the input is gzipped, 0 otherwise
+   GZipScanner * getGZipScanner ();
+
    CP_DECL;
    TL_CP_DECL(Array<char>, data);
    TL_CP_DECL(PropertiesMap, properties);
@@ -55,6 +71,8 @@ protected:
    TL_CP_DECL(Array<char>, _preread);
    int _current_number;
    long long _max_offset;
+   long long _first_offset;
+   bool _index_complete;
 };
 
 }
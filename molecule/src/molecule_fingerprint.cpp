@@ -19,6 +19,7 @@
 
 #include "graph/graph_subtree_enumerator.h"
 #include "graph/cycle_enumerator.h"
+#include "graph/frozen_graph.h"
 #include "graph/subgraph_hash.h"
 
 #include "molecule/molecule.h"
@@ -611,8 +612,12 @@ void MoleculeFingerprintBuilder::_makeFingerprint (BaseMolecule &mol)
    else
       _tau_super_structure = 0;
    
+   // The subgraphs are not needed for the similarity bits of the other
+   // similarity types
+   bool sim_subgraphs = !skip_sim && _parameters.similarity_type == SimilarityType::SIM;
+
    if (!skip_ord || !skip_any_atoms || !skip_any_atoms_bonds ||
-       !skip_any_bonds || !skip_tau || !skip_sim)
+       !skip_any_bonds || !skip_tau || sim_subgraphs)
       _makeFingerprint_calcOrdSim(*mol_for_enumeration);
 
    if (!skip_ext && _parameters.ext)
@@ -673,11 +678,17 @@ void MoleculeFingerprintBuilder::_makeFingerprint_calcOrdSim(BaseMolecule &mol)
 
    _initHashCalculations(mol, vfilter);
 
+   // Both enumerators walk the same snapshot of the molecule
+   QS_DEF(FrozenGraph, frozen);
+   frozen.build(mol);
+
    CycleEnumerator ce(mol);
    GraphSubtreeEnumerator se(mol);
 
    ce.vfilter = &vfilter;
    se.vfilter = &vfilter;
+   ce.frozen_graph = &frozen;
+   se.frozen_graph = &frozen;
 
    bool sim_only = skip_ord && skip_tau && skip_any_atoms &&
                    skip_any_atoms_bonds && skip_any_bonds;
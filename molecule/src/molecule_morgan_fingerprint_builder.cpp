@@ -14,36 +14,44 @@
 
 #include <molecule/elements.h>
 #include <cmath>
-#include <vector>
-#include <set>
+#include <cstring>
 #include <algorithm>
 #include "molecule/molecule_morgan_fingerprint_builder.h"
 
 using namespace indigo;
 
-
-MoleculeMorganFingerprintBuilder::MoleculeMorganFingerprintBuilder(BaseMolecule &mol) : mol(mol) {}
+CP_DEF(MoleculeMorganFingerprintBuilder);
+
+MoleculeMorganFingerprintBuilder::MoleculeMorganFingerprintBuilder(BaseMolecule &mol) : mol(mol),
+   CP_INIT,
+   TL_CP_GET(atoms),
+   TL_CP_GET(bond_offsets),
+   TL_CP_GET(bond_descriptors),
+   TL_CP_GET(atom_hashes),
+   TL_CP_GET(new_atom_hashes),
+   TL_CP_GET(atom_bonds),
+   TL_CP_GET(new_atom_bonds),
+   TL_CP_GET(new_features),
+   TL_CP_GET(new_features_table),
+   TL_CP_GET(feature_hashes),
+   TL_CP_GET(feature_bonds),
+   TL_CP_GET(features_table)
+{
+   bond_words = 1;
+}
 
 void MoleculeMorganFingerprintBuilder::calculateDescriptorsECFP(int fp_depth, Array<dword> &res) {
    initDescriptors(initialStateCallback_ECFP);
    buildDescriptors(fp_depth);
    
-   res.clear();
-   
-   for(auto& feature : features) {
-      res.push(feature.hash);
-   }
+   res.copy(feature_hashes);
 }
 
 void MoleculeMorganFingerprintBuilder::calculateDescriptorsFCFP(int fp_depth, Array<dword> &res) {
    initDescriptors(initialStateCallback_FCFP);
    buildDescriptors(fp_depth);
 
-   res.clear();
-
-   for(auto& feature : features) {
-      res.push(feature.hash);
-   }
+   res.copy(feature_hashes);
 }
 
 void MoleculeMorganFingerprintBuilder::packFingerprintECFP(int fp_depth, Array<byte> &res) {
@@ -57,8 +65,8 @@ void MoleculeMorganFingerprintBuilder::packFingerprintECFP(int fp_depth, Array<b
    
    res.zerofill();
 
-   for(auto& feature : features) {
-      setBits(feature.hash, res.ptr(), size);
+   for(int i = 0; i < feature_hashes.size(); i++) {
+      setBits(feature_hashes[i], res.ptr(), size);
    }
 }
 
@@ -73,12 +81,46 @@ void MoleculeMorganFingerprintBuilder::packFingerprintFCFP(int fp_depth, Array<b
 
    res.zerofill();
 
-   for(auto& feature : features) {
-      setBits(feature.hash, res.ptr(), size);
+   for(int i = 0; i < feature_hashes.size(); i++) {
+      setBits(feature_hashes[i], res.ptr(), size);
    }
 }
 
-void MoleculeMorganFingerprintBuilder::setBits(dword hash, byte *fp, int size)
+void MoleculeMorganFingerprintBuilder::countFeaturesECFP(int fp_depth, Array<dword> &hashes, Array<int> &counts) {
+   initDescriptors(initialStateCallback_ECFP);
+   buildDescriptors(fp_depth);
+
+   countFeatures(hashes, counts);
+}
+
+void MoleculeMorganFingerprintBuilder::countFeaturesFCFP(int fp_depth, Array<dword> &hashes, Array<int> &counts) {
+   initDescriptors(initialStateCallback_FCFP);
+   buildDescriptors(fp_depth);
+
+   countFeatures(hashes, counts);
+}
+
+void MoleculeMorganFingerprintBuilder::countFeatures(Array<dword> &hashes, Array<int> &counts) {
+   hashes.copy(feature_hashes);
+   std::sort(hashes.ptr(), hashes.ptr() + hashes.size());
+
+   counts.clear();
+
+   int n = 0;
+
+   for (int i = 0; i < hashes.size(); i++) {
+      if (n > 0 && hashes[n - 1] == hashes[i]) {
+         counts.top()++;
+         continue;
+      }
+      hashes[n++] = hashes[i];
+      counts.push(1);
+   }
+
+   hashes.resize(n);
+}
+
+int MoleculeMorganFingerprintBuilder::foldedBit(dword hash, int bits)
 {
    unsigned seed = hash;
 
@@ -86,7 +128,18 @@ void MoleculeMorganFingerprintBuilder::setBits(dword hash, byte *fp, int size)
    seed = seed * 0x8088405 + 1;
 
    // Uniformly distributed bits
-   unsigned n = (unsigned)(((qword)(size * 8) * seed) / (unsigned)(-1));
+   unsigned n = (unsigned)(((qword)bits * seed) / (unsigned)(-1));
+
+   // seed may be (unsigned)(-1) itself
+   if (n >= (unsigned)bits)
+      n = bits - 1;
+
+   return (int)n;
+}
+
+void MoleculeMorganFingerprintBuilder::setBits(dword hash, byte *fp, int size)
+{
+   unsigned n = foldedBit(hash, size * 8);
 
    unsigned nByte = n / 8;
    unsigned nBit = n - nByte * 8;
@@ -95,80 +148,155 @@ void MoleculeMorganFingerprintBuilder::setBits(dword hash, byte *fp, int size)
 }
 
 void MoleculeMorganFingerprintBuilder::initDescriptors(InitialStateCallback initialStateCallback) {
-   features.clear();
-   atom_descriptors.clear();
+   int vertex_end = mol.vertexEnd();
+
+   bond_words = std::max(1, (mol.edgeEnd() + 63) / 64);
+
+   atoms.clear();
+   bond_offsets.clear_resize(vertex_end + 1);
+   bond_offsets.zerofill();
+   bond_descriptors.clear();
+
+   atom_hashes.clear_resize(vertex_end);
+   atom_hashes.zerofill();
+   new_atom_hashes.clear_resize(vertex_end);
+   atom_bonds.clear_resize(vertex_end * bond_words);
+   atom_bonds.zerofill();
+   new_atom_bonds.clear_resize(vertex_end * bond_words);
+
+   feature_hashes.clear();
+   feature_bonds.clear();
 
    for(int idx : mol.vertices()) {
-      AtomDescriptor atom_descriptor;
-      atom_descriptor.descr.hash = initialStateCallback(mol, idx);
+      atoms.push(idx);
+      atom_hashes[idx] = initialStateCallback(mol, idx);
 
       const Vertex &vertex = mol.getVertex(idx);
 
+      bond_offsets[idx] = bond_descriptors.size();
+
       for(int nei_idx : vertex.neighbors()) {
          int edge_idx = vertex.neiEdge(nei_idx);
          int vertex_idx = vertex.neiVertex(nei_idx);
 
          int bond_type = mol.getBondOrder(edge_idx);
 
-         atom_descriptor.bond_descriptors.push_back(BondDescriptor {bond_type, vertex_idx, edge_idx});
+         bond_descriptors.push(BondDescriptor {bond_type, vertex_idx, edge_idx});
       }
 
-      atom_descriptors.push_back(atom_descriptor);
+      bond_offsets[idx + 1] = bond_descriptors.size();
    }
 }
 
+static int _tableSize(int count) {
+   int size = 16;
+
+   while (size < count * 2)
+      size *= 2;
+   return size;
+}
+
 void MoleculeMorganFingerprintBuilder::buildDescriptors(int fp_depth) {
+   features_table.clear_resize(_tableSize(atoms.size() * fp_depth));
+   features_table.zerofill();
+
+   new_features_table.clear_resize(_tableSize(atoms.size()));
+
    for(int i = 0; i < fp_depth; i++) {
       calculateNewAtomDescriptors(i);
 
       // Update all atom descriptors simultaneously
-      std::vector<FeatureDescriptor> new_features;
-      for (auto &atom : atom_descriptors) {
-         atom.descr = atom.new_descr;
-
-         const auto &duplicate = std::find(new_features.begin(), new_features.end(), atom.descr);
-         if(duplicate == new_features.end()) {
-            new_features.push_back(atom.descr);
-         } else if(atom.descr.hash < duplicate->hash) { // the leaser hash is preferred
-            new_features.erase(duplicate);
-            new_features.push_back(atom.descr);
-         }
-      }
+      atom_hashes.copy(new_atom_hashes);
+      atom_bonds.copy(new_atom_bonds);
+
+      new_features.clear();
+      new_features_table.zerofill();
+
+      for (int k = 0; k < atoms.size(); k++)
+         addNewFeature(atoms[k]);
 
       // Features are sorted by their iteration number, then by their hash
-      std::sort(new_features.begin(), new_features.end(),
-                [](const FeatureDescriptor & fd1, const FeatureDescriptor & fd2) {
-                   return fd1.hash < fd2.hash;
+      std::sort(new_features.ptr(), new_features.ptr() + new_features.size(),
+                [&](int idx1, int idx2) {
+                   return atom_hashes[idx1] < atom_hashes[idx2];
                 });
 
       // Update features
-      for(auto& feature : new_features) {
-         if(std::find(features.begin(), features.end(), feature) == features.end()) {
-            features.push_back(feature);  // add unique
+      for (int k = 0; k < new_features.size(); k++)
+         addFeature(new_features[k]);
+   }
+}
+
+void MoleculeMorganFingerprintBuilder::addNewFeature(int idx) {
+   const qword *bonds = atomBonds(atom_bonds, idx);
+   int size = new_features_table.size();
+   int slot = bondsSlot(bonds, size);
+
+   while (new_features_table[slot] != 0) {
+      int duplicate = new_features_table[slot] - 1;
+
+      if (sameBonds(atomBonds(atom_bonds, duplicate), bonds)) {
+         if (atom_hashes[idx] < atom_hashes[duplicate]) { // the leaser hash is preferred
+            new_features.remove(new_features.find(duplicate));
+            new_features.push(idx);
+            new_features_table[slot] = idx + 1;
          }
+         return;
       }
+      slot = (slot + 1) & (size - 1);
+   }
+
+   new_features.push(idx);
+   new_features_table[slot] = idx + 1;
+}
+
+void MoleculeMorganFingerprintBuilder::addFeature(int idx) {
+   const qword *bonds = atomBonds(atom_bonds, idx);
+   int size = features_table.size();
+   int slot = bondsSlot(bonds, size);
+
+   while (features_table[slot] != 0) {
+      if (sameBonds(featureBonds(features_table[slot] - 1), bonds))
+         return;
+      slot = (slot + 1) & (size - 1);
    }
+
+   features_table[slot] = feature_hashes.size() + 1;
+   feature_hashes.push(atom_hashes[idx]);
+
+   int offset = feature_bonds.size();
+   feature_bonds.resize(offset + bond_words);
+   memcpy(feature_bonds.ptr() + offset, bonds, bond_words * sizeof(qword));
 }
 
 void MoleculeMorganFingerprintBuilder::calculateNewAtomDescriptors(int iterationNumber) {
-   for (auto &atom : atom_descriptors) {
-      std::sort(atom.bond_descriptors.begin(), atom.bond_descriptors.end(),
+   for (int k = 0; k < atoms.size(); k++) {
+      int idx = atoms[k];
+      BondDescriptor *begin = bond_descriptors.ptr() + bond_offsets[idx];
+      BondDescriptor *end = bond_descriptors.ptr() + bond_offsets[idx + 1];
+
+      std::sort(begin, end,
                 [&](const BondDescriptor &bd1, const BondDescriptor &bd2) {
                    return bondDescriptorCmp(bd1, bd2) < 0;
                 });
 
-      atom.new_descr.hash = (dword) iterationNumber * MAGIC_HASH_NUMBER + atom.descr.hash;
-      atom.new_descr.bond_set.clear();
+      dword hash = (dword) iterationNumber * MAGIC_HASH_NUMBER + atom_hashes[idx];
+      qword *new_bonds = atomBonds(new_atom_bonds, idx);
+
+      memset(new_bonds, 0, bond_words * sizeof(qword));
 
-      for (auto &bond : atom.bond_descriptors) {
-         FeatureDescriptor &descr = atom_descriptors[bond.vertex_idx].descr;
+      for (BondDescriptor *bond = begin; bond != end; bond++) {
+         const qword *bonds = atomBonds(atom_bonds, bond->vertex_idx);
 
-         atom.new_descr.hash = MAGIC_HASH_NUMBER * atom.new_descr.hash + bond.bond_type;
-         atom.new_descr.hash = MAGIC_HASH_NUMBER * atom.new_descr.hash + descr.hash;
+         hash = MAGIC_HASH_NUMBER * hash + bond->bond_type;
+         hash = MAGIC_HASH_NUMBER * hash + atom_hashes[bond->vertex_idx];
 
-         atom.new_descr.bond_set.insert(bond.edge_idx);
-         atom.new_descr.bond_set.insert(descr.bond_set.begin(), descr.bond_set.end());
+         new_bonds[bond->edge_idx / 64] |= (qword)1 << (bond->edge_idx % 64);
+         for (int w = 0; w < bond_words; w++)
+            new_bonds[w] |= bonds[w];
       }
+
+      new_atom_hashes[idx] = hash;
    }
 }
 
@@ -210,17 +338,18 @@ int MoleculeMorganFingerprintBuilder::bondDescriptorCmp(const BondDescriptor &bd
    if(bd1.bond_type != bd2.bond_type)
       return bd1.bond_type - bd2.bond_type;
 
-   AtomDescriptor &ad1 = atom_descriptors[bd1.vertex_idx];
-   AtomDescriptor &ad2 = atom_descriptors[bd2.vertex_idx];
-
-   return ad1.descr.hash - ad2.descr.hash;
+   return atom_hashes[bd1.vertex_idx] - atom_hashes[bd2.vertex_idx];
 }
 
-bool MoleculeMorganFingerprintBuilder::FeatureDescriptor::operator==(const FeatureDescriptor &rhs) const {
-   return bond_set == rhs.bond_set;
+bool MoleculeMorganFingerprintBuilder::sameBonds(const qword *bonds1, const qword *bonds2) const {
+   return memcmp(bonds1, bonds2, bond_words * sizeof(qword)) == 0;
 }
 
-bool MoleculeMorganFingerprintBuilder::FeatureDescriptor::operator<(
-      const MoleculeMorganFingerprintBuilder::FeatureDescriptor &rhs) const {
-   return bond_set < rhs.bond_set;
+int MoleculeMorganFingerprintBuilder::bondsSlot(const qword *bonds, int table_size) const {
+   qword hash = 0;
+
+   for (int w = 0; w < bond_words; w++)
+      hash = (hash ^ bonds[w]) * 0x9E3779B97F4A7C15ULL;
+
+   return (int)((hash >> 32) & (table_size - 1));
 }
@@ -0,0 +1,355 @@
+/****************************************************************************
+ * Copyright (C) 2009-2015 EPAM Systems
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * This file may be distributed and/or modified under the terms of the
+ * GNU General Public License version 3 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.
+ *
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ ***************************************************************************/
+
+#include "molecule/molecule_query_program.h"
+
+#include "molecule/molecule_substructure_matcher.h"
+
+using namespace indigo;
+
+CP_DEF(MoleculeQueryProgram);
+
+MoleculeQueryProgram::MoleculeQueryProgram () :
+CP_INIT,
+TL_CP_GET(_code),
+TL_CP_GET(_atom_start),
+TL_CP_GET(_bond_start),
+TL_CP_GET(_min_h),
+TL_CP_GET(_elements)
+{
+   _query = 0;
+}
+
+void MoleculeQueryProgram::clear ()
+{
+   _query = 0;
+   _code.clear();
+   _atom_start.clear();
+   _bond_start.clear();
+   _min_h.clear();
+   _elements.clear();
+}
+
+void MoleculeQueryProgram::compile (QueryMolecule &query)
+{
+   clear();
+
+   _atom_start.clear_resize(query.vertexEnd());
+   _atom_start.fill(-1);
+   _min_h.clear_resize(query.vertexEnd());
+   _elements.clear_resize(query.vertexEnd());
+
+   _bond_start.clear_resize(query.edgeEnd());
+   _bond_start.fill(-1);
+
+   _query = &query;
+}
+
+void MoleculeQueryProgram::_compileAtom (int idx)
+{
+   _atom_start[idx] = _code.size();
+   _compile(&_query->getAtom(idx), false, false, 0);
+   _possibleElements(_code.ptr() + _atom_start[idx], _elements[idx]);
+
+   try
+   {
+      _min_h[idx] = _query->getAtomMinH(idx);
+   }
+   catch (Exception &)
+   {
+      _min_h[idx] = 0;
+   }
+}
+
+void MoleculeQueryProgram::_compileBond (int idx)
+{
+   _bond_start[idx] = _code.size();
+   _compile(&_query->getBond(idx), true, false, 0);
+}
+
+MoleculeQueryProgram::Instruction & MoleculeQueryProgram::_push (int op, bool negative, dword flags_xor)
+{
+   Instruction &ins = _code.push();
+
+   ins.op = op;
+   ins.size = 1;
+   ins.type = 0;
+   ins.value_min = 0;
+   ins.value_max = 0;
+   ins.negative = negative;
+   ins.flags_xor = flags_xor;
+   ins.elements[0] = ins.elements[1] = 0;
+   ins.node = 0;
+   return ins;
+}
+
+void MoleculeQueryProgram::_compile (QueryMolecule::Node *node, bool is_bond, bool negative, dword flags_xor)
+{
+   // matchQueryAtom() inverts the result and the MATCH_DISABLED_AS_TRUE
+   // flag for every NOT, so the leaf keeps both
+   while (node->type == QueryMolecule::OP_NOT)
+   {
+      node = node->children[0];
+      negative = !negative;
+      flags_xor ^= MoleculeSubstructureMatcher::MATCH_DISABLED_AS_TRUE;
+   }
+
+   if (node->type == QueryMolecule::OP_NONE)
+   {
+      // Empty conjunction is true, empty disjunction is false
+      _push(negative ? _OR : _AND, false, 0);
+      return;
+   }
+
+   if (node->type == QueryMolecule::OP_AND || node->type == QueryMolecule::OP_OR)
+   {
+      // De Morgan's laws
+      int op = ((node->type == QueryMolecule::OP_AND) != negative) ? _AND : _OR;
+      int pos = _code.size();
+      int elements_pos = -1;
+
+      _push(op, false, 0);
+      _compileGroup(node, op, is_bond, negative, flags_xor, elements_pos);
+      _code[pos].size = _code.size() - pos;
+
+      // The group of one subtree is the subtree itself
+      if (_code.size() > pos + 1 && _code[pos + 1].size == _code.size() - pos - 1)
+         _code.remove(pos);
+      return;
+   }
+
+   if (is_bond)
+   {
+      QueryMolecule::Bond *bond = (QueryMolecule::Bond *)node;
+      Instruction &ins = _push(_BOND_VALUE, negative, flags_xor);
+
+      ins.type = bond->type;
+      ins.value_min = ins.value_max = bond->value;
+      return;
+   }
+
+   QueryMolecule::Atom *atom = (QueryMolecule::Atom *)node;
+
+   if (atom->type == QueryMolecule::ATOM_PSEUDO || atom->type == QueryMolecule::ATOM_TEMPLATE ||
+       atom->type == QueryMolecule::ATOM_FRAGMENT)
+   {
+      Instruction &ins = _push(_ATOM_TREE, negative, flags_xor);
+
+      ins.node = atom;
+      return;
+   }
+
+   Instruction &ins = _push(_ATOM_VALUE, negative, flags_xor);
+
+   ins.type = atom->type;
+   ins.value_min = atom->value_min;
+   ins.value_max = atom->value_max;
+}
+
+void MoleculeQueryProgram::_compileGroup (QueryMolecule::Node *node, int op, bool is_bond, bool negative,
+                                          dword flags_xor, int &elements_pos)
+{
+   int i;
+
+   for (i = 0; i < node->children.size(); i++)
+   {
+      QueryMolecule::Node *child = node->children[i];
+      bool child_negative = negative;
+      dword child_flags_xor = flags_xor;
+
+      while (child->type == QueryMolecule::OP_NOT)
+      {
+         child = child->children[0];
+         child_negative = !child_negative;
+         child_flags_xor ^= MoleculeSubstructureMatcher::MATCH_DISABLED_AS_TRUE;
+      }
+
+      // Nested group of the same kind
+      if (child->type == QueryMolecule::OP_AND || child->type == QueryMolecule::OP_OR)
+      {
+         int child_op = ((child->type == QueryMolecule::OP_AND) != child_negative) ? _AND : _OR;
+
+         if (child_op == op)
+         {
+            _compileGroup(child, op, is_bond, child_negative, child_flags_xor, elements_pos);
+            continue;
+         }
+      }
+
+      // Element alternatives: [C,N,O] is a disjunction of the numbers and
+      // [!C;!N] is a conjunction of their negations
+      if (!is_bond && child->type == QueryMolecule::ATOM_NUMBER && child_negative == (op == _AND))
+      {
+         QueryMolecule::Atom *atom = (QueryMolecule::Atom *)child;
+
+         if (atom->value_min >= 0 && atom->value_max < 128)
+         {
+            if (elements_pos < 0)
+            {
+               elements_pos = _code.size();
+               _push(_ATOM_ELEMENTS, child_negative, 0);
+            }
+
+            Instruction &ins = _code[elements_pos];
+
+            for (int number = atom->value_min; number <= atom->value_max; number++)
+               ins.elements[number >> 6] |= (qword)1 << (number & 63);
+            continue;
+         }
+      }
+
+      _compile(child, is_bond, child_negative, child_flags_xor);
+   }
+}
+
+void MoleculeQueryProgram::_possibleElements (const Instruction *ins, ElementSet &set)
+{
+   int i;
+
+   switch (ins->op)
+   {
+      case _AND:
+      case _OR:
+      {
+         const Instruction *end = ins + ins->size;
+         bool is_and = (ins->op == _AND);
+
+         // Empty conjunction allows everything, empty disjunction nothing
+         set.bits[0] = set.bits[1] = is_and ? ~(qword)0 : 0;
+         set.others = is_and;
+
+         for (const Instruction *child = ins + 1; child < end; child += child->size)
+         {
+            ElementSet child_set;
+
+            _possibleElements(child, child_set);
+            for (i = 0; i < 2; i++)
+               set.bits[i] = is_and ? (set.bits[i] & child_set.bits[i]) : (set.bits[i] | child_set.bits[i]);
+            set.others = is_and ? (set.others && child_set.others) : (set.others || child_set.others);
+         }
+         return;
+      }
+      case _ATOM_ELEMENTS:
+         for (i = 0; i < 2; i++)
+            set.bits[i] = ins->negative ? ~ins->elements[i] : ins->elements[i];
+         set.others = ins->negative;
+         return;
+      case _ATOM_VALUE:
+         if (ins->type == QueryMolecule::ATOM_NUMBER && !ins->negative)
+         {
+            set.bits[0] = set.bits[1] = 0;
+            set.others = (ins->value_min < 0 || ins->value_max >= 128);
+            for (i = __max(ins->value_min, 0); i <= __min(ins->value_max, 127); i++)
+               set.bits[i >> 6] |= (qword)1 << (i & 63);
+            return;
+         }
+         break;
+   }
+
+   set.bits[0] = set.bits[1] = ~(qword)0;
+   set.others = true;
+}
+
+bool MoleculeQueryProgram::possibleAtomNumber (int sub_idx, int number)
+{
+   if (_atom_start[sub_idx] < 0)
+      _compileAtom(sub_idx);
+
+   const ElementSet &set = _elements[sub_idx];
+
+   if (number < 0 || number >= 128)
+      return set.others;
+   return ((set.bits[number >> 6] >> (number & 63)) & 1) != 0;
+}
+
+int MoleculeQueryProgram::atomMinH (int sub_idx)
+{
+   if (_atom_start[sub_idx] < 0)
+      _compileAtom(sub_idx);
+
+   return _min_h[sub_idx];
+}
+
+bool MoleculeQueryProgram::_run (const Instruction *ins, const Context &context)
+{
+   switch (ins->op)
+   {
+      case _AND:
+      case _OR:
+      {
+         // The value that stops the evaluation
+         bool stop = (ins->op == _OR);
+         const Instruction *end = ins + ins->size;
+
+         for (const Instruction *child = ins + 1; child < end; child += child->size)
+            if (_run(child, context) == stop)
+               return stop;
+         return !stop;
+      }
+      case _ATOM_ELEMENTS:
+      {
+         int number = context.target->getAtomNumber(context.super_idx);
+         bool found = number >= 0 && number < 128 &&
+                      ((ins->elements[number >> 6] >> (number & 63)) & 1) != 0;
+
+         return found != ins->negative;
+      }
+      case _ATOM_VALUE:
+         // The target values are read through the accessors of the molecule,
+         // which cache the derived ones (valence, ring bonds, SSSR rings).
+         // A packed copy of them per target was tried and was not faster.
+         return MoleculeSubstructureMatcher::matchAtomConstraint(ins->type, ins->value_min, ins->value_max,
+                   *context.target, context.super_idx, context.flags ^ ins->flags_xor) != ins->negative;
+      case _ATOM_TREE:
+         return MoleculeSubstructureMatcher::matchQueryAtom((QueryMolecule::Atom *)ins->node,
+                   *context.target, context.super_idx, context.fmcache, context.flags ^ ins->flags_xor) != ins->negative;
+      default:
+         return MoleculeSubstructureMatcher::matchBondConstraint(ins->type, ins->value_min, *context.target,
+                   context.sub_idx, context.super_idx, context.am, context.flags ^ ins->flags_xor) != ins->negative;
+   }
+}
+
+bool MoleculeQueryProgram::matchAtom (int sub_idx, BaseMolecule &target, int super_idx,
+                                      FragmentMatchCache *fmcache, dword flags)
+{
+   Context context;
+
+   context.target = &target;
+   context.sub_idx = sub_idx;
+   context.super_idx = super_idx;
+   context.fmcache = fmcache;
+   context.am = 0;
+   context.flags = flags;
+
+   if (_atom_start[sub_idx] < 0)
+      _compileAtom(sub_idx);
+   return _run(_code.ptr() + _atom_start[sub_idx], context);
+}
+
+bool MoleculeQueryProgram::matchBond (int sub_idx, BaseMolecule &target, int super_idx,
+                                      AromaticityMatcher *am, dword flags)
+{
+   Context context;
+
+   context.target = &target;
+   context.sub_idx = sub_idx;
+   context.super_idx = super_idx;
+   context.fmcache = 0;
+   context.am = am;
+   context.flags = flags;
+
+   if (_bond_start[sub_idx] < 0)
+      _compileBond(sub_idx);
+   return _run(_code.ptr() + _bond_start[sub_idx], context);
+}
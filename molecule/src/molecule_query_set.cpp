@@ -0,0 +1,221 @@
+/****************************************************************************
+ * Copyright (C) 2009-2015 EPAM Systems
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * This file may be distributed and/or modified under the terms of the
+ * GNU General Public License version 3 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.
+ *
+ * This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+ * WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+ ***************************************************************************/
+
+#include "molecule/molecule_query_set.h"
+
+#include "base_c/bitarray.h"
+#include "molecule/elements.h"
+
+using namespace indigo;
+
+IMPL_ERROR(MoleculeQuerySet, "query set");
+
+MoleculeQuerySet::MoleculeQuerySet (const MoleculeFingerprintParameters &fp_params) :
+_fp_params(fp_params)
+{
+   use_fingerprints = false;
+   _fingerprints_needed = false;
+   _heavy_atoms = 0;
+   _screened_out = 0;
+   _target.prepared = false;
+   _target_h_unfolded.prepared = false;
+}
+
+MoleculeQuerySet::~MoleculeQuerySet ()
+{
+}
+
+int MoleculeQuerySet::size () const
+{
+   return _queries.size();
+}
+
+void MoleculeQuerySet::clear ()
+{
+   _queries.clear();
+   _fingerprints_needed = false;
+}
+
+int MoleculeQuerySet::add (QueryMolecule &query)
+{
+   _Query &item = _queries.push();
+   int i;
+
+   // The same atom order as Bingo uses for the SMARTS queries: the atoms
+   // that are the hardest to match go first
+   QS_DEF(Array<int>, transposition);
+
+   MoleculeSubstructureMatcher::makeTransposition(query, transposition);
+   item.query.makeSubmolecule(query, transposition, 0);
+   item.query.optimize();
+   item.nei_counters.calculate(item.query);
+
+   item.h_unfold = MoleculeSubstructureMatcher::shouldUnfoldTargetHydrogens(item.query, false);
+
+   item.heavy_atoms = 0;
+   item.elements.clear();
+
+   QS_DEF(Array<int>, counts);
+
+   counts.clear_resize(ELEM_MAX);
+   counts.zerofill();
+
+   for (i = item.query.vertexBegin(); i != item.query.vertexEnd(); i = item.query.vertexNext(i))
+   {
+      if (item.query.isRSite(i) || item.query.possibleAtomNumber(i, ELEM_H))
+         continue;
+
+      item.heavy_atoms++;
+
+      int number = item.query.getAtomNumber(i);
+
+      if (number > ELEM_H && number < ELEM_MAX)
+         counts[number]++;
+   }
+
+   for (i = 0; i < ELEM_MAX; i++)
+      if (counts[i] > 0)
+      {
+         item.elements.push(i);
+         item.elements.push(counts[i]);
+      }
+
+   MoleculeFingerprintBuilder builder(item.query, _fp_params);
+
+   builder.query = true;
+   builder.skip_sim = true;
+   builder.skip_tau = true;
+   builder.process();
+
+   int fp_size = _fp_params.fingerprintSize();
+
+   item.fingerprint.clear();
+   if (!bitIsAllZero(builder.get(), fp_size))
+   {
+      item.fingerprint.copy(builder.get(), fp_size);
+      _fingerprints_needed = true;
+   }
+
+   return _queries.size() - 1;
+}
+
+void MoleculeQuerySet::_prepare (Molecule &source, _Target &prepared, bool aromatize)
+{
+   prepared.mol.clone(source, 0, 0);
+
+   if (aromatize)
+      prepared.mol.aromatize(arom_options);
+
+   prepared.nei_counters.calculate(prepared.mol);
+   prepared.fmcache.clear();
+   prepared.frozen.clear();
+   prepared.prepared = true;
+}
+
+bool MoleculeQuerySet::_screen (const _Query &query)
+{
+   if (query.heavy_atoms > _heavy_atoms)
+      return false;
+
+   for (int i = 0; i < query.elements.size(); i += 2)
+      if (query.elements[i + 1] > _element_counts[query.elements[i]])
+         return false;
+
+   if (use_fingerprints && query.fingerprint.size() > 0)
+      if (!bitTestOnes(query.fingerprint.ptr(), _fingerprint.ptr(), query.fingerprint.size()))
+         return false;
+
+   return true;
+}
+
+void MoleculeQuerySet::match (Molecule &target, Array<int> &ids)
+{
+   int i;
+
+   ids.clear();
+   _screened_out = 0;
+   _target_h_unfolded.prepared = false;
+
+   _prepare(target, _target, !target.isAromatized());
+
+   Molecule &mol = _target.mol;
+
+   _element_counts.clear_resize(ELEM_MAX);
+   _element_counts.zerofill();
+   _heavy_atoms = 0;
+
+   for (i = mol.vertexBegin(); i != mol.vertexEnd(); i = mol.vertexNext(i))
+   {
+      int number = mol.getAtomNumber(i);
+
+      if (number == ELEM_H)
+         continue;
+
+      _heavy_atoms++;
+      if (number > 0 && number < ELEM_MAX)
+         _element_counts[number]++;
+   }
+
+   if (use_fingerprints && _fingerprints_needed)
+   {
+      MoleculeFingerprintBuilder builder(mol, _fp_params);
+
+      builder.skip_sim = true;
+      builder.skip_tau = true;
+      builder.process();
+      _fingerprint.copy(builder.get(), _fp_params.fingerprintSize());
+   }
+
+   for (i = 0; i < _queries.size(); i++)
+   {
+      _Query &item = _queries[i];
+
+      if (!_screen(item))
+      {
+         _screened_out++;
+         continue;
+      }
+
+      _Target *prepared = &_target;
+
+      if (item.h_unfold)
+      {
+         // The hydrogens are unfolded by the first query that needs them
+         // and are kept for the next ones
+         if (!_target_h_unfolded.prepared)
+            _prepare(target, _target_h_unfolded, !target.isAromatized());
+         prepared = &_target_h_unfolded;
+      }
+
+      // The first query that unfolds the hydrogens makes the snapshot stale,
+      // the matcher does not use it then and it is made again for the next ones
+      if (!prepared->frozen.isSnapshotOf(prepared->mol))
+      {
+         prepared->frozen.build(prepared->mol);
+         prepared->frozen.buildEdgeTable();
+      }
+
+      MoleculeSubstructureMatcher matcher(prepared->mol);
+
+      matcher.arom_options = arom_options;
+      matcher.fmcache = &prepared->fmcache;
+      matcher.frozen_target = &prepared->frozen;
+      matcher.setQuery(item.query);
+      matcher.setNeiCounters(&item.nei_counters, &prepared->nei_counters);
+      matcher.restore_unfolded_h = false;
+
+      if (matcher.find())
+         ids.push(i);
+   }
+}
@@ -87,6 +87,7 @@ TL_CP_GET(_used_target_h)
    cb_embedding_context = 0;
 
    fmcache = 0;
+   frozen_target = 0;
 
    disable_unfolding_implicit_h = false;
    restore_unfolded_h = true;
@@ -314,6 +315,8 @@ bool MoleculeSubstructureMatcher::find ()
      _ee->validate();
    }
 
+   _ee->setFrozenSupergraph(frozen_target);
+
    if (_canUseEquivalenceHeuristic(*_query))
       _ee->setEquivalenceHandler(vertex_equivalence_handler);
    else
@@ -334,6 +337,13 @@ bool MoleculeSubstructureMatcher::find ()
    _3d_constraints_checker.recreate(_query->spatial_constraints);
    _createEmbeddingsStorage();
 
+   // The query of the Markush structure is changed during the matching as
+   // the R-groups are attached, so its atoms are checked by the trees
+   if (_markush.get() == 0)
+      _program.compile(*_query);
+   else
+      _program.clear();
+
    int result = _ee->process();
 
    if (_h_unfold && restore_unfolded_h)
@@ -409,22 +419,86 @@ bool MoleculeSubstructureMatcher::matchQueryAtom
          return !matchQueryAtom(query->child(0), target, super_idx, fmcache,
                                 flags ^ MATCH_DISABLED_AS_TRUE);
 
-      case QueryMolecule::ATOM_NUMBER:
-         return query->valueWithinRange(target.getAtomNumber(super_idx));
       case QueryMolecule::ATOM_PSEUDO:
          return target.isPseudoAtom(super_idx) &&
                  strcmp(query->alias.ptr(), target.getPseudoAtom(super_idx)) == 0;
       case QueryMolecule::ATOM_TEMPLATE:
          return target.isTemplateAtom(super_idx) &&
                  strcmp(query->alias.ptr(), target.getTemplateAtom(super_idx)) == 0;
+      case QueryMolecule::ATOM_FRAGMENT:
+      {
+         if (fmcache == 0)
+            throw Error("unexpected 'fragment' constraint");
+
+         QueryMolecule *fragment = query->fragment.get();
+         const char *smarts = fragment->fragment_smarts.ptr();
+
+         if (fragment->vertexCount() == 0)
+            throw Error("empty fragment");
+
+         if (smarts != 0 && strlen(smarts) > 0)
+         {
+            fmcache->expand(super_idx + 1);
+            int *value = fmcache->at(super_idx).at2(smarts);
+
+            if (value != 0)
+               return *value != 0;
+         }
+
+         // The first fragment atom is fixed on the target atom, and the
+         // matcher setup takes the time proportional to the target size.
+         // The fix fails anyway if the atom itself doesn't match.
+         int first = fragment->vertexBegin();
+         bool result = matchQueryAtom(&fragment->getAtom(first), target, super_idx, fmcache, 0xFFFFFFFF);
+
+         if (result)
+         {
+            MoleculeSubstructureMatcher matcher(target.asMolecule());
+
+            matcher.not_ignore_first_atom = true;
+            matcher.setQuery(*fragment);
+            matcher.fmcache = fmcache;
+
+            result = matcher.fix(first, super_idx);
+
+            if (result)
+               result = matcher.find();
+         }
+
+         if (smarts != 0 && strlen(smarts) > 0)
+         {
+            fmcache->expand(super_idx + 1);
+            fmcache->at(super_idx).insert(smarts, result ? 1 : 0);
+         }
+
+         return result;
+      }
+      default:
+         return matchAtomConstraint(query->type, query->value_min, query->value_max,
+                                    target, super_idx, flags);
+   }
+}
+
+static bool _withinRange (int value_min, int value_max, int value)
+{
+   return value >= value_min && value <= value_max;
+}
+
+bool MoleculeSubstructureMatcher::matchAtomConstraint (int type, int value_min, int value_max,
+         BaseMolecule &target, int super_idx, dword flags)
+{
+   switch (type)
+   {
+      case QueryMolecule::ATOM_NUMBER:
+         return _withinRange(value_min, value_max, target.getAtomNumber(super_idx));
       case QueryMolecule::ATOM_RSITE:
          return true;
       case QueryMolecule::ATOM_ISOTOPE:
-         return query->valueWithinRange(target.getAtomIsotope(super_idx));
+         return _withinRange(value_min, value_max, target.getAtomIsotope(super_idx));
       case QueryMolecule::ATOM_CHARGE:
       {
          if (flags & MATCH_ATOM_CHARGE)
-            return query->valueWithinRange(target.getAtomCharge(super_idx));
+            return _withinRange(value_min, value_max, target.getAtomCharge(super_idx));
          return (flags & MATCH_DISABLED_AS_TRUE) != 0;
       }
       case QueryMolecule::ATOM_RADICAL:
@@ -434,7 +508,7 @@ bool MoleculeSubstructureMatcher::matchQueryAtom
          int radical = target.getAtomRadical_NoThrow(super_idx, -1);
          if (radical == -1)
             return false;
-         return query->valueWithinRange(radical);
+         return _withinRange(value_min, value_max, radical);
       }
       case QueryMolecule::ATOM_VALENCE:
       {
@@ -445,7 +519,7 @@ bool MoleculeSubstructureMatcher::matchQueryAtom
             int valence = target.getAtomValence_NoThrow(super_idx, -1);
             if (valence == -1)
                return false;
-            return query->valueWithinRange(valence);
+            return _withinRange(value_min, value_max, valence);
          }
          return (flags & MATCH_DISABLED_AS_TRUE) != 0;
       }
@@ -454,7 +528,7 @@ bool MoleculeSubstructureMatcher::matchQueryAtom
          int conn = target.getVertex(super_idx).degree();
          if (!target.isPseudoAtom(super_idx) && !target.isRSite(super_idx))
             conn += target.asMolecule().getImplicitH_NoThrow(super_idx, 0);
-         return query->valueWithinRange(conn);
+         return _withinRange(value_min, value_max, conn);
       }
       case QueryMolecule::ATOM_TOTAL_BOND_ORDER:
       {
@@ -462,72 +536,32 @@ bool MoleculeSubstructureMatcher::matchQueryAtom
          int conn = target.asMolecule().getAtomConnectivity_NoThrow(super_idx, -1);
          if (conn == -1)
             return false;
-         return query->valueWithinRange(conn);
+         return _withinRange(value_min, value_max, conn);
       }
       case QueryMolecule::ATOM_TOTAL_H:
       {
          if (target.isPseudoAtom(super_idx) || target.isRSite(super_idx) || target.isTemplateAtom(super_idx))
             return false;
-         return query->valueWithinRange(target.getAtomTotalH(super_idx));
+         return _withinRange(value_min, value_max, target.getAtomTotalH(super_idx));
       }
       case QueryMolecule::ATOM_SUBSTITUENTS:
       case QueryMolecule::ATOM_SUBSTITUENTS_AS_DRAWN:
-         return query->valueWithinRange(target.getAtomSubstCount(super_idx));
+         return _withinRange(value_min, value_max, target.getAtomSubstCount(super_idx));
       case QueryMolecule::ATOM_SSSR_RINGS:
-         return query->valueWithinRange(target.vertexCountSSSR(super_idx));
+         return _withinRange(value_min, value_max, target.vertexCountSSSR(super_idx));
       case QueryMolecule::ATOM_SMALLEST_RING_SIZE:
-         return query->valueWithinRange(target.vertexSmallestRingSize(super_idx));
+         return _withinRange(value_min, value_max, target.vertexSmallestRingSize(super_idx));
       case QueryMolecule::ATOM_RING_BONDS:
       case QueryMolecule::ATOM_RING_BONDS_AS_DRAWN:
-         return query->valueWithinRange(target.getAtomRingBondsCount(super_idx));
+         return _withinRange(value_min, value_max, target.getAtomRingBondsCount(super_idx));
       case QueryMolecule::ATOM_UNSATURATION:
          return !target.isSaturatedAtom(super_idx);
-      case QueryMolecule::ATOM_FRAGMENT:
-      {
-         if (fmcache == 0)
-            throw Error("unexpected 'fragment' constraint");
-
-         QueryMolecule *fragment = query->fragment.get();
-         const char *smarts = fragment->fragment_smarts.ptr();
-
-         if (fragment->vertexCount() == 0)
-            throw Error("empty fragment");
-
-         if (smarts != 0 && strlen(smarts) > 0)
-         {
-            fmcache->expand(super_idx + 1);
-            int *value = fmcache->at(super_idx).at2(smarts);
-
-            if (value != 0)
-               return *value != 0;
-         }
-
-         
-         MoleculeSubstructureMatcher matcher(target.asMolecule());
-
-         matcher.not_ignore_first_atom = true;
-         matcher.setQuery(*fragment);
-         matcher.fmcache = fmcache;
-
-         bool result = matcher.fix(fragment->vertexBegin(), super_idx);
-
-         if (result)
-            result = matcher.find();
-
-         if (smarts != 0 && strlen(smarts) > 0)
-         {
-            fmcache->expand(super_idx + 1);
-            fmcache->at(super_idx).insert(smarts, result ? 1 : 0);
-         }
-
-         return result;
-      }
       case QueryMolecule::ATOM_AROMATICITY:
-         return query->valueWithinRange(target.getAtomAromaticity(super_idx));
+         return _withinRange(value_min, value_max, target.getAtomAromaticity(super_idx));
       case QueryMolecule::HIGHLIGHTING:
-         return query->valueWithinRange((int)target.isAtomHighlighted(super_idx));
+         return _withinRange(value_min, value_max, (int)target.isAtomHighlighted(super_idx));
       default:
-         throw Error("bad query atom type: %d", query->type);
+         throw Error("bad query atom type: %d", type);
    }
 }
 
@@ -558,6 +592,16 @@ bool MoleculeSubstructureMatcher::matchQueryBond (QueryMolecule::Bond *query,
          return !matchQueryBond(query->child(0), target, sub_idx, super_idx, am, 
             flags ^ MATCH_DISABLED_AS_TRUE);
 
+      default:
+         return matchBondConstraint(query->type, query->value, target, sub_idx, super_idx, am, flags);
+   }
+}
+
+bool MoleculeSubstructureMatcher::matchBondConstraint (int type, int value,
+             BaseMolecule &target, int sub_idx, int super_idx, AromaticityMatcher *am, dword flags)
+{
+   switch (type)
+   {
       case QueryMolecule::BOND_ORDER:
       {
          if (flags & MATCH_BOND_TYPE)
@@ -572,16 +616,16 @@ bool MoleculeSubstructureMatcher::matchQueryBond (QueryMolecule::Bond *query,
                      return false;
                }
             }
-            return target.possibleBondOrder(super_idx, query->value);
+            return target.possibleBondOrder(super_idx, value);
          }
          return (flags & MATCH_DISABLED_AS_TRUE) != 0;
       }
       case QueryMolecule::BOND_TOPOLOGY:
-         return target.getEdgeTopology(super_idx) == query->value;
+         return target.getEdgeTopology(super_idx) == value;
       case QueryMolecule::HIGHLIGHTING:
-         return query->value == (int)target.isAtomHighlighted(super_idx);
+         return value == (int)target.isAtomHighlighted(super_idx);
       default:
-         throw Error("bad query bond type: %d", query->type);
+         throw Error("bad query bond type: %d", type);
    }
 }
 
@@ -598,6 +642,17 @@ bool MoleculeSubstructureMatcher::_matchAtoms(Graph &subgraph, Graph &supergraph
             return false;
    }
 
+   QueryMolecule &query = (QueryMolecule &)subgraph;
+   BaseMolecule &target  = (BaseMolecule &)supergraph;
+   MoleculeQueryProgram *program = 0;
+
+   if (self->_program.isCompiledFor(query))
+   {
+      program = &self->_program;
+      if (!program->possibleAtomNumber(sub_idx, target.getAtomNumber(super_idx)))
+         return false;
+   }
+
    dword match_atoms_flags = 0xFFFFFFFF;
    // If target atom belongs to a pi-system then its charge
    // should be checked after embedding
@@ -607,32 +662,36 @@ bool MoleculeSubstructureMatcher::_matchAtoms(Graph &subgraph, Graph &supergraph
          match_atoms_flags &= ~(MATCH_ATOM_CHARGE | MATCH_ATOM_VALENCE);
    }
 
-   QueryMolecule &query = (QueryMolecule &)subgraph;
-   BaseMolecule &target  = (BaseMolecule &)supergraph;
-
    if (!target.isPseudoAtom(super_idx) && !target.isRSite(super_idx) && !target.isTemplateAtom(super_idx))
    {
       int q_min_h;
       int t_max_h;
-      try
-      {
-         q_min_h = query.getAtomMinH(sub_idx);
-      }
-      catch (Exception e)
-      {
-         q_min_h = 0;
-      }
-      try
+      if (program != 0)
+         q_min_h = program->atomMinH(sub_idx);
+      else
       {
-         t_max_h = target.getAtomMaxH(super_idx);
+         try
+         {
+            q_min_h = query.getAtomMinH(sub_idx);
+         }
+         catch (Exception e)
+         {
+            q_min_h = 0;
+         }
       }
-      catch (Exception e)
+      if (q_min_h > 0)
       {
-         t_max_h = 0;
-      }
-      if (q_min_h > 0 && t_max_h >= 0)
-         if (q_min_h > t_max_h)
+         try
+         {
+            t_max_h = target.getAtomMaxH(super_idx);
+         }
+         catch (Exception e)
+         {
+            t_max_h = 0;
+         }
+         if (t_max_h >= 0 && q_min_h > t_max_h)
             return false;
+      }
    }
 
    if (query.components.size() > sub_idx && query.components[sub_idx] > 0)
@@ -659,10 +718,18 @@ bool MoleculeSubstructureMatcher::_matchAtoms(Graph &subgraph, Graph &supergraph
       }
    }
 
-   QueryMolecule::Atom &sub_atom = query.getAtom(sub_idx);
+   if (program != 0)
+   {
+      if (!program->matchAtom(sub_idx, target, super_idx, self->fmcache, match_atoms_flags))
+         return false;
+   }
+   else
+   {
+      QueryMolecule::Atom &sub_atom = query.getAtom(sub_idx);
 
-   if (!matchQueryAtom(&sub_atom, target, super_idx, self->fmcache, match_atoms_flags))
-      return false;
+      if (!matchQueryAtom(&sub_atom, target, super_idx, self->fmcache, match_atoms_flags))
+         return false;
+   }
 
    if (query.stereocenters.getType(sub_idx) > target.stereocenters.getType(super_idx))
       return false;
@@ -719,6 +786,10 @@ bool MoleculeSubstructureMatcher::_matchBonds (Graph &subgraph, Graph &supergrap
 
    QueryMolecule &query = (QueryMolecule &)subgraph;
    BaseMolecule &target  = (BaseMolecule &)supergraph;
+
+   if (self->_program.isCompiledFor(query))
+      return self->_program.matchBond(sub_idx, target, super_idx, self->_am.get(), flags);
+
    QueryMolecule::Bond &sub_bond = query.getBond(sub_idx);
 
    if (!matchQueryBond(&sub_bond, target, sub_idx, super_idx, self->_am.get(), flags))
@@ -54,6 +54,9 @@ TL_CP_GET(_offsets) {
 
    _current_number = 0;
    _max_offset = 0LL;
+   _first_offset = _scanner->tell();
+   _index_complete = false;
+   _innerBufferOffset = 0LL;
    _offsets.clear();
 }
 
@@ -67,11 +70,15 @@ bool RdfLoader::isEOF() {
 }
 
 int RdfLoader::count () {
-   long long offset = _scanner->tell();
+   if (_index_complete)
+      return _offsets.size();
+
+   long long offset = _nextRecordOffset();
    int cn = _current_number;
 
    if (offset != _max_offset) {
       _scanner->seek(_max_offset, SEEK_SET);
+      _innerBuffer.clear();
       _current_number = _offsets.size();
    }
 
@@ -79,9 +86,11 @@ int RdfLoader::count () {
       readNext();
 
    int res = _current_number;
+   _index_complete = true;
 
    if (res != cn) {
       _scanner->seek(offset, SEEK_SET);
+      _innerBuffer.clear();
       _current_number = cn;
    }
 
@@ -98,7 +107,7 @@ void RdfLoader::readNext() {
       throw Error("end of stream");
 
    _offsets.expand(_current_number + 1);
-   _offsets[_current_number++] = _scanner->tell();
+   _offsets[_current_number++] = _nextRecordOffset();
 
    /*
     * Read data
@@ -147,7 +156,7 @@ void RdfLoader::readNext() {
       if(data.size() > MAX_DATA_SIZE)
          throw Error("data size exceeded the acceptable size %d bytes, Please check for correct file format", MAX_DATA_SIZE);
 
-   } while(_readLine(_getScanner(), _innerBuffer));
+   } while(_readInnerLine());
 
    /*
     * Current value for property reading
@@ -207,10 +216,10 @@ void RdfLoader::readNext() {
          current_datum->appendString(_innerBuffer.ptr(), true);
       }
       
-   } while(_readLine(_getScanner(), _innerBuffer));
+   } while(_readInnerLine());
 
-   if (_scanner->tell() > _max_offset)
-      _max_offset = _scanner->tell();
+   if (_nextRecordOffset() > _max_offset)
+      _max_offset = _nextRecordOffset();
 }
 
 Scanner& RdfLoader::_getScanner() const {
@@ -261,6 +270,15 @@ bool RdfLoader::_readIdentifiers(bool from_begin) {
    return result;
 }
 
+bool RdfLoader::_readInnerLine() {
+   _innerBufferOffset = _scanner->tell();
+   return _readLine(*_scanner, _innerBuffer);
+}
+
+long long RdfLoader::_nextRecordOffset() const {
+   return _innerBuffer.size() > 0 ? _innerBufferOffset : _scanner->tell();
+}
+
 bool RdfLoader::_readLine(Scanner& scanner, Array<char>& buffer) {
    buffer.clear();
    if(scanner.isEOF())
@@ -282,12 +300,17 @@ void RdfLoader::readAt (int index)
    if (index < _offsets.size())
    {
       _scanner->seek(_offsets[index], SEEK_SET);
+      _innerBuffer.clear();
       _current_number = index;
       readNext();
    }
    else
    {
+      if (_index_complete)
+         throw Error("No such record index: %d", index);
+
       _scanner->seek(_max_offset, SEEK_SET);
+      _innerBuffer.clear();
       if (_scanner->isEOF()) {
          throw Error("No such record index: %d", index);
       }
@@ -299,3 +322,135 @@ void RdfLoader::readAt (int index)
       } while (index + 1 != _offsets.size());
    }
 }
+
+namespace {
+   /*
+    * Record boundaries as readNext() finds them: a record begins with a
+    * $MFMT or $RFMT line, unless there is no data in the current one yet
+    */
+   class RdfSplitter : public RecordSplitter {
+   public:
+      virtual bool skipRecord(const char *data, long long size, long long &pos) const {
+         if (pos >= size)
+            return false;
+
+         long long line_end;
+         long long p = pos;
+         long long next = _nextLine(data, size, p, line_end);
+
+         /*
+          * The header of the next record is read ahead with the previous
+          * record, readNext() is not called if the header is the last line
+          */
+         if (pos > 0 && next == size && _isHeader(data + p, line_end - p))
+            return false;
+
+         bool have_data = false;
+         bool in_properties = false;
+
+         while (p < size) {
+            next = _nextLine(data, size, p, line_end);
+
+            const char *line = data + p;
+            long long length = line_end - p;
+
+            if (_isHeader(line, length)) {
+               if (in_properties || have_data)
+                  break;
+            } else if (!in_properties) {
+               if (_startsWith(line, length, "$DTYPE"))
+                  in_properties = true;
+               else if (!_startsWith(line, length, "$RDFILE") && !_startsWith(line, length, "$DATM") &&
+                        !_isIdentifiers(line, length))
+                  have_data = true;
+            }
+            p = next;
+         }
+
+         pos = p;
+         return true;
+      }
+
+      virtual long long findRecordStart(const char *data, long long size, long long pos) const {
+         long long line_end;
+         long long p = _nextLine(data, size, pos, line_end);
+
+         while (p < size) {
+            long long next = _nextLine(data, size, p, line_end);
+
+            if (_isHeader(data + p, line_end - p))
+               return p;
+            p = next;
+         }
+         return size;
+      }
+
+   private:
+      static bool _isHeader(const char *line, long long length) {
+         return _startsWith(line, length, "$MFMT") || _startsWith(line, length, "$RFMT");
+      }
+
+      /*
+       * See _readIdentifiers(): the line is skipped if it starts with a
+       * registry number
+       */
+      static bool _isIdentifiers(const char *line, long long length) {
+         long long begin = 0;
+
+         while (begin < length && isspace((unsigned char)line[begin]))
+            begin++;
+
+         long long end = begin;
+
+         while (end < length && !isspace((unsigned char)line[end]))
+            end++;
+
+         static const char *words[] = {"$MIREG", "$RIREG", "$MEREG", "$REREG"};
+
+         for (int i = 0; i < NELEM(words); i++)
+            if (end - begin == (long long)strlen(words[i]) && strncmp(line + begin, words[i], end - begin) == 0)
+               return true;
+         return false;
+      }
+   };
+}
+
+void RdfLoader::buildIndex(int threads) {
+   if (_index_complete)
+      return;
+
+   long long size = 0;
+   const char *data = _ownScanner ? 0 : RecordIndex::getData(*_scanner, _first_offset, size);
+
+   if (data == 0) {
+      count();
+      return;
+   }
+
+   RecordIndex::build(data, size, _first_offset, RdfSplitter(), threads, _offsets, _max_offset);
+   _index_complete = true;
+}
+
+bool RdfLoader::isIndexComplete() {
+   return _index_complete;
+}
+
+void RdfLoader::saveIndex(Output &output, const RecordIndex::Source &source) {
+   if (!_index_complete)
+      throw Error("saveIndex(): the record offsets are not known yet");
+
+   RecordIndex::save(output, source, _offsets, _max_offset);
+}
+
+void RdfLoader::loadIndex(Scanner &input, const RecordIndex::Source &source) {
+   QS_DEF(Array<long long>, offsets);
+   long long end;
+
+   RecordIndex::load(input, source, offsets, end);
+   if (offsets.size() > 0 && offsets[0] != _first_offset)
+      throw Error("the record index does not match the input");
+
+   _offsets.swap(offsets);
+   _max_offset = end;
+   _index_complete = true;
+}
@@ -52,6 +52,8 @@ TL_CP_GET(_preread)
    }
    _current_number = 0;
    _max_offset = 0LL;
+   _first_offset = _scanner->tell();
+   _index_complete = false;
    _offsets.clear();
    _preread.clear();
 }
@@ -62,6 +64,13 @@ SdfLoader::~SdfLoader()
       delete _scanner;
 }
 
+GZipScanner * SdfLoader::getGZipScanner ()
+{
+   if (!_own_scanner)
+      return 0;
+   return (GZipScanner *)_scanner;
+}
+
 long long SdfLoader::tell ()
 {
    return _scanner->tell();
@@ -74,6 +83,9 @@ int SdfLoader::currentNumber ()
 
 int SdfLoader::count ()
 {
+   if (_index_complete)
+      return _offsets.size();
+
    long long offset = _scanner->tell();
    int cn = _current_number;
 
@@ -88,6 +100,7 @@ int SdfLoader::count ()
       readNext();
 
    int res = _current_number;
+   _index_complete = true;
 
    if (res != cn)
    {
@@ -162,31 +175,18 @@ void SdfLoader::readNext ()
 
       output.writeStringCR(str.ptr());
 
-      BufferScanner ws(str.ptr());
-
-      while (!ws.isEOF())
-         if (ws.readChar() == '<')
-            break;
+      // The property name is the text between the first '<' and the
+      // following '>'
+      const char *name_begin = strchr(str.ptr(), '<');
+      const char *name_end = (name_begin != 0) ? strchr(name_begin + 1, '>') : 0;
 
       QS_DEF(Array<char>, word);
-      bool have_word = false;
 
       word.clear();
 
-      while (!ws.isEOF())
-      {
-         char c = ws.readChar();
-
-         if (c == '>')
-         {
-            have_word = true;
-            break;
-         }
-         word.push(c);
-      }
-
-      if (have_word && word.size() > 0)
+      if (name_end != 0 && name_end > name_begin + 1)
       {
+         word.copy(name_begin + 1, (int)(name_end - name_begin - 1));
          word.push(0);
 
 
@@ -236,6 +236,9 @@ void SdfLoader::readAt (int index)
    }
    else
    {
+      if (_index_complete)
+         throw Error("No such record index: %d", index);
+
       _scanner->seek(_max_offset, SEEK_SET);
       if (_scanner->isEOF()) {
          throw Error("No such record index: %d", index);
@@ -249,3 +252,147 @@ void SdfLoader::readAt (int index)
       } while (index + 1 != _offsets.size());
    }
 }
+
+namespace
+{
+   // Record boundaries as readNext() finds them: a record ends with the
+   // "$$$$" line, unless the line is a value of a data item
+   class SdfSplitter : public RecordSplitter
+   {
+   public:
+      virtual bool skipRecord (const char *data, long long size, long long &pos) const
+      {
+         long long p = pos;
+
+         // Blank characters before the end of the file are not a record,
+         // see isEOF()
+         while (p < size && isspace((unsigned char)data[p]))
+            p++;
+         if (p == size)
+            return false;
+
+         const char *line;
+         long long length;
+
+         do
+         {
+            p = _readLine(data, size, p, line, length);
+            if (length > 0 && line[0] == '>')
+               break;
+            if (_startsWith(line, length, "$$$$"))
+               break;
+         } while (p < size);
+
+         while (1)
+         {
+            if (_startsWith(line, length, "$$$$"))
+               break;
+
+            if (_isDataHeader(line, length))
+            {
+               // readNext() fails on the missing value, the record ends here
+               if (p == size)
+                  break;
+
+               p = _readLine(data, size, p, line, length);
+               while (length > 0 && p < size)
+                  p = _readLine(data, size, p, line, length);
+            }
+
+            if (p == size)
+               break;
+
+            p = _readLine(data, size, p, line, length);
+         }
+
+         pos = p;
+         return true;
+      }
+
+      virtual long long findRecordStart (const char *data, long long size, long long pos) const
+      {
+         long long line_end;
+         long long p = _nextLine(data, size, pos, line_end);
+
+         while (p < size)
+         {
+            long long next = _nextLine(data, size, p, line_end);
+
+            if (_startsWith(data + p, line_end - p, "$$$$"))
+               return next;
+            p = next;
+         }
+         return size;
+      }
+
+   private:
+      static long long _readLine (const char *data, long long size, long long pos,
+                                  const char * &line, long long &length)
+      {
+         long long line_end;
+         long long next = _nextLine(data, size, pos, line_end);
+
+         line = data + pos;
+         length = line_end - pos;
+         return next;
+      }
+
+      // "<name>" somewhere in the line
+      static bool _isDataHeader (const char *line, long long length)
+      {
+         const char *name_begin = (const char *)memchr(line, '<', (size_t)length);
+
+         if (name_begin == 0)
+            return false;
+
+         const char *name_end = (const char *)memchr(name_begin + 1, '>', (size_t)(line + length - name_begin - 1));
+
+         return name_end != 0 && name_end > name_begin + 1;
+      }
+   };
+}
+
+void SdfLoader::buildIndex (int threads)
+{
+   if (_index_complete)
+      return;
+
+   long long size = 0;
+   const char *data = _own_scanner ? 0 : RecordIndex::getData(*_scanner, _first_offset, size);
+
+   if (data == 0)
+   {
+      count();
+      return;
+   }
+
+   RecordIndex::build(data, size, _first_offset, SdfSplitter(), threads, _offsets, _max_offset);
+   _index_complete = true;
+}
+
+bool SdfLoader::isIndexComplete ()
+{
+   return _index_complete;
+}
+
+void SdfLoader::saveIndex (Output &output, const RecordIndex::Source &source)
+{
+   if (!_index_complete)
+      throw Error("saveIndex(): the record offsets are not known yet");
+
+   RecordIndex::save(output, source, _offsets, _max_offset);
+}
+
+void SdfLoader::loadIndex (Scanner &input, const RecordIndex::Source &source)
+{
+   QS_DEF(Array<long long>, offsets);
+   long long end;
+
+   RecordIndex::load(input, source, offsets, end);
+   if (offsets.size() > 0 && offsets[0] != _first_offset)
+      throw Error("the record index does not match the input");
+
+   _offsets.swap(offsets);
+   _max_offset = end;
+   _index_complete = true;
+}
@@ -93,6 +93,13 @@ public:
 
    AromaticityOptions arom_options;
 
+   /*
+    * Threads and time limit (ms) of the exact MCS search for every pair of molecules.
+    * On the time limit the best of the exact solutions found by then and the approximate ones is taken
+    */
+   int mcs_threads;
+   int mcs_timeout;
+
    DECL_ERROR;
 
    CancellationHandler* cancellation;
@@ -78,6 +78,14 @@ public:
    int max_deep_level;
    int max_product_count;
    int max_reuse_count;
+
+   // If set, the first reactants are matched with these monomers only, one
+   // monomer per reactant in the order of the reactants
+   const Array<int> *first_monomers;
+
+   // If set, receives the canonical SMILES of the product before product_proc
+   // is called, or is cleared if the products are not checked for duplicates
+   Array<char> *product_smiles;
    
    ReactionEnumeratorState(ReactionEnumeratorContext &context, QueryReaction &cur_reaction, QueryMolecule &cur_full_product, 
       Array<int> &cur_product_aam_array, RedBlackStringMap<int> &cur_smiles_array, 
@@ -52,6 +52,19 @@ public:
    int getMonomersCount( int reactant_idx );
 
    void buildProducts( void );
+
+   // The products can also be built by parts, the parts are independent and
+   // can be built by separate enumerators with the same reaction and
+   // monomers, e.g. in different threads. A part fixes the monomers of the
+   // first reactants, so every part holds only its own products, and the
+   // products are unique within a part only. max_product_count is the limit
+   // for a part.
+   long long partsCount( void );
+   void buildPart( long long part );
+
+   // Canonical SMILES of the product passed to product_proc, empty if the
+   // products are not checked for duplicates
+   const char * productSmiles( void );
    
    // This callback should be used for validation and refining of the results of applying the pattern.
    // uncleaned_fragments: the molecule before applying the reaction (with aromatization and unfolded hydrogens)
@@ -67,15 +80,22 @@ public:
 
 private:
    bool _is_rg_exist;
+   bool _is_prepared;
    int _product_count;
    QueryReaction &_reaction;
    ReactionEnumeratorState::ReactionMonomers _reaction_monomers;
+   QueryMolecule _all_products;
+   Array<int> _part_monomers;
+   Array<char> _product_smiles;
    CP_DECL;
    TL_CP_DECL(Array<int>, _product_aam_array);
    TL_CP_DECL(RedBlackStringMap<int>, _smiles_array);
    TL_CP_DECL(ObjArray< Array<int> >, _tubes_monomers);
 
-   void _buildTubesGrid( void );
+   void _prepare( void );
+   void _partDigits( ObjArray< Array<int> > &digits );
+   void _build( const Array<int> *first_monomers );
+   void _buildTubesGrid( const Array<int> *fixed_monomers );
 };
 
 }
@@ -32,6 +32,8 @@ ignore_atom_charges(false),
 ignore_atom_valence(false),
 ignore_atom_isotopes(false),
 ignore_atom_radicals(false),
+mcs_threads(0),
+mcs_timeout(0),
 cancellation(nullptr),
 _initReaction(reaction),
 _maxMapUsed(0),
@@ -1430,6 +1432,8 @@ bool RSubstructureMcs::searchMaxCommonSubReact(const Array<int>* in_map, Array<i
       
    MaxCommonSubmolecule mcs(*sub_molecule, *super_molecule);
    mcs.parametersForExact.maxIteration = MAX_ITERATION_NUMBER; 
+   mcs.parametersForExact.threads = _context.mcs_threads;
+   mcs.parametersForExact.timeout = _context.mcs_timeout;
    mcs.conditionVerticesColor = atomConditionReact;
    mcs.conditionEdgeWeight = bondConditionReact;
    mcs.cbSolutionTerm = cbMcsSolutionTerm;  
@@ -1445,15 +1449,9 @@ bool RSubstructureMcs::searchMaxCommonSubReact(const Array<int>* in_map, Array<i
 
     try {
         /*
-         * Search for exact mcs first
+         * Search for exact mcs first, then for approximate mcs if the exact one is stopped
          */
-        mcs.findExactMCS();
-        /*
-         * Search for approximate mcs
-         */
-        if (mcs.parametersForExact.isStopped) {
-            mcs.findApproximateMCS();
-        }
+        mcs.findAnytimeMCS();
     } catch (Exception& e) {
 		if(strstr(e.message(), "input mapping incorrect") != 0)
 			throw e;
@@ -178,6 +178,9 @@ ReactionEnumeratorState::ReactionEnumeratorState(ReactionEnumeratorContext &cont
    max_product_count = 1000;
    max_reuse_count = 10;
 
+   first_monomers = NULL;
+   product_smiles = NULL;
+
    refine_proc = NULL;
    product_proc = NULL;
    userdata = NULL;
@@ -250,6 +253,8 @@ ReactionEnumeratorState::ReactionEnumeratorState( ReactionEnumeratorState &cur_r
    is_transform = cur_rpe_state.is_transform;
    _is_rg_exist = cur_rpe_state._is_rg_exist;
    _is_simple_transform = cur_rpe_state._is_simple_transform;
+   first_monomers = cur_rpe_state.first_monomers;
+   product_smiles = cur_rpe_state.product_smiles;
 
    _is_frag_search = false;
 
@@ -273,12 +278,12 @@ int ReactionEnumeratorState::buildProduct( void )
    if (is_transform)
       return 0;
    
+   int level = _product_monomers.size();
+
    for (int i = 0; i < _reaction_monomers._monomers.size(); i++)
    {
-      QS_DEF(Molecule, ee_monomer);
-      ee_monomer.clear();
-      ee_monomer.clone(_reaction_monomers._monomers[i], NULL, NULL);
-      ee_monomer.cis_trans.build(NULL);
+      if (first_monomers != NULL && level < first_monomers->size() && first_monomers->at(level) != i)
+         continue;
 
       if (!is_one_tube)
          if (!_isMonomerFromCurTube(i))
@@ -288,6 +293,13 @@ int ReactionEnumeratorState::buildProduct( void )
          if ((_reaction_monomers._deep_levels[i] != 0) && (_product_monomers.find(i) != -1))
             continue;
 
+      // The monomer is copied after the checks, most of the monomers are
+      // skipped in the grid mode
+      QS_DEF(Molecule, ee_monomer);
+      ee_monomer.clear();
+      ee_monomer.clone(_reaction_monomers._monomers[i], NULL, NULL);
+      ee_monomer.cis_trans.build(NULL);
+
       ReactionEnumeratorState rpe_state(*this);
 
       rpe_state._deep_level += _reaction_monomers._deep_levels[i];
@@ -378,6 +390,28 @@ bool ReactionEnumeratorState::_isMonomerFromCurTube( int monomer_idx )
          return false;
    }
 
+   /* The grid may hold the tubes of a part only, see
+    * ReactionProductEnumerator::buildPart(), the other monomers are skipped */
+   else if (!is_one_tube && _reaction_monomers._deep_levels[monomer_idx] == 0 && _tubes_monomers.size() > 0)
+   {
+      for (j = 0; j < _tubes_monomers.size(); j++)
+      {
+         if (_tubes_monomers[j].find(monomer_idx) == -1)
+            continue;
+
+         int k;
+
+         for (k = 0; k < _product_monomers.size(); k++)
+            if (_tubes_monomers[j].find(_product_monomers[k]) == -1)
+               break;
+
+         if (k == _product_monomers.size())
+            break;
+      }
+      if (j == _tubes_monomers.size())
+         return false;
+   }
+
    return true;
 }
 
@@ -426,7 +460,12 @@ void ReactionEnumeratorState::_productProcess( void )
       }
       _product_count++;
       _smiles_array.insert(cur_smiles.ptr(), 1);
+
+      if (product_smiles != NULL)
+         product_smiles->copy(cur_smiles);
    }
+   else if (product_smiles != NULL)
+      product_smiles->clear();
 
    for (int i = 0; i < _product_monomers.size(); i++)
    {
@@ -44,6 +44,7 @@ ReactionProductEnumerator::ReactionProductEnumerator( QueryReaction &reaction )
    _tubes_monomers.clear();
    _product_count = 0;
    _is_rg_exist = false;
+   _is_prepared = false;
    refine_proc = 0;
    product_proc = 0;
 }
@@ -51,7 +52,7 @@ ReactionProductEnumerator::ReactionProductEnumerator( QueryReaction &reaction )
 void ReactionProductEnumerator::addMonomer( int reactant_idx, Molecule &monomer )
 {
    _reaction_monomers.addMonomer(reactant_idx, monomer);
-
+   _is_prepared = false;
 }
 
 void ReactionProductEnumerator::clearReactantMonomers( int reactant_idx )
@@ -62,6 +63,8 @@ void ReactionProductEnumerator::clearReactantMonomers( int reactant_idx )
    for (int i = _reaction_monomers._monomers.size() - 1; i >= 0; i--)
       if (_reaction_monomers._reactant_indexes[i] == reactant_idx)
          _reaction_monomers.removeMonomer(i);
+
+   _is_prepared = false;
 }
 
 Molecule & ReactionProductEnumerator::getMonomer( int reactant_idx, int index )
@@ -92,8 +95,136 @@ int ReactionProductEnumerator::getMonomersCount( int reactant_idx )
 
 void ReactionProductEnumerator::buildProducts( void )
 {
-   QS_DEF(QueryMolecule, all_products);
-   all_products.clear();
+   _is_prepared = false;
+   _prepare();
+
+   /* Building of monomer tubes grid */
+   if (!is_one_tube)
+      _buildTubesGrid(NULL);
+
+   _build(NULL);
+}
+
+long long ReactionProductEnumerator::partsCount( void )
+{
+   _prepare();
+
+   QS_DEF(ObjArray< Array<int> >, digits);
+   _partDigits(digits);
+
+   long long parts_count = 1;
+
+   for (int i = 0; i < digits.size(); i++)
+      parts_count *= digits[i].size();
+
+   return parts_count;
+}
+
+void ReactionProductEnumerator::buildPart( long long part )
+{
+   _prepare();
+
+   QS_DEF(ObjArray< Array<int> >, digits);
+   _partDigits(digits);
+
+   if (part < 0 || (digits.size() == 0 && part != 0))
+      throw Error("part %lld is out of range", part);
+
+   if (digits.size() == 0)
+   {
+      buildProducts();
+      return;
+   }
+
+   /* The first digit is the most significant one */
+   _part_monomers.clear_resize(digits.size());
+   for (int i = digits.size() - 1; i >= 0; i--)
+   {
+      int digit_size = digits[i].size();
+
+      _part_monomers[i] = digits[i][(int)(part % digit_size)];
+      part /= digit_size;
+   }
+
+   if (part != 0)
+      throw Error("part is out of range");
+
+   if (is_one_tube)
+   {
+      _build(&_part_monomers);
+      return;
+   }
+
+   /* The part is the tubes with the fixed monomers, any reactant of the
+    * reaction may take them */
+   _buildTubesGrid(&_part_monomers);
+   _build(NULL);
+}
+
+const char * ReactionProductEnumerator::productSmiles( void )
+{
+   if (_product_smiles.size() == 0)
+      return "";
+
+   return _product_smiles.ptr();
+}
+
+void ReactionProductEnumerator::_partDigits( ObjArray< Array<int> > &digits )
+{
+   digits.clear();
+
+   /* A multistep reaction adds the products to the monomers, and the self
+    * reaction in one tube may take several reactants from one monomer, the
+    * products are built at once then */
+   if (is_multistep_reaction || (is_one_tube && is_self_react))
+      return;
+
+   int monomers_count = _reaction_monomers.size();
+
+   if (monomers_count == 0)
+      return;
+
+   int fixed_count = _reaction.reactantsCount() - 1;
+
+   if (fixed_count < 1)
+      fixed_count = 1;
+
+   /* In one tube every digit is a monomer taken by one of the first
+    * reactants. In the grid mode it is a monomer of one of the first
+    * reactants: the products are built from the tubes, and a tube holds a
+    * monomer of each reactant, so every product is in one part. */
+   long long parts_count = 1;
+
+   for (int i = _reaction.reactantBegin(); i != _reaction.reactantEnd() && digits.size() < fixed_count;
+            i = _reaction.reactantNext(i))
+   {
+      Array<int> &digit = digits.push();
+
+      for (int j = 0; j < monomers_count; j++)
+         if (is_one_tube || _reaction_monomers._reactant_indexes[j] == i)
+            digit.push(j);
+
+      /* There are no tubes without the monomers of a reactant */
+      if (digit.size() == 0)
+      {
+         digits.clear();
+         return;
+      }
+
+      /* Keeping the count of the parts in a reasonable range */
+      parts_count *= digit.size();
+      if (parts_count > 0x7FFFFFFF)
+      {
+         digits.pop();
+         return;
+      }
+   }
+}
+
+void ReactionProductEnumerator::_prepare( void )
+{
+   if (_is_prepared)
+      return;
 
    for (int i = 0; i < _reaction_monomers.size(); i++)
    {
@@ -104,9 +235,8 @@ void ReactionProductEnumerator::buildProducts( void )
       }
    }
 
-   /* Building of monomer tubes grid */
-   if (!is_one_tube)
-      _buildTubesGrid();
+   _all_products.clear();
+   _product_aam_array.clear();
 
    for (int i = _reaction.productBegin(); i != _reaction.productEnd(); i = _reaction.productNext(i))
    {
@@ -114,21 +244,27 @@ void ReactionProductEnumerator::buildProducts( void )
       QS_DEF(Array<int>, mapping);
       mapping.clear();
 
-      all_products.mergeWithMolecule(product, &mapping);
-      _product_aam_array.expand(all_products.vertexEnd());
+      _all_products.mergeWithMolecule(product, &mapping);
+      _product_aam_array.expand(_all_products.vertexEnd());
       for (int j = product.vertexBegin(); j != product.vertexEnd(); j = product.vertexNext(j))
          _product_aam_array[mapping[j]] = _reaction.getAAM(i, j);
    }
 
-   all_products.cis_trans.build(NULL);
+   _all_products.cis_trans.build(NULL);
+
+   _is_prepared = true;
+}
 
+void ReactionProductEnumerator::_build( const Array<int> *first_monomers )
+{
    _smiles_array.clear();
    _product_count = 0;
+   _product_smiles.clear();
 
    ReactionEnumeratorContext context;
    context.arom_options = arom_options;
 
-   ReactionEnumeratorState rpe_state(context, _reaction, all_products, 
+   ReactionEnumeratorState rpe_state(context, _reaction, _all_products, 
                       _product_aam_array, _smiles_array, _reaction_monomers, 
                       _product_count, _tubes_monomers);
 
@@ -140,54 +276,60 @@ void ReactionProductEnumerator::buildProducts( void )
    rpe_state.max_deep_level = max_deep_level;
    rpe_state.max_product_count = max_product_count;
    rpe_state.is_one_tube = is_one_tube;
+   rpe_state.first_monomers = first_monomers;
+   rpe_state.product_smiles = &_product_smiles;
 
    rpe_state.buildProduct();
+
+   /* A multistep reaction adds its products to the monomers */
+   if (is_multistep_reaction)
+      _is_prepared = false;
 }
 
-void ReactionProductEnumerator::_buildTubesGrid( void )
+void ReactionProductEnumerator::_buildTubesGrid( const Array<int> *fixed_monomers )
 {
+   /* Every tube holds one monomer of each reactant, the monomers of the
+    * reactants listed in fixed_monomers are the only ones of their reactants */
    QS_DEF(ObjArray< Array<int> >, digits);
    digits.clear();
 
-   int digit_idx = 0;
-   int val = 0;
    for (int i = _reaction.reactantBegin(); i != _reaction.reactantEnd(); 
             i = _reaction.reactantNext(i))
    {
-      int monomers_count = getMonomersCount(i);
       Array<int> &new_array = digits.push();
 
-      for (int j = 0; j < monomers_count; j++)
-         new_array.push(val++);
- 
-      digit_idx++;
+      if (fixed_monomers != NULL)
+      {
+         for (int j = 0; j < fixed_monomers->size(); j++)
+            if (_reaction_monomers._reactant_indexes[fixed_monomers->at(j)] == i)
+               new_array.push(fixed_monomers->at(j));
+
+         if (new_array.size() > 0)
+            continue;
+      }
+
+      for (int j = 0; j < _reaction_monomers.size(); j++)
+         if (_reaction_monomers._reactant_indexes[j] == i)
+            new_array.push(j);
    }
 
    int tubes_count = 1;
-   for (int i = _reaction.reactantBegin(); i != _reaction.reactantEnd(); 
-            i = _reaction.reactantNext(i))
-      tubes_count *= getMonomersCount(i);
+   for (int i = 0; i < digits.size(); i++)
+      tubes_count *= digits[i].size();
+
+   _tubes_monomers.clear();
    _tubes_monomers.resize(tubes_count);
 
    for (int i = 0; i < tubes_count; i++)
    {
       int cur_tube_code = i;
-      int code_pos = 0;
-      int dev = 1;
-      for (int j = _reaction.reactantBegin(); j != _reaction.reactantEnd(); 
-               j = _reaction.reactantNext(j))
+
+      for (int j = 0; j < digits.size(); j++)
       {
-         int monomers_count = getMonomersCount(j);
+         int monomers_count = digits[j].size();
          
-         val = cur_tube_code % monomers_count;
+         _tubes_monomers[i].push(digits[j][cur_tube_code % monomers_count]);
          cur_tube_code /= monomers_count;
-
-         _tubes_monomers[i].push(digits[code_pos][val]);
-
-         dev *= getMonomersCount(j);
-         code_pos++;
       }
-         
    }
-
-}
\ No newline at end of file
+}